@@ -10,6 +10,7 @@
 #include <cpu_func.h>
 #include <log.h>
 #include <malloc.h>
+#include <spl.h>
 #include <asm/cache.h>
 #include <asm/global_data.h>
 
@@ -133,6 +134,62 @@ void invalidate_l2_cache(void)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(ENABLE_CACHES)
+__weak ulong spl_alloc_page_tables(ulong size)
+{
+	u64 top;
+
+	if (CONFIG_SPL_PAGE_TABLE_ADDR)
+		return CONFIG_SPL_PAGE_TABLE_ADDR;
+
+	top = (u64)gd->bd->bi_dram[0].start + gd->bd->bi_dram[0].size;
+	/* keep the page tables in the 32-bit address space */
+	if (top > 0x100000000ULL)
+		top = 0x100000000ULL;
+
+	/* round down to next 64 kB limit */
+	return (top - size) & ~(0x10000UL - 1);
+}
+
+uint spl_enable_caches(void)
+{
+	uint caches = 0;
+
+	if (!icache_status()) {
+		icache_enable();
+		caches |= SPL_CACHE_ICACHE;
+	}
+
+	/* The board may have set up the MMU itself, e.g. in SRAM */
+	if (dcache_status())
+		return caches;
+
+	if (!gd->arch.tlb_addr) {
+		if (!CONFIG_SPL_PAGE_TABLE_ADDR && !gd->bd->bi_dram[0].size) {
+			debug("No DRAM bank for page tables, cache stays off\n");
+			return caches;
+		}
+		gd->arch.tlb_size = PGTABLE_SIZE;
+		gd->arch.tlb_addr = spl_alloc_page_tables(gd->arch.tlb_size);
+	}
+	debug("TLB table from %08lx to %08lx\n", gd->arch.tlb_addr,
+	      gd->arch.tlb_addr + gd->arch.tlb_size);
+
+	dcache_enable();
+
+	return caches | SPL_CACHE_DCACHE;
+}
+
+void spl_disable_caches(uint caches)
+{
+	/* Writes back any dirty lines as well */
+	if (caches & SPL_CACHE_DCACHE)
+		dcache_disable();
+	if (caches & SPL_CACHE_ICACHE)
+		icache_disable();
+}
+#endif
+
 int arch_reserve_mmu(void)
 {
 	return arm_reserve_mmu();
@@ -82,6 +82,14 @@ typedef int sandbox_eth_tx_hand_f(struct udevice *dev, void *pkt,
  * recv_packets - number of packets returned
  * tx_handler - function to generate responses to sent packets
  * priv - a pointer to some structure a test may want to keep track of
+ * tx_packet - buffer for gathering a packet sent with send_sg()
+ * tx_sg_packets - number of packets sent with send_sg()
+ * rx_slot - slot from eth_rx_hint_buf() for each of the PKTBUFSRX receive
+ *	buffers which the driver acts as if it had, or NULL
+ * rx_slot_len - number of bytes which may go in each slot
+ * rx_hdr_len - number of bytes of the packet which stay out of each slot
+ * rx_next - receive buffer which the next packet goes to
+ * rx_split_packets - number of packets received with the payload in a slot
  */
 struct eth_sandbox_priv {
 	uchar fake_host_hwaddr[ARP_HLEN];
@@ -92,6 +100,13 @@ struct eth_sandbox_priv {
 	int recv_packets;
 	sandbox_eth_tx_hand_f *tx_handler;
 	void *priv;
+	uchar tx_packet[PKTSIZE_ALIGN];
+	int tx_sg_packets;
+	uchar *rx_slot[PKTBUFSRX];
+	uint rx_slot_len[PKTBUFSRX];
+	uint rx_hdr_len[PKTBUFSRX];
+	int rx_next;
+	int rx_split_packets;
 };
 
 /*
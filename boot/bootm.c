@@ -373,6 +373,57 @@ static int handle_decomp_error(int comp_type, size_t uncomp_size, int ret)
 #endif
 
 #ifndef USE_HOSTCC
+/**
+ * bootm_decomp_inplace() - check if the OS image can be decompressed in place
+ *
+ * This is the case when the compressed data lies inside the output window,
+ * at or beyond the offset needed for in-place decompression. The offset is
+ * taken from the FIT if mkimage recorded it there, otherwise it is worked
+ * out from the header of the compressed data.
+ *
+ * Only the compressed data may be overwritten, so the image must be a legacy
+ * image with a single component, whose header has been copied, or a FIT with
+ * external data, which lies after the FIT structure.
+ *
+ * @images:	Images information
+ * @image_buf:	Compressed data
+ * Return: true if the image can be decompressed in place
+ */
+static bool bootm_decomp_inplace(bootm_headers_t *images, const void *image_buf)
+{
+	image_info_t *os = &images->os;
+	ulong offset;
+	int pos;
+
+	if (os->comp == IH_COMP_NONE || os->image_start <= os->load ||
+	    os->image_start - os->load >= CONFIG_SYS_BOOTM_LEN)
+		return false;
+
+	if (images->legacy_hdr_valid) {
+		if (image_get_type(&images->legacy_hdr_os_copy) ==
+		    IH_TYPE_MULTI)
+			return false;
+	} else if (!CONFIG_IS_ENABLED(FIT) || !images->fit_hdr_os) {
+		return false;
+	} else if (fit_image_get_data_position(images->fit_hdr_os,
+					       images->fit_noffset_os, &pos) &&
+		   fit_image_get_data_offset(images->fit_hdr_os,
+					     images->fit_noffset_os, &pos)) {
+		debug("   data is inside the FIT, cannot decompress in place\n");
+		return false;
+	}
+
+	if (!CONFIG_IS_ENABLED(FIT) || !images->fit_hdr_os ||
+	    fit_image_get_decomp_offset(images->fit_hdr_os,
+					images->fit_noffset_os, &offset)) {
+		if (image_decomp_offset(os->comp, image_buf, os->image_len,
+					&offset))
+			return false;
+	}
+
+	return os->image_start - os->load >= offset;
+}
+
 static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 {
 	image_info_t os = images->os;
@@ -383,12 +434,15 @@ static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 	ulong image_start = os.image_start;
 	ulong image_len = os.image_len;
 	ulong flush_start = ALIGN_DOWN(load, ARCH_DMA_MINALIGN);
-	bool no_overlap;
+	bool no_overlap, inplace, overlap;
 	void *load_buf, *image_buf;
 	int err;
 
 	load_buf = map_sysmem(load, 0);
 	image_buf = map_sysmem(os.image_start, image_len);
+	inplace = bootm_decomp_inplace(images, image_buf);
+	if (inplace)
+		debug("   decompressing in place\n");
 	err = image_decomp(os.comp, load, os.image_start, os.type,
 			   load_buf, image_buf, image_len,
 			   CONFIG_SYS_BOOTM_LEN, &load_end);
@@ -407,7 +461,16 @@ static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 
 	no_overlap = (os.comp == IH_COMP_NONE && load == image_start);
 
-	if (!no_overlap && load < blob_end && load_end > blob_start) {
+	/*
+	 * When decompressing a legacy image in place, only its header lies
+	 * before the data, and that has been copied. External FIT data lies
+	 * after blob_end, so only the FIT structure is checked.
+	 */
+	overlap = load < blob_end && load_end > blob_start;
+	if (inplace && images->legacy_hdr_valid)
+		overlap = false;
+
+	if (!no_overlap && overlap) {
 		debug("images.os.start = 0x%lX, images.os.end = 0x%lx\n",
 		      blob_start, blob_end);
 		debug("images.os.load = 0x%lx, load_end = 0x%lx\n", load,
@@ -449,6 +512,7 @@ ulong bootm_disable_interrupts(void)
 	iflag = disable_interrupts();
 #ifdef CONFIG_NETCONSOLE
 	/* Stop the ethernet stack if NetConsole could have left it up */
+	nc_flush();
 	eth_halt();
 # ifndef CONFIG_DM_ETH
 	eth_unregister(eth_get_dev());
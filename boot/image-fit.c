@@ -478,7 +478,7 @@ void fit_image_print(const void *fit, int image_noffset, const char *p)
 	char *desc;
 	uint8_t type, arch, os, comp;
 	size_t size;
-	ulong load, entry;
+	ulong load, entry, decomp_offset;
 	const void *data;
 	int noffset;
 	int ndepth;
@@ -556,6 +556,10 @@ void fit_image_print(const void *fit, int image_noffset, const char *p)
 			printf("0x%08lx\n", load);
 	}
 
+	if (comp != IH_COMP_NONE &&
+	    !fit_image_get_decomp_offset(fit, image_noffset, &decomp_offset))
+		printf("%s  Decomp Offs:  0x%08lx\n", p, decomp_offset);
+
 	/* optional load address for FDT */
 	if (type == IH_TYPE_FLATDT && !fit_image_get_load(fit, image_noffset, &load))
 		printf("%s  Load Address: 0x%08lx\n", p, load);
@@ -975,6 +979,33 @@ int fit_image_get_data_size(const void *fit, int noffset, int *data_size)
 	return 0;
 }
 
+/**
+ * fit_image_get_decomp_offset() - get the in-place decompression offset
+ * @fit: pointer to the FIT format image header
+ * @noffset: component image node offset
+ * @offset: holds the decomp-offset property
+ *
+ * This is the minimum offset from the load address at which the compressed
+ * data of the image can be placed for it to be decompressed in place. It is
+ * added by mkimage for compression types which support this.
+ *
+ * returns:
+ *     0, on success
+ *     -ENOENT if the property could not be found
+ */
+int fit_image_get_decomp_offset(const void *fit, int noffset, ulong *offset)
+{
+	const fdt32_t *val;
+
+	val = fdt_getprop(fit, noffset, FIT_DECOMP_OFFSET_PROP, NULL);
+	if (!val)
+		return -ENOENT;
+
+	*offset = fdt32_to_cpu(*val);
+
+	return 0;
+}
+
 /**
  * Get 'data-size-unciphered' property from a given image node.
  *
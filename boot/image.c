@@ -428,6 +428,137 @@ int image_decomp_type(const unsigned char *buf, ulong len)
 	return cmagic->comp_id;
 }
 
+#define LZ4F_CONTENT_SIZE	0x08
+
+/* Read a little-endian value of @bytes bytes (at most 8) from @p */
+static uint64_t decomp_get_le(const uint8_t *p, int bytes)
+{
+	uint64_t val = 0;
+
+	while (bytes--)
+		val = (val << 8) | p[bytes];
+
+	return val;
+}
+
+/*
+ * Walk the frames in zstd data, adding up their content sizes and counting
+ * their blocks. Returns -ENODATA if a frame does not record its size.
+ */
+static int decomp_zstd_info(const uint8_t *buf, ulong len, uint64_t *sizep,
+			    ulong *framesp, ulong *blocksp)
+{
+	static const uint8_t dict_id_len[] = { 0, 1, 2, 4 };
+	ulong frames = 0, blocks = 0;
+	uint64_t size = 0;
+	ulong pos = 0;
+
+	while (pos + 8 <= len) {
+		uint32_t magic = decomp_get_le(buf + pos, 4);
+		uint fhd, fcs_len;
+		uint64_t fcs;
+		bool last;
+
+		if ((magic & ~0xfU) == ZSTD_MAGIC_SKIPPABLE_START) {
+			pos += 8 + decomp_get_le(buf + pos + 4, 4);
+			continue;
+		}
+		if (magic != ZSTD_MAGICNUMBER)
+			break;
+
+		fhd = buf[pos + 4];
+		pos += 5;
+		if (!(fhd & 0x20))
+			pos++;			/* window descriptor */
+		pos += dict_id_len[fhd & 3];
+		fcs_len = fhd >> 6 ? 1 << (fhd >> 6) : (fhd >> 5) & 1;
+		if (!fcs_len)
+			return -ENODATA;
+		if (pos + fcs_len > len)
+			return -EINVAL;
+		fcs = decomp_get_le(buf + pos, fcs_len);
+		if (fcs_len == 2)
+			fcs += 256;
+		pos += fcs_len;
+		size += fcs;
+
+		do {
+			uint32_t bh;
+
+			if (pos + 3 > len)
+				return -EINVAL;
+			bh = decomp_get_le(buf + pos, 3);
+			pos += 3;
+			last = bh & 1;
+			/* RLE blocks hold a single byte */
+			pos += ((bh >> 1) & 3) == 1 ? 1 : bh >> 3;
+			blocks++;
+		} while (!last);
+		if (fhd & 0x04)
+			pos += 4;		/* content checksum */
+		frames++;
+	}
+	if (!frames)
+		return -EINVAL;
+	*sizep = size;
+	*framesp = frames;
+	*blocksp = blocks;
+
+	return 0;
+}
+
+int image_decomp_offset(int comp, const void *buf, ulong len, ulong *offsetp)
+{
+	const uint8_t *p = buf;
+	ulong frames, blocks;
+	uint64_t unc_len, margin;
+	int ret;
+
+	/*
+	 * The margin is how far the end of the compressed data must lie past
+	 * the end of the output, so that the decoder never overwrites input
+	 * it has yet to read. The formulae follow those used for in-place
+	 * decompression in Linux and upstream LZ4/zstd.
+	 */
+	switch (comp) {
+	case IH_COMP_LZ4:
+		if (len < 15 || decomp_get_le(p, 4) != LZ4F_MAGIC)
+			return -EINVAL;
+		if (!(p[4] & LZ4F_CONTENT_SIZE))
+			return -ENODATA;
+		unc_len = decomp_get_le(p + 6, 8);
+		/* Room for one block stored uncompressed, plus overrun */
+		margin = (unc_len >> 8) + (1 << (8 + 2 * ((p[5] >> 4) & 7))) +
+			 32;
+		break;
+	case IH_COMP_LZMA:
+		if (len < 13)
+			return -EINVAL;
+		unc_len = decomp_get_le(p + 5, 8);
+		if (unc_len == ~0ULL)
+			return -ENODATA;
+		margin = (unc_len >> 12) + 65536 + 128;
+		break;
+	case IH_COMP_ZSTD:
+		ret = decomp_zstd_info(p, len, &unc_len, &frames, &blocks);
+		if (ret)
+			return ret;
+		margin = frames * (ZSTD_FRAMEHEADERSIZE_MAX + 4) + blocks * 3 +
+			 ZSTD_BLOCKSIZE_ABSOLUTEMAX + 32;
+		break;
+	default:
+		return -EPROTONOSUPPORT;
+	}
+
+	/* Keep the compressed data 8-byte aligned */
+	if (unc_len + margin > len)
+		*offsetp = (unc_len + margin - len + 7) & ~7ULL;
+	else
+		*offsetp = 0;
+
+	return 0;
+}
+
 int image_decomp(int comp, ulong load, ulong image_start, int type,
 		 void *load_buf, void *image_buf, ulong image_len,
 		 uint unc_len, ulong *load_end)
@@ -500,7 +631,7 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 			struct abuf in, out;
 
 			abuf_init_set(&in, image_buf, image_len);
-			abuf_init_set(&in, load_buf, unc_len);
+			abuf_init_set(&out, load_buf, unc_len);
 			ret = zstd_decompress(&in, &out);
 			if (ret >= 0) {
 				image_len = ret;
@@ -83,6 +83,77 @@ int format_mac_pxe(char *outbuf, size_t outbuf_len)
 	return 1;
 }
 
+/**
+ * get_relpath() - get the path of a file relative to the PXE file
+ *
+ * @ctx: PXE context
+ * @file_path: File path (relative to the PXE file)
+ * @relfile: Returns the path to use, at most MAX_TFTP_PATH_LEN bytes long
+ * Returns 0 if OK, -ENAMETOOLONG if the path is too long
+ */
+static int get_relpath(struct pxe_context *ctx, const char *file_path,
+		       char *relfile)
+{
+	size_t path_len;
+
+	if (file_path[0] == '/' && ctx->allow_abs_path)
+		*relfile = '\0';
+	else
+		strncpy(relfile, ctx->bootdir, MAX_TFTP_PATH_LEN);
+
+	path_len = strlen(file_path) + strlen(relfile);
+
+	if (path_len > MAX_TFTP_PATH_LEN) {
+		printf("Base path too long (%s%s)\n", relfile, file_path);
+
+		return -ENAMETOOLONG;
+	}
+
+	strcat(relfile, file_path);
+
+	return 0;
+}
+
+static void pxe_prefetch_clear(struct pxe_context *ctx)
+{
+	int i;
+
+	for (i = 0; i < ctx->prefetch_count; i++)
+		free(ctx->prefetch[i].path);
+	ctx->prefetch_count = 0;
+}
+
+/**
+ * pxe_take_prefetched() - check if a file has already been read
+ *
+ * Each file read by label_prefetch() is only used once, since the memory
+ * it was loaded to may be used for something else afterwards.
+ *
+ * @ctx: PXE context
+ * @relfile: Path of the file
+ * @file_addr: Address the file is wanted at
+ * @sizep: Returns the size of the file in bytes
+ * Returns true if the file is already at @file_addr
+ */
+static bool pxe_take_prefetched(struct pxe_context *ctx, const char *relfile,
+				ulong file_addr, ulong *sizep)
+{
+	struct pxe_file *file;
+
+	for (file = ctx->prefetch; file < ctx->prefetch + ctx->prefetch_count;
+	     file++) {
+		if (!file->path || file->err || file->addr != file_addr ||
+		    strcmp(file->path, relfile))
+			continue;
+		*sizep = file->size;
+		free(file->path);
+		file->path = NULL;
+		return true;
+	}
+
+	return false;
+}
+
 /**
  * get_relfile() - read a file relative to the PXE file
  *
@@ -100,29 +171,23 @@ int format_mac_pxe(char *outbuf, size_t outbuf_len)
 static int get_relfile(struct pxe_context *ctx, const char *file_path,
 		       unsigned long file_addr, ulong *filesizep)
 {
-	size_t path_len;
 	char relfile[MAX_TFTP_PATH_LEN + 1];
 	char addr_buf[18];
 	ulong size;
 	int ret;
 
-	if (file_path[0] == '/' && ctx->allow_abs_path)
-		*relfile = '\0';
-	else
-		strncpy(relfile, ctx->bootdir, MAX_TFTP_PATH_LEN);
+	ret = get_relpath(ctx, file_path, relfile);
+	if (ret)
+		return ret;
 
-	path_len = strlen(file_path) + strlen(relfile);
-
-	if (path_len > MAX_TFTP_PATH_LEN) {
-		printf("Base path too long (%s%s)\n", relfile, file_path);
+	printf("Retrieving file: %s\n", relfile);
 
-		return -ENAMETOOLONG;
+	if (pxe_take_prefetched(ctx, relfile, file_addr, &size)) {
+		if (filesizep)
+			*filesizep = size;
+		return 1;
 	}
 
-	strcat(relfile, file_path);
-
-	printf("Retrieving file: %s\n", relfile);
-
 	sprintf(addr_buf, "%lx", file_addr);
 
 	ret = ctx->getfile(ctx, relfile, addr_buf, &size);
@@ -467,6 +532,130 @@ skip_overlay:
 }
 #endif
 
+/**
+ * label_fdtdir_file() - work out the device tree file in a label's fdtdir
+ *
+ * @label: Label with an fdtdir
+ * Returns the path of the file, which must be freed, or NULL if out of memory
+ */
+static char *label_fdtdir_file(struct pxe_label *label)
+{
+	char *f1, *f2, *f3, *f4, *slash;
+	char *fdtfile;
+	int len;
+
+	f1 = env_get("fdtfile");
+	if (f1) {
+		f2 = "";
+		f3 = "";
+		f4 = "";
+	} else {
+		/*
+		 * For complex cases where this code doesn't
+		 * generate the correct filename, the board
+		 * code should set $fdtfile during early boot,
+		 * or the boot scripts should set $fdtfile
+		 * before invoking "pxe" or "sysboot".
+		 */
+		f1 = env_get("soc");
+		f2 = "-";
+		f3 = env_get("board");
+		f4 = ".dtb";
+		if (!f1) {
+			f1 = "";
+			f2 = "";
+		}
+		if (!f3) {
+			f2 = "";
+			f3 = "";
+		}
+	}
+
+	len = strlen(label->fdtdir);
+	if (!len)
+		slash = "./";
+	else if (label->fdtdir[len - 1] != '/')
+		slash = "/";
+	else
+		slash = "";
+
+	len = strlen(label->fdtdir) + strlen(slash) +
+		strlen(f1) + strlen(f2) + strlen(f3) +
+		strlen(f4) + 1;
+	fdtfile = malloc(len);
+	if (!fdtfile) {
+		printf("malloc fail (FDT filename)\n");
+		return NULL;
+	}
+
+	snprintf(fdtfile, len, "%s%s%s%s%s%s",
+		 label->fdtdir, slash, f1, f2, f3, f4);
+
+	return fdtfile;
+}
+
+/* Add a file to be read by label_prefetch(), to the address in envaddr_name */
+static void pxe_prefetch_add(struct pxe_context *ctx, const char *file_path,
+			     const char *envaddr_name)
+{
+	char relfile[MAX_TFTP_PATH_LEN + 1];
+	struct pxe_file *file;
+	char *envaddr;
+	ulong addr;
+
+	envaddr = env_get(envaddr_name);
+	if (!envaddr || strict_strtoul(envaddr, 16, &addr) < 0 ||
+	    get_relpath(ctx, file_path, relfile))
+		return;
+
+	file = &ctx->prefetch[ctx->prefetch_count];
+	file->path = strdup(relfile);
+	if (!file->path)
+		return;
+	file->addr = addr;
+	file->size = 0;
+	file->err = -EINPROGRESS;
+	ctx->prefetch_count++;
+}
+
+/**
+ * label_prefetch() - read the files needed to boot a label, all at once
+ *
+ * If the context can read several files together, this reads the initrd,
+ * kernel and device tree of @label as soon as it is chosen, so that
+ * label_boot() finds them already loaded. A file which cannot be read here
+ * is read again in the usual way, which reports any error.
+ *
+ * @ctx: PXE context
+ * @label: Label to be booted
+ */
+static void label_prefetch(struct pxe_context *ctx, struct pxe_label *label)
+{
+	pxe_prefetch_clear(ctx);
+	if (!ctx->getfiles || label->localboot || !label->kernel)
+		return;
+
+	if (label->initrd)
+		pxe_prefetch_add(ctx, label->initrd, "ramdisk_addr_r");
+	pxe_prefetch_add(ctx, label->kernel, "kernel_addr_r");
+	if (env_get("fdt_addr_r")) {
+		if (label->fdt) {
+			pxe_prefetch_add(ctx, label->fdt, "fdt_addr_r");
+		} else if (label->fdtdir) {
+			char *fdtfile = label_fdtdir_file(label);
+
+			if (fdtfile)
+				pxe_prefetch_add(ctx, fdtfile, "fdt_addr_r");
+			free(fdtfile);
+		}
+	}
+
+	/* There is nothing to gain from reading a single file this way */
+	if (ctx->prefetch_count < 2 ||
+	    ctx->getfiles(ctx, ctx->prefetch, ctx->prefetch_count))
+		pxe_prefetch_clear(ctx);
+}
+
 /**
  * label_boot() - Boot according to the contents of a pxe_label
  *
@@ -500,13 +689,13 @@ static int label_boot(struct pxe_context *ctx, struct pxe_label *label)
 	char *fit_addr = NULL;
 	int bootm_argc = 2;
 	int zboot_argc = 3;
-	int len = 0;
 	ulong kernel_addr_r;
 	void *buf;
 
 	label_print(label);
 
 	label->attempted = 1;
+	label_prefetch(ctx, label);
 
 	if (label->localboot) {
 		if (label->localboot_val >= 0)
@@ -631,54 +820,9 @@ static int label_boot(struct pxe_context *ctx, struct pxe_label *label)
 		if (label->fdt) {
 			fdtfile = label->fdt;
 		} else if (label->fdtdir) {
-			char *f1, *f2, *f3, *f4, *slash;
-
-			f1 = env_get("fdtfile");
-			if (f1) {
-				f2 = "";
-				f3 = "";
-				f4 = "";
-			} else {
-				/*
-				 * For complex cases where this code doesn't
-				 * generate the correct filename, the board
-				 * code should set $fdtfile during early boot,
-				 * or the boot scripts should set $fdtfile
-				 * before invoking "pxe" or "sysboot".
-				 */
-				f1 = env_get("soc");
-				f2 = "-";
-				f3 = env_get("board");
-				f4 = ".dtb";
-				if (!f1) {
-					f1 = "";
-					f2 = "";
-				}
-				if (!f3) {
-					f2 = "";
-					f3 = "";
-				}
-			}
-
-			len = strlen(label->fdtdir);
-			if (!len)
-				slash = "./";
-			else if (label->fdtdir[len - 1] != '/')
-				slash = "/";
-			else
-				slash = "";
-
-			len = strlen(label->fdtdir) + strlen(slash) +
-				strlen(f1) + strlen(f2) + strlen(f3) +
-				strlen(f4) + 1;
-			fdtfilefree = malloc(len);
-			if (!fdtfilefree) {
-				printf("malloc fail (FDT filename)\n");
+			fdtfilefree = label_fdtdir_file(label);
+			if (!fdtfilefree)
 				goto cleanup;
-			}
-
-			snprintf(fdtfilefree, len, "%s%s%s%s%s%s",
-				 label->fdtdir, slash, f1, f2, f3, f4);
 			fdtfile = fdtfilefree;
 		}
 
@@ -1588,6 +1732,7 @@ int pxe_setup_ctx(struct pxe_context *ctx, struct cmd_tbl *cmdtp,
 
 void pxe_destroy_ctx(struct pxe_context *ctx)
 {
+	pxe_prefetch_clear(ctx);
 	free(ctx->bootdir);
 }
 
@@ -0,0 +1,215 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * The 'membench' command measures the throughput of the memory and string
+ * functions, comparing them with simple byte-at-a-time loops. This shows what
+ * an architecture-specific or word-at-a-time implementation gains over the
+ * naive one on a particular board, or on the host when run under sandbox.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+#include <time.h>
+#include <linux/compiler.h>
+#include <linux/math64.h>
+
+/*
+ * Reference implementations. The Makefile stops the compiler turning these
+ * loops back into calls to the functions being measured.
+ */
+static noinline void *ref_memcpy(void *dest, const void *src, size_t count)
+{
+	const char *s = src;
+	char *d = dest;
+
+	while (count--)
+		*d++ = *s++;
+
+	return dest;
+}
+
+static noinline void *ref_memmove(void *dest, const void *src, size_t count)
+{
+	const char *s = src + count;
+	char *d = dest + count;
+
+	if (dest <= src)
+		return ref_memcpy(dest, src, count);
+	while (count--)
+		*--d = *--s;
+
+	return dest;
+}
+
+static noinline void *ref_memset(void *s, int c, size_t count)
+{
+	char *d = s;
+
+	while (count--)
+		*d++ = c;
+
+	return s;
+}
+
+static noinline int ref_memcmp(const void *cs, const void *ct, size_t count)
+{
+	const unsigned char *su1 = cs, *su2 = ct;
+	int res = 0;
+
+	for (; count; su1++, su2++, count--) {
+		res = *su1 - *su2;
+		if (res)
+			break;
+	}
+
+	return res;
+}
+
+static noinline void *ref_memchr(const void *s, int c, size_t n)
+{
+	const unsigned char *p = s;
+
+	for (; n; n--, p++) {
+		if (*p == (unsigned char)c)
+			return (void *)p;
+	}
+
+	return NULL;
+}
+
+static noinline size_t ref_strlen(const char *s)
+{
+	const char *sc;
+
+	for (sc = s; *sc; sc++)
+		;
+
+	return sc - s;
+}
+
+/**
+ * enum membench_op - operation being measured
+ *
+ * The source buffer holds @size non-zero bytes followed by a terminator and
+ * the destination buffer is a copy of it, so that the compare, search and
+ * length operations all have to look at every byte.
+ */
+enum membench_op {
+	MEMBENCH_MEMCPY,
+	MEMBENCH_MEMMOVE,
+	MEMBENCH_MEMSET,
+	MEMBENCH_MEMCMP,
+	MEMBENCH_MEMCHR,
+	MEMBENCH_STRLEN,
+
+	MEMBENCH_COUNT,
+};
+
+/* memmove() overlaps by all but this many bytes, keeping the alignment */
+#define MEMBENCH_MOVE_OFS	16
+
+static const char *const membench_name[MEMBENCH_COUNT] = {
+	"memcpy", "memmove", "memset", "memcmp", "memchr", "strlen",
+};
+
+/* Returns something derived from the result so that the call is not dropped */
+static ulong membench_run(enum membench_op op, bool ref, char *dst, char *src,
+			  ulong size)
+{
+	switch (op) {
+	case MEMBENCH_MEMCPY:
+		return (ulong)(ref ? ref_memcpy : memcpy)(dst, src, size);
+	case MEMBENCH_MEMMOVE:
+		/* an overlapping move to a higher address copies backwards */
+		return (ulong)(ref ? ref_memmove : memmove)(dst +
+				MEMBENCH_MOVE_OFS, dst, size - MEMBENCH_MOVE_OFS);
+	case MEMBENCH_MEMSET:
+		return (ulong)(ref ? ref_memset : memset)(dst, 0x5a, size);
+	case MEMBENCH_MEMCMP:
+		return (ref ? ref_memcmp : memcmp)(dst, src, size);
+	case MEMBENCH_MEMCHR:
+		return (ulong)(ref ? ref_memchr : memchr)(src, 0, size);
+	case MEMBENCH_STRLEN:
+		return (ref ? ref_strlen : strlen)(src);
+	default:
+		return 0;
+	}
+}
+
+/* Returns the throughput in MB/s, or 0 if it was too quick to measure */
+static ulong membench_time(enum membench_op op, bool ref, char *dst,
+			   char *src, ulong size, ulong count)
+{
+	static volatile ulong sink;
+	ulong start, us;
+	ulong i;
+
+	/* restore the destination, which memmove() and memset() change */
+	ref_memcpy(dst, src, size + 1);
+
+	start = timer_get_us();
+	for (i = 0; i < count; i++)
+		sink += membench_run(op, ref, dst, src, size);
+	us = timer_get_us() - start;
+	if (!us)
+		return 0;
+
+	return div_u64((u64)size * count, us);
+}
+
+static int do_membench(struct cmd_tbl *cmdtp, int flag, int argc,
+		       char *const argv[])
+{
+	ulong size = 0x100000, count = 16;
+	char *src, *dst;
+	int op;
+
+	if (argc > 3)
+		return CMD_RET_USAGE;
+	if (argc > 1)
+		size = hextoul(argv[1], NULL);
+	if (argc > 2)
+		count = hextoul(argv[2], NULL);
+	if (size <= MEMBENCH_MOVE_OFS || !count)
+		return CMD_RET_USAGE;
+
+	src = malloc(size + 1);
+	dst = malloc(size + 1);
+	if (!src || !dst) {
+		printf("Cannot allocate %lx bytes\n", size);
+		free(src);
+		free(dst);
+		return CMD_RET_FAILURE;
+	}
+	ref_memset(src, 0xa5, size);
+	src[size] = '\0';
+
+	printf("%lx bytes, %lx times\n", size, count);
+	printf("%-8s %10s %10s\n", "", "MB/s", "byte MB/s");
+	for (op = 0; op < MEMBENCH_COUNT; op++) {
+		ulong rate, ref_rate;
+
+		rate = membench_time(op, false, dst, src, size, count);
+		ref_rate = membench_time(op, true, dst, src, size, count);
+		printf("%-8s %10lu %10lu\n", membench_name[op], rate, ref_rate);
+	}
+
+	free(dst);
+	free(src);
+
+	return CMD_RET_SUCCESS;
+}
+
+#ifdef CONFIG_SYS_LONGHELP
+static char membench_help_text[] =
+	"[size [count]]\n"
+	"    - time the memory and string functions over 'size' bytes\n"
+	"      (default 100000), 'count' times (default 10), against\n"
+	"      byte-at-a-time loops";
+#endif
+
+U_BOOT_CMD(
+	membench, 3, 0, do_membench,
+	"measure memory and string function throughput",
+	membench_help_text
+);
@@ -124,6 +124,20 @@ U_BOOT_CMD(
 );
 #endif
 
+#if defined(CONFIG_CMD_WGET)
+static int do_wget(struct cmd_tbl *cmdtp, int flag, int argc,
+		   char *const argv[])
+{
+	return netboot_common(WGET, cmdtp, argc, argv);
+}
+
+U_BOOT_CMD(
+	wget,	3,	1,	do_wget,
+	"boot image via network using HTTP protocol",
+	"[loadAddress] [[hostIPaddr:]path]"
+);
+#endif
+
 static void netboot_update_env(void)
 {
 	char tmp[22];
@@ -496,8 +510,37 @@ static int do_net_list(struct cmd_tbl *cmdtp, int flag, int argc, char *const ar
 	return CMD_RET_SUCCESS;
 }
 
+static int do_net_stats(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	struct eth_stats *stats;
+	struct udevice *dev;
+	struct uclass *uc;
+
+	uclass_id_foreach_dev(UCLASS_ETH, dev, uc) {
+		/* Only probed devices have counters */
+		if (!device_active(dev))
+			continue;
+		if (argc > 1 && strcmp(argv[1], dev->name))
+			continue;
+
+		stats = eth_get_stats(dev);
+		printf("eth%d : %s\n", dev_seq(dev), dev->name);
+		printf("  rx: %lu packets, %llu bytes, %lu errors, %lu dropped, %lu overruns\n",
+		       stats->rx_packets, stats->rx_bytes, stats->rx_errors,
+		       stats->rx_dropped, stats->rx_overruns);
+		printf("  tx: %lu packets, %llu bytes, %lu errors\n",
+		       stats->tx_packets, stats->tx_bytes, stats->tx_errors);
+		printf("  polls: %lu, %lu full, batch %u\n", stats->rx_polls,
+		       stats->rx_full_polls, eth_get_rx_batch(dev));
+	}
+
+	return CMD_RET_SUCCESS;
+}
+
 static struct cmd_tbl cmd_net[] = {
 	U_BOOT_CMD_MKENT(list, 1, 0, do_net_list, "", ""),
+	U_BOOT_CMD_MKENT(stats, 2, 0, do_net_stats, "", ""),
 };
 
 static int do_net(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
@@ -519,8 +562,9 @@ static int do_net(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 }
 
 U_BOOT_CMD(
-	net, 2, 1, do_net,
+	net, 3, 1, do_net,
 	"NET sub-system",
 	"list - list available devices\n"
+	"net stats [dev] - show packet counters of the probed devices\n"
 );
 #endif // CONFIG_DM_ETH
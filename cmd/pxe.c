@@ -8,6 +8,7 @@
 #include <command.h>
 #include <fs.h>
 #include <net.h>
+#include <net/tftp.h>
 
 #include "pxe_utils.h"
 
@@ -43,6 +44,38 @@ static int do_get_tftp(struct pxe_context *ctx, const char *file_path,
 	return 1;
 }
 
+#ifdef CONFIG_TFTP_MULTI
+static int do_get_tftp_files(struct pxe_context *ctx, struct pxe_file *files,
+			     int count)
+{
+	struct tftp_file tfiles[PXE_PREFETCH_MAX];
+	int i;
+
+	if (count > min(PXE_PREFETCH_MAX, TFTP_MULTI_MAX))
+		return -E2BIG;
+
+	for (i = 0; i < count; i++) {
+		tfiles[i].name = files[i].path;
+		tfiles[i].addr = files[i].addr;
+	}
+	if (tftp_get_files(tfiles, count) < 0)
+		return -EIO;
+	for (i = 0; i < count; i++) {
+		files[i].size = tfiles[i].size;
+		files[i].err = tfiles[i].err;
+	}
+
+	return 0;
+}
+#endif
+
+static void pxe_set_getfiles(struct pxe_context *ctx)
+{
+#ifdef CONFIG_TFTP_MULTI
+	ctx->getfiles = do_get_tftp_files;
+#endif
+}
+
 /*
  * Looks for a pxe file with a name based on the pxeuuid environment variable.
  *
@@ -114,6 +147,7 @@ int pxe_get(ulong pxefile_addr_r, char **bootdirp, ulong *sizep)
 	if (pxe_setup_ctx(&ctx, cmdtp, do_get_tftp, NULL, false,
 			  env_get("bootfile")))
 		return -ENOMEM;
+	pxe_set_getfiles(&ctx);
 	/*
 	 * Keep trying paths until we successfully get a file we're looking
 	 * for.
@@ -233,6 +267,7 @@ do_pxe_boot(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 		printf("Out of memory\n");
 		return CMD_RET_FAILURE;
 	}
+	pxe_set_getfiles(&ctx);
 	ret = pxe_process(&ctx, pxefile_addr_r, false);
 	pxe_destroy_ctx(&ctx);
 	if (ret)
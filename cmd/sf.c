@@ -18,6 +18,8 @@
 #include <asm/cache.h>
 #include <jffs2/jffs2.h>
 #include <linux/mtd/mtd.h>
+#include <linux/sizes.h>
+#include <linux/string.h>
 
 #include <asm/io.h>
 #include <dm/device-internal.h>
@@ -154,11 +156,60 @@ static int do_spi_flash_probe(int argc, char *const argv[])
 	return 0;
 }
 
+/*
+ * Upper limit for a run of consecutive sectors which are erased and written
+ * together by 'sf update'
+ */
+#define SF_UPDATE_MAX_RUN	SZ_1M
+
+/**
+ * struct sf_update_run - Consecutive whole sectors waiting to be rewritten
+ *
+ * @offset:	flash offset of the first sector
+ * @len:	number of bytes in the run (a multiple of the sector size)
+ * @buf:	buffer holding the new data for the run
+ */
+struct sf_update_run {
+	u32 offset;
+	size_t len;
+	const char *buf;
+};
+
+/**
+ * Erase and write a pending run of sectors
+ *
+ * The run is erased with a single call so that the flash driver can use its
+ * largest erase commands for aligned blocks instead of one sector at a time.
+ *
+ * @param flash		flash context pointer
+ * @param run		run to flush, emptied by this function
+ * Return: NULL if OK, else a string containing the stage which failed
+ */
+static const char *spi_flash_update_flush(struct spi_flash *flash,
+					  struct sf_update_run *run)
+{
+	size_t len = run->len;
+
+	if (!len)
+		return NULL;
+
+	run->len = 0;
+	if (spi_flash_erase(flash, run->offset, len))
+		return "erase";
+	if (spi_flash_write(flash, run->offset, len, run->buf))
+		return "write";
+
+	return NULL;
+}
+
 /**
  * Write a block of data to SPI flash, first checking if it is different from
  * what is already there.
  *
  * If the data being written is the same, then *skipped is incremented by len.
+ * If the flash is already blank the data is written without erasing. Whole
+ * sectors which need erasing are added to @run and written later, so that
+ * consecutive sectors are erased together.
  *
  * @param flash		flash context pointer
  * @param offset	flash offset to write
@@ -166,11 +217,14 @@ static int do_spi_flash_probe(int argc, char *const argv[])
  * @param buf		buffer to write from
  * @param cmp_buf	read buffer to use to compare data
  * @param skipped	Count of skipped data (incremented by this function)
+ * @param run		pending run of sectors to erase and write
  * Return: NULL if OK, else a string containing the stage which failed
  */
 static const char *spi_flash_update_block(struct spi_flash *flash, u32 offset,
-		size_t len, const char *buf, char *cmp_buf, size_t *skipped)
+		size_t len, const char *buf, char *cmp_buf, size_t *skipped,
+		struct sf_update_run *run)
 {
+	const char *err_oper;
 	char *ptr = (char *)buf;
 
 	debug("offset=%#x, sector_size=%#x, len=%#zx\n",
@@ -183,6 +237,28 @@ static const char *spi_flash_update_block(struct spi_flash *flash, u32 offset,
 		debug("Skip region %x size %zx: no change\n",
 		      offset, len);
 		*skipped += len;
+		return spi_flash_update_flush(flash, run);
+	}
+	/* Queue whole sectors so that they can be erased together */
+	if (len == flash->sector_size && memchr_inv(cmp_buf, 0xff, len)) {
+		if (run->len && run->len < SF_UPDATE_MAX_RUN) {
+			run->len += len;
+			return NULL;
+		}
+		err_oper = spi_flash_update_flush(flash, run);
+		run->offset = offset;
+		run->len = len;
+		run->buf = buf;
+		return err_oper;
+	}
+	err_oper = spi_flash_update_flush(flash, run);
+	if (err_oper)
+		return err_oper;
+	/* Nothing to erase if the region is blank already */
+	if (!memchr_inv(cmp_buf, 0xff, len)) {
+		debug("Skip erase %x size %zx: blank\n", offset, len);
+		if (spi_flash_write(flash, offset, len, buf))
+			return "write";
 		return NULL;
 	}
 	/* Erase the entire sector */
@@ -221,6 +297,7 @@ static int spi_flash_update(struct spi_flash *flash, u32 offset,
 	const ulong start_time = get_timer(0);
 	size_t scale = 1;
 	const char *start_buf = buf;
+	struct sf_update_run run = { 0 };
 	ulong delta;
 
 	if (end - buf >= 200)
@@ -239,8 +316,10 @@ static int spi_flash_update(struct spi_flash *flash, u32 offset,
 				last_update = get_timer(0);
 			}
 			err_oper = spi_flash_update_block(flash, offset, todo,
-					buf, cmp_buf, &skipped);
+					buf, cmp_buf, &skipped, &run);
 		}
+		if (!err_oper)
+			err_oper = spi_flash_update_flush(flash, &run);
 	} else {
 		err_oper = "malloc";
 	}
@@ -548,6 +627,73 @@ static int do_spi_flash_test(int argc, char *const argv[])
 	return 0;
 }
 
+static int do_spi_flash_bench(int argc, char *const argv[])
+{
+	unsigned long offset, len, count = 1;
+	unsigned long i, start_ms, time_ms;
+	uint64_t speed;	/* KiB/s */
+	int bps;	/* Bits per second */
+	char *endp;
+	void *buf;
+	int ret = 0;
+
+	if (argc < 3)
+		return -1;
+	offset = hextoul(argv[1], &endp);
+	if (*argv[1] == 0 || *endp != 0)
+		return -1;
+	len = hextoul(argv[2], &endp);
+	if (*argv[2] == 0 || *endp != 0 || !len)
+		return -1;
+	if (argc > 3) {
+		count = simple_strtoul(argv[3], &endp, 10);
+		if (*argv[3] == 0 || *endp != 0 || !count)
+			return -1;
+	}
+
+	if (offset + len > flash->size) {
+		printf("ERROR: attempting bench past flash size (%#x)\n",
+		       flash->size);
+		return 1;
+	}
+
+	buf = memalign(ARCH_DMA_MINALIGN, len);
+	if (!buf) {
+		printf("Cannot allocate memory (%lu bytes)\n", len);
+		return 1;
+	}
+
+	start_ms = get_timer(0);
+	for (i = 0; i < count; i++) {
+		ret = spi_flash_read(flash, offset, len, buf);
+		if (ret) {
+			printf("Read failed (err = %d)\n", ret);
+			break;
+		}
+	}
+	time_ms = get_timer(start_ms);
+	free(buf);
+	if (ret)
+		return 1;
+
+	/* Too quick for the millisecond timer to give a rate */
+	if (!time_ms) {
+		printf("SF: read %lu x %lu bytes @ %#lx: under 1 ms, use a larger count\n",
+		       count, len, offset);
+		return 0;
+	}
+
+	speed = (uint64_t)len * count * 1000;
+	do_div(speed, time_ms * 1024);
+	bps = speed * 8;
+
+	printf("SF: read %lu x %lu bytes @ %#lx: %lu ms, %d KiB/s %d.%03d Mbps\n",
+	       count, len, offset, time_ms, (int)speed, bps / 1000,
+	       bps % 1000);
+
+	return 0;
+}
+
 static int do_spi_flash(struct cmd_tbl *cmdtp, int flag, int argc,
 			char *const argv[])
 {
@@ -582,6 +728,8 @@ static int do_spi_flash(struct cmd_tbl *cmdtp, int flag, int argc,
 		ret = do_spi_protect(argc, argv);
 	else if (IS_ENABLED(CONFIG_CMD_SF_TEST) && !strcmp(cmd, "test"))
 		ret = do_spi_flash_test(argc, argv);
+	else if (IS_ENABLED(CONFIG_CMD_SF_BENCH) && !strcmp(cmd, "bench"))
+		ret = do_spi_flash_bench(argc, argv);
 	else
 		ret = -1;
 
@@ -614,6 +762,10 @@ static const char long_help[] =
 #ifdef CONFIG_CMD_SF_TEST
 	"\nsf test offset len		- run a very basic destructive test"
 #endif
+#ifdef CONFIG_CMD_SF_BENCH
+	"\nsf bench offset len [count]	- time `count' reads of `len' bytes\n"
+	"					  from `offset' and show the throughput"
+#endif
 #endif /* CONFIG_SYS_LONGHELP */
 	;
 
@@ -10,6 +10,7 @@
 #include <env.h>
 #include <log.h>
 #include <mapmem.h>
+#include <malloc.h>
 #include <net.h>
 #include <stdio_dev.h>
 #include <linux/ctype.h>
@@ -19,6 +20,7 @@
 #include <fdt_support.h>
 #include <exports.h>
 #include <fdtdec.h>
+#include <sort.h>
 
 /**
  * fdt_getprop_u32_default_node - Return a node's property or a default
@@ -383,6 +385,308 @@ void do_fixup_by_compat_u32(void *fdt, const char *compat,
 	do_fixup_by_compat(fdt, compat, prop, &tmp, 4, create);
 }
 
+/* Number of updates a batch has room for when it first allocates */
+#define FDT_BATCH_INITIAL	16
+
+/**
+ * struct fdt_batch_edit - a property update queued in a batch
+ *
+ * @path: Path of the node, or NULL to use @phandle
+ * @phandle: Phandle of the node, if @path is NULL
+ * @prop: Property name
+ * @val: Property value, which also holds @prop and @path
+ * @len: Length of the value in bytes
+ * @create: Create the property if it does not exist
+ * @seq: Position in the batch, which keeps updates to a node in order
+ * @offset: Offset of the node, or -FDT_ERR_... if it was not found
+ */
+struct fdt_batch_edit {
+	char *path;
+	u32 phandle;
+	char *prop;
+	void *val;
+	int len;
+	int create;
+	int seq;
+	int offset;
+};
+
+void fdt_batch_init(struct fdt_batch *batch, void *fdt)
+{
+	memset(batch, '\0', sizeof(*batch));
+	batch->fdt = fdt;
+}
+
+static int fdt_batch_add(struct fdt_batch *batch, const char *path,
+			 u32 phandle, const char *prop, const void *val,
+			 int len, int create)
+{
+	int path_len = path ? strlen(path) + 1 : 0;
+	int prop_len = strlen(prop) + 1;
+	struct fdt_batch_edit *edit;
+	char *buf;
+
+	if (batch->count == batch->size) {
+		int size = batch->size ? batch->size * 2 : FDT_BATCH_INITIAL;
+
+		edit = realloc(batch->edits, size * sizeof(*edit));
+		if (!edit)
+			goto err;
+		batch->edits = edit;
+		batch->size = size;
+	}
+
+	buf = malloc(len + prop_len + path_len);
+	if (!buf)
+		goto err;
+
+	edit = &batch->edits[batch->count];
+	edit->val = buf;
+	memcpy(buf, val, len);
+	edit->prop = buf + len;
+	memcpy(edit->prop, prop, prop_len);
+	edit->path = NULL;
+	if (path) {
+		edit->path = edit->prop + prop_len;
+		memcpy(edit->path, path, path_len);
+	}
+	edit->phandle = phandle;
+	edit->len = len;
+	edit->create = create;
+	edit->seq = batch->count++;
+	edit->offset = -FDT_ERR_NOTFOUND;
+
+	return 0;
+
+err:
+	if (!batch->err)
+		batch->err = -FDT_ERR_NOSPACE;
+
+	return -FDT_ERR_NOSPACE;
+}
+
+int fdt_batch_setprop(struct fdt_batch *batch, const char *path,
+		      const char *prop, const void *val, int len, int create)
+{
+	return fdt_batch_add(batch, path, 0, prop, val, len, create);
+}
+
+int fdt_batch_setprop_phandle(struct fdt_batch *batch, u32 phandle,
+			      const char *prop, const void *val, int len,
+			      int create)
+{
+	return fdt_batch_add(batch, NULL, phandle, prop, val, len, create);
+}
+
+int fdt_batch_setprop_u32(struct fdt_batch *batch, const char *path,
+			  const char *prop, u32 val, int create)
+{
+	fdt32_t tmp = cpu_to_fdt32(val);
+
+	return fdt_batch_setprop(batch, path, prop, &tmp, sizeof(tmp), create);
+}
+
+/*
+ * Look up the node of each update: each path once, and all the phandles in
+ * one walk of the tree
+ */
+static void fdt_batch_resolve(struct fdt_batch *batch)
+{
+	const void *fdt = batch->fdt;
+	struct fdt_batch_edit *edit;
+	int i, j, node, phandles = 0;
+
+	for (i = 0, edit = batch->edits; i < batch->count; i++, edit++) {
+		if (!edit->path) {
+			if (!edit->phandle || edit->phandle == -1U)
+				edit->offset = -FDT_ERR_BADPHANDLE;
+			else
+				phandles++;
+			continue;
+		}
+
+		for (j = 0; j < i; j++) {
+			if (batch->edits[j].path &&
+			    !strcmp(batch->edits[j].path, edit->path))
+				break;
+		}
+		if (j < i)
+			edit->offset = batch->edits[j].offset;
+		else
+			edit->offset = fdt_path_offset(fdt, edit->path);
+	}
+
+	for (node = fdt_next_node(fdt, -1, NULL); node >= 0 && phandles;
+	     node = fdt_next_node(fdt, node, NULL)) {
+		u32 phandle = fdt_get_phandle(fdt, node);
+
+		if (!phandle)
+			continue;
+
+		for (i = 0, edit = batch->edits; i < batch->count; i++, edit++) {
+			if (!edit->path && edit->phandle == phandle &&
+			    edit->offset == -FDT_ERR_NOTFOUND) {
+				edit->offset = node;
+				phandles--;
+			}
+		}
+	}
+}
+
+/* Sort by node, last first, keeping the updates to each node in order */
+static int fdt_batch_compar(const void *p1, const void *p2)
+{
+	const struct fdt_batch_edit *e1 = p1, *e2 = p2;
+
+	if (e1->offset != e2->offset)
+		return e1->offset < e2->offset ? 1 : -1;
+
+	return e1->seq - e2->seq;
+}
+
+/* Check whether libfdt can reuse a name already in the strings block */
+static bool fdt_batch_has_string(const void *fdt, const char *name)
+{
+	const char *strtab = (const char *)fdt + fdt_off_dt_strings(fdt);
+	int len = strlen(name) + 1;
+	int i;
+
+	for (i = 0; i + len <= fdt_size_dt_strings(fdt); i++) {
+		if (!memcmp(strtab + i, name, len))
+			return true;
+	}
+
+	return false;
+}
+
+/* Check whether an update adds a property to its node */
+static bool fdt_batch_creates(const void *fdt,
+			      const struct fdt_batch_edit *edit)
+{
+	return edit->offset >= 0 && edit->create &&
+	       !fdt_get_property(fdt, edit->offset, edit->prop, NULL);
+}
+
+/* Work out how much the updates can grow the tree by */
+static int fdt_batch_space(struct fdt_batch *batch)
+{
+	const void *fdt = batch->fdt;
+	struct fdt_batch_edit *edit;
+	int i, j, len, need = 0;
+
+	for (i = 0, edit = batch->edits; i < batch->count; i++, edit++) {
+		if (edit->offset < 0)
+			continue;
+
+		if (fdt_get_property(fdt, edit->offset, edit->prop, &len)) {
+			need += max(0, ALIGN(edit->len, FDT_TAGSIZE) -
+				    ALIGN(len, FDT_TAGSIZE));
+			continue;
+		}
+		if (!edit->create)
+			continue;
+
+		need += sizeof(struct fdt_property) +
+			ALIGN(edit->len, FDT_TAGSIZE);
+
+		/* Each new name is only added to the strings block once */
+		if (fdt_batch_has_string(fdt, edit->prop))
+			continue;
+		for (j = 0; j < i; j++) {
+			if (fdt_batch_creates(fdt, &batch->edits[j]) &&
+			    !strcmp(batch->edits[j].prop, edit->prop))
+				break;
+		}
+		if (j == i)
+			need += strlen(edit->prop) + 1;
+	}
+
+	return need;
+}
+
+/* Apply one update to the node at @edit->offset, reporting any failure */
+static int fdt_batch_setprop_one(void *fdt, struct fdt_batch_edit *edit)
+{
+	int ret = edit->offset;
+
+	debug("Updating property '%s/%s'\n", edit->path, edit->prop);
+	if (ret >= 0) {
+		if (!edit->create &&
+		    !fdt_get_property(fdt, edit->offset, edit->prop, NULL))
+			return 0;
+		ret = fdt_setprop(fdt, edit->offset, edit->prop, edit->val,
+				  edit->len);
+	}
+	if (ret < 0) {
+		if (edit->path)
+			printf("Unable to update property %s:%s, err=%s\n",
+			       edit->path, edit->prop, fdt_strerror(ret));
+		else
+			printf("Unable to update property <%#x>:%s, err=%s\n",
+			       edit->phandle, edit->prop, fdt_strerror(ret));
+	}
+
+	return ret < 0 ? ret : 0;
+}
+
+int fdt_batch_apply(struct fdt_batch *batch)
+{
+	void *fdt = batch->fdt;
+	struct fdt_batch_edit *edit;
+	int i, ret, err = 0;
+
+	if (!batch->count)
+		return batch->err;
+
+	fdt_batch_resolve(batch);
+
+	/*
+	 * If the tree cannot hold every update, fall back to applying them in
+	 * the order they were queued, looking up each node again as separate
+	 * fixups would, so that the ones queued first are the ones which fit
+	 */
+	if (fdt_off_dt_strings(fdt) + fdt_size_dt_strings(fdt) +
+	    fdt_batch_space(batch) > fdt_totalsize(fdt)) {
+		printf("Not enough space in the device tree to batch %d updates\n",
+		       batch->count);
+		for (i = 0, edit = batch->edits; i < batch->count; i++, edit++) {
+			if (edit->path)
+				edit->offset = fdt_path_offset(fdt, edit->path);
+			else if (edit->offset >= 0)
+				edit->offset = fdt_node_offset_by_phandle(fdt,
+							edit->phandle);
+			ret = fdt_batch_setprop_one(fdt, edit);
+			if (ret && !err)
+				err = ret;
+		}
+
+		return batch->err ? batch->err : err;
+	}
+
+	/*
+	 * Updating a node only moves the nodes after it, so going backwards
+	 * keeps the offsets of the nodes still to be updated
+	 */
+	qsort(batch->edits, batch->count, sizeof(*edit), fdt_batch_compar);
+	for (i = 0, edit = batch->edits; i < batch->count; i++, edit++) {
+		ret = fdt_batch_setprop_one(fdt, edit);
+		if (ret && !err)
+			err = ret;
+	}
+
+	return batch->err ? batch->err : err;
+}
+
+void fdt_batch_free(struct fdt_batch *batch)
+{
+	int i;
+
+	for (i = 0; i < batch->count; i++)
+		free(batch->edits[i].val);
+	free(batch->edits);
+	fdt_batch_init(batch, batch->fdt);
+}
+
 #ifdef CONFIG_ARCH_FIXUP_FDT_MEMORY
 /*
  * fdt_pack_reg - pack address and size array into the "reg"-suitable stream
@@ -531,34 +835,30 @@ int fdt_fixup_memory(void *blob, u64 start, u64 size)
 
 void fdt_fixup_ethernet(void *fdt)
 {
-	int i = 0, j, prop;
+	struct fdt_batch batch;
+	int i = 0, j;
 	char *tmp, *end;
 	char mac[16];
 	const char *path;
 	unsigned char mac_addr[ARP_HLEN];
-	int offset;
+	int aliases, offset;
 #ifdef FDT_SEQ_MACADDR_FROM_ENV
 	int nodeoff;
 	const struct fdt_property *fdt_prop;
 #endif
 
-	if (fdt_path_offset(fdt, "/aliases") < 0)
+	aliases = fdt_path_offset(fdt, "/aliases");
+	if (aliases < 0)
 		return;
 
-	/* Cycle through all aliases */
-	for (prop = 0; ; prop++) {
+	/*
+	 * Cycle through all aliases. The updates are batched, so the tree
+	 * does not change under the loop.
+	 */
+	fdt_batch_init(&batch, fdt);
+	fdt_for_each_property_offset(offset, fdt, aliases) {
 		const char *name;
 
-		/* FDT might have been edited, recompute the offset */
-		offset = fdt_first_property_offset(fdt,
-			fdt_path_offset(fdt, "/aliases"));
-		/* Select property number 'prop' */
-		for (j = 0; j < prop; j++)
-			offset = fdt_next_property_offset(fdt, offset);
-
-		if (offset < 0)
-			break;
-
 		path = fdt_getprop_by_offset(fdt, offset, &name, NULL);
 		if (!strncmp(name, "ethernet", 8)) {
 			/* Treat plain "ethernet" same as "ethernet0". */
@@ -599,12 +899,14 @@ void fdt_fixup_ethernet(void *fdt)
 					tmp = (*end) ? end + 1 : end;
 			}
 
-			do_fixup_by_path(fdt, path, "mac-address",
-					 &mac_addr, 6, 0);
-			do_fixup_by_path(fdt, path, "local-mac-address",
-					 &mac_addr, 6, 1);
+			fdt_batch_setprop(&batch, path, "mac-address",
+					  &mac_addr, 6, 0);
+			fdt_batch_setprop(&batch, path, "local-mac-address",
+					  &mac_addr, 6, 1);
 		}
 	}
+	fdt_batch_apply(&batch);
+	fdt_batch_free(&batch);
 }
 
 int fdt_record_loadable(void *blob, u32 index, const char *name,
@@ -2014,6 +2316,113 @@ int fdt_fixup_display(void *blob, const char *path, const char *display)
 }
 
 #ifdef CONFIG_OF_LIBFDT_OVERLAY
+/*
+ * Resolve the references of one __fixups__ property of @fdto. They all
+ * point at the same label, so the base tree is searched for it once, and
+ * consecutive references from the same overlay node share a path lookup.
+ */
+static int fdt_overlay_fixup_label(void *fdt, void *fdto, int symbols_off,
+				   int property)
+{
+	const char *value, *label, *symbol_path;
+	const char *path = NULL;
+	int len, path_len = 0;
+	int node = 0, ret;
+	fdt32_t phandle = 0;
+
+	value = fdt_getprop_by_offset(fdto, property, &label, &len);
+	if (!value)
+		return len == -FDT_ERR_NOTFOUND ? -FDT_ERR_INTERNAL : len;
+
+	do {
+		const char *end, *name, *sep;
+		char *endptr;
+		ulong poffset;
+
+		/* Each reference is "path:property:offset" */
+		end = memchr(value, '\0', len);
+		if (!end)
+			return -FDT_ERR_BADOVERLAY;
+		sep = memchr(value, ':', end - value);
+		if (!sep || sep + 1 == end)
+			return -FDT_ERR_BADOVERLAY;
+		name = sep + 1;
+		sep = memchr(name, ':', end - name);
+		if (!sep || sep == name)
+			return -FDT_ERR_BADOVERLAY;
+		poffset = simple_strtoul(sep + 1, &endptr, 10);
+		if (*endptr || endptr == sep + 1)
+			return -FDT_ERR_BADOVERLAY;
+
+		if (!phandle) {
+			if (symbols_off < 0)
+				return symbols_off;
+			symbol_path = fdt_getprop(fdt, symbols_off, label, &ret);
+			if (!symbol_path)
+				return ret;
+			ret = fdt_path_offset(fdt, symbol_path);
+			if (ret < 0)
+				return ret;
+			phandle = cpu_to_fdt32(fdt_get_phandle(fdt, ret));
+			if (!phandle)
+				return -FDT_ERR_NOTFOUND;
+		}
+
+		/* Updating a value in place moves nothing in the overlay */
+		if (!path || name - 1 - value != path_len ||
+		    memcmp(value, path, path_len)) {
+			path = value;
+			path_len = name - 1 - value;
+			node = fdt_path_offset_namelen(fdto, path, path_len);
+			if (node == -FDT_ERR_NOTFOUND)
+				return -FDT_ERR_BADOVERLAY;
+			if (node < 0)
+				return node;
+		}
+
+		ret = fdt_setprop_inplace_namelen_partial(fdto, node, name,
+							  sep - name, poffset,
+							  &phandle,
+							  sizeof(phandle));
+		if (ret)
+			return ret;
+
+		len -= end - value + 1;
+		value = end + 1;
+	} while (len > 0);
+
+	return 0;
+}
+
+/*
+ * Resolve the __fixups__ of @fdto against @fdt before handing it to
+ * fdt_overlay_apply(), which would search the base tree again for every
+ * reference. The node is then removed, leaving libfdt nothing to resolve.
+ */
+static int fdt_overlay_fixup_phandles(void *fdt, void *fdto)
+{
+	int fixups_off, symbols_off, property, ret;
+
+	fixups_off = fdt_path_offset(fdto, "/__fixups__");
+	if (fixups_off == -FDT_ERR_NOTFOUND)
+		return 0;
+	if (fixups_off < 0)
+		return fixups_off;
+
+	symbols_off = fdt_path_offset(fdt, "/__symbols__");
+	if (symbols_off < 0 && symbols_off != -FDT_ERR_NOTFOUND)
+		return symbols_off;
+
+	fdt_for_each_property_offset(property, fdto, fixups_off) {
+		ret = fdt_overlay_fixup_label(fdt, fdto, symbols_off,
+					      property);
+		if (ret)
+			return ret;
+	}
+
+	return fdt_del_node(fdto, fixups_off);
+}
+
 /**
  * fdt_overlay_apply_verbose - Apply an overlay with verbose error reporting
  *
@@ -2031,7 +2440,9 @@ int fdt_overlay_apply_verbose(void *fdt, void *fdto)
 	err = fdt_path_offset(fdt, "/__symbols__");
 	has_symbols = err >= 0;
 
-	err = fdt_overlay_apply(fdt, fdto);
+	err = fdt_overlay_fixup_phandles(fdt, fdto);
+	if (!err)
+		err = fdt_overlay_apply(fdt, fdto);
 	if (err < 0) {
 		printf("failed on fdt_overlay_apply(): %s\n",
 				fdt_strerror(err));
@@ -101,6 +101,45 @@ enum log_level_t log_get_level_by_name(const char *name)
 	return LOGL_NONE;
 }
 
+int log_format_header(const struct log_rec *rec, char *buf, int size)
+{
+	int fmt = gd->log_fmt;
+	int len = 0;
+
+	/*
+	 * The output format is designed to give someone a fighting chance of
+	 * figuring out which field is which:
+	 *    - level is in CAPS
+	 *    - cat is lower case and ends with comma
+	 *    - file normally has a .c extension and ends with a colon
+	 *    - line is integer and ends with a -
+	 *    - function is an identifier and ends with ()
+	 *    - message has a space before it unless it is on its own
+	 */
+	if (!(rec->flags & LOGRECF_CONT) && fmt != BIT(LOGF_MSG)) {
+		if (fmt & BIT(LOGF_LEVEL))
+			len += scnprintf(buf + len, size - len, "%s.",
+					 log_get_level_name(rec->level));
+		if (fmt & BIT(LOGF_CAT))
+			len += scnprintf(buf + len, size - len, "%s,",
+					 log_get_cat_name(rec->cat));
+		if (fmt & BIT(LOGF_FILE))
+			len += scnprintf(buf + len, size - len, "%s:",
+					 rec->file);
+		if (fmt & BIT(LOGF_LINE))
+			len += scnprintf(buf + len, size - len, "%d-",
+					 rec->line);
+		if (fmt & BIT(LOGF_FUNC))
+			len += scnprintf(buf + len, size - len, "%*s()",
+					 CONFIG_LOGF_FUNC_PAD, rec->func);
+		if (fmt & BIT(LOGF_MSG))
+			len += scnprintf(buf + len, size - len, " ");
+	}
+	buf[len] = '\0';
+
+	return len;
+}
+
 struct log_device *log_device_find_by_name(const char *drv_name)
 {
 	struct log_device *ldev;
@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Log to the network console
+ *
+ * Records are only queued here; the network console sends them together with
+ * its other output, so that logging does not wait for the network.
+ */
+
+#include <common.h>
+#include <log.h>
+#include <net.h>
+#include <asm/global_data.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+static int log_nc_emit(struct log_device *ldev, struct log_rec *rec)
+{
+	char header[LOG_HEADER_SIZE];
+	int len;
+
+	len = log_format_header(rec, header, sizeof(header));
+	nc_output(header, len);
+	if (gd->log_fmt & BIT(LOGF_MSG))
+		nc_output(rec->msg, strlen(rec->msg));
+
+	return 0;
+}
+
+LOG_DRIVER(netconsole) = {
+	.name	= "netconsole",
+	.emit	= log_nc_emit,
+	.flags	= LOGDF_ENABLE,
+};
@@ -702,6 +702,7 @@ void board_init_r(gd_t *dummy1, ulong dummy2)
 		BOOT_DEVICE_NONE,
 	};
 	struct spl_image_info spl_image;
+	uint caches = 0;
 	int ret;
 
 	debug(">>" SPL_TPL_PROMPT "board_init_r()\n");
@@ -752,9 +753,12 @@ void board_init_r(gd_t *dummy1, ulong dummy2)
 #endif
 
 	if (IS_ENABLED(CONFIG_SPL_OS_BOOT) || CONFIG_IS_ENABLED(HANDOFF) ||
-	    IS_ENABLED(CONFIG_SPL_ATF))
+	    IS_ENABLED(CONFIG_SPL_ATF) || CONFIG_IS_ENABLED(ENABLE_CACHES))
 		dram_init_banksize();
 
+	if (CONFIG_IS_ENABLED(ENABLE_CACHES))
+		caches = spl_enable_caches();
+
 	bootcount_inc();
 
 	memset(&spl_image, '\0', sizeof(spl_image));
@@ -790,6 +794,14 @@ void board_init_r(gd_t *dummy1, ulong dummy2)
 			       ret);
 	}
 
+	/*
+	 * Turn off the caches which SPL turned on, so that the next image
+	 * starts as it would without them, with everything SPL has written
+	 * in memory
+	 */
+	if (caches)
+		spl_disable_caches(caches);
+
 	switch (spl_image.os) {
 	case IH_OS_U_BOOT:
 		debug("Jumping to %s...\n", spl_phase_name(spl_next_phase()));
@@ -8,15 +8,18 @@
 #include <errno.h>
 #include <fpga.h>
 #include <gzip.h>
+#include <hash.h>
 #include <image.h>
 #include <log.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <memalign.h>
 #include <spl.h>
 #include <sysinfo.h>
 #include <asm/cache.h>
 #include <asm/global_data.h>
 #include <linux/libfdt.h>
+#include <u-boot/zlib.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -218,6 +221,330 @@ static int get_aligned_image_size(struct spl_load_info *info, int data_size,
 	return (data_size + info->bl_len - 1) / info->bl_len;
 }
 
+#if CONFIG_IS_ENABLED(LOAD_FIT_STREAM)
+#define SPL_FIT_STREAM_MAX_HASHES	4
+
+/**
+ * struct spl_fit_stream - state for loading an image in chunks
+ *
+ * @algo:	hash algorithm of each hash node being checked
+ * @hash_ctx:	progressive hash context of each hash node being checked
+ * @hash_node:	FDT offset of each hash node being checked
+ * @nr_hashes:	number of hash nodes being checked
+ * @gzip:	true if the data is gzip-compressed
+ * @done:	true once the end of the compressed stream has been seen
+ * @zs:		zlib stream, used if @gzip is true
+ */
+struct spl_fit_stream {
+	struct hash_algo *algo[SPL_FIT_STREAM_MAX_HASHES];
+	void *hash_ctx[SPL_FIT_STREAM_MAX_HASHES];
+	int hash_node[SPL_FIT_STREAM_MAX_HASHES];
+	int nr_hashes;
+	bool gzip;
+	bool done;
+	z_stream zs;
+};
+
+/*
+ * A key which is required for all images means that each image needs a
+ * signature, and these are checked over the whole of the image data.
+ */
+static bool spl_fit_image_sig_required(const void *key_blob)
+{
+	int key_node, noffset;
+
+	key_node = fdt_subnode_offset(key_blob, 0, FIT_SIG_NODENAME);
+	if (key_node < 0)
+		return false;
+
+	fdt_for_each_subnode(noffset, key_blob, key_node) {
+		const char *required;
+
+		required = fdt_getprop(key_blob, noffset, FIT_KEY_REQUIRED,
+				       NULL);
+		if (required && !strcmp(required, "image"))
+			return true;
+	}
+
+	return false;
+}
+
+static int spl_fit_stream_find_hashes(const void *fit, int node,
+				      struct spl_fit_stream *stream)
+{
+	int noffset, count = 0;
+	int i;
+
+	/* A hash device is given the whole image by calculate_hash() */
+	if (IS_ENABLED(CONFIG_DM_HASH) ||
+	    spl_fit_image_sig_required(gd_fdt_blob()))
+		return -ENOTSUPP;
+
+	fdt_for_each_subnode(noffset, fit, node) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+		const int *ignore;
+		const char *algo;
+		int len;
+
+		if (!strncmp(name, FIT_SIG_NODENAME, strlen(FIT_SIG_NODENAME)))
+			return -ENOTSUPP;
+		if (strncmp(name, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+
+		ignore = fdt_getprop(fit, noffset, FIT_IGNORE_PROP, &len);
+		if (ignore && len == sizeof(int) && *ignore)
+			continue;
+
+		/* Let fit_image_verify_with_data() report any problems */
+		if (count == SPL_FIT_STREAM_MAX_HASHES ||
+		    fit_image_hash_get_algo(fit, noffset, &algo) ||
+		    hash_progressive_lookup_algo(algo, &stream->algo[count]))
+			return -ENOTSUPP;
+		stream->hash_node[count++] = noffset;
+	}
+
+	for (i = 0; i < count; i++) {
+		struct hash_algo *algo = stream->algo[i];
+
+		if (algo->hash_init(algo, &stream->hash_ctx[i]))
+			return -ENOMEM;
+		stream->nr_hashes = i + 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Finish each hash and, if @check is true, check it against the value in its
+ * hash node
+ */
+static int spl_fit_stream_check_hashes(const void *fit,
+				       struct spl_fit_stream *stream,
+				       bool check)
+{
+	uint8_t value[FIT_MAX_HASH_LEN];
+	int ret = 0;
+	int i;
+
+	for (i = 0; i < stream->nr_hashes; i++) {
+		struct hash_algo *algo = stream->algo[i];
+		uint8_t *fit_value;
+		int fit_value_len;
+
+		if (algo->hash_finish(algo, stream->hash_ctx[i], value,
+				      sizeof(value))) {
+			ret = -EIO;
+			continue;
+		}
+		if (!check || ret)
+			continue;
+
+		printf("%s", algo->name);
+		if (fit_image_hash_get_value(fit, stream->hash_node[i],
+					     &fit_value, &fit_value_len) ||
+		    fit_value_len != algo->digest_size ||
+		    memcmp(value, fit_value, fit_value_len)) {
+			printf(" error!\nBad hash value for '%s' hash node\n",
+			       fit_get_name(fit, stream->hash_node[i], NULL));
+			ret = -EPERM;
+			continue;
+		}
+		puts("+ ");
+	}
+	stream->nr_hashes = 0;
+
+	return ret;
+}
+
+/* Hash a chunk of image data and decompress it to the load address */
+static int spl_fit_stream_chunk(struct spl_fit_stream *stream,
+				const void *buf, ulong len)
+{
+	int ret;
+	int i;
+
+	for (i = 0; i < stream->nr_hashes; i++) {
+		struct hash_algo *algo = stream->algo[i];
+
+		if (algo->hash_update(algo, stream->hash_ctx[i], buf, len, 0)) {
+			int last = --stream->nr_hashes;
+
+			/* hash_update() has freed the context */
+			stream->algo[i] = stream->algo[last];
+			stream->hash_ctx[i] = stream->hash_ctx[last];
+			stream->hash_node[i] = stream->hash_node[last];
+			return -EIO;
+		}
+	}
+
+	if (!IS_ENABLED(CONFIG_SPL_GZIP) || !stream->gzip || stream->done)
+		return 0;
+
+	if (!stream->zs.next_in) {
+		int offset = gzip_parse_header(buf, len);
+
+		if (offset < 0)
+			return -EINVAL;
+		buf += offset;
+		len -= offset;
+	}
+	stream->zs.next_in = (unsigned char *)buf;
+	stream->zs.avail_in = len;
+	ret = inflate(&stream->zs, Z_NO_FLUSH);
+	if (ret == Z_STREAM_END) {
+		/* anything left is the gzip trailer */
+		stream->done = true;
+	} else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+		printf("Error: inflate() returned %d\n", ret);
+		return -EIO;
+	} else if (stream->zs.avail_in) {
+		puts("Error: uncompressed image too large\n");
+		return -E2BIG;
+	}
+
+	return 0;
+}
+
+/**
+ * spl_fit_stream_load() - load an image with external data in chunks
+ *
+ * Each chunk is read from the device, hashed while it is still in the cache
+ * and then, for gzip-compressed images, decompressed to the load address. A
+ * compressed image is therefore never held in memory in full. Uncompressed
+ * images are read straight to the load address as before, so this only
+ * removes the separate pass over the data for hashing.
+ *
+ * If verification is enabled, the hashes are checked once all of the data
+ * has been read, so the load address may hold data which fails verification
+ * by the time this returns an error.
+ *
+ * @info:	device to read from
+ * @sector:	the start sector of the FIT image on the device
+ * @fit:	pointer to the FIT
+ * @node:	offset of the DT node describing the image to load
+ * @offset:	offset of the image data from the start of the FIT
+ * @length:	size of the image data in bytes
+ * @comp:	compression used by the image data
+ * @load_addr:	address to load the image to
+ * @sizep:	returns the size of the loaded image in bytes
+ * Return: 0 on success, -ENOTSUPP if the image should be loaded in a single
+ *	pass, or another negative error number
+ */
+static int spl_fit_stream_load(struct spl_load_info *info, ulong sector,
+			       const void *fit, int node, int offset,
+			       size_t length, uint8_t comp, ulong load_addr,
+			       size_t *sizep)
+{
+	struct spl_fit_stream stream = {};
+	ulong unit = info->filename ? 1 : info->bl_len;
+	ulong chunk = max_t(ulong, CONFIG_SPL_LOAD_FIT_STREAM_CHUNK_SIZE / unit,
+			    1);
+	ulong start = sector + get_aligned_image_offset(info, offset);
+	ulong overhead = get_aligned_image_overhead(info, offset);
+	ulong left = get_aligned_image_size(info, length, offset);
+	ulong remain = length;
+	void *load_ptr, *buf, *dst;
+	int ret = 0;
+
+	if (CONFIG_IS_ENABLED(FIT_IMAGE_POST_PROCESS))
+		return -ENOTSUPP;
+
+	stream.gzip = IS_ENABLED(CONFIG_SPL_GZIP) && comp == IH_COMP_GZIP;
+	if (CONFIG_IS_ENABLED(FIT_SIGNATURE)) {
+		ret = spl_fit_stream_find_hashes(fit, node, &stream);
+		if (ret) {
+			spl_fit_stream_check_hashes(fit, &stream, false);
+			return ret;
+		}
+	}
+	/* Without hashes or decompression there is nothing to overlap */
+	if (!stream.gzip && !stream.nr_hashes)
+		return -ENOTSUPP;
+
+	load_ptr = map_sysmem(load_addr, length);
+	if (IS_ENABLED(CONFIG_SPL_GZIP) && stream.gzip) {
+		/* Without the memory for this, fall back to a single pass */
+		buf = malloc_cache_aligned(chunk * unit);
+		if (!buf) {
+			spl_fit_stream_check_hashes(fit, &stream, false);
+			return -ENOTSUPP;
+		}
+		stream.zs.zalloc = gzalloc;
+		stream.zs.zfree = gzfree;
+		if (inflateInit2(&stream.zs, -MAX_WBITS) != Z_OK) {
+			spl_fit_stream_check_hashes(fit, &stream, false);
+			free(buf);
+			return -ENOTSUPP;
+		}
+		stream.zs.next_in = NULL;
+		stream.zs.next_out = load_ptr;
+		stream.zs.avail_out = CONFIG_SYS_BOOTM_LEN;
+	} else {
+		buf = map_sysmem(ALIGN(load_addr, ARCH_DMA_MINALIGN), length);
+	}
+
+	if (CONFIG_IS_ENABLED(FIT_SIGNATURE))
+		printf("## Checking hash(es) for Image %s ... ",
+		       fit_get_name(fit, node, NULL));
+
+	dst = buf;
+	while (left) {
+		ulong count = min(left, chunk);
+		ulong len = min(count * unit - overhead, remain);
+
+		if (info->read(info, start, count, dst) != count) {
+			ret = -EIO;
+			break;
+		}
+		ret = spl_fit_stream_chunk(&stream, dst + overhead, len);
+		if (ret)
+			break;
+
+		/* Uncompressed data stays where it was read */
+		if (!stream.gzip)
+			dst += count * unit;
+		start += count;
+		left -= count;
+		remain -= len;
+		overhead = 0;
+	}
+
+	if (IS_ENABLED(CONFIG_SPL_GZIP) && stream.gzip) {
+		if (!ret && !stream.done) {
+			puts("Uncompressing error\n");
+			ret = -EIO;
+		}
+		*sizep = stream.zs.total_out;
+		inflateEnd(&stream.zs);
+		free(buf);
+	} else {
+		*sizep = length;
+		overhead = get_aligned_image_overhead(info, offset);
+		if (!ret && buf + overhead != load_ptr)
+			memmove(load_ptr, buf + overhead, length);
+	}
+
+	if (CONFIG_IS_ENABLED(FIT_SIGNATURE)) {
+		int err = spl_fit_stream_check_hashes(fit, &stream, !ret);
+
+		if (!ret && err)
+			ret = err;
+		if (!ret)
+			puts("OK\n");
+	}
+
+	return ret;
+}
+#else
+static int spl_fit_stream_load(struct spl_load_info *info, ulong sector,
+			       const void *fit, int node, int offset,
+			       size_t length, uint8_t comp, ulong load_addr,
+			       size_t *sizep)
+{
+	return -ENOTSUPP;
+}
+#endif
+
 /**
  * spl_load_fit_image(): load the image described in a certain FIT node
  * @info:	points to information about the device to load data from
@@ -245,6 +572,7 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 	void *src;
 	ulong overhead;
 	int nr_sectors;
+	int ret;
 	uint8_t image_comp = -1, type = -1;
 	const void *data;
 	const void *fit = ctx->fit;
@@ -293,8 +621,15 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 			return 0;
 		}
 
-		src_ptr = map_sysmem(ALIGN(load_addr, ARCH_DMA_MINALIGN), len);
 		length = len;
+		ret = spl_fit_stream_load(info, sector, fit, node, offset,
+					  length, image_comp, load_addr, &length);
+		if (!ret)
+			goto done;
+		if (ret != -ENOTSUPP)
+			return ret;
+
+		src_ptr = map_sysmem(ALIGN(load_addr, ARCH_DMA_MINALIGN), len);
 
 		overhead = get_aligned_image_overhead(info, offset);
 		nr_sectors = get_aligned_image_size(info, length, offset);
@@ -342,6 +677,7 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 		memcpy(load_ptr, src, length);
 	}
 
+done:
 	if (image_info) {
 		ulong entry_point;
 
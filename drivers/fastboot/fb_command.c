@@ -11,8 +11,10 @@
 #include <fb_mmc.h>
 #include <fb_nand.h>
 #include <flash.h>
+#include <image-sparse.h>
 #include <part.h>
 #include <stdlib.h>
+#include <linux/sizes.h>
 
 /**
  * image_size - final fastboot image size
@@ -29,6 +31,40 @@ static u32 fastboot_bytes_received;
  */
 static u32 fastboot_bytes_expected;
 
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+/* Part of the download buffer used to pass a streamed image through */
+#define FB_STREAM_WINDOW	SZ_1M
+
+enum fb_stream_state {
+	FB_STREAM_OFF,		/* the download is kept in the buffer */
+	FB_STREAM_ARMED,	/* waiting to see if the image is sparse */
+	FB_STREAM_ON,		/* writing the image as it arrives */
+	FB_STREAM_FAILED,	/* writing failed, dropping the rest */
+	FB_STREAM_DONE,		/* waiting for the flash command */
+};
+
+/**
+ * struct fb_stream - a sparse image written to flash as it is downloaded
+ *
+ * @state: how far the stream has got
+ * @part: partition being written, from ${fastboot_flash_stream}
+ * @storage: where the image is written
+ * @sparse: progress through the sparse image
+ * @window: bytes of the download buffer to use
+ * @pending: bytes at the start of the download buffer not yet written
+ * @response: response for the flash command, once known
+ */
+static struct fb_stream {
+	enum fb_stream_state state;
+	char part[PART_NAME_LEN];
+	struct sparse_storage storage;
+	struct sparse_stream sparse;
+	u32 window;
+	u32 pending;
+	char response[FASTBOOT_RESPONSE_LEN];
+} fb_stream;
+#endif
+
 static void okay(char *, char *);
 static void getvar(char *, char *);
 static void download(char *, char *);
@@ -193,6 +229,171 @@ static void getvar(char *cmd_parameter, char *response)
 	fastboot_getvar(cmd_parameter, response);
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+static int fb_stream_storage(const char *part, struct sparse_storage *sparse,
+			     char *response)
+{
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_MMC)
+	return fastboot_mmc_sparse_storage(part, sparse, response);
+#elif CONFIG_IS_ENABLED(FASTBOOT_FLASH_NAND)
+	return fastboot_nand_sparse_storage(part, sparse, response);
+#else
+	return -ENOSYS;
+#endif
+}
+
+/**
+ * fb_stream_arm() - get ready to stream the coming download, if wanted
+ *
+ * Return: true if a sparse image will be written to flash as it arrives
+ */
+static bool fb_stream_arm(void)
+{
+	const char *part = env_get("fastboot_flash_stream");
+
+	fb_stream.state = FB_STREAM_OFF;
+	if (!part || !*part)
+		return false;
+
+	strlcpy(fb_stream.part, part, sizeof(fb_stream.part));
+	fb_stream.window = min_t(u32, FB_STREAM_WINDOW, fastboot_buf_size);
+	fb_stream.pending = 0;
+	fb_stream.state = FB_STREAM_ARMED;
+
+	return true;
+}
+
+/* Start writing once the image is known to be sparse */
+static void fb_stream_received(void)
+{
+	char *response = fb_stream.response;
+
+	if (fb_stream.state != FB_STREAM_ARMED ||
+	    fastboot_bytes_received < sizeof(sparse_header_t))
+		return;
+	if (!is_sparse_image(fastboot_buf_addr)) {
+		fb_stream.state = FB_STREAM_OFF;
+		return;
+	}
+
+	printf("\nwriting sparse image to '%s' as it arrives\n",
+	       fb_stream.part);
+	fb_stream.pending = fastboot_bytes_received;
+	if (fb_stream_storage(fb_stream.part, &fb_stream.storage, response)) {
+		fb_stream.state = FB_STREAM_FAILED;
+		return;
+	}
+	sparse_stream_init(&fb_stream.sparse, &fb_stream.storage,
+			   fb_stream.part, response);
+	fb_stream.state = FB_STREAM_ON;
+}
+
+/* Write out the data received so far, keeping any part block for later */
+static void fb_stream_flush(void)
+{
+	int used;
+
+	if (fb_stream.state != FB_STREAM_ON || !fb_stream.pending)
+		return;
+
+	used = sparse_stream_write(&fb_stream.sparse, fastboot_buf_addr,
+				   fb_stream.pending);
+	if (used < 0) {
+		fb_stream.state = FB_STREAM_FAILED;
+		return;
+	}
+	fb_stream.pending -= used;
+	memmove(fastboot_buf_addr, fastboot_buf_addr + used,
+		fb_stream.pending);
+}
+
+/**
+ * fb_stream_data() - pass received data to the stream, if there is one
+ *
+ * @data: received data
+ * @len: number of bytes at @data
+ * Return: true if the stream took the data
+ */
+static bool fb_stream_data(const void *data, unsigned int len)
+{
+	unsigned int n;
+
+	if (fb_stream.state != FB_STREAM_ON &&
+	    fb_stream.state != FB_STREAM_FAILED)
+		return false;
+
+	while (len && fb_stream.state == FB_STREAM_ON) {
+		if (fb_stream.pending == fb_stream.window)
+			fb_stream_flush();
+		n = min(len, fb_stream.window - fb_stream.pending);
+		if (!n) {
+			fastboot_fail("sparse chunk header too large",
+				      fb_stream.response);
+			fb_stream.state = FB_STREAM_FAILED;
+			break;
+		}
+		memcpy(fastboot_buf_addr + fb_stream.pending, data, n);
+		fb_stream.pending += n;
+		data += n;
+		len -= n;
+	}
+
+	return true;
+}
+
+/* Write out the rest of the image and keep the result for 'flash' */
+static void fb_stream_complete(void)
+{
+	switch (fb_stream.state) {
+	case FB_STREAM_ARMED:
+		fb_stream.state = FB_STREAM_OFF;
+		break;
+	case FB_STREAM_ON:
+		fb_stream_flush();
+		if (fb_stream.state == FB_STREAM_ON &&
+		    !sparse_stream_finish(&fb_stream.sparse))
+			fastboot_okay(NULL, fb_stream.response);
+		fb_stream.state = FB_STREAM_DONE;
+		break;
+	case FB_STREAM_FAILED:
+		fb_stream.state = FB_STREAM_DONE;
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * fb_stream_flash() - respond to 'flash' after a streamed download
+ *
+ * @part: partition named by the flash command
+ * @response: Pointer to fastboot response buffer
+ * Return: true if the download was streamed, so there is nothing to write
+ */
+static bool fb_stream_flash(const char *part, char *response)
+{
+	if (fb_stream.state != FB_STREAM_DONE)
+		return false;
+
+	fb_stream.state = FB_STREAM_OFF;
+	if (!part || strcmp(part, fb_stream.part))
+		fastboot_response("FAIL", response, "image was written to '%s'",
+				  fb_stream.part);
+	else
+		strlcpy(response, fb_stream.response, FASTBOOT_RESPONSE_LEN);
+
+	return true;
+}
+#else
+static inline bool fb_stream_arm(void) { return false; }
+static inline void fb_stream_received(void) {}
+static inline bool fb_stream_data(const void *data, unsigned int len)
+{
+	return false;
+}
+static inline void fb_stream_complete(void) {}
+#endif
+
 /**
  * fastboot_download() - Start a download transfer from the client
  *
@@ -201,8 +402,11 @@ static void getvar(char *cmd_parameter, char *response)
  */
 static void download(char *cmd_parameter, char *response)
 {
+	bool stream;
 	char *tmp;
 
+	/* Any earlier streamed image is forgotten */
+	stream = fb_stream_arm();
 	if (!cmd_parameter) {
 		fastboot_fail("Expected command parameter", response);
 		return;
@@ -217,9 +421,10 @@ static void download(char *cmd_parameter, char *response)
 	 * Nothing to download yet. Response is of the form:
 	 * [DATA|FAIL]$cmd_parameter
 	 *
-	 * where cmd_parameter is an 8 digit hexadecimal number
+	 * where cmd_parameter is an 8 digit hexadecimal number. A sparse
+	 * image which is streamed does not have to fit in the buffer.
 	 */
-	if (fastboot_bytes_expected > fastboot_buf_size) {
+	if (fastboot_bytes_expected > fastboot_buf_size && !stream) {
 		fastboot_fail(cmd_parameter, response);
 	} else {
 		printf("Starting download of %d bytes\n",
@@ -266,9 +471,17 @@ void fastboot_data_download(const void *fastboot_data,
 			      response);
 		return;
 	}
-	/* Download data to fastboot_buf_addr */
-	memcpy(fastboot_buf_addr + fastboot_bytes_received,
-	       fastboot_data, fastboot_data_len);
+	if (!fb_stream_data(fastboot_data, fastboot_data_len)) {
+		if (fastboot_bytes_received + fastboot_data_len >
+		    fastboot_buf_size) {
+			fastboot_fail("Image is too large for the buffer",
+				      response);
+			return;
+		}
+		/* Download data to fastboot_buf_addr */
+		memcpy(fastboot_buf_addr + fastboot_bytes_received,
+		       fastboot_data, fastboot_data_len);
+	}
 
 	pre_dot_num = fastboot_bytes_received / BYTES_PER_DOT;
 	fastboot_bytes_received += fastboot_data_len;
@@ -280,6 +493,23 @@ void fastboot_data_download(const void *fastboot_data,
 			putc('\n');
 	}
 	*response = '\0';
+
+	fb_stream_received();
+}
+
+/**
+ * fastboot_data_write() - write out data of a streamed download
+ *
+ * A transport may call this once it has acknowledged received data, so that
+ * the host can send more while the data is written. Without it, data is
+ * written whenever the window in the download buffer fills up.
+ */
+void fastboot_data_write(void)
+{
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	if (fb_stream.pending >= fb_stream.window / 2)
+		fb_stream_flush();
+#endif
 }
 
 /**
@@ -291,6 +521,8 @@ void fastboot_data_download(const void *fastboot_data,
  */
 void fastboot_data_complete(char *response)
 {
+	fb_stream_complete();
+
 	/* Download complete. Respond with "OKAY" */
 	fastboot_okay(NULL, response);
 	printf("\ndownloading of %d bytes finished\n", fastboot_bytes_received);
@@ -312,6 +544,10 @@ void fastboot_data_complete(char *response)
  */
 static void flash(char *cmd_parameter, char *response)
 {
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+	if (fb_stream_flash(cmd_parameter, response))
+		return;
+#endif
 #if CONFIG_IS_ENABLED(FASTBOOT_FLASH_MMC)
 	fastboot_mmc_flash_write(cmd_parameter, fastboot_buf_addr, image_size,
 				 response);
@@ -18,6 +18,9 @@
 #include <linux/bitops.h>
 #include <linux/err.h>
 
+/* CQHCI registers, relative to the SDHCI base */
+#define SDHCI_AM654_CQE_BASE_ADDR	0x200
+
 /* CTL_CFG Registers */
 #define CTL_CFG_2		0x14
 
@@ -560,6 +563,15 @@ static int am654_sdhci_probe(struct udevice *dev)
 	if (ret)
 		return ret;
 
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+	if (cfg->host_caps & MMC_CAP_CQE) {
+		ret = sdhci_cqe_add_host(host, host->ioaddr +
+					 SDHCI_AM654_CQE_BASE_ADDR);
+		if (ret)
+			dev_warn(dev, "failed to add CQE (%d)\n", ret);
+	}
+#endif
+
 	/* Update ops based on SoC revision */
 	soc = soc_device_match(am654_sdhci_soc_attr);
 	if (soc && soc->data) {
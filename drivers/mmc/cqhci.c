@@ -0,0 +1,353 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * eMMC Command Queue Host Controller Interface (CQHCI)
+ *
+ * Polled implementation for queued block reads, based on the Linux driver
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ */
+
+#define LOG_CATEGORY UCLASS_MMC
+
+#include <common.h>
+#include <cpu_func.h>
+#include <cqhci.h>
+#include <dm.h>
+#include <log.h>
+#include <malloc.h>
+#include <mmc.h>
+#include <phys2bus.h>
+#include <time.h>
+#include <asm/cache.h>
+#include <linux/dma-mapping.h>
+#include <linux/errno.h>
+#include <linux/sizes.h>
+
+/* Timeout for one batch of tasks to complete */
+#define CQHCI_TASK_TIMEOUT_MS	2000
+/* Timeout for the engine to halt or clear its tasks */
+#define CQHCI_HALT_TIMEOUT_MS	100
+
+static u8 *get_desc(struct cqhci_host *cq_host, u8 tag)
+{
+	return cq_host->desc_base + (tag * cq_host->slot_sz);
+}
+
+static u8 *get_link_desc(struct cqhci_host *cq_host, u8 tag)
+{
+	return get_desc(cq_host, tag) + cq_host->task_desc_len;
+}
+
+static u8 *get_trans_desc(struct cqhci_host *cq_host, u8 tag)
+{
+	return cq_host->trans_desc_base +
+	       (cq_host->trans_desc_len * CQHCI_MAX_SEGS * tag);
+}
+
+static dma_addr_t cqhci_bus_addr(struct cqhci_host *cq_host, dma_addr_t addr)
+{
+	return dev_phys_to_bus(mmc_to_dev(cq_host->mmc), addr);
+}
+
+static void cqhci_set_addr(struct cqhci_host *cq_host, u8 *desc,
+			   dma_addr_t addr)
+{
+	if (cq_host->dma64) {
+		__le64 *data_addr = (__le64 __force *)(desc + 4);
+
+		data_addr[0] = cpu_to_le64(addr);
+	} else {
+		__le32 *data_addr = (__le32 __force *)(desc + 4);
+
+		data_addr[0] = cpu_to_le32(addr);
+	}
+}
+
+static void cqhci_setup_link_desc(struct cqhci_host *cq_host, u8 tag)
+{
+	u8 *link = get_link_desc(cq_host, tag);
+
+	memset(link, 0, cq_host->link_desc_len);
+	*link = CQHCI_VALID(1) | CQHCI_ACT(CQHCI_ACT_LINK) | CQHCI_END(0);
+	cqhci_set_addr(cq_host, link,
+		       cqhci_bus_addr(cq_host,
+				      (ulong)get_trans_desc(cq_host, tag)));
+}
+
+static void cqhci_prep_task_desc(struct cqhci_host *cq_host, u8 tag,
+				 lbaint_t start, u32 blkcnt)
+{
+	__le64 *task_desc = (__le64 __force *)get_desc(cq_host, tag);
+	u64 desc;
+
+	desc = CQHCI_VALID(1) |
+	       CQHCI_END(1) |
+	       CQHCI_INT(1) |
+	       CQHCI_ACT(CQHCI_ACT_TASK) |
+	       CQHCI_DATA_DIR(1) |
+	       CQHCI_BLK_COUNT(blkcnt) |
+	       CQHCI_BLK_ADDR(start);
+
+	task_desc[0] = cpu_to_le64(desc);
+	if (cq_host->task_desc_len > 8)
+		task_desc[1] = 0;
+}
+
+static void cqhci_prep_trans_desc(struct cqhci_host *cq_host, u8 tag,
+				  dma_addr_t addr, u32 len)
+{
+	u8 *desc = get_trans_desc(cq_host, tag);
+	u32 seg;
+
+	do {
+		seg = min_t(u32, len, CQHCI_MAX_SEG_LEN);
+		len -= seg;
+
+		memset(desc, 0, cq_host->trans_desc_len);
+		*(__le32 __force *)desc = cpu_to_le32(CQHCI_VALID(1) |
+						      CQHCI_END(!len) |
+						      CQHCI_ACT(CQHCI_ACT_TRAN) |
+						      CQHCI_DAT_LENGTH(seg));
+		cqhci_set_addr(cq_host, desc, addr);
+
+		addr += seg;
+		desc += cq_host->trans_desc_len;
+	} while (len);
+}
+
+static int cqhci_wait_ctl(struct cqhci_host *cq_host, u32 mask, u32 val)
+{
+	ulong start = get_timer(0);
+
+	while ((cqhci_readl(cq_host, CQHCI_CTL) & mask) != val) {
+		if (get_timer(start) > CQHCI_HALT_TIMEOUT_MS)
+			return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+static int cqhci_wait_tasks(struct cqhci_host *cq_host, u32 mask)
+{
+	ulong start = get_timer(0);
+	u32 status, tcn, terri;
+
+	for (;;) {
+		status = cqhci_readl(cq_host, CQHCI_IS);
+		terri = cqhci_readl(cq_host, CQHCI_TERRI);
+		if ((status & CQHCI_IS_ERR_MASK) ||
+		    (terri & (CQHCI_TERRI_C_VALID | CQHCI_TERRI_D_VALID))) {
+			log_err("task error: IS %#x TERRI %#x TCN %#x\n",
+				status, terri,
+				cqhci_readl(cq_host, CQHCI_TCN));
+			cqhci_writel(cq_host, status, CQHCI_IS);
+			return -EIO;
+		}
+
+		tcn = cqhci_readl(cq_host, CQHCI_TCN);
+		if ((tcn & mask) == mask)
+			break;
+
+		if (get_timer(start) > CQHCI_TASK_TIMEOUT_MS) {
+			log_err("timeout: TDBR %#x TCN %#x\n",
+				cqhci_readl(cq_host, CQHCI_TDBR), tcn);
+			return -ETIMEDOUT;
+		}
+	}
+
+	cqhci_writel(cq_host, mask, CQHCI_TCN);
+	cqhci_writel(cq_host, status, CQHCI_IS);
+
+	return 0;
+}
+
+int cqhci_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
+		      lbaint_t blkcnt)
+{
+	struct cqhci_host *cq_host = mmc->cqe_host;
+	u32 blksz = mmc->read_bl_len;
+	dma_addr_t addr, batch_addr;
+	u32 mask, cur, len;
+	size_t batch_len;
+	u8 tag;
+	int ret;
+
+	if (!cq_host->enabled)
+		return -EINVAL;
+
+	while (blkcnt) {
+		cur = min_t(lbaint_t, blkcnt,
+			    mmc->cqe_qdepth * CQHCI_MAX_TASK_BLKS);
+		batch_len = (size_t)cur * blksz;
+		batch_addr = dma_map_single(dst, batch_len, DMA_FROM_DEVICE);
+		addr = batch_addr;
+
+		mask = 0;
+		for (tag = 0; tag < mmc->cqe_qdepth && blkcnt; tag++) {
+			cur = min_t(lbaint_t, blkcnt, CQHCI_MAX_TASK_BLKS);
+			len = cur * blksz;
+
+			cqhci_prep_task_desc(cq_host, tag, start, cur);
+			cqhci_prep_trans_desc(cq_host, tag,
+					      cqhci_bus_addr(cq_host, addr),
+					      len);
+			mask |= BIT(tag);
+
+			blkcnt -= cur;
+			start += cur;
+			addr += len;
+		}
+
+		flush_dcache_range((ulong)cq_host->desc_base,
+				   (ulong)cq_host->desc_base +
+				   ALIGN(tag * cq_host->slot_sz,
+					 ARCH_DMA_MINALIGN));
+		flush_dcache_range((ulong)cq_host->trans_desc_base,
+				   (ulong)get_trans_desc(cq_host, tag));
+
+		/* Ring the doorbell for the whole batch at once */
+		cqhci_writel(cq_host, mask, CQHCI_TDBR);
+
+		ret = cqhci_wait_tasks(cq_host, mask);
+		dma_unmap_single(batch_addr, batch_len, DMA_FROM_DEVICE);
+		if (ret)
+			return ret;
+
+		dst += batch_len;
+	}
+
+	return 0;
+}
+
+int cqhci_enable(struct mmc *mmc)
+{
+	struct cqhci_host *cq_host = mmc->cqe_host;
+	dma_addr_t desc_dma = cqhci_bus_addr(cq_host,
+					     (ulong)cq_host->desc_base);
+	u32 cqcfg;
+
+	if (cq_host->enabled)
+		return 0;
+
+	cqcfg = cqhci_readl(cq_host, CQHCI_CFG);
+
+	/* Configuration must not be changed while enabled */
+	if (cqcfg & CQHCI_ENABLE) {
+		cqcfg &= ~CQHCI_ENABLE;
+		cqhci_writel(cq_host, cqcfg, CQHCI_CFG);
+	}
+
+	cqcfg &= ~(CQHCI_DCMD | CQHCI_TASK_DESC_SZ);
+	if (cq_host->task_desc_len > 8)
+		cqcfg |= CQHCI_TASK_DESC_SZ;
+	cqhci_writel(cq_host, cqcfg, CQHCI_CFG);
+
+	cqhci_writel(cq_host, lower_32_bits(desc_dma), CQHCI_TDLBA);
+	cqhci_writel(cq_host, upper_32_bits(desc_dma), CQHCI_TDLBAU);
+	cqhci_writel(cq_host, mmc->rca, CQHCI_SSC2);
+
+	/* Status is polled, so latch it but do not signal interrupts */
+	cqhci_writel(cq_host, CQHCI_IS_MASK, CQHCI_ISTE);
+	cqhci_writel(cq_host, 0, CQHCI_ISGE);
+	cqhci_writel(cq_host, cqhci_readl(cq_host, CQHCI_IS), CQHCI_IS);
+	cqhci_writel(cq_host, cqhci_readl(cq_host, CQHCI_TCN), CQHCI_TCN);
+
+	cqcfg |= CQHCI_ENABLE;
+	cqhci_writel(cq_host, cqcfg, CQHCI_CFG);
+
+	if (cqhci_readl(cq_host, CQHCI_CTL) & CQHCI_HALT)
+		cqhci_writel(cq_host, 0, CQHCI_CTL);
+
+	if (cq_host->ops->enable)
+		cq_host->ops->enable(mmc);
+
+	cq_host->enabled = true;
+
+	return 0;
+}
+
+void cqhci_disable(struct mmc *mmc, bool recovery)
+{
+	struct cqhci_host *cq_host = mmc->cqe_host;
+	u32 cqcfg;
+
+	if (!cq_host->enabled)
+		return;
+
+	cqhci_writel(cq_host, CQHCI_HALT, CQHCI_CTL);
+	if (cqhci_wait_ctl(cq_host, CQHCI_HALT, CQHCI_HALT))
+		log_warning("failed to halt\n");
+
+	if (recovery) {
+		cqhci_writel(cq_host, CQHCI_HALT | CQHCI_CLEAR_ALL_TASKS,
+			     CQHCI_CTL);
+		if (cqhci_wait_ctl(cq_host, CQHCI_CLEAR_ALL_TASKS, 0))
+			log_warning("failed to clear tasks\n");
+		cqhci_writel(cq_host, cqhci_readl(cq_host, CQHCI_TCN),
+			     CQHCI_TCN);
+		cqhci_writel(cq_host, cqhci_readl(cq_host, CQHCI_IS),
+			     CQHCI_IS);
+	}
+
+	cqcfg = cqhci_readl(cq_host, CQHCI_CFG);
+	cqhci_writel(cq_host, cqcfg & ~CQHCI_ENABLE, CQHCI_CFG);
+
+	if (cq_host->ops->disable)
+		cq_host->ops->disable(mmc, recovery);
+
+	cq_host->enabled = false;
+}
+
+int cqhci_init(struct cqhci_host *cq_host, struct mmc *mmc, bool dma64)
+{
+	size_t desc_size, data_size;
+	u32 ver;
+	u8 tag;
+
+	cq_host->mmc = mmc;
+	cq_host->dma64 = dma64;
+	cq_host->num_slots = CQHCI_NUM_SLOTS;
+
+	if (dma64) {
+		cq_host->task_desc_len = 16;
+		cq_host->link_desc_len = 16;
+		cq_host->trans_desc_len = 16;
+	} else {
+		cq_host->task_desc_len = 8;
+		cq_host->link_desc_len = 8;
+		cq_host->trans_desc_len = 8;
+	}
+	cq_host->slot_sz = cq_host->task_desc_len + cq_host->link_desc_len;
+
+	desc_size = cq_host->slot_sz * cq_host->num_slots;
+	data_size = cq_host->trans_desc_len * CQHCI_MAX_SEGS *
+		    cq_host->num_slots;
+
+	/* The task descriptor list must be 1KiB aligned */
+	cq_host->desc_base = memalign(max(SZ_1K, ARCH_DMA_MINALIGN),
+				      ALIGN(desc_size, ARCH_DMA_MINALIGN));
+	cq_host->trans_desc_base = memalign(ARCH_DMA_MINALIGN,
+					    ALIGN(data_size,
+						  ARCH_DMA_MINALIGN));
+	if (!cq_host->desc_base || !cq_host->trans_desc_base) {
+		free(cq_host->desc_base);
+		free(cq_host->trans_desc_base);
+		return -ENOMEM;
+	}
+	memset(cq_host->desc_base, 0, desc_size);
+	memset(cq_host->trans_desc_base, 0, data_size);
+
+	/* Link descriptors never change, so set them up once */
+	for (tag = 0; tag < cq_host->num_slots; tag++)
+		cqhci_setup_link_desc(cq_host, tag);
+	flush_dcache_range((ulong)cq_host->desc_base,
+			   (ulong)cq_host->desc_base +
+			   ALIGN(desc_size, ARCH_DMA_MINALIGN));
+
+	ver = cqhci_readl(cq_host, CQHCI_VER);
+	log_debug("CQHCI version %u.%02u\n", CQHCI_VER_MAJOR(ver),
+		  CQHCI_VER_MINOR1(ver) * 10 + CQHCI_VER_MINOR2(ver));
+
+	mmc->cqe_host = cq_host;
+
+	return 0;
+}
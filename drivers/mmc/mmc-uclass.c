@@ -40,6 +40,12 @@ static int dm_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	struct dm_mmc_ops *ops = mmc_get_ops(dev);
 	int ret;
 
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+	/* Legacy commands cannot be issued while the command queue is on */
+	if (mmc->cqe_on)
+		mmc_cqe_off(mmc, false);
+#endif
+
 	mmmc_trace_before_send(mmc, cmd);
 	if (ops->send_cmd)
 		ret = ops->send_cmd(dev, cmd, data);
@@ -265,6 +271,9 @@ int mmc_of_parse(struct udevice *dev, struct mmc_config *cfg)
 			cfg->host_caps |= MMC_CAP_NEEDS_POLL;
 	}
 
+	if (dev_read_bool(dev, "supports-cqe"))
+		cfg->host_caps |= MMC_CAP_CQE;
+
 	if (dev_read_bool(dev, "no-1-8-v")) {
 		cfg->host_caps &= ~(UHS_CAPS | MMC_MODE_HS200 |
 				    MMC_MODE_HS400 | MMC_MODE_HS400_ES);
@@ -11,6 +11,7 @@
 #include <common.h>
 #include <blk.h>
 #include <command.h>
+#include <cqhci.h>
 #include <dm.h>
 #include <log.h>
 #include <dm/device-internal.h>
@@ -446,6 +447,71 @@ static int mmc_get_b_max(struct mmc *mmc, void *dst, lbaint_t blkcnt)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+static int mmc_cqe_on(struct mmc *mmc)
+{
+	int err;
+
+	if (mmc->cqe_on)
+		return 0;
+
+	err = mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_CMDQ_MODE_EN, 1);
+	if (err)
+		return err;
+
+	err = cqhci_enable(mmc);
+	if (err) {
+		mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_CMDQ_MODE_EN, 0);
+		return err;
+	}
+	mmc->cqe_on = true;
+
+	return 0;
+}
+
+int mmc_cqe_off(struct mmc *mmc, bool recovery)
+{
+	if (!mmc->cqe_on)
+		return 0;
+
+	/* Clear this first as the switch below goes through mmc_send_cmd() */
+	mmc->cqe_on = false;
+	cqhci_disable(mmc, recovery);
+
+	return mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_CMDQ_MODE_EN, 0);
+}
+
+/*
+ * Queued reads are only used for multi-block reads from the user area into
+ * a DMA-aligned buffer; everything else takes the legacy path.
+ */
+static bool mmc_cqe_can_read(struct mmc *mmc, struct blk_desc *block_dev,
+			     void *dst, lbaint_t blkcnt)
+{
+	return mmc->cqe_qdepth && blkcnt > 1 && !block_dev->hwpart &&
+	       mmc->high_capacity && mmc->read_bl_len == MMC_MAX_BLOCK_LEN &&
+	       IS_ALIGNED((ulong)dst, ARCH_DMA_MINALIGN);
+}
+
+static int mmc_cqe_read(struct mmc *mmc, void *dst, lbaint_t start,
+			lbaint_t blkcnt)
+{
+	int err;
+
+	err = mmc_cqe_on(mmc);
+	if (!err)
+		err = cqhci_read_blocks(mmc, dst, start, blkcnt);
+	if (err) {
+		pr_warn("%s: queued read failed (%d), using legacy mode\n",
+			mmc->cfg->name, err);
+		mmc_cqe_off(mmc, true);
+		mmc->cqe_qdepth = 0;
+	}
+
+	return err;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(BLK)
 ulong mmc_bread(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *dst)
 #else
@@ -484,6 +550,12 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 		return 0;
 	}
 
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+	if (mmc_cqe_can_read(mmc, block_dev, dst, blkcnt) &&
+	    !mmc_cqe_read(mmc, dst, start, blkcnt))
+		return blkcnt;
+#endif
+
 	if (mmc_set_blocklen(mmc, mmc->read_bl_len)) {
 		pr_debug("%s: Failed to set blocklen\n", __func__);
 		return 0;
@@ -2279,6 +2351,15 @@ static int mmc_startup_v4(struct mmc *mmc)
 	if (mmc->version >= MMC_VERSION_4_5)
 		mmc->gen_cmd6_time = ext_csd[EXT_CSD_GENERIC_CMD6_TIME];
 
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+	mmc->cqe_qdepth = 0;
+	if (mmc->cqe_host && mmc->version >= MMC_VERSION_5_1 &&
+	    (ext_csd[EXT_CSD_CMDQ_SUPPORT] & 0x1))
+		mmc->cqe_qdepth = min_t(u32,
+					(ext_csd[EXT_CSD_CMDQ_DEPTH] & 0x1f) + 1,
+					mmc->cqe_host->num_slots);
+#endif
+
 	/* The partition data may be non-zero but it is only
 	 * effective if PARTITION_SETTING_COMPLETED is set in
 	 * EXT_CSD, so ignore any data if this bit is not set,
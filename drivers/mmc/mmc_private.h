@@ -132,4 +132,17 @@ int mmc_switch_part(struct mmc *mmc, unsigned int part_num);
  */
 int mmc_switch(struct mmc *mmc, u8 set, u8 index, u8 value);
 
+/**
+ * mmc_cqe_off() - Leave command queue mode
+ *
+ * Halts the command queue engine and disables command queueing in the card
+ * so that legacy commands can be issued. Does nothing if the command queue
+ * is not in use.
+ *
+ * @mmc:	MMC device
+ * @recovery:	true if leaving after an error; queued tasks are discarded
+ * Return: 0 if OK, -ve on error
+ */
+int mmc_cqe_off(struct mmc *mmc, bool recovery);
+
 #endif /* _MMC_PRIVATE_H_ */
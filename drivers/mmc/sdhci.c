@@ -9,6 +9,7 @@
 
 #include <common.h>
 #include <cpu_func.h>
+#include <cqhci.h>
 #include <dm.h>
 #include <errno.h>
 #include <log.h>
@@ -730,6 +731,68 @@ static int sdhci_init(struct mmc *mmc)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+static void sdhci_cqe_enable(struct mmc *mmc)
+{
+	struct sdhci_host *host = mmc->priv;
+	u8 ctrl;
+
+	ctrl = sdhci_readb(host, SDHCI_HOST_CONTROL);
+	ctrl &= ~SDHCI_CTRL_DMA_MASK;
+	if (host->flags & USE_ADMA64)
+		ctrl |= SDHCI_CTRL_ADMA64;
+	else
+		ctrl |= SDHCI_CTRL_ADMA32;
+	sdhci_writeb(host, ctrl, SDHCI_HOST_CONTROL);
+
+	sdhci_writew(host, SDHCI_MAKE_BLKSZ(SDHCI_DEFAULT_BOUNDARY_ARG,
+					    MMC_MAX_BLOCK_LEN),
+		     SDHCI_BLOCK_SIZE);
+	sdhci_writeb(host, 0xe, SDHCI_TIMEOUT_CONTROL);
+
+	sdhci_writel(host, SDHCI_INT_CQE | SDHCI_INT_ERROR_MASK,
+		     SDHCI_INT_ENABLE);
+}
+
+static void sdhci_cqe_disable(struct mmc *mmc, bool recovery)
+{
+	struct sdhci_host *host = mmc->priv;
+
+	sdhci_writel(host, SDHCI_INT_DATA_MASK | SDHCI_INT_CMD_MASK,
+		     SDHCI_INT_ENABLE);
+
+	if (recovery) {
+		sdhci_reset(host, SDHCI_RESET_CMD);
+		sdhci_reset(host, SDHCI_RESET_DATA);
+	}
+	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
+}
+
+static const struct cqhci_host_ops sdhci_cqhci_ops = {
+	.enable		= sdhci_cqe_enable,
+	.disable	= sdhci_cqe_disable,
+};
+
+int sdhci_cqe_add_host(struct sdhci_host *host, void __iomem *mmio)
+{
+	struct cqhci_host *cq_host;
+	int ret;
+
+	cq_host = calloc(1, sizeof(*cq_host));
+	if (!cq_host)
+		return -ENOMEM;
+
+	cq_host->mmio = mmio;
+	cq_host->ops = &sdhci_cqhci_ops;
+
+	ret = cqhci_init(cq_host, host->mmc, host->flags & USE_ADMA64);
+	if (ret)
+		free(cq_host);
+
+	return ret;
+}
+#endif
+
 #ifdef CONFIG_DM_MMC
 int sdhci_probe(struct udevice *dev)
 {
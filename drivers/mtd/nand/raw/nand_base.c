@@ -2295,6 +2295,75 @@ static int nand_setup_read_retry(struct mtd_info *mtd, int retry_mode)
 	return chip->setup_read_retry(mtd, retry_mode);
 }
 
+/**
+ * nand_read_cache_end - [INTERN] terminate a cache read sequence
+ * @mtd: MTD device structure
+ * @chip: nand chip info structure
+ * @cache_next: next page of the ongoing cache read sequence, -1 if none
+ */
+static void nand_read_cache_end(struct mtd_info *mtd, struct nand_chip *chip,
+				int *cache_next)
+{
+	if (*cache_next < 0)
+		return;
+
+	chip->cmdfunc(mtd, NAND_CMD_READCACHEEND, -1, -1);
+	*cache_next = -1;
+}
+
+/**
+ * nand_read_page_cached - [INTERN] start reading a page, using cache read
+ * @mtd: MTD device structure
+ * @chip: nand chip info structure
+ * @realpage: page to read
+ * @npages: number of whole pages still to be read, including @realpage
+ * @cache_next: next page of the ongoing cache read sequence, -1 if none
+ * @cache_last: last page of the ongoing cache read sequence
+ *
+ * Issue the commands which make the data of @realpage available in the page
+ * register. If @realpage continues an ongoing READ CACHE SEQUENTIAL sequence
+ * the chip already loaded it into its cache register while the previous page
+ * was transferred, and only READ CACHE SEQUENTIAL or READ CACHE END is needed.
+ * Otherwise a regular page read is issued and, if more pages of the same
+ * block follow, a new sequence is started.
+ */
+static int nand_read_page_cached(struct mtd_info *mtd, struct nand_chip *chip,
+				 int realpage, int npages, int *cache_next,
+				 int *cache_last)
+{
+	int ppb = 1 << (chip->phys_erase_shift - chip->page_shift);
+	int ret;
+
+	if (*cache_next >= 0) {
+		if (realpage == *cache_next) {
+			if (realpage == *cache_last) {
+				nand_read_cache_end(mtd, chip, cache_next);
+			} else {
+				chip->cmdfunc(mtd, NAND_CMD_READCACHESEQ,
+					      -1, -1);
+				(*cache_next)++;
+			}
+			return 0;
+		}
+
+		/* Out of sequence (e.g. read retry): end the sequence */
+		nand_read_cache_end(mtd, chip, cache_next);
+	}
+
+	ret = nand_read_page_op(chip, realpage & chip->pagemask, 0, NULL, 0);
+	if (ret)
+		return ret;
+
+	/* Cache reads must not cross a block boundary */
+	*cache_last = min(realpage + npages - 1, realpage | (ppb - 1));
+	if (*cache_last > realpage) {
+		chip->cmdfunc(mtd, NAND_CMD_READCACHESEQ, -1, -1);
+		*cache_next = realpage + 1;
+	}
+
+	return 0;
+}
+
 /**
  * nand_do_read_ops - [INTERN] Read data with ECC
  * @mtd: MTD device structure
@@ -2318,6 +2387,8 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 	unsigned int max_bitflips = 0;
 	int retry_mode = 0;
 	bool ecc_fail = false;
+	bool cache_read;
+	int cache_next = -1, cache_last = -1;
 
 	chipnr = (int)(from >> chip->chip_shift);
 	chip->select_chip(mtd, chipnr);
@@ -2331,6 +2402,16 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 	oob = ops->oobbuf;
 	oob_required = oob ? 1 : 0;
 
+	/*
+	 * Stream whole pages with the cache read commands, so that the array
+	 * read of the next page overlaps the transfer of the current one. ECC
+	 * is still corrected page by page.
+	 */
+	cache_read = IS_ENABLED(CONFIG_NAND_CACHE_READ) &&
+		     NAND_HAS_CACHEREAD(chip) &&
+		     nand_standard_page_accessors(&chip->ecc) &&
+		     readlen >= 2 * mtd->writesize;
+
 	while (1) {
 		unsigned int ecc_failures = mtd->ecc_stats.failed;
 
@@ -2355,7 +2436,16 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 						 __func__, buf);
 
 read_retry:
-			if (nand_standard_page_accessors(&chip->ecc)) {
+			if (cache_read && aligned) {
+				ret = nand_read_page_cached(mtd, chip, realpage,
+							    readlen >>
+							    chip->page_shift,
+							    &cache_next,
+							    &cache_last);
+				if (ret)
+					break;
+			} else if (nand_standard_page_accessors(&chip->ecc)) {
+				nand_read_cache_end(mtd, chip, &cache_next);
 				ret = nand_read_page_op(chip, page, 0, NULL, 0);
 				if (ret)
 					break;
@@ -2421,6 +2511,8 @@ read_retry:
 			if (mtd->ecc_stats.failed - ecc_failures) {
 				if (retry_mode + 1 < chip->read_retries) {
 					retry_mode++;
+					nand_read_cache_end(mtd, chip,
+							    &cache_next);
 					ret = nand_setup_read_retry(mtd,
 							retry_mode);
 					if (ret < 0)
@@ -2447,6 +2539,7 @@ read_retry:
 
 		/* Reset to retry mode 0 */
 		if (retry_mode) {
+			nand_read_cache_end(mtd, chip, &cache_next);
 			ret = nand_setup_read_retry(mtd, 0);
 			if (ret < 0)
 				break;
@@ -2469,6 +2562,8 @@ read_retry:
 			chip->select_chip(mtd, chipnr);
 		}
 	}
+	/* Terminate a cache read sequence which was left unfinished */
+	nand_read_cache_end(mtd, chip, &cache_next);
 	chip->select_chip(mtd, -1);
 
 	ops->retlen = ops->len - (size_t) readlen;
@@ -3989,6 +4084,9 @@ static int nand_flash_detect_onfi(struct mtd_info *mtd, struct nand_chip *chip,
 		pr_warn("Could not retrieve ONFI ECC requirements\n");
 	}
 
+	if (le16_to_cpu(p->opt_cmd) & ONFI_OPT_CMD_READ_CACHE)
+		chip->options |= NAND_CACHEREAD;
+
 	if (p->jedec_id == NAND_MFR_MICRON)
 		nand_onfi_detect_micron(chip, p);
 
@@ -5245,6 +5343,11 @@ int nand_scan_tail(struct mtd_info *mtd)
 	/* Invalidate the pagebuffer reference */
 	chip->pagebuf = -1;
 
+	/* The generic large page command function handles cache reads */
+	if (IS_ENABLED(CONFIG_NAND_CACHE_READ) &&
+	    chip->cmdfunc == nand_command_lp)
+		chip->options |= NAND_USE_CACHE_READ;
+
 	/* Large page NAND with SOFT_ECC should support subpage reads */
 	switch (ecc->mode) {
 	case NAND_ECC_SOFT:
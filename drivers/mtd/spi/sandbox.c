@@ -247,6 +247,7 @@ static int sandbox_sf_process_cmd(struct sandbox_spi_flash *sbsf, const u8 *rx,
 		sbsf->cmd = SF_ID;
 		break;
 	case SPINOR_OP_READ_FAST:
+	case SPINOR_OP_READ_1_1_2:
 		sbsf->pad_addr_bytes = 1;
 	case SPINOR_OP_READ:
 	case SPINOR_OP_PP:
@@ -380,6 +381,7 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 			}
 			switch (sbsf->cmd) {
 			case SPINOR_OP_READ_FAST:
+			case SPINOR_OP_READ_1_1_2:
 			case SPINOR_OP_READ:
 				sbsf->state = SF_READ;
 				break;
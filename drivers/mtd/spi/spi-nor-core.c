@@ -44,6 +44,12 @@
 
 #define DEFAULT_READY_WAIT_JIFFIES		(40UL * HZ)
 
+/*
+ * For full-chip erase, calibrated to a 2MB flash (M25P16); should be scaled up
+ * for larger flash
+ */
+#define CHIP_ERASE_2MB_READY_WAIT_JIFFIES	(40UL * HZ)
+
 #define ROUND_UP_TO(x, y)	(((x) + (y) - 1) / (y) * (y))
 
 struct sfdp_parameter_header {
@@ -174,6 +180,23 @@ struct sfdp_header {
 #define PROFILE1_DWORD5_DUMMY_100MHZ		GENMASK(11, 7)
 #define PROFILE1_DUMMY_DEFAULT			20
 
+/* Sector Map Parameter Table (from JESD216 rev B). */
+#define SMPT_CMD_ADDRESS_LEN_MASK		GENMASK(23, 22)
+#define SMPT_CMD_ADDRESS_LEN_0			(0x0UL << 22)
+#define SMPT_CMD_ADDRESS_LEN_3			(0x1UL << 22)
+#define SMPT_CMD_ADDRESS_LEN_4			(0x2UL << 22)
+#define SMPT_CMD_ADDRESS_LEN_USE_CURRENT	(0x3UL << 22)
+#define SMPT_CMD_READ_DUMMY_MASK		GENMASK(19, 16)
+#define SMPT_CMD_READ_DUMMY_IS_VARIABLE		0xfUL
+#define SMPT_CMD_READ_DATA_MASK			GENMASK(31, 24)
+#define SMPT_CMD_OPCODE_MASK			GENMASK(15, 8)
+#define SMPT_MAP_ID_MASK			GENMASK(15, 8)
+#define SMPT_MAP_REGION_COUNT_MASK		GENMASK(23, 16)
+#define SMPT_MAP_REGION_SIZE_MASK		GENMASK(31, 8)
+#define SMPT_MAP_REGION_ERASE_TYPE_MASK		GENMASK(3, 0)
+#define SMPT_DESC_TYPE_MAP			BIT(1)
+#define SMPT_DESC_END				BIT(0)
+
 struct sfdp_bfpt {
 	u32	dwords[BFPT_DWORD_MAX];
 };
@@ -342,6 +365,16 @@ static int spansion_write_any_reg(struct spi_nor *nor, u32 addr, u8 val)
 }
 #endif
 
+static void spi_nor_setup_read_op(struct spi_nor *nor, struct spi_mem_op *op)
+{
+	spi_nor_setup_op(nor, op, nor->read_proto);
+
+	/* convert the dummy cycles to the number of bytes */
+	op->dummy.nbytes = (nor->read_dummy * op->dummy.buswidth) / 8;
+	if (spi_nor_protocol_is_dtr(nor->read_proto))
+		op->dummy.nbytes *= 2;
+}
+
 static ssize_t spi_nor_read_data(struct spi_nor *nor, loff_t from, size_t len,
 				 u_char *buf)
 {
@@ -353,12 +386,12 @@ static ssize_t spi_nor_read_data(struct spi_nor *nor, loff_t from, size_t len,
 	size_t remaining = len;
 	int ret;
 
-	spi_nor_setup_op(nor, &op, nor->read_proto);
+#if CONFIG_IS_ENABLED(SPI_DIRMAP)
+	if (nor->dirmap.rdesc)
+		return spi_mem_dirmap_read(nor->dirmap.rdesc, from, len, buf);
+#endif
 
-	/* convert the dummy cycles to the number of bytes */
-	op.dummy.nbytes = (nor->read_dummy * op.dummy.buswidth) / 8;
-	if (spi_nor_protocol_is_dtr(nor->read_proto))
-		op.dummy.nbytes *= 2;
+	spi_nor_setup_read_op(nor, &op);
 
 	while (remaining) {
 		op.data.nbytes = remaining < UINT_MAX ? remaining : UINT_MAX;
@@ -607,6 +640,8 @@ static u8 spi_nor_convert_3to4_erase(u8 opcode)
 static void spi_nor_set_4byte_opcodes(struct spi_nor *nor,
 				      const struct flash_info *info)
 {
+	int i;
+
 	/* Do some manufacturer fixups first */
 	switch (JEDEC_MFR(info)) {
 	case SNOR_MFR_SPANSION:
@@ -622,6 +657,16 @@ static void spi_nor_set_4byte_opcodes(struct spi_nor *nor,
 	nor->read_opcode = spi_nor_convert_3to4_read(nor->read_opcode);
 	nor->program_opcode = spi_nor_convert_3to4_program(nor->program_opcode);
 	nor->erase_opcode = spi_nor_convert_3to4_erase(nor->erase_opcode);
+
+	for (i = 0; i < SNOR_ERASE_TYPE_MAX; i++) {
+		struct spi_nor_erase_type *erase = &nor->erase_type[i];
+		u8 opcode = spi_nor_convert_3to4_erase(erase->opcode);
+
+		/* Drop erase types that have no 4-byte address variant */
+		if (opcode == erase->opcode)
+			erase->size = 0;
+		erase->opcode = opcode;
+	}
 }
 #endif /* !CONFIG_SPI_FLASH_BAR */
 
@@ -873,23 +918,68 @@ static int read_bar(struct spi_nor *nor, const struct flash_info *info)
 #endif
 
 /*
- * Initiate the erasure of a single sector. Returns the number of bytes erased
- * on success, a negative error code on error.
+ * Select the largest erase command that fits an aligned block at @addr
+ * within @len bytes, falling back to the default sector erase. With a
+ * sector map, only the erase types of the region holding @addr are used
+ * and the block may not cross the end of that region.
  */
-static int spi_nor_erase_sector(struct spi_nor *nor, u32 addr)
+static u32 spi_nor_select_erase_type(struct spi_nor *nor, u32 addr, u32 len,
+				     u8 *opcode)
+{
+	u32 size = nor->mtd.erasesize;
+	u8 mask = GENMASK(SNOR_ERASE_TYPE_MAX - 1, 0);
+	u32 offset = 0;
+	int i;
+
+	for (i = 0; i < nor->erase_map_count; i++) {
+		const struct spi_nor_erase_region *region = &nor->erase_map[i];
+
+		offset += region->size;
+		if (addr < offset) {
+			mask = region->erase_mask;
+			len = min(len, offset - addr);
+			break;
+		}
+	}
+
+	*opcode = nor->erase_opcode;
+	for (i = 0; i < SNOR_ERASE_TYPE_MAX; i++) {
+		const struct spi_nor_erase_type *erase = &nor->erase_type[i];
+
+		if (!(mask & BIT(i)) || erase->size <= size ||
+		    erase->size > len || addr % erase->size)
+			continue;
+
+		size = erase->size;
+		*opcode = erase->opcode;
+	}
+
+	return size;
+}
+
+/*
+ * Initiate the erasure of a single sector, or of the largest aligned block
+ * which fits in @len. Returns the number of bytes erased on success, a
+ * negative error code on error.
+ */
+static int spi_nor_erase_sector(struct spi_nor *nor, u32 addr, u32 len)
 {
 	struct spi_mem_op op =
 		SPI_MEM_OP(SPI_MEM_OP_CMD(nor->erase_opcode, 0),
 			   SPI_MEM_OP_ADDR(nor->addr_width, addr, 0),
 			   SPI_MEM_OP_NO_DUMMY,
 			   SPI_MEM_OP_NO_DATA);
+	u32 size;
+	u8 opcode;
 	int ret;
 
-	spi_nor_setup_op(nor, &op, nor->write_proto);
-
 	if (nor->erase)
 		return nor->erase(nor, addr);
 
+	size = spi_nor_select_erase_type(nor, addr, len, &opcode);
+	op.cmd.opcode = opcode;
+	spi_nor_setup_op(nor, &op, nor->write_proto);
+
 	/*
 	 * Default implementation, if driver doesn't have a specialized HW
 	 * control
@@ -898,7 +988,20 @@ static int spi_nor_erase_sector(struct spi_nor *nor, u32 addr)
 	if (ret)
 		return ret;
 
-	return nor->mtd.erasesize;
+	return size;
+}
+
+static int spi_nor_erase_chip(struct spi_nor *nor)
+{
+	struct spi_mem_op op =
+		SPI_MEM_OP(SPI_MEM_OP_CMD(SPINOR_OP_CHIP_ERASE, 0),
+			   SPI_MEM_OP_NO_ADDR,
+			   SPI_MEM_OP_NO_DUMMY,
+			   SPI_MEM_OP_NO_DATA);
+
+	spi_nor_setup_op(nor, &op, nor->write_proto);
+
+	return spi_mem_exec_op(nor->spi, &op);
 }
 
 /*
@@ -927,6 +1030,35 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 	instr->state = MTD_ERASING;
 	addr_known = true;
 
+	/* whole-chip erase? */
+	if (len == mtd->size && !nor->erase &&
+	    !(nor->flags & SNOR_F_NO_OP_CHIP_ERASE)) {
+		unsigned long timeout;
+
+		ret = write_enable(nor);
+		if (ret < 0)
+			goto erase_err;
+
+		ret = spi_nor_erase_chip(nor);
+		if (ret < 0)
+			goto erase_err;
+
+		/*
+		 * Scale the timeout linearly with the size of the flash, with
+		 * a minimum calibrated to an old 2MB flash. We could try to
+		 * pull these from CFI/SFDP, but these values should be good
+		 * enough for now.
+		 */
+		timeout = max(CHIP_ERASE_2MB_READY_WAIT_JIFFIES,
+			      CHIP_ERASE_2MB_READY_WAIT_JIFFIES *
+			      (unsigned long)div_u64(mtd->size, SZ_2M));
+		ret = spi_nor_wait_till_ready_with_timeout(nor, timeout);
+		if (ret)
+			goto erase_err;
+
+		len = 0;
+	}
+
 	while (len) {
 		WATCHDOG_RESET();
 		if (ctrlc()) {
@@ -943,7 +1075,7 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 		if (ret < 0)
 			goto erase_err;
 
-		ret = spi_nor_erase_sector(nor, addr);
+		ret = spi_nor_erase_sector(nor, addr, len);
 		if (ret < 0)
 			goto erase_err;
 
@@ -2181,6 +2313,7 @@ static int spi_nor_parse_bfpt(struct spi_nor *nor,
 {
 	struct mtd_info *mtd = &nor->mtd;
 	struct sfdp_bfpt bfpt;
+	bool sect_4k = false;
 	size_t len;
 	int i, cmd, err;
 	u32 addr;
@@ -2268,14 +2401,18 @@ static int spi_nor_parse_bfpt(struct spi_nor *nor,
 
 		erasesize = 1U << erasesize;
 		opcode = (half >> 8) & 0xff;
+		nor->erase_type[i].size = erasesize;
+		nor->erase_type[i].opcode = opcode;
 #ifdef CONFIG_SPI_FLASH_USE_4K_SECTORS
 		if (erasesize == SZ_4K) {
 			nor->erase_opcode = opcode;
 			mtd->erasesize = erasesize;
-			break;
+			sect_4k = true;
+			continue;
 		}
 #endif
-		if (!mtd->erasesize || mtd->erasesize < erasesize) {
+		if (!sect_4k &&
+		    (!mtd->erasesize || mtd->erasesize < erasesize)) {
 			nor->erase_opcode = opcode;
 			mtd->erasesize = erasesize;
 		}
@@ -2456,6 +2593,169 @@ out:
 	return ret;
 }
 
+/**
+ * spi_nor_smpt_read_map_id() - run the detection commands of a Sector Map
+ *				Parameter Table to get the current map ID
+ * @nor:	pointer to a 'struct spi_nor'
+ * @smpt:	pointer to the Sector Map Parameter Table DWORDs
+ * @count:	number of DWORDs in @smpt
+ * @map_id:	where to store the ID of the configuration in use
+ *
+ * Return: index of the first map descriptor on success, -errno otherwise.
+ */
+static int spi_nor_smpt_read_map_id(struct spi_nor *nor, const u32 *smpt,
+				    int count, u8 *map_id)
+{
+	u8 addr_width, read_opcode, read_dummy;
+	int i, ret = 0;
+	u8 *buf;
+	u32 addr;
+
+	buf = kmalloc(1, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	read_opcode = nor->read_opcode;
+	addr_width = nor->addr_width;
+	read_dummy = nor->read_dummy;
+
+	*map_id = 0;
+	for (i = 0; i + 1 < count && !(smpt[i] & SMPT_DESC_TYPE_MAP); i += 2) {
+		switch (smpt[i] & SMPT_CMD_ADDRESS_LEN_MASK) {
+		case SMPT_CMD_ADDRESS_LEN_0:
+			nor->addr_width = 0;
+			break;
+		case SMPT_CMD_ADDRESS_LEN_3:
+			nor->addr_width = 3;
+			break;
+		case SMPT_CMD_ADDRESS_LEN_4:
+			nor->addr_width = 4;
+			break;
+		default:
+			nor->addr_width = addr_width ?: 3;
+			break;
+		}
+
+		nor->read_dummy = FIELD_GET(SMPT_CMD_READ_DUMMY_MASK, smpt[i]);
+		if (nor->read_dummy == SMPT_CMD_READ_DUMMY_IS_VARIABLE)
+			nor->read_dummy = read_dummy;
+		nor->read_opcode = FIELD_GET(SMPT_CMD_OPCODE_MASK, smpt[i]);
+		addr = smpt[i + 1];
+
+		ret = nor->read(nor, addr, 1, buf);
+		if (ret != 1) {
+			ret = ret < 0 ? ret : -EIO;
+			goto out;
+		}
+
+		/* Each detection command contributes one bit to the map ID. */
+		*map_id = *map_id << 1 |
+			  !!(*buf & FIELD_GET(SMPT_CMD_READ_DATA_MASK, smpt[i]));
+
+		if (smpt[i] & SMPT_DESC_END) {
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+	ret = i + 1 < count ? i : -EINVAL;
+
+out:
+	nor->read_opcode = read_opcode;
+	nor->addr_width = addr_width;
+	nor->read_dummy = read_dummy;
+	kfree(buf);
+	return ret;
+}
+
+/**
+ * spi_nor_parse_smpt() - parse the Sector Map Parameter Table
+ * @nor:		pointer to a 'struct spi_nor'
+ * @smpt_header:	pointer to the 'struct sfdp_parameter_header' describing
+ *			the Sector Map Parameter Table length and version.
+ * @params:		pointer to the 'struct spi_nor_flash_parameter' to be.
+ *
+ * Record the erase types supported by each region of the sector map in use,
+ * so that larger erase commands are only issued where the flash accepts
+ * them.
+ *
+ * Return: 0 on success, -errno otherwise.
+ */
+static int spi_nor_parse_smpt(struct spi_nor *nor,
+			      const struct sfdp_parameter_header *smpt_header,
+			      struct spi_nor_flash_parameter *params)
+{
+	struct spi_nor_erase_region *map;
+	int i, ret, count, nregions;
+	u32 *smpt, addr;
+	u64 total = 0;
+	size_t len;
+	u8 map_id;
+
+	count = smpt_header->length;
+	len = count * sizeof(*smpt);
+	smpt = kmalloc(len, GFP_KERNEL);
+	if (!smpt)
+		return -ENOMEM;
+
+	addr = SFDP_PARAM_HEADER_PTP(smpt_header);
+	ret = spi_nor_read_sfdp(nor, addr, len, smpt);
+	if (ret)
+		goto out;
+
+	/* Fix endianness of the SMPT DWORDs. */
+	for (i = 0; i < count; i++)
+		smpt[i] = le32_to_cpu(smpt[i]);
+
+	ret = spi_nor_smpt_read_map_id(nor, smpt, count, &map_id);
+	if (ret < 0)
+		goto out;
+
+	/* Find the map descriptor matching the detected configuration. */
+	for (i = ret; i < count; i += nregions + 1) {
+		nregions = FIELD_GET(SMPT_MAP_REGION_COUNT_MASK, smpt[i]) + 1;
+		if (FIELD_GET(SMPT_MAP_ID_MASK, smpt[i]) == map_id)
+			break;
+		if (smpt[i] & SMPT_DESC_END)
+			i = count;
+	}
+
+	ret = -EINVAL;
+	if (i >= count || i + nregions >= count)
+		goto out;
+
+	map = devm_kmalloc(nor->dev, nregions * sizeof(*map), GFP_KERNEL);
+	if (!map) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (i++, count = 0; count < nregions; count++, i++) {
+		map[count].size = (FIELD_GET(SMPT_MAP_REGION_SIZE_MASK,
+					     smpt[i]) + 1) * 256;
+		map[count].erase_mask = FIELD_GET(SMPT_MAP_REGION_ERASE_TYPE_MASK,
+						  smpt[i]);
+		total += map[count].size;
+	}
+
+	if (total != params->size) {
+		dev_warn(nor->dev, "sector map does not cover the flash\n");
+		devm_kfree(nor->dev, map);
+		goto out;
+	}
+
+	nor->erase_map = map;
+	nor->erase_map_count = nregions;
+	ret = 0;
+
+out:
+	/* Without a usable map, only the default erase is safe everywhere. */
+	if (ret)
+		memset(nor->erase_type, 0, sizeof(nor->erase_type));
+	kfree(smpt);
+	return ret;
+}
+
 /**
  * spi_nor_parse_sfdp() - parse the Serial Flash Discoverable Parameters.
  * @nor:		pointer to a 'struct spi_nor'
@@ -2550,8 +2850,7 @@ static int spi_nor_parse_sfdp(struct spi_nor *nor,
 
 		switch (SFDP_PARAM_HEADER_ID(param_header)) {
 		case SFDP_SECTOR_MAP_ID:
-			dev_info(nor->dev,
-				 "non-uniform erase sector maps are not supported yet.\n");
+			err = spi_nor_parse_smpt(nor, param_header, params);
 			break;
 
 		case SFDP_SST_ID:
@@ -2619,6 +2918,8 @@ static int spi_nor_init_params(struct spi_nor *nor,
 			       const struct flash_info *info,
 			       struct spi_nor_flash_parameter *params)
 {
+	bool sfdp_ok = false;
+
 	/* Set legacy flash parameters as default. */
 	memset(params, 0, sizeof(*params));
 
@@ -2732,11 +3033,24 @@ static int spi_nor_init_params(struct spi_nor *nor,
 		if (spi_nor_parse_sfdp(nor, &sfdp_params)) {
 			nor->addr_width = 0;
 			nor->mtd.erasesize = 0;
+			memset(nor->erase_type, 0, sizeof(nor->erase_type));
 		} else {
 			memcpy(params, &sfdp_params, sizeof(*params));
+			sfdp_ok = true;
 		}
 	}
 
+	/*
+	 * Without SFDP the flash table sector erase is the only larger erase
+	 * known. It is not added when SFDP was parsed: a sector map which
+	 * could not be used leaves no erase types, so that only the default
+	 * erase is issued on a non-uniform flash.
+	 */
+	if (!sfdp_ok) {
+		nor->erase_type[0].size = info->sector_size;
+		nor->erase_type[0].opcode = SPINOR_OP_SE;
+	}
+
 	spi_nor_post_sfdp_fixups(nor, params);
 
 	return 0;
@@ -3061,6 +3375,7 @@ static int spi_nor_select_erase(struct spi_nor *nor,
 		nor->erase_opcode = SPINOR_OP_SE;
 		mtd->erasesize = info->sector_size;
 	}
+
 	return 0;
 }
 
@@ -3656,8 +3971,53 @@ out:
 }
 #endif /* CONFIG_SPI_FLASH_SOFT_RESET */
 
+#if CONFIG_IS_ENABLED(SPI_DIRMAP)
+static int spi_nor_create_read_dirmap(struct spi_nor *nor)
+{
+	struct spi_mem_dirmap_info info = {
+		.op_tmpl = SPI_MEM_OP(SPI_MEM_OP_CMD(nor->read_opcode, 0),
+				      SPI_MEM_OP_ADDR(nor->addr_width, 0, 0),
+				      SPI_MEM_OP_DUMMY(nor->read_dummy, 0),
+				      SPI_MEM_OP_DATA_IN(0, NULL, 0)),
+		.offset = 0,
+		.length = nor->mtd.size,
+	};
+	struct spi_mem_dirmap_desc *desc;
+
+	spi_nor_setup_read_op(nor, &info.op_tmpl);
+
+	/*
+	 * The template has no data length, so spi_nor_setup_op() leaves the
+	 * data buswidth alone. Set it here, as each read uses the template.
+	 */
+	info.op_tmpl.data.buswidth =
+		spi_nor_get_protocol_data_nbits(nor->read_proto);
+
+	desc = spi_mem_dirmap_create(nor->spi, &info);
+	if (IS_ERR(desc))
+		return PTR_ERR(desc);
+
+	nor->dirmap.rdesc = desc;
+
+	return 0;
+}
+
+static void spi_nor_destroy_read_dirmap(struct spi_nor *nor)
+{
+	if (!nor->dirmap.rdesc)
+		return;
+
+	spi_mem_dirmap_destroy(nor->dirmap.rdesc);
+	nor->dirmap.rdesc = NULL;
+}
+#endif /* CONFIG_SPI_DIRMAP */
+
 int spi_nor_remove(struct spi_nor *nor)
 {
+#if CONFIG_IS_ENABLED(SPI_DIRMAP)
+	spi_nor_destroy_read_dirmap(nor);
+#endif
+
 #ifdef CONFIG_SPI_FLASH_SOFT_RESET
 	if (nor->info->flags & SPI_NOR_OCTAL_DTR_READ &&
 	    nor->flags & SNOR_F_SOFT_RESET)
@@ -3876,6 +4236,19 @@ int spi_nor_scan(struct spi_nor *nor)
 	nor->erase_size = mtd->erasesize;
 	nor->sector_size = mtd->erasesize;
 
+#if CONFIG_IS_ENABLED(SPI_DIRMAP) && !defined(CONFIG_SPI_FLASH_BAR)
+	/*
+	 * Reads go through a direct mapping of the whole device from now on.
+	 * If the controller cannot map it, plain spi-mem operations are used
+	 * as before.
+	 */
+	spi_nor_destroy_read_dirmap(nor);
+	ret = spi_nor_create_read_dirmap(nor);
+	if (ret)
+		dev_dbg(nor->dev, "no read dirmap, using spi-mem ops: %d\n",
+			ret);
+#endif
+
 #ifndef CONFIG_SPL_BUILD
 	printf("SF: Detected %s with page size ", nor->name);
 	print_size(nor->page_size, ", erase size ");
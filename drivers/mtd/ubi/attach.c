@@ -832,6 +832,8 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
+	ubi_io_prefetch_hdrs(ubi, pnum);
+
 	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
 	if (err < 0)
 		return err;
@@ -1406,6 +1408,8 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 	if (!ai)
 		return -ENOMEM;
 
+	ubi_io_hdr_cache_init(ubi);
+
 #ifdef CONFIG_MTD_UBI_FASTMAP
 	/* On small flash devices we disable fastmap in any case. */
 	if ((int)mtd_div_by_eb(ubi->mtd->size, ubi->mtd) <= UBI_FM_MAX_START) {
@@ -1421,8 +1425,10 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 			if (err != UBI_NO_FASTMAP) {
 				destroy_ai(ai);
 				ai = alloc_ai();
-				if (!ai)
+				if (!ai) {
+					ubi_io_hdr_cache_free(ubi);
 					return -ENOMEM;
+				}
 
 				err = scan_all(ubi, ai, 0);
 			} else {
@@ -1433,6 +1439,7 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 #else
 	err = scan_all(ubi, ai, 0);
 #endif
+	ubi_io_hdr_cache_free(ubi);
 	if (err)
 		goto out_ai;
 
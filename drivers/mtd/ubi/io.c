@@ -136,6 +136,17 @@ int ubi_io_read(const struct ubi_device *ubi, void *buf, int pnum, int offset,
 	if (err)
 		return err;
 
+	/* Headers prefetched while attaching are served from memory */
+	if (pnum == ubi->hdr_cache_pnum &&
+	    offset + len <= ubi->hdr_cache_len) {
+		memcpy(buf, ubi->hdr_cache + offset, len);
+		if (ubi_dbg_is_bitflip(ubi)) {
+			dbg_gen("bit-flip (emulated)");
+			return UBI_IO_BITFLIPS;
+		}
+		return 0;
+	}
+
 	/*
 	 * Deliberately corrupt the buffer to improve robustness. Indeed, if we
 	 * do not do this, the following may happen:
@@ -251,6 +262,9 @@ int ubi_io_write(struct ubi_device *ubi, const void *buf, int pnum, int offset,
 	if (err)
 		return err;
 
+	if (pnum == ubi->hdr_cache_pnum)
+		ubi->hdr_cache_pnum = -1;
+
 	/* The area we are writing to has to contain all 0xFF bytes */
 	err = ubi_self_check_all_ff(ubi, pnum, offset, len);
 	if (err)
@@ -327,6 +341,9 @@ static int do_sync_erase(struct ubi_device *ubi, int pnum)
 		return -EROFS;
 	}
 
+	if (pnum == ubi->hdr_cache_pnum)
+		ubi->hdr_cache_pnum = -1;
+
 retry:
 	init_waitqueue_head(&wq);
 	memset(&ei, 0, sizeof(struct erase_info));
@@ -1101,6 +1118,62 @@ int ubi_io_write_vid_hdr(struct ubi_device *ubi, int pnum,
 	return err;
 }
 
+/**
+ * ubi_io_hdr_cache_init - set up the header prefetch buffer.
+ * @ubi: UBI device description object
+ *
+ * While attaching, the EC and VID headers of each PEB are needed one after
+ * the other. Reading both with a single MTD read halves the number of flash
+ * accesses, and lets the driver stream consecutive pages when the VID header
+ * does not share a page with the EC header. If the buffer cannot be
+ * allocated, the headers are simply read one by one.
+ */
+void ubi_io_hdr_cache_init(struct ubi_device *ubi)
+{
+	ubi->hdr_cache_pnum = -1;
+	ubi->hdr_cache_len = ubi->vid_hdr_aloffset + ubi->vid_hdr_alsize;
+	ubi->hdr_cache = kmalloc(ubi->hdr_cache_len, GFP_KERNEL);
+}
+
+/**
+ * ubi_io_hdr_cache_free - release the header prefetch buffer.
+ * @ubi: UBI device description object
+ */
+void ubi_io_hdr_cache_free(struct ubi_device *ubi)
+{
+	kfree(ubi->hdr_cache);
+	ubi->hdr_cache = NULL;
+	ubi->hdr_cache_pnum = -1;
+	ubi->hdr_cache_len = 0;
+}
+
+/**
+ * ubi_io_prefetch_hdrs - read the EC and VID headers of a PEB in one go.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock number to read from
+ *
+ * Subsequent 'ubi_io_read_ec_hdr()' and 'ubi_io_read_vid_hdr()' calls for
+ * @pnum are served from memory. Nothing is cached if the read reports
+ * bit-flips or errors, so that the regular per-header reads handle and
+ * report them exactly as before.
+ */
+void ubi_io_prefetch_hdrs(struct ubi_device *ubi, int pnum)
+{
+	size_t read;
+	loff_t addr;
+	int err;
+
+	if (!ubi->hdr_cache)
+		return;
+
+	ubi->hdr_cache_pnum = -1;
+	addr = (loff_t)pnum * ubi->peb_size;
+	err = mtd_read(ubi->mtd, addr, ubi->hdr_cache_len, &read,
+		       ubi->hdr_cache);
+	if (!err && read == ubi->hdr_cache_len)
+		ubi->hdr_cache_pnum = pnum;
+}
+
 /**
  * self_check_not_bad - ensure that a physical eraseblock is not bad.
  * @ubi: UBI device description object
@@ -526,6 +526,10 @@ struct ubi_debug_info {
  *
  * @peb_buf: a buffer of PEB size used for different purposes
  * @buf_mutex: protects @peb_buf
+ * @hdr_cache: EC and VID headers of PEB @hdr_cache_pnum, read in one go while
+ *             attaching (%NULL when not attaching)
+ * @hdr_cache_pnum: PEB held in @hdr_cache, or %-1 if none
+ * @hdr_cache_len: length of @hdr_cache in bytes
  * @ckvol_mutex: serializes static volume checking when opening
  *
  * @dbg: debugging information for this UBI device
@@ -625,6 +629,9 @@ struct ubi_device {
 
 	void *peb_buf;
 	struct mutex buf_mutex;
+	void *hdr_cache;
+	int hdr_cache_pnum;
+	int hdr_cache_len;
 	struct mutex ckvol_mutex;
 
 	struct ubi_debug_info dbg;
@@ -898,6 +905,9 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 			struct ubi_vid_hdr *vid_hdr, int verbose);
 int ubi_io_write_vid_hdr(struct ubi_device *ubi, int pnum,
 			 struct ubi_vid_hdr *vid_hdr);
+void ubi_io_hdr_cache_init(struct ubi_device *ubi);
+void ubi_io_hdr_cache_free(struct ubi_device *ubi);
+void ubi_io_prefetch_hdrs(struct ubi_device *ubi, int pnum);
 
 /* build.c */
 int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
@@ -24,6 +24,7 @@
 #include <dm/device-internal.h>
 #include <dm/devres.h>
 #include <dm/lists.h>
+#include <linux/bug.h>
 #include <linux/compiler.h>
 #include <linux/delay.h>
 #include <linux/err.h>
@@ -269,11 +270,47 @@ static void tx_descs_init(struct dw_eth_dev *priv)
 	priv->tx_currdescnum = 0;
 }
 
+static int rx_ring_alloc(struct dw_eth_dev *priv, u32 num)
+{
+	priv->rx_mac_descrtable = memalign(ARCH_DMA_MINALIGN,
+					   num * sizeof(struct dmamacdescr));
+	priv->rxbuffs = memalign(ARCH_DMA_MINALIGN, num * CONFIG_ETH_BUFSIZE);
+	if (!priv->rx_mac_descrtable || !priv->rxbuffs)
+		return -ENOMEM;
+#ifdef CONFIG_NET_RX_HINT
+	priv->rx_slot = calloc(num, sizeof(*priv->rx_slot));
+	priv->rx_hdr_len = calloc(num, sizeof(*priv->rx_hdr_len));
+	if (!priv->rx_slot || !priv->rx_hdr_len)
+		return -ENOMEM;
+#endif
+
+	if ((u64)(ulong)priv->rxbuffs + num * CONFIG_ETH_BUFSIZE >
+	    (1ULL << 32) ||
+	    (u64)(ulong)&priv->rx_mac_descrtable[num] > (1ULL << 32)) {
+		printf("designware: buffers are outside DMA memory\n");
+		return -EINVAL;
+	}
+	priv->rx_descr_num = num;
+
+	return 0;
+}
+
+static void rx_ring_free(struct dw_eth_dev *priv)
+{
+	free(priv->rx_mac_descrtable);
+	free(priv->rxbuffs);
+#ifdef CONFIG_NET_RX_HINT
+	free(priv->rx_slot);
+	free(priv->rx_hdr_len);
+#endif
+}
+
 static void rx_descs_init(struct dw_eth_dev *priv)
 {
 	struct eth_dma_regs *dma_p = priv->dma_regs_p;
 	struct dmamacdescr *desc_table_p = &priv->rx_mac_descrtable[0];
 	char *rxbuffs = &priv->rxbuffs[0];
+	u32 num = priv->rx_descr_num;
 	struct dmamacdescr *desc_p;
 	u32 idx;
 
@@ -283,27 +320,43 @@ static void rx_descs_init(struct dw_eth_dev *priv)
 	 * Otherwise there's a chance to get some of them flushed in RAM when
 	 * GMAC is already pushing data to RAM via DMA. This way incoming from
 	 * GMAC data will be corrupted. */
-	flush_dcache_range((ulong)rxbuffs, (ulong)rxbuffs + RX_TOTAL_BUFSIZE);
+	flush_dcache_range((ulong)rxbuffs,
+			   (ulong)rxbuffs + num * CONFIG_ETH_BUFSIZE);
 
-	for (idx = 0; idx < CONFIG_RX_DESCR_NUM; idx++) {
+	for (idx = 0; idx < num; idx++) {
 		desc_p = &desc_table_p[idx];
 		desc_p->dmamac_addr = (ulong)&rxbuffs[idx * CONFIG_ETH_BUFSIZE];
+#ifdef CONFIG_NET_RX_HINT
+		/*
+		 * Use ring mode, where the second buffer address is free to
+		 * take part of a split packet. designware_eth_init() tells the
+		 * DMA how far apart the descriptors are.
+		 */
+		desc_p->dmamac_next = 0;
+		desc_p->dmamac_cntl = MAC_MAX_FRAME_SZ & DESC_RXCTRL_SIZE1MASK;
+		priv->rx_slot[idx] = NULL;
+#else
 		desc_p->dmamac_next = (ulong)&desc_table_p[idx + 1];
 
 		desc_p->dmamac_cntl =
 			(MAC_MAX_FRAME_SZ & DESC_RXCTRL_SIZE1MASK) |
 				      DESC_RXCTRL_RXCHAIN;
+#endif
 
 		desc_p->txrx_status = DESC_RXSTS_OWNBYDMA;
 	}
 
+#ifdef CONFIG_NET_RX_HINT
+	desc_p->dmamac_cntl |= DESC_RXCTRL_RXRINGEND;
+	priv->rx_ring_new = true;
+#else
 	/* Correcting the last pointer of the chain */
 	desc_p->dmamac_next = (ulong)&desc_table_p[0];
+#endif
 
 	/* Flush all Rx buffer descriptors at once */
 	flush_dcache_range((ulong)priv->rx_mac_descrtable,
-			   (ulong)priv->rx_mac_descrtable +
-			   sizeof(priv->rx_mac_descrtable));
+			   (ulong)&priv->rx_mac_descrtable[num]);
 
 	writel((ulong)&desc_table_p[0], &dma_p->rxdesclistaddr);
 	priv->rx_currdescnum = 0;
@@ -345,6 +398,11 @@ static int dw_adjust_link(struct dw_eth_dev *priv, struct eth_mac_regs *mac_p,
 	if (phydev->duplex)
 		conf |= FULLDPLXMODE;
 
+#ifdef CONFIG_NET_OFFLOAD
+	if (priv->rx_coe)
+		conf |= IPC_CSUM_OFFLOAD;
+#endif
+
 	writel(conf, &mac_p->conf);
 
 	printf("Speed: %d, %s duplex%s\n", phydev->speed,
@@ -370,6 +428,7 @@ int designware_eth_init(struct dw_eth_dev *priv, u8 *enetaddr)
 	struct eth_mac_regs *mac_p = priv->mac_regs_p;
 	struct eth_dma_regs *dma_p = priv->dma_regs_p;
 	unsigned int start;
+	u32 busmode;
 	int ret;
 
 	writel(readl(&dma_p->busmode) | DMAMAC_SRST, &dma_p->busmode);
@@ -402,7 +461,15 @@ int designware_eth_init(struct dw_eth_dev *priv, u8 *enetaddr)
 	rx_descs_init(priv);
 	tx_descs_init(priv);
 
-	writel(FIXEDBURST | PRIORXTX_41 | DMA_PBL, &dma_p->busmode);
+	busmode = FIXEDBURST | PRIORXTX_41 | DMA_PBL;
+#ifdef CONFIG_NET_RX_HINT
+	/* In ring mode the DMA skips the padding after each descriptor */
+	BUILD_BUG_ON(DESC_PAD_SIZE % CONFIG_ETH_DESIGNWARE_BUS_WIDTH ||
+		     DESC_PAD_SIZE / CONFIG_ETH_DESIGNWARE_BUS_WIDTH > 31);
+	busmode |= DESC_PAD_SIZE / CONFIG_ETH_DESIGNWARE_BUS_WIDTH <<
+		   DESCSKIPLEN_SHIFT;
+#endif
+	writel(busmode, &dma_p->busmode);
 
 #ifndef CONFIG_DW_MAC_FORCE_THRESHOLD_MODE
 	writel(readl(&dma_p->opmode) | FLUSHTXFIFO | STOREFORWARD,
@@ -447,7 +514,12 @@ int designware_eth_enable(struct dw_eth_dev *priv)
 
 #define ETH_ZLEN	60
 
-static int _dw_eth_send(struct dw_eth_dev *priv, void *packet, int length)
+/*
+ * Send a packet given in two parts, gathering them into the Tx buffer; the
+ * second part may be empty
+ */
+static int _dw_eth_send(struct dw_eth_dev *priv, void *packet, int length,
+			const void *data, int data_len)
 {
 	struct eth_dma_regs *dma_p = priv->dma_regs_p;
 	u32 desc_num = priv->tx_currdescnum;
@@ -456,7 +528,8 @@ static int _dw_eth_send(struct dw_eth_dev *priv, void *packet, int length)
 	ulong desc_end = desc_start +
 		roundup(sizeof(*desc_p), ARCH_DMA_MINALIGN);
 	ulong data_start = desc_p->dmamac_addr;
-	ulong data_end = data_start + roundup(length, ARCH_DMA_MINALIGN);
+	ulong data_end = data_start + roundup(length + data_len,
+					      ARCH_DMA_MINALIGN);
 	/*
 	 * Strictly we only need to invalidate the "txrx_status" field
 	 * for the following check, but on some platforms we cannot
@@ -474,6 +547,10 @@ static int _dw_eth_send(struct dw_eth_dev *priv, void *packet, int length)
 	}
 
 	memcpy((void *)data_start, packet, length);
+	if (data_len) {
+		memcpy((void *)data_start + length, data, data_len);
+		length += data_len;
+	}
 	if (length < ETH_ZLEN) {
 		memset(&((char *)data_start)[length], 0, ETH_ZLEN - length);
 		length = ETH_ZLEN;
@@ -489,12 +566,20 @@ static int _dw_eth_send(struct dw_eth_dev *priv, void *packet, int length)
 			      DESC_TXCTRL_SIZE1MASK);
 
 	desc_p->txrx_status &= ~(DESC_TXSTS_MSK);
+#ifdef CONFIG_NET_OFFLOAD
+	if (priv->tx_coe)
+		desc_p->txrx_status |= DESC_TXSTS_TXCHECKINSCTRL;
+#endif
 	desc_p->txrx_status |= DESC_TXSTS_OWNBYDMA;
 #else
 	desc_p->dmamac_cntl = (desc_p->dmamac_cntl & ~DESC_TXCTRL_SIZE1MASK) |
 			      ((length << DESC_TXCTRL_SIZE1SHFT) &
 			      DESC_TXCTRL_SIZE1MASK) | DESC_TXCTRL_TXLAST |
 			      DESC_TXCTRL_TXFIRST;
+#ifdef CONFIG_NET_OFFLOAD
+	if (priv->tx_coe)
+		desc_p->dmamac_cntl |= DESC_TXCTRL_TXCHECKINSCTRL;
+#endif
 
 	desc_p->txrx_status = DESC_TXSTS_OWNBYDMA;
 #endif
@@ -563,7 +648,7 @@ static int _dw_free_pkt(struct dw_eth_dev *priv)
 	flush_dcache_range(desc_start, desc_end);
 
 	/* Test the wrap-around condition. */
-	if (++desc_num >= CONFIG_RX_DESCR_NUM)
+	if (++desc_num >= priv->rx_descr_num)
 		desc_num = 0;
 	priv->rx_currdescnum = desc_num;
 
@@ -619,7 +704,7 @@ static int dw_eth_init(struct eth_device *dev, struct bd_info *bis)
 
 static int dw_eth_send(struct eth_device *dev, void *packet, int length)
 {
-	return _dw_eth_send(dev->priv, packet, length);
+	return _dw_eth_send(dev->priv, packet, length, NULL, 0);
 }
 
 static int dw_eth_recv(struct eth_device *dev)
@@ -675,6 +760,13 @@ int designware_initialize(ulong base_addr, u32 interface)
 	memset(dev, 0, sizeof(struct eth_device));
 	memset(priv, 0, sizeof(struct dw_eth_dev));
 
+	if (rx_ring_alloc(priv, CONFIG_RX_DESCR_NUM)) {
+		rx_ring_free(priv);
+		free(priv);
+		free(dev);
+		return -ENOMEM;
+	}
+
 	sprintf(dev->name, "dwmac.%lx", base_addr);
 	dev->iobase = (int)base_addr;
 	dev->priv = priv;
@@ -722,20 +814,155 @@ int designware_eth_send(struct udevice *dev, void *packet, int length)
 {
 	struct dw_eth_dev *priv = dev_get_priv(dev);
 
-	return _dw_eth_send(priv, packet, length);
+	return _dw_eth_send(priv, packet, length, NULL, 0);
+}
+
+int designware_eth_send_sg(struct udevice *dev, void *hdr, int hdr_len,
+			   const void *data, int data_len)
+{
+	struct dw_eth_dev *priv = dev_get_priv(dev);
+
+	if (hdr_len + data_len > CONFIG_ETH_BUFSIZE)
+		return -EMSGSIZE;
+
+	return _dw_eth_send(priv, hdr, hdr_len, data, data_len);
+}
+
+#ifdef CONFIG_NET_RX_HINT
+/* Slot length, which must hold the largest packet less its headers */
+#define DW_RX_SLOT_SIZE	roundup(MAC_MAX_FRAME_SZ, ARCH_DMA_MINALIGN)
+
+/*
+ * The first buffer of a split packet takes the headers, rounded up to a whole
+ * number of bus words, so the second one starts a few bytes into the slot.
+ * Move those first few bytes of the payload across to the start of the slot.
+ */
+static void dw_rx_split(struct udevice *dev, struct dw_eth_dev *priv,
+			uchar *packet, int length)
+{
+	u32 desc_num = priv->rx_currdescnum;
+	uchar *slot = priv->rx_slot[desc_num];
+	u32 hdr_len = priv->rx_hdr_len[desc_num];
+	u32 size1 = ALIGN(hdr_len, MAC_RX_BUF_ALIGN);
+
+	if (!slot || length <= size1)
+		return;
+
+	invalidate_dcache_range((ulong)slot, (ulong)slot +
+				roundup(length - hdr_len, ARCH_DMA_MINALIGN));
+	memcpy(slot, packet + hdr_len, size1 - hdr_len);
+	eth_rx_set_payload(dev, slot, hdr_len);
+}
+
+/* Set up the current Rx descriptor with the next slot, if there is one */
+static void dw_rx_post(struct udevice *dev, struct dw_eth_dev *priv)
+{
+	u32 desc_num = priv->rx_currdescnum;
+	struct dmamacdescr *desc_p = &priv->rx_mac_descrtable[desc_num];
+	ulong buf = desc_p->dmamac_addr;
+	u32 size1 = MAC_MAX_FRAME_SZ, size2 = 0;
+	uint slot_len = DW_RX_SLOT_SIZE;
+	u32 hdr_len = 0;
+	ulong buf2 = 0;
+	uchar *slot;
+
+	/* The payload of the last packet may have been copied back */
+	if (priv->rx_slot[desc_num])
+		flush_dcache_range(buf, buf + DW_RX_SLOT_SIZE);
+
+	slot = eth_rx_hint_buf(dev, desc_num, ARCH_DMA_MINALIGN, &slot_len,
+			       &hdr_len);
+	if (slot) {
+		/*
+		 * The second buffer starts a few bytes into the slot, but the
+		 * DMA writes from the bus word holding that start and counts
+		 * the buffer size from there, so the buffer is the slot
+		 */
+		size1 = ALIGN(hdr_len, MAC_RX_BUF_ALIGN);
+		size2 = ALIGN_DOWN(slot_len, MAC_RX_BUF_ALIGN);
+		buf2 = (ulong)slot + size1 - hdr_len;
+		flush_dcache_range((ulong)slot, (ulong)slot + slot_len);
+	}
+	priv->rx_slot[desc_num] = slot;
+	priv->rx_hdr_len[desc_num] = hdr_len;
+
+	desc_p->dmamac_next = buf2;
+	desc_p->dmamac_cntl = (desc_p->dmamac_cntl & DESC_RXCTRL_RXRINGEND) |
+		((size1 << DESC_RXCTRL_SIZE1SHFT) & DESC_RXCTRL_SIZE1MASK) |
+		((size2 << DESC_RXCTRL_SIZE2SHFT) & DESC_RXCTRL_SIZE2MASK);
+}
+
+/* Check that the current Rx descriptor holds a whole frame */
+static bool dw_rx_whole(struct dw_eth_dev *priv)
+{
+	struct dmamacdescr *desc_p =
+		&priv->rx_mac_descrtable[priv->rx_currdescnum];
+	u32 both = DESC_RXSTS_RXFIRST | DESC_RXSTS_RXLAST;
+
+	return (desc_p->txrx_status & both) == both;
+}
+#endif
+
+/* Count the frames which the DMA had to drop since the last look */
+static void dw_count_missed(struct udevice *dev, struct dw_eth_dev *priv)
+{
+	u32 missed = readl(&priv->dma_regs_p->missedframes);
+
+	eth_get_stats(dev)->rx_overruns += (missed & MISSED_NODESC_MASK) +
+		((missed & MISSED_FIFO_MASK) >> MISSED_FIFO_SHIFT);
 }
 
 int designware_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct dw_eth_dev *priv = dev_get_priv(dev);
+	int length;
 
-	return _dw_eth_recv(priv, packetp);
+	length = _dw_eth_recv(priv, packetp);
+#ifdef CONFIG_NET_RX_HINT
+	if (priv->rx_ring_new) {
+		eth_rx_hint_reset(dev, priv->rx_descr_num);
+		priv->rx_ring_new = false;
+	}
+
+	/*
+	 * A frame too long for a descriptor with a slot runs on into the
+	 * next descriptors. It is not one the hint asked for, so drop it.
+	 */
+	while (length > 0 && !dw_rx_whole(priv)) {
+		eth_get_stats(dev)->rx_dropped++;
+		dw_rx_post(dev, priv);
+		_dw_free_pkt(priv);
+		length = _dw_eth_recv(priv, packetp);
+	}
+#endif
+	if (length == -EAGAIN)
+		dw_count_missed(dev, priv);
+#ifdef CONFIG_NET_RX_HINT
+	if (length > 0)
+		dw_rx_split(dev, priv, *packetp, length);
+#endif
+#ifdef CONFIG_NET_OFFLOAD
+	if (length > 0 && priv->rx_coe) {
+		struct dmamacdescr *desc_p =
+			&priv->rx_mac_descrtable[priv->rx_currdescnum];
+
+		if ((desc_p->txrx_status & DESC_RXSTS_CSUM_MASK) ==
+		    DESC_RXSTS_CSUM_OK)
+			eth_rx_set_csum_ok(dev);
+	}
+#endif
+
+	return length;
 }
 
 int designware_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
 	struct dw_eth_dev *priv = dev_get_priv(dev);
 
+#ifdef CONFIG_NET_RX_HINT
+	dw_rx_post(dev, priv);
+#endif
+
 	return _dw_free_pkt(priv);
 }
 
@@ -778,6 +1005,9 @@ int designware_eth_probe(struct udevice *dev)
 	ulong ioaddr;
 	int ret, err;
 	struct reset_ctl_bulk reset_bulk;
+#ifdef CONFIG_NET_OFFLOAD
+	u32 hwfeature;
+#endif
 #ifdef CONFIG_CLK
 	int i, clock_nb;
 
@@ -851,6 +1081,23 @@ int designware_eth_probe(struct udevice *dev)
 	priv->interface = pdata->phy_interface;
 	priv->max_speed = pdata->max_speed;
 
+#ifdef CONFIG_NET_OFFLOAD
+	hwfeature = readl(&priv->dma_regs_p->hwfeature);
+	priv->rx_coe = hwfeature & HWFEAT_RXTYP2COE;
+	/* Tx checksum insertion needs the whole frame in the FIFO */
+	priv->tx_coe = !IS_ENABLED(CONFIG_DW_MAC_FORCE_THRESHOLD_MODE) &&
+		(hwfeature & HWFEAT_TXCOESEL);
+	if (priv->tx_coe)
+		pdata->features |= ETH_FEAT_TX_CSUM;
+#endif
+
+	ret = rx_ring_alloc(priv, eth_get_rx_ring_size(dev,
+						       CONFIG_RX_DESCR_NUM));
+	if (ret) {
+		err = ret;
+		goto mdio_err;
+	}
+
 #if IS_ENABLED(CONFIG_DM_MDIO)
 	ret = dw_dm_mdio_init(dev->name, dev);
 #else
@@ -872,6 +1119,7 @@ int designware_eth_probe(struct udevice *dev)
 	mdio_unregister(priv->bus);
 	mdio_free(priv->bus);
 mdio_err:
+	rx_ring_free(priv);
 
 #ifdef CONFIG_CLK
 clk_err:
@@ -890,6 +1138,7 @@ static int designware_eth_remove(struct udevice *dev)
 	free(priv->phydev);
 	mdio_unregister(priv->bus);
 	mdio_free(priv->bus);
+	rx_ring_free(priv);
 
 #ifdef CONFIG_CLK
 	return clk_release_all(priv->clocks, priv->clock_count);
@@ -905,6 +1154,7 @@ const struct eth_ops designware_eth_ops = {
 	.free_pkt		= designware_eth_free_pkt,
 	.stop			= designware_eth_stop,
 	.write_hwaddr		= designware_eth_write_hwaddr,
+	.send_sg		= designware_eth_send_sg,
 };
 
 int designware_eth_of_to_plat(struct udevice *dev)
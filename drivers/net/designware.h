@@ -18,7 +18,6 @@
 #define CONFIG_RX_DESCR_NUM	16
 #define CONFIG_ETH_BUFSIZE	2048
 #define TX_TOTAL_BUFSIZE	(CONFIG_ETH_BUFSIZE * CONFIG_TX_DESCR_NUM)
-#define RX_TOTAL_BUFSIZE	(CONFIG_ETH_BUFSIZE * CONFIG_RX_DESCR_NUM)
 
 #define CONFIG_MACRESET_TIMEOUT	(3 * CONFIG_SYS_HZ)
 #define CONFIG_MDIO_TIMEOUT	(3 * CONFIG_SYS_HZ)
@@ -46,6 +45,7 @@ struct eth_mac_regs {
 #define FES_100			(1 << 14)
 #define DISABLERXOWN		(1 << 13)
 #define FULLDPLXMODE		(1 << 11)
+#define IPC_CSUM_OFFLOAD	(1 << 10)
 #define RXENABLE		(1 << 2)
 #define TXENABLE		(1 << 3)
 
@@ -74,13 +74,15 @@ struct eth_dma_regs {
 	u32 status;		/* 0x14 */
 	u32 opmode;		/* 0x18 */
 	u32 intenable;		/* 0x1c */
-	u32 reserved1[2];
+	u32 missedframes;	/* 0x20 */
+	u32 reserved1[1];
 	u32 axibus;		/* 0x28 */
 	u32 reserved2[7];
 	u32 currhosttxdesc;	/* 0x48 */
 	u32 currhostrxdesc;	/* 0x4c */
 	u32 currhosttxbuffaddr;	/* 0x50 */
 	u32 currhostrxbuffaddr;	/* 0x54 */
+	u32 hwfeature;		/* 0x58 */
 };
 
 #define DW_DMA_BASE_OFFSET	(0x1000)
@@ -97,9 +99,19 @@ struct eth_dma_regs {
 #define PRIORXTX_21		(1 << 14)
 #define PRIORXTX_11		(0 << 14)
 #define DMA_PBL			(CONFIG_DW_GMAC_DEFAULT_DMA_PBL<<8)
+#define DESCSKIPLEN_SHIFT	2	/* bus words between ring descriptors */
 #define RXHIGHPRIO		(1 << 1)
 #define DMAMAC_SRST		(1 << 0)
 
+/* Missed frame counter definitions, cleared on read */
+#define MISSED_NODESC_MASK	0xffff		/* no Rx descriptor */
+#define MISSED_FIFO_SHIFT	17
+#define MISSED_FIFO_MASK	(0x7ff << 17)	/* Rx FIFO overflow */
+
+/* HW feature register definitions, which older cores read as 0 */
+#define HWFEAT_RXTYP2COE	(1 << 18)	/* Rx full checksum offload */
+#define HWFEAT_TXCOESEL		(1 << 16)	/* Tx checksum insertion */
+
 /* Poll demand definitions */
 #define POLL_DATA		(0xFFFFFFFF)
 
@@ -112,6 +124,8 @@ struct eth_dma_regs {
 
 /* Descriptior related definitions */
 #define MAC_MAX_FRAME_SZ	(1600)
+/* Rx buffer sizes must be a multiple of the bus width, at most 128 bits */
+#define MAC_RX_BUF_ALIGN	16
 
 struct dmamacdescr {
 	u32 txrx_status;
@@ -120,6 +134,9 @@ struct dmamacdescr {
 	u32 dmamac_next;
 } __aligned(ARCH_DMA_MINALIGN);
 
+/* Padding which the alignment puts after each descriptor */
+#define DESC_PAD_SIZE	(sizeof(struct dmamacdescr) - 4 * sizeof(u32))
+
 /*
  * txrx_status definitions
  */
@@ -167,6 +184,16 @@ struct dmamacdescr {
 #define DESC_RXSTS_RXMIIERROR		(1 << 3)
 #define DESC_RXSTS_RXDRIBBLING		(1 << 2)
 #define DESC_RXSTS_RXCRC		(1 << 1)
+#define DESC_RXSTS_RXPAYLOADCSUM	(1 << 0)
+
+/*
+ * With Rx checksum offload, an IP packet whose checksums are good has the
+ * frame type bit set and both checksum error bits clear
+ */
+#define DESC_RXSTS_CSUM_MASK	(DESC_RXSTS_RXFRAMEETHER | \
+				 DESC_RXSTS_RXIPC_GIANT | \
+				 DESC_RXSTS_RXPAYLOADCSUM)
+#define DESC_RXSTS_CSUM_OK	DESC_RXSTS_RXFRAMEETHER
 
 /*
  * dmamac_cntl definitions
@@ -224,9 +251,10 @@ struct dmamacdescr {
 
 struct dw_eth_dev {
 	struct dmamacdescr tx_mac_descrtable[CONFIG_TX_DESCR_NUM];
-	struct dmamacdescr rx_mac_descrtable[CONFIG_RX_DESCR_NUM];
+	struct dmamacdescr *rx_mac_descrtable;
 	char txbuffs[TX_TOTAL_BUFSIZE] __aligned(ARCH_DMA_MINALIGN);
-	char rxbuffs[RX_TOTAL_BUFSIZE] __aligned(ARCH_DMA_MINALIGN);
+	char *rxbuffs;
+	u32 rx_descr_num;	/* size of the Rx ring */
 
 	u32 interface;
 	u32 max_speed;
@@ -238,6 +266,16 @@ struct dw_eth_dev {
 #ifndef CONFIG_DM_ETH
 	struct eth_device *dev;
 #endif
+#ifdef CONFIG_NET_RX_HINT
+	/* Slot from eth_rx_hint_buf() for each Rx descriptor, or NULL */
+	uchar **rx_slot;
+	u32 *rx_hdr_len;
+	bool rx_ring_new;	/* descriptors set up since the last recv */
+#endif
+#ifdef CONFIG_NET_OFFLOAD
+	bool tx_coe;		/* the MAC fills in UDP/TCP checksums */
+	bool rx_coe;		/* the MAC checks IP/UDP/TCP checksums */
+#endif
 #if CONFIG_IS_ENABLED(DM_GPIO)
 	struct gpio_desc reset_gpio;
 #endif
@@ -263,6 +301,8 @@ struct dw_eth_pdata {
 int designware_eth_init(struct dw_eth_dev *priv, u8 *enetaddr);
 int designware_eth_enable(struct dw_eth_dev *priv);
 int designware_eth_send(struct udevice *dev, void *packet, int length);
+int designware_eth_send_sg(struct udevice *dev, void *hdr, int hdr_len,
+			   const void *data, int data_len);
 int designware_eth_recv(struct udevice *dev, int flags, uchar **packetp);
 int designware_eth_free_pkt(struct udevice *dev, uchar *packet,
 				   int length);
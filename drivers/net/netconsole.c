@@ -10,11 +10,15 @@
 #include <log.h>
 #include <stdio_dev.h>
 #include <net.h>
+#include <linux/build_bug.h>
 
 #ifndef CONFIG_NETCONSOLE_BUFFER_SIZE
 #define CONFIG_NETCONSOLE_BUFFER_SIZE 512
 #endif
 
+/* Most output sent in one datagram, so that it is not fragmented */
+#define NC_PACKET_SIZE	(1500 - IP_UDP_HDR_SIZE)
+
 static char input_buffer[CONFIG_NETCONSOLE_BUFFER_SIZE];
 static int input_size; /* char count in input buffer */
 static int input_offset; /* offset to valid chars in input buffer */
@@ -27,6 +31,7 @@ static short nc_out_port; /* target output port */
 static short nc_in_port; /* source input port */
 static const char *output_packet; /* used by first send udp */
 static int output_packet_len;
+static bool nc_started; /* set up by nc_stdio_start() */
 /*
  * Start with a default last protocol.
  * We are only interested in NETCONS or not.
@@ -178,7 +183,6 @@ static void nc_send_packet(const char *buf, int len)
 	struct eth_device *eth;
 #endif
 	int inited = 0;
-	uchar *pkt;
 	uchar *ether;
 	struct in_addr ip;
 
@@ -188,7 +192,8 @@ static void nc_send_packet(const char *buf, int len)
 	if (eth == NULL)
 		return;
 
-	if (!memcmp(nc_ether, net_null_ethaddr, 6)) {
+	if (!memcmp(nc_ether, net_null_ethaddr, 6) &&
+	    !arp_cache_lookup(nc_ip, nc_ether)) {
 		if (eth_is_active(eth))
 			return;	/* inside net loop */
 		output_packet = buf;
@@ -211,11 +216,9 @@ static void nc_send_packet(const char *buf, int len)
 
 		inited = 1;
 	}
-	pkt = (uchar *)net_tx_packet + net_eth_hdr_size() + IP_UDP_HDR_SIZE;
-	memcpy(pkt, buf, len);
 	ether = nc_ether;
 	ip = nc_ip;
-	net_send_udp_packet(ether, ip, nc_out_port, nc_in_port, len);
+	net_send_udp_data(ether, ip, nc_out_port, nc_in_port, buf, len);
 
 	if (inited) {
 		if (eth_is_on_demand_init())
@@ -225,6 +228,110 @@ static void nc_send_packet(const char *buf, int len)
 	}
 }
 
+#ifdef CONFIG_NETCONSOLE_BUFFERED
+/*
+ * Output ring. Only producers move nc_ring_head and only nc_ring_send()
+ * moves nc_ring_tail, with the bytes copied out before they are sent, so
+ * that output (e.g. a log record) produced while a datagram is on its way
+ * is simply queued behind it. Both counts run freely and wrap.
+ */
+static char nc_ring[CONFIG_NETCONSOLE_RING_SIZE];
+static uint nc_ring_head;
+static uint nc_ring_tail;
+static ulong nc_ring_start; /* when the oldest queued byte was added */
+static ulong nc_ring_sent; /* when output was last sent */
+static char nc_packet[NC_PACKET_SIZE];
+
+/* Send queued output, leaving at most @keep bytes in the ring */
+static void nc_ring_send(uint keep)
+{
+	uint len, pos, chunk;
+
+	while (nc_ring_head - nc_ring_tail > keep) {
+		len = min(nc_ring_head - nc_ring_tail, (uint)NC_PACKET_SIZE);
+		pos = nc_ring_tail % CONFIG_NETCONSOLE_RING_SIZE;
+		chunk = min(len, CONFIG_NETCONSOLE_RING_SIZE - pos);
+		memcpy(nc_packet, nc_ring + pos, chunk);
+		memcpy(nc_packet + chunk, nc_ring, len - chunk);
+		nc_ring_tail += len;
+		nc_ring_start = get_timer(0);
+		nc_ring_sent = nc_ring_start;
+		nc_send_packet(nc_packet, len);
+	}
+}
+
+void nc_output(const char *s, int len)
+{
+	bool newline = memchr(s, '\n', len);
+	bool idle = nc_ring_head == nc_ring_tail &&
+		get_timer(nc_ring_sent) >= CONFIG_NETCONSOLE_FLUSH_MS;
+	uint room, pos, chunk;
+
+	BUILD_BUG_ON(CONFIG_NETCONSOLE_RING_SIZE &
+		     (CONFIG_NETCONSOLE_RING_SIZE - 1));
+
+	while (len) {
+		if (nc_ring_head == nc_ring_tail)
+			nc_ring_start = get_timer(0);
+		room = CONFIG_NETCONSOLE_RING_SIZE -
+			(nc_ring_head - nc_ring_tail);
+		if (!room) {
+			/* Make room for a packet's worth, unless sending */
+			if (!nc_started || output_recursion)
+				return;
+			output_recursion = 1;
+			nc_ring_send(CONFIG_NETCONSOLE_RING_SIZE -
+				     NC_PACKET_SIZE);
+			output_recursion = 0;
+			continue;
+		}
+		pos = nc_ring_head % CONFIG_NETCONSOLE_RING_SIZE;
+		chunk = min3((uint)len, room, CONFIG_NETCONSOLE_RING_SIZE - pos);
+		memcpy(nc_ring + pos, s, chunk);
+		nc_ring_head += chunk;
+		s += chunk;
+		len -= chunk;
+	}
+
+	if (!nc_started || output_recursion)
+		return;
+	output_recursion = 1;
+	/*
+	 * Send full datagrams, and the rest at the end of a line which follows
+	 * a quiet spell or has waited a while. Output which is still queued
+	 * after that goes out from nc_poll().
+	 */
+	if (newline && (idle ||
+	    get_timer(nc_ring_start) >= CONFIG_NETCONSOLE_FLUSH_MS))
+		nc_ring_send(0);
+	else
+		nc_ring_send(NC_PACKET_SIZE - 1);
+	output_recursion = 0;
+}
+
+void nc_flush(void)
+{
+	if (!nc_started || output_recursion)
+		return;
+	output_recursion = 1;
+	nc_ring_send(0);
+	output_recursion = 0;
+}
+
+void nc_poll(void)
+{
+	if (nc_ring_head == nc_ring_tail ||
+	    get_timer(nc_ring_start) < CONFIG_NETCONSOLE_FLUSH_MS)
+		return;
+
+	/* Inside the net loop output can only go to a known server */
+	if (!memcmp(nc_ether, net_null_ethaddr, 6) &&
+	    !arp_cache_lookup(nc_ip, nc_ether))
+		return;
+	nc_flush();
+}
+#endif
+
 static int nc_stdio_start(struct stdio_dev *dev)
 {
 	int retval;
@@ -241,6 +348,15 @@ static int nc_stdio_start(struct stdio_dev *dev)
 	 * incase we call net_send_udp_packet before net_loop
 	 */
 	net_init();
+	nc_started = true;
+
+	return 0;
+}
+
+static int nc_stdio_stop(struct stdio_dev *dev)
+{
+	nc_flush();
+	nc_started = false;
 
 	return 0;
 }
@@ -249,11 +365,15 @@ static void nc_stdio_putc(struct stdio_dev *dev, char c)
 {
 	if (output_recursion)
 		return;
+#ifdef CONFIG_NETCONSOLE_BUFFERED
+	nc_output(&c, 1);
+#else
 	output_recursion = 1;
 
 	nc_send_packet(&c, 1);
 
 	output_recursion = 0;
+#endif
 }
 
 static void nc_stdio_puts(struct stdio_dev *dev, const char *s)
@@ -262,9 +382,12 @@ static void nc_stdio_puts(struct stdio_dev *dev, const char *s)
 
 	if (output_recursion)
 		return;
+	len = strlen(s);
+#ifdef CONFIG_NETCONSOLE_BUFFERED
+	nc_output(s, len);
+#else
 	output_recursion = 1;
 
-	len = strlen(s);
 	while (len) {
 		int send_len = min(len, (int)sizeof(input_buffer));
 		nc_send_packet(s, send_len);
@@ -273,12 +396,14 @@ static void nc_stdio_puts(struct stdio_dev *dev, const char *s)
 	}
 
 	output_recursion = 0;
+#endif
 }
 
 static int nc_stdio_getc(struct stdio_dev *dev)
 {
 	uchar c;
 
+	nc_flush();
 	input_recursion = 1;
 
 	net_timeout = 0;	/* no timeout */
@@ -314,6 +439,7 @@ static int nc_stdio_tstc(struct stdio_dev *dev)
 	if (eth_is_active(eth))
 		return 0;	/* inside net loop */
 
+	nc_flush();
 	input_recursion = 1;
 
 	net_timeout = 1;
@@ -334,6 +460,7 @@ int drv_nc_init(void)
 	strcpy(dev.name, "nc");
 	dev.flags = DEV_FLAGS_OUTPUT | DEV_FLAGS_INPUT;
 	dev.start = nc_stdio_start;
+	dev.stop = nc_stdio_stop;
 	dev.putc = nc_stdio_putc;
 	dev.puts = nc_stdio_puts;
 	dev.getc = nc_stdio_getc;
@@ -74,8 +74,10 @@ int sandbox_eth_arp_req_to_reply(struct udevice *dev, void *packet,
 		return -EAGAIN;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (priv->recv_packets >= PKTBUFSRX) {
+		eth_get_stats(dev)->rx_overruns++;
 		return 0;
+	}
 
 	/* store this as the assumed IP of the fake host */
 	priv->fake_host_ipaddr = net_read_ip(&arp->ar_tpa);
@@ -136,8 +138,10 @@ int sandbox_eth_ping_req_to_reply(struct udevice *dev, void *packet,
 		return -EAGAIN;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (priv->recv_packets >= PKTBUFSRX) {
+		eth_get_stats(dev)->rx_overruns++;
 		return 0;
+	}
 
 	/* reply to the ping */
 	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
@@ -176,8 +180,10 @@ int sandbox_eth_recv_arp_req(struct udevice *dev)
 	struct arp_hdr *arp_recv;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (priv->recv_packets >= PKTBUFSRX) {
+		eth_get_stats(dev)->rx_overruns++;
 		return -EOVERFLOW;
+	}
 
 	/* Formulate a fake request */
 	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
@@ -218,8 +224,10 @@ int sandbox_eth_recv_ping_req(struct udevice *dev)
 	struct icmp_hdr *icmpr;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	if (priv->recv_packets >= PKTBUFSRX) {
+		eth_get_stats(dev)->rx_overruns++;
 		return -EOVERFLOW;
+	}
 
 	/* Formulate a fake ping */
 	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
@@ -330,11 +338,90 @@ static int sb_eth_start(struct udevice *dev)
 	for (int i = 0; i < PKTBUFSRX; i++) {
 		priv->recv_packet_buffer[i] = net_rx_packets[i];
 		priv->recv_packet_length[i] = 0;
+		priv->rx_slot[i] = NULL;
 	}
+	priv->rx_next = 0;
+	if (IS_ENABLED(CONFIG_NET_RX_HINT))
+		eth_rx_hint_reset(dev, PKTBUFSRX);
 
 	return 0;
 }
 
+/*
+ * Receive the payload of a packet into the slot of the receive buffer it
+ * goes to, as a driver which supports eth_rx_hint() does, if it fits
+ */
+static void sb_eth_rx_split(struct udevice *dev, uchar *packet, int length)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int i = priv->rx_next;
+	uint hdr_len = priv->rx_hdr_len[i];
+
+	if (!priv->rx_slot[i] || length <= hdr_len ||
+	    length - hdr_len > priv->rx_slot_len[i])
+		return;
+
+	memcpy(priv->rx_slot[i], packet + hdr_len, length - hdr_len);
+	/* The payload never reached the packet buffer */
+	memset(packet + hdr_len, 0xff, length - hdr_len);
+	priv->rx_split_packets++;
+	eth_rx_set_payload(dev, priv->rx_slot[i], hdr_len);
+}
+
+/* Give the receive buffer of the last packet a new slot, if there is one */
+static void sb_eth_rx_post(struct udevice *dev)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int i = priv->rx_next;
+	uint len = PKTSIZE_ALIGN;
+	uint hdr_len = 0;
+
+	priv->rx_slot[i] = eth_rx_hint_buf(dev, i, 1, &len, &hdr_len);
+	priv->rx_slot_len[i] = len;
+	priv->rx_hdr_len[i] = hdr_len;
+	priv->rx_next = (i + 1) % PKTBUFSRX;
+}
+
+/* Sum a packet's pseudo-header and UDP or TCP segment; 0 if it is right */
+static u16 sb_eth_csum(struct ip_udp_hdr *ip)
+{
+	return net_l4_checksum(ip->ip_src, ip->ip_dst, ip->ip_p, &ip->udp_src,
+			       ntohs(ip->ip_len) - IP_HDR_SIZE);
+}
+
+/* Fill in the checksum of a packet being sent, standing in for hardware */
+static void sb_eth_tx_csum(struct udevice *dev, void *packet, int length)
+{
+	struct eth_pdata *pdata = dev_get_plat(dev);
+	struct ip_udp_hdr *ip;
+	u16 *xsum, sum;
+
+	if (!(pdata->features & ETH_FEAT_TX_CSUM))
+		return;
+	xsum = net_l4_checksum_field(packet, length, &ip);
+	if (!xsum || (void *)ip - packet + ntohs(ip->ip_len) > length)
+		return;
+
+	*xsum = 0;
+	sum = sb_eth_csum(ip);
+	/* A UDP checksum of 0 means that there is none */
+	if (!sum && ip->ip_p == IPPROTO_UDP)
+		sum = 0xffff;
+	*xsum = sum;
+}
+
+/* Check the checksum of a received packet, standing in for hardware */
+static void sb_eth_rx_csum(struct udevice *dev, void *packet, int length)
+{
+	struct ip_udp_hdr *ip;
+	u16 *xsum = net_l4_checksum_field(packet, length, &ip);
+
+	if (xsum && *xsum &&
+	    (void *)ip - packet + ntohs(ip->ip_len) <= length &&
+	    !sb_eth_csum(ip))
+		eth_rx_set_csum_ok(dev);
+}
+
 static int sb_eth_send(struct udevice *dev, void *packet, int length)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -344,9 +431,28 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 	if (priv->disabled)
 		return 0;
 
+	if (IS_ENABLED(CONFIG_NET_OFFLOAD))
+		sb_eth_tx_csum(dev, packet, length);
+
 	return priv->tx_handler(dev, packet, length);
 }
 
+static int sb_eth_send_sg(struct udevice *dev, void *hdr, int hdr_len,
+			  const void *data, int data_len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	if (hdr_len + data_len > sizeof(priv->tx_packet))
+		return -EMSGSIZE;
+
+	/* Stand in for the DMA, which would gather the two parts */
+	memcpy(priv->tx_packet, hdr, hdr_len);
+	memcpy(priv->tx_packet + hdr_len, data, data_len);
+	priv->tx_sg_packets++;
+
+	return sb_eth_send(dev, priv->tx_packet, hdr_len + data_len);
+}
+
 static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -362,6 +468,10 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 		debug("eth_sandbox: received packet[%d], %d waiting\n",
 		      lcl_recv_packet_length, priv->recv_packets - 1);
 		*packetp = priv->recv_packet_buffer[0];
+		if (IS_ENABLED(CONFIG_NET_OFFLOAD))
+			sb_eth_rx_csum(dev, *packetp, lcl_recv_packet_length);
+		if (IS_ENABLED(CONFIG_NET_RX_HINT))
+			sb_eth_rx_split(dev, *packetp, lcl_recv_packet_length);
 		return lcl_recv_packet_length;
 	}
 	return 0;
@@ -375,6 +485,8 @@ static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 	if (!priv->recv_packets)
 		return 0;
 
+	if (IS_ENABLED(CONFIG_NET_RX_HINT))
+		sb_eth_rx_post(dev);
 	--priv->recv_packets;
 	for (i = 0; i < priv->recv_packets; i++) {
 		priv->recv_packet_length[i] = priv->recv_packet_length[i + 1];
@@ -408,6 +520,7 @@ static const struct eth_ops sb_eth_ops = {
 	.free_pkt		= sb_eth_free_pkt,
 	.stop			= sb_eth_stop,
 	.write_hwaddr		= sb_eth_write_hwaddr,
+	.send_sg		= sb_eth_send_sg,
 };
 
 static int sb_eth_remove(struct udevice *dev)
@@ -431,6 +544,8 @@ static int sb_eth_of_to_plat(struct udevice *dev)
 	memcpy(priv->fake_host_hwaddr, mac, ARP_HLEN);
 	priv->disabled = false;
 	priv->tx_handler = sb_default_handler;
+	if (IS_ENABLED(CONFIG_NET_OFFLOAD))
+		pdata->features = ETH_FEAT_TX_CSUM;
 
 	return 0;
 }
@@ -302,6 +302,46 @@ static int cadence_spi_mem_exec_op(struct spi_slave *spi,
 	return err;
 }
 
+#if CONFIG_IS_ENABLED(SPI_DIRMAP)
+static int cadence_spi_mem_dirmap_create(struct spi_mem_dirmap_desc *desc)
+{
+	struct udevice *bus = desc->slave->dev->parent;
+	struct cadence_spi_plat *plat = dev_get_plat(bus);
+
+	/* Only the direct access (DAC) window can back a direct mapping */
+	if (!cadence_qspi_apb_dac_covers(plat, desc->info.offset,
+					 desc->info.length))
+		return -EOPNOTSUPP;
+
+	if (!spi_mem_supports_op(desc->slave, &desc->info.op_tmpl))
+		return -EOPNOTSUPP;
+
+	return 0;
+}
+
+static ssize_t cadence_spi_mem_dirmap_read(struct spi_mem_dirmap_desc *desc,
+					   u64 offs, size_t len, void *buf)
+{
+	struct spi_mem_op op = desc->info.op_tmpl;
+	int err;
+
+	op.addr.val = desc->info.offset + offs;
+	op.data.buf.in = buf;
+	op.data.nbytes = len;
+
+	/*
+	 * The mapping lies within the AHB window, so the whole request is
+	 * copied out of it in one go rather than split up to the size limit
+	 * of indirect transfers
+	 */
+	err = cadence_spi_mem_exec_op(desc->slave, &op);
+	if (err)
+		return err;
+
+	return len;
+}
+#endif
+
 static bool cadence_spi_mem_supports_op(struct spi_slave *slave,
 					const struct spi_mem_op *op)
 {
@@ -379,6 +419,10 @@ static int cadence_spi_of_to_plat(struct udevice *bus)
 static const struct spi_controller_mem_ops cadence_spi_mem_ops = {
 	.exec_op = cadence_spi_mem_exec_op,
 	.supports_op = cadence_spi_mem_supports_op,
+#if CONFIG_IS_ENABLED(SPI_DIRMAP)
+	.dirmap_create = cadence_spi_mem_dirmap_create,
+	.dirmap_read = cadence_spi_mem_dirmap_read,
+#endif
 };
 
 static const struct dm_spi_ops cadence_spi_ops = {
@@ -76,6 +76,9 @@ int cadence_qspi_apb_command_write(struct cadence_spi_plat *plat,
 
 int cadence_qspi_apb_read_setup(struct cadence_spi_plat *plat,
 				const struct spi_mem_op *op);
+/* Check whether a read of @len bytes at @from can use the DAC window */
+bool cadence_qspi_apb_dac_covers(struct cadence_spi_plat *plat, u64 from,
+				 u64 len);
 int cadence_qspi_apb_read_execute(struct cadence_spi_plat *plat,
 				  const struct spi_mem_op *op);
 int cadence_qspi_apb_write_setup(struct cadence_spi_plat *plat,
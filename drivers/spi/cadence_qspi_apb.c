@@ -875,6 +875,12 @@ failrd:
 	return ret;
 }
 
+bool cadence_qspi_apb_dac_covers(struct cadence_spi_plat *plat, u64 from,
+				 u64 len)
+{
+	return plat->use_dac_mode && from + len <= plat->ahbsize;
+}
+
 int cadence_qspi_apb_read_execute(struct cadence_spi_plat *plat,
 				  const struct spi_mem_op *op)
 {
@@ -882,7 +888,7 @@ int cadence_qspi_apb_read_execute(struct cadence_spi_plat *plat,
 	void *buf = op->data.buf.in;
 	size_t len = op->data.nbytes;
 
-	if (plat->use_dac_mode && (from + len < plat->ahbsize)) {
+	if (cadence_qspi_apb_dac_covers(plat, from, len)) {
 		if (len < 256 ||
 		    dma_memcpy(buf, plat->ahbbase + from, len) < 0) {
 			memcpy_fromio(buf, plat->ahbbase + from, len);
@@ -481,6 +481,9 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 
 	req->actual = 0;
 	usb_ep_queue(ep, req, 0);
+
+	/* Write streamed data while the next packet comes in */
+	fastboot_data_write();
 }
 
 static void do_exit_on_complete(struct usb_ep *ep, struct usb_request *req)
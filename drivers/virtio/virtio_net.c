@@ -33,19 +33,34 @@ struct virtio_net_priv {
 	char rx_buff[VIRTIO_NET_NUM_RX_BUFS][VIRTIO_NET_RX_BUF_SIZE];
 	bool rx_running;
 	int net_hdr_len;
+#ifdef CONFIG_NET_RX_HINT
+	/* Slot from eth_rx_hint_buf() for each receive buffer, or NULL */
+	uchar *rx_slot[VIRTIO_NET_NUM_RX_BUFS];
+	uint rx_slot_len[VIRTIO_NET_NUM_RX_BUFS];
+	uint rx_hdr_len[VIRTIO_NET_NUM_RX_BUFS];
+#endif
 };
 
 /*
- * For simplicity, the driver only negotiates the VIRTIO_NET_F_MAC feature.
- * For the VIRTIO_NET_F_STATUS feature, we don't negotiate it, hence per spec
- * we should assume the link is always active.
+ * For simplicity, the driver only negotiates the VIRTIO_NET_F_MAC feature,
+ * plus checksum offload with CONFIG_NET_OFFLOAD. For the VIRTIO_NET_F_STATUS
+ * feature, we don't negotiate it, hence per spec we should assume the link is
+ * always active.
  */
 static const u32 feature[] = {
-	VIRTIO_NET_F_MAC
+	VIRTIO_NET_F_MAC,
+#ifdef CONFIG_NET_OFFLOAD
+	VIRTIO_NET_F_CSUM,
+	VIRTIO_NET_F_GUEST_CSUM,
+#endif
 };
 
 static const u32 feature_legacy[] = {
-	VIRTIO_NET_F_MAC
+	VIRTIO_NET_F_MAC,
+#ifdef CONFIG_NET_OFFLOAD
+	VIRTIO_NET_F_CSUM,
+	VIRTIO_NET_F_GUEST_CSUM,
+#endif
 };
 
 static int virtio_net_start(struct udevice *dev)
@@ -69,19 +84,57 @@ static int virtio_net_start(struct udevice *dev)
 
 		/* setup the receive queue only once */
 		priv->rx_running = true;
+#ifdef CONFIG_NET_RX_HINT
+		memset(priv->rx_slot, '\0', sizeof(priv->rx_slot));
+		eth_rx_hint_reset(dev, VIRTIO_NET_NUM_RX_BUFS);
+#endif
 	}
 
 	return 0;
 }
 
-static int virtio_net_send(struct udevice *dev, void *packet, int length)
+#ifdef CONFIG_NET_OFFLOAD
+/*
+ * Ask the device to fill in the UDP or TCP checksum of an IPv4 packet which
+ * is not a fragment. As the spec requires, the checksum field is seeded with
+ * the sum over the pseudo-header.
+ *
+ * @packet holds the headers, @len bytes of them
+ */
+static void virtio_net_tx_csum(struct udevice *dev, struct virtio_net_hdr *hdr,
+			       void *packet, int len)
+{
+	struct ip_udp_hdr *ip;
+	u16 *xsum;
+
+	if (!virtio_has_feature(dev, VIRTIO_NET_F_CSUM))
+		return;
+	xsum = net_l4_checksum_field(packet, len, &ip);
+	if (!xsum)
+		return;
+
+	*xsum = ~net_pseudo_checksum(ip->ip_src, ip->ip_dst, ip->ip_p,
+				     ntohs(ip->ip_len) - IP_HDR_SIZE);
+
+	hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+	hdr->csum_start = cpu_to_virtio16(dev, (uchar *)&ip->udp_src -
+					  (uchar *)packet);
+	hdr->csum_offset = cpu_to_virtio16(dev, (uchar *)xsum -
+					   (uchar *)&ip->udp_src);
+}
+#endif
+
+/* Send a packet given in two parts; @data_len may be 0 */
+static int virtio_net_xmit(struct udevice *dev, void *packet, int length,
+			   const void *data, int data_len)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
 	struct virtio_net_hdr hdr;
 	struct virtio_net_hdr_v1 hdr_v1;
 	struct virtio_sg hdr_sg;
-	struct virtio_sg data_sg = { packet, length };
-	struct virtio_sg *sgs[] = { &hdr_sg, &data_sg };
+	struct virtio_sg pkt_sg = { packet, length };
+	struct virtio_sg data_sg = { (void *)data, data_len };
+	struct virtio_sg *sgs[] = { &hdr_sg, &pkt_sg, &data_sg };
 	int ret;
 
 	if (priv->net_hdr_len == sizeof(struct virtio_net_hdr))
@@ -91,8 +144,12 @@ static int virtio_net_send(struct udevice *dev, void *packet, int length)
 	hdr_sg.length = priv->net_hdr_len;
 
 	memset(hdr_sg.addr, 0, priv->net_hdr_len);
+#ifdef CONFIG_NET_OFFLOAD
+	/* Both headers start with the fields of struct virtio_net_hdr */
+	virtio_net_tx_csum(dev, hdr_sg.addr, packet, length);
+#endif
 
-	ret = virtqueue_add(priv->tx_vq, sgs, 2, 0);
+	ret = virtqueue_add(priv->tx_vq, sgs, data_len ? 3 : 2, 0);
 	if (ret)
 		return ret;
 
@@ -106,6 +163,44 @@ static int virtio_net_send(struct udevice *dev, void *packet, int length)
 	return 0;
 }
 
+static int virtio_net_send(struct udevice *dev, void *packet, int length)
+{
+	return virtio_net_xmit(dev, packet, length, NULL, 0);
+}
+
+static int virtio_net_send_sg(struct udevice *dev, void *hdr, int hdr_len,
+			      const void *data, int data_len)
+{
+	return virtio_net_xmit(dev, hdr, hdr_len, data, data_len);
+}
+
+#ifdef CONFIG_NET_RX_HINT
+static int virtio_net_buf_index(struct virtio_net_priv *priv, void *buf)
+{
+	return ((char *)buf - priv->rx_buff[0]) / VIRTIO_NET_RX_BUF_SIZE;
+}
+
+/*
+ * Tell the uclass where the payload went, if the buffer was split. A packet
+ * too long for the slot ran on into our own buffer, so put it back together
+ * there instead.
+ */
+static void virtio_net_rx_split(struct udevice *dev, void *buf,
+				unsigned int len)
+{
+	struct virtio_net_priv *priv = dev_get_priv(dev);
+	int i = virtio_net_buf_index(priv, buf);
+	uint hdr_len = priv->net_hdr_len + priv->rx_hdr_len[i];
+
+	if (!priv->rx_slot[i] || len <= hdr_len)
+		return;
+	if (len > hdr_len + priv->rx_slot_len[i])
+		memcpy(buf + hdr_len, priv->rx_slot[i], priv->rx_slot_len[i]);
+	else
+		eth_rx_set_payload(dev, priv->rx_slot[i], priv->rx_hdr_len[i]);
+}
+#endif
+
 static int virtio_net_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct virtio_net_priv *priv = dev_get_priv(dev);
@@ -116,6 +211,16 @@ static int virtio_net_recv(struct udevice *dev, int flags, uchar **packetp)
 	if (!buf)
 		return -EAGAIN;
 
+#ifdef CONFIG_NET_RX_HINT
+	virtio_net_rx_split(dev, buf, len);
+#endif
+#ifdef CONFIG_NET_OFFLOAD
+	/* The header starts with the flags in either layout */
+	if (((struct virtio_net_hdr *)buf)->flags &
+	    (VIRTIO_NET_HDR_F_NEEDS_CSUM | VIRTIO_NET_HDR_F_DATA_VALID))
+		eth_rx_set_csum_ok(dev);
+#endif
+
 	*packetp = buf + priv->net_hdr_len;
 	return len - priv->net_hdr_len;
 }
@@ -125,10 +230,46 @@ static int virtio_net_free_pkt(struct udevice *dev, uchar *packet, int length)
 	struct virtio_net_priv *priv = dev_get_priv(dev);
 	void *buf = packet - priv->net_hdr_len;
 	struct virtio_sg sg = { buf, VIRTIO_NET_RX_BUF_SIZE };
-	struct virtio_sg *sgs[] = { &sg };
+	struct virtio_sg *sgs[] = { &sg, NULL, NULL };
+	unsigned int num = 1;
+
+#ifdef CONFIG_NET_RX_HINT
+	int i = virtio_net_buf_index(priv, buf);
+	struct virtio_sg slot_sg, rest_sg;
+	uint slot_len = VIRTIO_NET_RX_BUF_SIZE;
+	uint hdr_len = 0;
+	uchar *slot;
+
+	/*
+	 * Split the buffer so that the headers land in our own buffer and
+	 * the payload in the slot. Anything which does not fit in the slot
+	 * goes to the rest of our buffer, so the device still has room for
+	 * a whole packet.
+	 */
+	slot = eth_rx_hint_buf(dev, i, 1, &slot_len, &hdr_len);
+	if (slot) {
+		sg.length = priv->net_hdr_len + hdr_len;
+		slot_len = min_t(uint, slot_len,
+				 VIRTIO_NET_RX_BUF_SIZE - sg.length);
+		slot_sg.addr = slot;
+		slot_sg.length = slot_len;
+		sgs[1] = &slot_sg;
+		num = 2;
+		if (sg.length + slot_len < VIRTIO_NET_RX_BUF_SIZE) {
+			rest_sg.addr = buf + sg.length + slot_len;
+			rest_sg.length = VIRTIO_NET_RX_BUF_SIZE - sg.length -
+					 slot_len;
+			sgs[2] = &rest_sg;
+			num = 3;
+		}
+	}
+	priv->rx_slot[i] = slot;
+	priv->rx_slot_len[i] = slot_len;
+	priv->rx_hdr_len[i] = hdr_len;
+#endif
 
 	/* Put the buffer back to the rx ring */
-	virtqueue_add(priv->rx_vq, sgs, 0, 1);
+	virtqueue_add(priv->rx_vq, sgs, 0, num);
 
 	return 0;
 }
@@ -140,6 +281,36 @@ static void virtio_net_stop(struct udevice *dev)
 	 * a reset to the virtio device, and re-do the queue initialization
 	 * from the beginning.
 	 */
+#ifdef CONFIG_NET_RX_HINT
+	struct virtio_net_priv *priv = dev_get_priv(dev);
+	int i;
+
+	/*
+	 * Do just that if a receive buffer still points into a load buffer,
+	 * since the device could otherwise write to it at any time
+	 */
+	for (i = 0; i < VIRTIO_NET_NUM_RX_BUFS; i++) {
+		if (priv->rx_slot[i])
+			break;
+	}
+	if (i == VIRTIO_NET_NUM_RX_BUFS)
+		return;
+
+	virtio_reset(dev);
+	virtio_del_vqs(dev);
+	virtio_add_status(dev, VIRTIO_CONFIG_S_ACKNOWLEDGE |
+			  VIRTIO_CONFIG_S_DRIVER);
+	if (virtio_finalize_features(dev) ||
+	    virtio_find_vqs(dev, 2, priv->vqs) < 0) {
+		virtio_add_status(dev, VIRTIO_CONFIG_S_FAILED);
+		return;
+	}
+	virtio_add_status(dev, VIRTIO_CONFIG_S_DRIVER_OK);
+
+	/* start() posts the receive buffers again */
+	memset(priv->rx_slot, '\0', sizeof(priv->rx_slot));
+	priv->rx_running = false;
+#endif
 }
 
 static int virtio_net_write_hwaddr(struct udevice *dev)
@@ -213,6 +384,13 @@ static int virtio_net_probe(struct udevice *dev)
 	else
 		priv->net_hdr_len = sizeof(struct virtio_net_hdr_v1);
 
+	if (IS_ENABLED(CONFIG_NET_OFFLOAD) &&
+	    virtio_has_feature(dev, VIRTIO_NET_F_CSUM)) {
+		struct eth_pdata *pdata = dev_get_plat(dev);
+
+		pdata->features |= ETH_FEAT_TX_CSUM;
+	}
+
 	return 0;
 }
 
@@ -224,6 +402,7 @@ static const struct eth_ops virtio_net_ops = {
 	.stop = virtio_net_stop,
 	.write_hwaddr = virtio_net_write_hwaddr,
 	.read_rom_hwaddr = virtio_net_read_rom_hwaddr,
+	.send_sg = virtio_net_send_sg,
 };
 
 U_BOOT_DRIVER(virtio_net) = {
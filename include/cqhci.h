@@ -0,0 +1,216 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * eMMC Command Queue Host Controller Interface (CQHCI)
+ *
+ * Based on the Linux driver
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ */
+
+#ifndef __CQHCI_H
+#define __CQHCI_H
+
+#include <blk.h>
+#include <linux/bitops.h>
+#include <linux/types.h>
+#include <asm/io.h>
+
+struct mmc;
+
+/* registers */
+#define CQHCI_VER			0x00
+#define CQHCI_VER_MAJOR(x)		(((x) & GENMASK(11, 8)) >> 8)
+#define CQHCI_VER_MINOR1(x)		(((x) & GENMASK(7, 4)) >> 4)
+#define CQHCI_VER_MINOR2(x)		((x) & GENMASK(3, 0))
+
+#define CQHCI_CAP			0x04
+
+#define CQHCI_CFG			0x08
+#define  CQHCI_DCMD			BIT(12)
+#define  CQHCI_TASK_DESC_SZ		BIT(8)
+#define  CQHCI_ENABLE			BIT(0)
+
+#define CQHCI_CTL			0x0C
+#define  CQHCI_CLEAR_ALL_TASKS		BIT(8)
+#define  CQHCI_HALT			BIT(0)
+
+#define CQHCI_IS			0x10
+#define CQHCI_ISTE			0x14
+#define CQHCI_ISGE			0x18
+#define  CQHCI_IS_HAC			BIT(0)
+#define  CQHCI_IS_TCC			BIT(1)
+#define  CQHCI_IS_RED			BIT(2)
+#define  CQHCI_IS_TCL			BIT(3)
+#define  CQHCI_IS_GCE			BIT(4)
+#define  CQHCI_IS_ICCE			BIT(5)
+#define  CQHCI_IS_MASK			(CQHCI_IS_TCC | CQHCI_IS_RED | \
+					 CQHCI_IS_GCE | CQHCI_IS_ICCE)
+#define  CQHCI_IS_ERR_MASK		(CQHCI_IS_RED | CQHCI_IS_GCE | \
+					 CQHCI_IS_ICCE)
+
+#define CQHCI_IC			0x1C
+#define CQHCI_TDLBA			0x20
+#define CQHCI_TDLBAU			0x24
+#define CQHCI_TDBR			0x28
+#define CQHCI_TCN			0x2C
+#define CQHCI_DQS			0x30
+#define CQHCI_DPT			0x34
+#define CQHCI_TCLR			0x38
+#define CQHCI_SSC1			0x40
+#define CQHCI_SSC2			0x44
+#define CQHCI_CRDCT			0x48
+#define CQHCI_RMEM			0x50
+
+#define CQHCI_TERRI			0x54
+#define  CQHCI_TERRI_C_VALID		BIT(15)
+#define  CQHCI_TERRI_D_VALID		BIT(31)
+
+#define CQHCI_CRI			0x58
+#define CQHCI_CRA			0x5C
+
+/* task descriptor and transfer descriptor fields */
+#define CQHCI_VALID(x)			(((x) & 1) << 0)
+#define CQHCI_END(x)			(((x) & 1) << 1)
+#define CQHCI_INT(x)			(((x) & 1) << 2)
+#define CQHCI_ACT(x)			(((x) & 0x7) << 3)
+#define CQHCI_FORCED_PROG(x)		(((x) & 1) << 6)
+#define CQHCI_CONTEXT(x)		(((x) & 0xF) << 7)
+#define CQHCI_DATA_TAG(x)		(((x) & 1) << 11)
+#define CQHCI_DATA_DIR(x)		(((x) & 1) << 12)
+#define CQHCI_PRIORITY(x)		(((x) & 1) << 13)
+#define CQHCI_QBAR(x)			(((x) & 1) << 14)
+#define CQHCI_REL_WRITE(x)		(((x) & 1) << 15)
+#define CQHCI_BLK_COUNT(x)		(((u64)(x) & 0xFFFF) << 16)
+#define CQHCI_BLK_ADDR(x)		(((u64)(x) & 0xFFFFFFFF) << 32)
+#define CQHCI_DAT_LENGTH(x)		(((x) & 0xFFFF) << 16)
+
+#define CQHCI_ACT_TASK			0x5
+#define CQHCI_ACT_TRAN			0x4
+#define CQHCI_ACT_LINK			0x6
+
+/* Maximum number of task slots defined by the specification */
+#define CQHCI_NUM_SLOTS			32
+
+/*
+ * Maximum number of transfer descriptors per task and the number of bytes
+ * described by each of them. Keeping the segment length block-aligned means
+ * a task never splits a block across descriptors.
+ */
+#define CQHCI_MAX_SEGS			16
+#define CQHCI_MAX_SEG_LEN		0xFE00
+
+/* Blocks per task; well below the 16-bit task descriptor block count */
+#define CQHCI_MAX_TASK_BLKS		(CQHCI_MAX_SEGS * CQHCI_MAX_SEG_LEN / 512)
+
+struct cqhci_host_ops {
+	/**
+	 * enable() - Switch the host controller to CQE operation
+	 *
+	 * Called after CQHCI has been enabled. The host driver should select
+	 * ADMA and set up the block size and interrupt masks.
+	 *
+	 * @mmc: MMC device
+	 */
+	void (*enable)(struct mmc *mmc);
+
+	/**
+	 * disable() - Switch the host controller back to legacy operation
+	 *
+	 * @mmc: MMC device
+	 * @recovery: true if CQE is being disabled after an error, in which
+	 *	case the host should reset its command and data lines
+	 */
+	void (*disable)(struct mmc *mmc, bool recovery);
+};
+
+/**
+ * struct cqhci_host - state of a CQHCI instance
+ *
+ * @mmio: base of the CQHCI register block
+ * @mmc: MMC device this engine belongs to
+ * @ops: host driver callbacks
+ * @dma64: true if the host uses 64-bit DMA addressing
+ * @enabled: true if CQHCI is currently enabled (not halted)
+ * @num_slots: number of task slots in use
+ * @task_desc_len: length of a task descriptor in bytes
+ * @link_desc_len: length of a link descriptor in bytes
+ * @trans_desc_len: length of a transfer descriptor in bytes
+ * @slot_sz: length of a task slot (task + link descriptor) in bytes
+ * @desc_base: task descriptor list
+ * @trans_desc_base: transfer descriptor lists, CQHCI_MAX_SEGS per slot
+ */
+struct cqhci_host {
+	void __iomem *mmio;
+	struct mmc *mmc;
+	const struct cqhci_host_ops *ops;
+	bool dma64;
+	bool enabled;
+	u32 num_slots;
+	u32 task_desc_len;
+	u32 link_desc_len;
+	u32 trans_desc_len;
+	u32 slot_sz;
+	u8 *desc_base;
+	u8 *trans_desc_base;
+};
+
+static inline void cqhci_writel(struct cqhci_host *host, u32 val, int reg)
+{
+	writel(val, host->mmio + reg);
+}
+
+static inline u32 cqhci_readl(struct cqhci_host *host, int reg)
+{
+	return readl(host->mmio + reg);
+}
+
+/**
+ * cqhci_init() - Attach a CQHCI instance to an MMC device
+ *
+ * This should be called from the host driver's probe() method when the
+ * device tree node has the "supports-cqe" property. It allocates the
+ * descriptor lists and stores @cq_host in @mmc so that the MMC core can
+ * issue queued reads through it.
+ *
+ * @cq_host:	CQHCI host, with @mmio and @ops filled in
+ * @mmc:	MMC device
+ * @dma64:	true if the host uses 64-bit DMA addressing
+ * Return: 0 if OK, -ve on error
+ */
+int cqhci_init(struct cqhci_host *cq_host, struct mmc *mmc, bool dma64);
+
+/**
+ * cqhci_enable() - Enable command queueing in the host controller
+ *
+ * The card must already have command queueing enabled in its EXT_CSD.
+ *
+ * @mmc:	MMC device
+ * Return: 0 if OK, -ve on error
+ */
+int cqhci_enable(struct mmc *mmc);
+
+/**
+ * cqhci_disable() - Halt and disable command queueing in the host controller
+ *
+ * @mmc:	MMC device
+ * @recovery:	true if disabling after an error; outstanding tasks are
+ *		discarded
+ */
+void cqhci_disable(struct mmc *mmc, bool recovery);
+
+/**
+ * cqhci_read_blocks() - Read blocks using queued tasks
+ *
+ * The range is split into up to @mmc->cqe_qdepth tasks which are submitted
+ * together and then polled for completion, repeating until the whole range
+ * has been read. CQHCI must have been enabled with cqhci_enable().
+ *
+ * @mmc:	MMC device
+ * @dst:	Destination buffer, aligned to ARCH_DMA_MINALIGN
+ * @start:	First block to read
+ * @blkcnt:	Number of blocks to read
+ * Return: 0 if OK, -ve on error
+ */
+int cqhci_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
+		      lbaint_t blkcnt);
+
+#endif /* __CQHCI_H */
@@ -164,6 +164,15 @@ u32 fastboot_data_remaining(void);
 void fastboot_data_download(const void *fastboot_data,
 			    unsigned int fastboot_data_len, char *response);
 
+/**
+ * fastboot_data_write() - Write out data of a streamed download
+ *
+ * When a sparse image is written to flash as it is downloaded, the transport
+ * may call this after acknowledging received data, so that the host can send
+ * more while the data is written. Otherwise this does nothing.
+ */
+void fastboot_data_write(void);
+
 /**
  * fastboot_data_complete() - Mark current transfer complete
  *
@@ -8,6 +8,7 @@
 
 struct blk_desc;
 struct disk_partition;
+struct sparse_storage;
 
 /**
  * fastboot_mmc_get_part_info() - Lookup eMMC partion by name
@@ -39,4 +40,17 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
  * @response: Pointer to fastboot response buffer
  */
 void fastboot_mmc_erase(const char *cmd, char *response);
+
+/**
+ * fastboot_mmc_sparse_storage() - Set up writing a sparse image to eMMC
+ *
+ * This is used to write an image while it is downloaded.
+ *
+ * @cmd: Named partition to write the image to
+ * @sparse: Returns where to write the image
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 if OK, -ve on error
+ */
+int fastboot_mmc_sparse_storage(const char *cmd, struct sparse_storage *sparse,
+				char *response);
 #endif
@@ -9,6 +9,8 @@
 
 #include <jffs2/load_kernel.h>
 
+struct sparse_storage;
+
 /**
  * fastboot_nand_get_part_info() - Lookup NAND partion by name
  *
@@ -37,4 +39,17 @@ void fastboot_nand_flash_write(const char *cmd, void *download_buffer,
  * @response: Pointer to fastboot response buffer
  */
 void fastboot_nand_erase(const char *cmd, char *response);
+
+/**
+ * fastboot_nand_sparse_storage() - Set up writing a sparse image to NAND
+ *
+ * This is used to write an image while it is downloaded.
+ *
+ * @cmd: Named device to write the image to
+ * @sparse: Returns where to write the image
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 if OK, -ve on error
+ */
+int fastboot_nand_sparse_storage(const char *cmd,
+				 struct sparse_storage *sparse, char *response);
 #endif
@@ -121,6 +121,115 @@ static inline int fdt_fixup_memory_banks(void *blob, u64 start[], u64 size[],
 void fdt_fixup_ethernet(void *fdt);
 int fdt_find_and_setprop(void *fdt, const char *node, const char *prop,
 			 const void *val, int len, int create);
+
+struct fdt_batch_edit;
+
+/**
+ * struct fdt_batch - a set of property updates applied in one pass
+ *
+ * Each fdt_setprop() moves everything after the property to make room for
+ * it, so a node looked up before the update may have moved afterwards and
+ * fixups end up resolving the same paths over and over. A batch collects
+ * updates against node paths or phandles without touching the tree, then
+ * fdt_batch_apply() resolves every node once and applies the updates from
+ * the end of the tree backwards, so that no offset has to be looked up
+ * again.
+ *
+ * @fdt: Device tree the updates are for
+ * @edits: Updates collected so far
+ * @count: Number of updates in @edits
+ * @size: Number of updates @edits has room for
+ * @err: First error seen while collecting the updates, returned by
+ *	fdt_batch_apply()
+ */
+struct fdt_batch {
+	void *fdt;
+	struct fdt_batch_edit *edits;
+	int count;
+	int size;
+	int err;
+};
+
+/**
+ * fdt_batch_init() - Start a batch of property updates
+ *
+ * @batch: Batch to set up
+ * @fdt: Device tree the updates are for
+ */
+void fdt_batch_init(struct fdt_batch *batch, void *fdt);
+
+/**
+ * fdt_batch_setprop() - Queue a property update on a node given by path
+ *
+ * The path, property name and value are copied, so they need not remain
+ * valid until the batch is applied.
+ *
+ * @batch: Batch to add to
+ * @path: Path of the node
+ * @prop: Property name
+ * @val: Property value
+ * @len: Length of @val in bytes
+ * @create: Create the property if it does not exist, otherwise only
+ *	update it if it does
+ * Return: 0 if ok, -FDT_ERR_NOSPACE if out of memory
+ */
+int fdt_batch_setprop(struct fdt_batch *batch, const char *path,
+		      const char *prop, const void *val, int len, int create);
+
+/**
+ * fdt_batch_setprop_phandle() - Queue a property update on a node given by
+ * phandle
+ *
+ * All the phandles in a batch are resolved with a single walk of the tree.
+ *
+ * @batch: Batch to add to
+ * @phandle: Phandle of the node
+ * @prop: Property name
+ * @val: Property value
+ * @len: Length of @val in bytes
+ * @create: Create the property if it does not exist, otherwise only
+ *	update it if it does
+ * Return: 0 if ok, -FDT_ERR_NOSPACE if out of memory
+ */
+int fdt_batch_setprop_phandle(struct fdt_batch *batch, u32 phandle,
+			      const char *prop, const void *val, int len,
+			      int create);
+
+/**
+ * fdt_batch_setprop_u32() - Queue a 32-bit property update on a node given
+ * by path
+ *
+ * @batch: Batch to add to
+ * @path: Path of the node
+ * @prop: Property name
+ * @val: Property value, in CPU byte order
+ * @create: Create the property if it does not exist
+ * Return: 0 if ok, -FDT_ERR_NOSPACE if out of memory
+ */
+int fdt_batch_setprop_u32(struct fdt_batch *batch, const char *path,
+			  const char *prop, u32 val, int create);
+
+/**
+ * fdt_batch_apply() - Apply a batch of property updates
+ *
+ * Updates to the same node are applied in the order they were queued.
+ * Updates whose node cannot be found or which fail, for example because
+ * the tree is too small to hold them all, are reported and skipped, as
+ * do_fixup_by_path() does.
+ *
+ * The batch must still be freed with fdt_batch_free().
+ *
+ * @batch: Batch to apply
+ * Return: 0 if ok, else the first -FDT_ERR_... error
+ */
+int fdt_batch_apply(struct fdt_batch *batch);
+
+/**
+ * fdt_batch_free() - Free a batch of property updates
+ *
+ * @batch: Batch to free
+ */
+void fdt_batch_free(struct fdt_batch *batch);
 void fdt_fixup_qe_firmware(void *fdt);
 
 /**
@@ -40,3 +40,66 @@ static inline int is_sparse_image(void *buf)
 
 int write_sparse_image(struct sparse_storage *info, const char *part_name,
 		       void *data, char *response);
+
+/**
+ * struct sparse_stream - a sparse image being written as it arrives
+ *
+ * @info: where to write the image
+ * @part_name: name of the partition, for messages
+ * @response: buffer for the message on failure
+ * @hdr: file header, once @have_hdr is set
+ * @have_hdr: true once the file header has been read
+ * @chunk_hdr: header of the current chunk
+ * @chunk: number of chunk headers read
+ * @left: bytes of data of the current chunk not yet used
+ * @blk: next block to write
+ * @bytes_written: number of bytes written so far
+ * @total_blocks: number of output blocks covered by the chunks so far
+ */
+struct sparse_stream {
+	struct sparse_storage	*info;
+	const char		*part_name;
+	char			*response;
+	sparse_header_t		hdr;
+	bool			have_hdr;
+	chunk_header_t		chunk_hdr;
+	unsigned int		chunk;
+	u64			left;
+	lbaint_t		blk;
+	u64			bytes_written;
+	u32			total_blocks;
+};
+
+/**
+ * sparse_stream_init() - start writing a sparse image piece by piece
+ *
+ * @ss: stream to set up
+ * @info: where to write the image
+ * @part_name: name of the partition, for messages
+ * @response: buffer for the message on failure
+ */
+void sparse_stream_init(struct sparse_stream *ss, struct sparse_storage *info,
+			const char *part_name, char *response);
+
+/**
+ * sparse_stream_write() - write the next piece of a sparse image
+ *
+ * Chunks are written as far as @data allows. A header, or data which is
+ * not a whole number of blocks, is only used once all of it is there, so
+ * the bytes not used must be passed again at the start of the next piece.
+ *
+ * @ss: stream being written
+ * @data: next part of the image
+ * @len: number of bytes at @data
+ * Return: number of bytes used, or -1 on error, with the reason in the
+ *	response buffer
+ */
+int sparse_stream_write(struct sparse_stream *ss, void *data, size_t len);
+
+/**
+ * sparse_stream_finish() - check that a sparse image was written in full
+ *
+ * @ss: stream being written
+ * Return: 0 if OK, -1 on error, with the reason in the response buffer
+ */
+int sparse_stream_finish(struct sparse_stream *ss);
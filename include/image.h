@@ -851,6 +851,28 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		 void *load_buf, void *image_buf, ulong image_len,
 		 uint unc_len, ulong *load_end);
 
+/**
+ * image_decomp_offset() - work out the placement for in-place decompression
+ *
+ * A compressed image can be decompressed in place, i.e. with the output
+ * overlapping the input, if the compressed data sits at the tail of the
+ * output window with enough of a margin that the decoder never catches up
+ * with data it has not read yet. This works out where that is, using the
+ * uncompressed size recorded in the image's header.
+ *
+ * Only lz4 (with the content size recorded), lzma and zstd are supported.
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @buf:	Compressed data
+ * @len:	Length of the compressed data
+ * @offsetp:	Returns the minimum offset from the load address at which the
+ *		compressed data must start
+ * Return: 0 if OK, -EPROTONOSUPPORT if @comp cannot be decompressed in place,
+ *	-ENODATA if the uncompressed size is not recorded, -EINVAL if the
+ *	header is invalid
+ */
+int image_decomp_offset(int comp, const void *buf, ulong len, ulong *offsetp);
+
 /**
  * Set up properties in the FDT
  *
@@ -931,6 +953,7 @@ int booti_setup(ulong image, ulong *relocated_addr, ulong *size,
 #define FIT_COMP_PROP		"compression"
 #define FIT_ENTRY_PROP		"entry"
 #define FIT_LOAD_PROP		"load"
+#define FIT_DECOMP_OFFSET_PROP	"decomp-offset"
 
 /* configuration node */
 #define FIT_KERNEL_PROP		"kernel"
@@ -1005,6 +1028,7 @@ int fit_image_get_data(const void *fit, int noffset,
 int fit_image_get_data_offset(const void *fit, int noffset, int *data_offset);
 int fit_image_get_data_position(const void *fit, int noffset,
 				int *data_position);
+int fit_image_get_decomp_offset(const void *fit, int noffset, ulong *offset);
 int fit_image_get_data_size(const void *fit, int noffset, int *data_size);
 int fit_image_get_data_size_unciphered(const void *fit, int noffset,
 				       size_t *data_size);
@@ -1021,6 +1045,19 @@ int fit_cipher_data(const char *keydir, void *keydest, void *fit,
 		    const char *comment, int require_keys,
 		    const char *engine_id, const char *cmdname);
 
+/**
+ * fit_add_decomp_offsets() - record in-place decompression offsets
+ *
+ * Adds a decomp-offset property to each compressed image whose compression
+ * type supports in-place decompression, so that a loader can place the data
+ * at the tail of the output window without needing a separate buffer.
+ *
+ * @fit:	Pointer to the FIT format image header
+ * Return: 0 if OK, -ENOSPC if the FIT needs to be expanded, other -ve on
+ *	error
+ */
+int fit_add_decomp_offsets(void *fit);
+
 #define NODE_MAX_NAME_LEN	80
 
 /**
@@ -1051,6 +1088,7 @@ struct image_summary {
  * @engine_id:	Engine to use for signing
  * @cmdname:	Command name used when reporting errors
  * @algo_name:	Algorithm name, or NULL if to be read from FIT
+ * @jobs:	Number of threads to use for calculating image hashes
  * @summary:	Returns information about what data was written
  *
  * Adds hash values for all component images in the FIT blob.
@@ -1067,7 +1105,7 @@ int fit_add_verification_data(const char *keydir, const char *keyfile,
 			      void *keydest, void *fit, const char *comment,
 			      int require_keys, const char *engine_id,
 			      const char *cmdname, const char *algo_name,
-			      struct image_summary *summary);
+			      int jobs, struct image_summary *summary);
 
 /**
  * fit_image_verify_with_data() - Verify an image with given data
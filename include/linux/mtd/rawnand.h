@@ -102,6 +102,8 @@ void nand_wait_ready(struct mtd_info *mtd);
 #define NAND_CMD_READSTART	0x30
 #define NAND_CMD_RNDOUTSTART	0xE0
 #define NAND_CMD_CACHEDPROG	0x15
+#define NAND_CMD_READCACHESEQ	0x31
+#define NAND_CMD_READCACHEEND	0x3f
 
 /* Extended commands for AG-AND device */
 /*
@@ -220,6 +222,9 @@ enum nand_ecc_algo {
 /* Device needs 3rd row address cycle */
 #define NAND_ROW_ADDR_3		0x00004000
 
+/* Chip has the READ CACHE SEQUENTIAL / READ CACHE END commands */
+#define NAND_CACHEREAD		0x00008000
+
 /* Options valid for Samsung large page devices */
 #define NAND_SAMSUNG_LP_OPTIONS NAND_CACHEPRG
 
@@ -227,6 +232,9 @@ enum nand_ecc_algo {
 #define NAND_HAS_CACHEPROG(chip) ((chip->options & NAND_CACHEPRG))
 #define NAND_HAS_SUBPAGE_READ(chip) ((chip->options & NAND_SUBPAGE_READ))
 #define NAND_HAS_SUBPAGE_WRITE(chip) !((chip)->options & NAND_NO_SUBPAGE_WRITE)
+#define NAND_HAS_CACHEREAD(chip) \
+	(((chip)->options & (NAND_CACHEREAD | NAND_USE_CACHE_READ)) == \
+	 (NAND_CACHEREAD | NAND_USE_CACHE_READ))
 
 /* Non chip related options */
 /* This option skips the bbt scan during initialization. */
@@ -250,6 +258,13 @@ enum nand_ecc_algo {
  * kmap'ed, vmalloc'ed highmem buffers being passed from upper layers
  */
 #define NAND_USE_BOUNCE_BUFFER	0x00100000
+/*
+ * This option could be defined by controller drivers whose cmdfunc() can
+ * issue NAND_CMD_READCACHESEQ and NAND_CMD_READCACHEEND (no address cycles,
+ * followed by a wait for ready). Multi-page reads then use the chip's cache
+ * read commands if the chip supports them.
+ */
+#define NAND_USE_CACHE_READ	0x00200000
 
 /* Options set by nand scan */
 /* bbt has already been read */
@@ -284,7 +299,8 @@ enum nand_ecc_algo {
 /* ONFI subfeature parameters length */
 #define ONFI_SUBFEATURE_PARAM_LEN	4
 
-/* ONFI optional commands SET/GET FEATURES supported? */
+/* ONFI optional commands READ CACHE and SET/GET FEATURES supported? */
+#define ONFI_OPT_CMD_READ_CACHE		(1 << 1)
 #define ONFI_OPT_CMD_SET_GET_FEATURES	(1 << 2)
 
 struct nand_onfi_params {
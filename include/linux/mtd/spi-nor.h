@@ -449,11 +449,38 @@ enum spi_nor_cmd_ext {
 	SPI_NOR_EXT_HEX,
 };
 
+#define SNOR_ERASE_TYPE_MAX	4
+
+/**
+ * struct spi_nor_erase_type - Structure to describe a uniform SPI NOR erase
+ *			       command
+ * @size:		the size of the sector/block erased by the command
+ *			(0 if this erase type is unused)
+ * @opcode:		the SPI command op code to erase the sector/block
+ */
+struct spi_nor_erase_type {
+	u32	size;
+	u8	opcode;
+};
+
+/**
+ * struct spi_nor_erase_region - Structure to describe a region of a
+ *				 non-uniform SPI NOR sector map
+ * @size:		the size of the region
+ * @erase_mask:		bitmask of the @erase_type entries supported in the
+ *			region
+ */
+struct spi_nor_erase_region {
+	u32	size;
+	u8	erase_mask;
+};
+
 /**
  * struct flash_info - Forward declaration of a structure used internally by
  *		       spi_nor_scan()
  */
 struct flash_info;
+struct spi_mem_dirmap_desc;
 
 /*
  * TODO: Remove, once all users of spi_flash interface are moved to MTD
@@ -476,6 +503,11 @@ struct spi_flash {
  * @page_size:		the page size of the SPI NOR
  * @addr_width:		number of address bytes
  * @erase_opcode:	the opcode for erasing a sector
+ * @erase_type:		erase commands larger than @erase_opcode which can be
+ *			used when an erase request covers an aligned block
+ * @erase_map:		regions of a non-uniform sector map, in address order,
+ *			or NULL when every erase type is valid everywhere
+ * @erase_map_count:	number of entries in @erase_map
  * @read_opcode:	the read opcode
  * @read_dummy:		the dummy needed by the read operation
  * @program_opcode:	the program opcode
@@ -511,6 +543,7 @@ struct spi_flash {
  * @quad_enable:	[FLASH-SPECIFIC] enables SPI NOR quad mode
  * @octal_dtr_enable:	[FLASH-SPECIFIC] enables SPI NOR octal DTR mode.
  * @ready:		[FLASH-SPECIFIC] check if the flash is ready
+ * @dirmap:		pointers to struct spi_mem_dirmap_desc for reads
  * @priv:		the private data
  */
 struct spi_nor {
@@ -522,6 +555,9 @@ struct spi_nor {
 	u32			page_size;
 	u8			addr_width;
 	u8			erase_opcode;
+	struct spi_nor_erase_type erase_type[SNOR_ERASE_TYPE_MAX];
+	const struct spi_nor_erase_region *erase_map;
+	int			erase_map_count;
 	u8			read_opcode;
 	u8			read_dummy;
 	u8			program_opcode;
@@ -561,6 +597,12 @@ struct spi_nor {
 	int (*octal_dtr_enable)(struct spi_nor *nor);
 	int (*ready)(struct spi_nor *nor);
 
+#if CONFIG_IS_ENABLED(SPI_DIRMAP)
+	struct {
+		struct spi_mem_dirmap_desc *rdesc;
+	} dirmap;
+#endif
+
 	void *priv;
 	char mtd_name[MTD_NAME_SIZE(MTD_DEV_TYPE_NOR)];
 /* Compatibility for spi_flash, remove once sf layer is merged with mtd */
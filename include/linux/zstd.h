@@ -1149,6 +1149,11 @@ struct abuf;
 /**
  * zstd_decompress() - Decompress Zstandard data
  *
+ * All frames at the start of @in are decompressed one after the other, so
+ * multi-frame (e.g. seekable) data is supported. Skippable frames are
+ * ignored, as is any trailing data which is not a frame. The decompression
+ * context is allocated on first use and kept for later calls.
+ *
  * @in: Input buffer to decompress
  * @out: Output buffer to hold the results (must be large enough)
  * Return: size of the decompressed data, or -ve on error
@@ -548,6 +548,24 @@ const char *log_get_level_name(enum log_level_t level);
  */
 enum log_level_t log_get_level_by_name(const char *name);
 
+/* Size of a buffer which holds the header from log_format_header() */
+#define LOG_HEADER_SIZE		192
+
+/**
+ * log_format_header() - Format the header of a log record
+ *
+ * This writes the fields selected by the current log format (gd->log_fmt)
+ * which go before the message, as shown by the console. If the message is
+ * also selected, the header ends with the space which separates the two.
+ * The header is empty for a continuation record.
+ *
+ * @rec: Log record to format
+ * @buf: Buffer to write to, which is always nul-terminated
+ * @size: Size of @buf in bytes, normally LOG_HEADER_SIZE
+ * Return: number of characters written to @buf, excluding the terminator
+ */
+int log_format_header(const struct log_rec *rec, char *buf, int size);
+
 /**
  * log_device_find_by_name() - Look up a log device by its driver's name
  *
@@ -46,6 +46,8 @@ struct udevice;
 
 /* Number of packets processed together */
 #define ETH_PACKETS_BATCH_RECV	32
+/* Most packets processed together while they keep arriving */
+#define ETH_PACKETS_BATCH_MAX	256
 
 /* ARP hardware address length */
 #define ARP_HLEN 6
@@ -116,6 +118,8 @@ enum eth_state_t {
  * @phy_interface: PHY interface to use - see PHY_INTERFACE_MODE_...
  * @max_speed: Maximum speed of Ethernet connection supported by MAC
  * @priv_pdata: device specific plat
+ * @features: ETH_FEAT_... flags for the offloads the device supports, set by
+ *	the driver when probing
  */
 struct eth_pdata {
 	phys_addr_t iobase;
@@ -123,6 +127,20 @@ struct eth_pdata {
 	int phy_interface;
 	int max_speed;
 	void *priv_pdata;
+	u32 features;
+};
+
+/*
+ * Offloads an Ethernet device may support (with CONFIG_NET_OFFLOAD). Receive
+ * checksum offload needs no flag, since the driver reports it for each packet
+ * with eth_rx_set_csum_ok().
+ */
+enum eth_features {
+	/*
+	 * The device fills in the checksum of each IPv4 UDP or TCP packet
+	 * which is not a fragment, so the stack leaves it as 0
+	 */
+	ETH_FEAT_TX_CSUM		= 1 << 0,
 };
 
 enum eth_recv_flags {
@@ -159,6 +177,11 @@ enum eth_recv_flags {
  *		    to the network stack. This function should fill in the
  *		    eth_pdata::enetaddr field - optional
  * set_promisc: Enable or Disable promiscuous mode
+ * send_sg: Send a packet whose payload is in a separate buffer from its
+ *	    headers, without first copying the two together. The driver may
+ *	    write to the headers, e.g. to set up a checksum. It returns
+ *	    -EMSGSIZE, without sending anything, if the packet is too long to
+ *	    gather - optional
  */
 struct eth_ops {
 	int (*start)(struct udevice *dev);
@@ -170,6 +193,8 @@ struct eth_ops {
 	int (*write_hwaddr)(struct udevice *dev);
 	int (*read_rom_hwaddr)(struct udevice *dev);
 	int (*set_promisc)(struct udevice *dev, bool enable);
+	int (*send_sg)(struct udevice *dev, void *hdr, int hdr_len,
+		       const void *data, int data_len);
 };
 
 #define eth_get_ops(dev) ((struct eth_ops *)(dev)->driver->ops)
@@ -186,6 +211,234 @@ unsigned char *eth_get_ethaddr(void); /* get the current device MAC */
 int eth_is_active(struct udevice *dev); /* Test device for active state */
 int eth_init_state_only(void); /* Set active state */
 void eth_halt_state_only(void); /* Set passive state */
+
+/**
+ * struct eth_stats - packet counters for an Ethernet device
+ *
+ * The uclass counts packets passing through eth_rx() and eth_send(). Drivers
+ * add the packets which never got that far to @rx_dropped and @rx_overruns.
+ *
+ * @rx_packets: Packets received
+ * @rx_bytes: Bytes received
+ * @rx_errors: Errors returned by the driver's recv() method
+ * @rx_dropped: Packets received but thrown away by the driver, e.g. because
+ *	they were bad
+ * @rx_overruns: Packets lost because there was no receive buffer for them
+ * @rx_polls: Calls to eth_rx()
+ * @rx_full_polls: Calls to eth_rx() which stopped with packets still waiting
+ * @tx_packets: Packets sent
+ * @tx_bytes: Bytes sent
+ * @tx_errors: Errors returned by the driver's send() method
+ */
+struct eth_stats {
+	ulong rx_packets;
+	u64 rx_bytes;
+	ulong rx_errors;
+	ulong rx_dropped;
+	ulong rx_overruns;
+	ulong rx_polls;
+	ulong rx_full_polls;
+	ulong tx_packets;
+	u64 tx_bytes;
+	ulong tx_errors;
+};
+
+/**
+ * eth_get_stats() - get the packet counters of a device
+ *
+ * @dev: Ethernet device, which must be probed
+ * Return: counters of the device
+ */
+struct eth_stats *eth_get_stats(struct udevice *dev);
+
+/**
+ * eth_get_rx_batch() - get how many packets eth_rx() may process at once
+ *
+ * This starts at ETH_PACKETS_BATCH_RECV and doubles, up to
+ * ETH_PACKETS_BATCH_MAX, each time eth_rx() finds packets still waiting once
+ * it has processed that many. It falls back again when the traffic eases.
+ *
+ * @dev: Ethernet device, which must be probed
+ * Return: number of packets
+ */
+uint eth_get_rx_batch(struct udevice *dev);
+
+/**
+ * eth_get_rx_ring_size() - get how many receive buffers a driver should use
+ *
+ * Drivers which can size their receive ring call this when probing. The
+ * size is taken from the "u-boot,rx-ring-size" property of the device, so
+ * that boards which see drops with bursty traffic can ask for more.
+ *
+ * @dev: Ethernet device
+ * @def: number of buffers to use if the device does not say
+ * Return: number of receive buffers
+ */
+int eth_get_rx_ring_size(struct udevice *dev, int def);
+
+/**
+ * struct eth_rx_hint - where to receive the payload of coming packets
+ *
+ * A protocol which knows where the data of the coming packets belongs can
+ * ask the driver to receive it there, so that it does not have to be copied.
+ * Each packet is split after @hdr_len bytes: the headers stay in the driver's
+ * own buffer and the rest goes to a slot in @buf, the slots following each
+ * other every @stride bytes. The data of a packet may end up in a slot other
+ * than its own, for example if another packet arrives in between, so the
+ * protocol must check where it is with eth_rx_payload().
+ *
+ * Only UDP packets for @port whose payload starts with @match are left
+ * split; the payload of any other packet is put back after its headers
+ * before it is processed.
+ *
+ * @buf: slot for the payload of the next packet the protocol expects
+ * @size: number of bytes from @buf which the driver may write to
+ * @stride: number of bytes between slots
+ * @hdr_len: number of bytes from the start of the Ethernet header which stay
+ *	in the driver's buffer
+ * @port: UDP destination port of the packets
+ * @match: bytes which the UDP payload of the packets starts with
+ * @match_len: number of bytes in @match, at most @hdr_len less the Ethernet,
+ *	IP and UDP headers
+ */
+struct eth_rx_hint {
+	uchar *buf;
+	ulong size;
+	uint stride;
+	uint hdr_len;
+	int port;
+	const uchar *match;
+	uint match_len;
+};
+
+/**
+ * eth_rx_hint() - say where the payload of coming packets belongs
+ *
+ * This applies to the receive buffers which the driver gives to the hardware
+ * from now on, until the next call or until the device is stopped. Buffers
+ * already given to the hardware are not changed, so the first few packets
+ * are still received into the driver's own buffers.
+ *
+ * @hint: where to put the payloads, or NULL to stop
+ * Return: 0 if OK, -ENODEV if there is no Ethernet device
+ */
+int eth_rx_hint(const struct eth_rx_hint *hint);
+
+/**
+ * eth_rx_payload() - get where the payload of the current packet is
+ *
+ * Return: the slot holding the payload of the packet being processed, or
+ *	NULL if the packet is all in one buffer
+ */
+uchar *eth_rx_payload(void);
+
+/**
+ * eth_rx_hint_buf() - get a slot for a receive buffer
+ *
+ * A driver which supports eth_rx_hint() calls this each time it gives a
+ * receive buffer to the hardware, so that the uclass can tell which packet
+ * the buffer is for. If this returns a slot, the driver receives the first
+ * *@hdr_lenp bytes of the packet into its own buffer and the rest into the
+ * slot, writing no more than *@lenp bytes to it, then reports it with
+ * eth_rx_set_payload(). The driver's buffer must still be large enough for
+ * the whole packet, since the uclass copies the payload back into it if the
+ * packet turns out not to be the one expected, and a packet too long for
+ * the slot must not be reported as split.
+ *
+ * @dev: Ethernet device
+ * @idx: which of the driver's receive buffers this is, from 0 to one less
+ *	than the count given to eth_rx_hint_reset()
+ * @align: alignment which the slot needs, e.g. ARCH_DMA_MINALIGN
+ * @lenp: number of bytes which the driver would like to write to the slot;
+ *	returns the number which it may write
+ * @hdr_lenp: returns the number of bytes to keep in the driver's buffer
+ * Return: slot for the payload, or NULL to receive into the driver's buffer
+ */
+uchar *eth_rx_hint_buf(struct udevice *dev, uint idx, ulong align,
+		       uint *lenp, uint *hdr_lenp);
+
+/**
+ * eth_rx_hint_reset() - note that the driver has set up its receive buffers
+ *
+ * Drivers call this when they take back all the receive buffers from the
+ * hardware and give it @count new ones without calling eth_rx_hint_buf(),
+ * normally when the device is started.
+ *
+ * @dev: Ethernet device
+ * @count: number of receive buffers the driver has
+ */
+void eth_rx_hint_reset(struct udevice *dev, uint count);
+
+/**
+ * eth_rx_set_payload() - note that a received packet is split
+ *
+ * Drivers call this from their recv() method when a packet was received with
+ * a slot from eth_rx_hint_buf() and is longer than the headers.
+ *
+ * @dev: Ethernet device
+ * @payload: slot holding the rest of the packet
+ * @hdr_len: number of bytes of the packet in the driver's buffer
+ */
+void eth_rx_set_payload(struct udevice *dev, uchar *payload, uint hdr_len);
+
+/**
+ * eth_rx_set_csum_ok() - note that the hardware checked a packet's checksum
+ *
+ * Drivers call this from their recv() method when the hardware found that
+ * the packet is an IPv4 UDP or TCP packet, not a fragment, with a good
+ * checksum. The stack then does not check that checksum again. The IP
+ * header checksum is always checked by the stack, since it is cheap.
+ *
+ * @dev: Ethernet device
+ */
+void eth_rx_set_csum_ok(struct udevice *dev);
+
+/**
+ * eth_start_all() - start every Ethernet device, not just the current one
+ *
+ * This lets a protocol look for a server on all the interfaces at once,
+ * rather than trying one after another. The devices started here are used
+ * by eth_foreach_active() and eth_rx_all(), and stopped again by eth_halt()
+ * or, once the protocol has chosen one, by eth_halt_others(). Devices
+ * without a valid MAC address and DSA ports are left alone.
+ *
+ * The current device must already be started with eth_init().
+ *
+ * Return: number of devices running, including the current one
+ */
+int eth_start_all(void);
+
+/**
+ * eth_foreach_active() - call a function with each running device current
+ *
+ * While @func runs, the device is current and net_ethaddr holds its MAC
+ * address, so that packets built and sent by @func go out on it. The
+ * current device is put back afterwards. If eth_start_all() has not started
+ * any other device, @func is just called once.
+ *
+ * @func: function to call
+ */
+void eth_foreach_active(void (*func)(void));
+
+/**
+ * eth_rx_all() - check each running device for received packets
+ *
+ * This calls eth_rx() for each device, with the device current as for
+ * eth_foreach_active() while its packets are processed. If a packet handler
+ * chooses the device by calling eth_halt_others(), it stays current and
+ * the rest are not checked.
+ *
+ * Return: as eth_rx() for the current device
+ */
+int eth_rx_all(void);
+
+/**
+ * eth_halt_others() - stop all the devices except the current one
+ *
+ * This undoes eth_start_all() for every device but the current one, which
+ * becomes the "ethact" device.
+ */
+void eth_halt_others(void);
 #endif
 
 #ifndef CONFIG_DM_ETH
@@ -302,6 +555,36 @@ int eth_env_get_enetaddr_by_index(const char *base_name, int index,
 int eth_init(void);			/* Initialize the device */
 int eth_send(void *packet, int length);	   /* Send a packet */
 
+/**
+ * eth_send_sg() - send a packet made of its headers and a separate payload
+ *
+ * This saves copying the payload in after the headers, if the driver can
+ * send the two from where they are. The driver may write to @hdr.
+ *
+ * @hdr: Ethernet, IP and UDP or TCP headers of the packet
+ * @hdr_len: number of bytes in @hdr
+ * @data: payload of the packet
+ * @data_len: number of bytes in @data
+ * Return: as eth_send(), or -ENOSYS if the packet must be sent whole, or
+ *	-EMSGSIZE if the driver cannot gather a packet this long
+ */
+int eth_send_sg(void *hdr, int hdr_len, const void *data, int data_len);
+
+/**
+ * eth_tx_csum_offload() - check if the current device fills in checksums
+ *
+ * Return: true if the current device has ETH_FEAT_TX_CSUM
+ */
+bool eth_tx_csum_offload(void);
+
+/**
+ * eth_rx_csum_ok() - check if the current packet's checksum was checked
+ *
+ * Return: true if the driver called eth_rx_set_csum_ok() for the packet being
+ *	processed
+ */
+bool eth_rx_csum_ok(void);
+
 #if defined(CONFIG_API) || defined(CONFIG_EFI_LOADER)
 int eth_receive(void *packet, int length); /* Receive a packet*/
 extern void (*push_packet)(void *packet, int length);
@@ -371,6 +654,7 @@ struct vlan_ethernet_hdr {
 #define PROT_NCSI	0x88f8		/* NC-SI control packets        */
 
 #define IPPROTO_ICMP	 1	/* Internet Control Message Protocol	*/
+#define IPPROTO_TCP	 6	/* Transmission Control Protocol	*/
 #define IPPROTO_UDP	17	/* User Datagram Protocol		*/
 
 /*
@@ -562,7 +846,7 @@ extern int		net_restart_wrap;	/* Tried all network devices */
 
 enum proto_t {
 	BOOTP, RARP, ARP, TFTPGET, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP,
-	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, UDP
+	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, UDP, WGET, TFTPMULTI
 };
 
 extern char	net_boot_file_name[1024];/* Boot File name */
@@ -653,12 +937,76 @@ unsigned add_ip_checksums(unsigned offset, unsigned sum, unsigned new_sum);
  */
 int ip_checksum_ok(const void *addr, unsigned nbytes);
 
+/**
+ * net_pseudo_checksum() - Compute the checksum of an IPv4 pseudo-header
+ *
+ * @src:	Source address
+ * @dest:	Destination address
+ * @proto:	IPPROTO_UDP or IPPROTO_TCP
+ * @len:	Length of the UDP or TCP segment in bytes
+ * Return: 16-bit IP checksum of the pseudo-header alone, as hardware which
+ *	fills in the rest of the checksum expects
+ */
+unsigned net_pseudo_checksum(struct in_addr src, struct in_addr dest,
+			     u8 proto, unsigned len);
+
+/**
+ * net_l4_checksum() - Compute the checksum of a UDP or TCP segment
+ *
+ * The sum covers the IPv4 pseudo-header and the segment, so it is the value
+ * to store when the checksum field is 0, or 0 if the segment is correct.
+ *
+ * @src:	Source address
+ * @dest:	Destination address
+ * @proto:	IPPROTO_UDP or IPPROTO_TCP
+ * @seg:	Segment, starting at its header (must be 16-bit aligned)
+ * @len:	Length of the segment in bytes
+ * Return: 16-bit IP checksum
+ */
+unsigned net_l4_checksum(struct in_addr src, struct in_addr dest, u8 proto,
+			 const void *seg, unsigned len);
+
+/**
+ * net_l4_checksum_field() - Find the checksum field of a UDP or TCP packet
+ *
+ * Only IPv4 packets without options which are not fragments are handled, as
+ * checksum offload hardware does. The Ethernet header may carry an 802.1Q
+ * VLAN tag.
+ *
+ * @packet:	Packet, starting at its Ethernet header
+ * @len:	Number of bytes of @packet which can be read
+ * @ipp:	Returns the IP header, if the checksum field is found
+ * Return: pointer to the checksum field, or NULL if there is none
+ */
+u16 *net_l4_checksum_field(void *packet, int len, struct ip_udp_hdr **ipp);
+
 /* Callbacks */
 rxhand_f *net_get_udp_handler(void);	/* Get UDP RX packet handler */
 void net_set_udp_handler(rxhand_f *);	/* Set UDP RX packet handler */
 rxhand_f *net_get_arp_handler(void);	/* Get ARP RX packet handler */
 void net_set_arp_handler(rxhand_f *);	/* Set ARP RX packet handler */
 bool arp_is_waiting(void);		/* Waiting for ARP reply? */
+#ifdef CONFIG_NET_ARP_CACHE
+/**
+ * arp_cache_lookup() - look up where to send a packet in the ARP cache
+ *
+ * @dest: IP address the packet is for
+ * @ethaddr: returns the MAC address of @dest, or of the gateway if @dest is
+ *	not on our network
+ * Return: true if found, false if an ARP request is needed
+ */
+bool arp_cache_lookup(struct in_addr dest, uchar *ethaddr);
+void arp_cache_flush(void);		/* Forget all MAC addresses */
+#else
+static inline bool arp_cache_lookup(struct in_addr dest, uchar *ethaddr)
+{
+	return false;
+}
+
+static inline void arp_cache_flush(void)
+{
+}
+#endif
 void net_set_icmp_handler(rxhand_icmp_f *f); /* Set ICMP RX handler */
 void net_set_timeout_handler(ulong, thand_f *);/* Set timeout handler */
 
@@ -693,14 +1041,18 @@ static inline void net_send_packet(uchar *pkt, int len)
 }
 
 /*
- * Transmit "net_tx_packet" as UDP packet, performing ARP request if needed
- *  (ether will be populated)
+ * Transmit "net_tx_packet" as UDP or TCP packet, performing ARP request if
+ *  needed (ether will be populated)
  *
  * @param ether Raw packet buffer
  * @param dest IP address to send the datagram to
- * @param dport Destination UDP port
- * @param sport Source UDP port
- * @param payload_len Length of data after the UDP header
+ * @param dport Destination UDP/TCP port
+ * @param sport Source UDP/TCP port
+ * @param payload_len Length of data after the UDP/TCP header
+ * @param proto IPPROTO_UDP or IPPROTO_TCP
+ * @param action TCP flags to send (TCP only)
+ * @param tcp_seq_num TCP sequence number
+ * @param tcp_ack_num TCP acknowledgement number
  */
 int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 		       int payload_len, int proto, u8 action, u32 tcp_seq_num,
@@ -708,6 +1060,24 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport,
 			int sport, int payload_len);
 
+/**
+ * net_send_udp_data() - send a UDP packet with a payload from elsewhere
+ *
+ * This is like net_send_udp_packet() but takes the payload from @data rather
+ * than from after the headers in net_tx_packet. If the driver can send the
+ * headers and payload from separate buffers, the payload is not copied.
+ *
+ * @ether: MAC address to send to, filled in by ARP if it is not yet known
+ * @dest: IP address to send the datagram to
+ * @dport: destination UDP port
+ * @sport: source UDP port
+ * @data: payload of the packet
+ * @len: number of bytes in @data
+ * Return: 0 if sent, 1 if waiting for ARP, -ve on error
+ */
+int net_send_udp_data(uchar *ether, struct in_addr dest, int dport, int sport,
+		      const void *data, int len);
+
 /* Processes a received packet */
 void net_process_received_packet(uchar *in_packet, int len);
 
@@ -717,6 +1087,46 @@ int nc_input_packet(uchar *pkt, struct in_addr src_ip, unsigned dest_port,
 	unsigned src_port, unsigned len);
 #endif
 
+#if defined(CONFIG_NETCONSOLE_BUFFERED) && !defined(CONFIG_SPL_BUILD)
+/**
+ * nc_output() - queue output for the network console
+ *
+ * The output is batched into datagrams of up to an Ethernet MTU. Full
+ * datagrams are sent straight away. The rest is sent when a newline is
+ * queued, if nothing was sent or queued for CONFIG_NETCONSOLE_FLUSH_MS
+ * before, or if the oldest queued byte has waited that long. Nothing is
+ * sent until the nc device has been started, and output which does not fit
+ * in the ring by then is dropped.
+ *
+ * @s: output to queue
+ * @len: number of bytes in @s
+ */
+void nc_output(const char *s, int len);
+
+/**
+ * nc_flush() - send all queued network console output
+ */
+void nc_flush(void);
+
+/**
+ * nc_poll() - send network console output which has waited long enough
+ *
+ * This is called from the net loop, so that the last lines of output do not
+ * stay queued while the network is busy. Output is only sent if the oldest
+ * queued byte has waited CONFIG_NETCONSOLE_FLUSH_MS and the server's
+ * Ethernet address is known.
+ */
+void nc_poll(void);
+#else
+static inline void nc_flush(void)
+{
+}
+
+static inline void nc_poll(void)
+{
+}
+#endif
+
 static __always_inline int eth_is_on_demand_init(void)
 {
 #if defined(CONFIG_NETCONSOLE) && !defined(CONFIG_SPL_BUILD)
@@ -0,0 +1,167 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Minimal TCP client
+ */
+
+#ifndef __TCP_H__
+#define __TCP_H__
+
+#include <net.h>
+
+#define TCP_FIN		0x01	/* no more data from the sender		*/
+#define TCP_SYN		0x02	/* synchronise sequence numbers		*/
+#define TCP_RST		0x04	/* reset the connection			*/
+#define TCP_PUSH	0x08	/* push the data to the application	*/
+#define TCP_ACK		0x10	/* acknowledgement field is valid	*/
+
+/* Option kinds */
+#define TCP_O_END	0	/* end of options			*/
+#define TCP_O_NOP	1	/* padding				*/
+#define TCP_O_MSS	2	/* maximum segment size			*/
+#define TCP_O_SCL	3	/* window scale				*/
+#define TCP_O_SACK_OK	4	/* selective acknowledgement permitted	*/
+#define TCP_O_SACK	5	/* selective acknowledgement blocks	*/
+
+/* Largest segment we can receive without IP fragmentation */
+#define TCP_MSS		1460
+
+/* Most SACK blocks reported in one acknowledgement (RFC 2018) */
+#define TCP_SACK_BLOCKS	4
+
+/*
+ *	Internet Protocol (IP) + TCP header, without options.
+ */
+struct ip_tcp_hdr {
+	u8		ip_hl_v;	/* header length and version	*/
+	u8		ip_tos;		/* type of service		*/
+	u16		ip_len;		/* total length			*/
+	u16		ip_id;		/* identification		*/
+	u16		ip_off;		/* fragment offset field	*/
+	u8		ip_ttl;		/* time to live			*/
+	u8		ip_p;		/* protocol			*/
+	u16		ip_sum;		/* checksum			*/
+	struct in_addr	ip_src;		/* Source IP address		*/
+	struct in_addr	ip_dst;		/* Destination IP address	*/
+	u16		tcp_src;	/* TCP source port		*/
+	u16		tcp_dst;	/* TCP destination port		*/
+	u32		tcp_seq;	/* sequence number		*/
+	u32		tcp_ack;	/* acknowledgement number	*/
+	u8		tcp_hlen;	/* header length in words << 4	*/
+	u8		tcp_flags;	/* TCP_... flags		*/
+	u16		tcp_win;	/* receive window		*/
+	u16		tcp_xsum;	/* checksum			*/
+	u16		tcp_urg;	/* urgent pointer		*/
+} __attribute__((packed));
+
+#define IP_TCP_HDR_SIZE		(sizeof(struct ip_tcp_hdr))
+#define TCP_HDR_SIZE		(IP_TCP_HDR_SIZE - IP_HDR_SIZE)
+
+enum tcp_state {
+	TCP_CLOSED,
+	TCP_SYN_SENT,		/* waiting for the server's SYN */
+	TCP_ESTABLISHED,
+	TCP_FIN_WAIT,		/* we closed, waiting for the server */
+	TCP_LAST_ACK,		/* the server closed and so did we */
+};
+
+/**
+ * struct tcp_ops - callbacks for the application using a TCP connection
+ *
+ * The connection delivers received data through @rx as soon as it arrives,
+ * including data which arrives out of order, so that the application can
+ * store it directly where it belongs. Data is never delivered twice unless
+ * it is retransmitted by the server.
+ *
+ * @connected: called once the connection is established
+ * @rx: called with @len bytes of @data found at @offset in the stream,
+ *	the first byte after the SYN being at offset 0. Returns 0 if the data
+ *	was used, -EAGAIN to drop out-of-order data so that the server sends it
+ *	again later, or another -ve error to reset the connection
+ * @closed: called when the connection is closed, with 0 if the server
+ *	closed it after sending all of its data, or a -ve error
+ */
+struct tcp_ops {
+	void (*connected)(void);
+	int (*rx)(u32 offset, const uchar *data, unsigned int len);
+	void (*closed)(int err);
+};
+
+/**
+ * tcp_connect() - open a connection to a server
+ *
+ * This sends the SYN and returns; the rest happens in net_loop(). Only one
+ * connection is supported, so any earlier one is forgotten.
+ *
+ * @dest: IP address of the server
+ * @dport: TCP port on the server
+ * @ops: callbacks for the connection
+ */
+void tcp_connect(struct in_addr dest, int dport, const struct tcp_ops *ops);
+
+/**
+ * tcp_send() - send data on an established connection
+ *
+ * The data is kept until the server acknowledges it, and sent again if
+ * needed. Only one segment of data may be outstanding at a time.
+ *
+ * @data: data to send
+ * @len: number of bytes, at most TCP_MSS
+ * Return: 0 if OK, -ENOTCONN if not connected, -EMSGSIZE if @len is too
+ *	large, -EBUSY if earlier data is not yet acknowledged
+ */
+int tcp_send(const void *data, unsigned int len);
+
+/**
+ * tcp_close() - close the connection
+ *
+ * This sends a FIN if the connection is established. The @closed callback is
+ * not called.
+ */
+void tcp_close(void);
+
+/**
+ * tcp_abort() - reset the connection
+ *
+ * This sends a RST if the connection is open. The @closed callback is not
+ * called.
+ */
+void tcp_abort(void);
+
+/**
+ * tcp_get_state() - get the state of the connection
+ *
+ * Return: state of the connection
+ */
+enum tcp_state tcp_get_state(void);
+
+/**
+ * tcp_set_tcp_header() - set up the IP and TCP headers of a segment
+ *
+ * Options are only added to segments without any data: the SYN options,
+ * or the SACK blocks describing data received out of order. The data must
+ * already be in place, at IP_TCP_HDR_SIZE bytes from @pkt, since it is
+ * included in the checksum.
+ *
+ * @pkt: buffer for the IP header
+ * @dest: IP address to send to
+ * @dport: destination port
+ * @sport: source port
+ * @payload_len: number of bytes of data
+ * @action: TCP_... flags to send
+ * @tcp_seq_num: sequence number
+ * @tcp_ack_num: acknowledgement number
+ * Return: size of the IP and TCP headers, including options
+ */
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num);
+
+/**
+ * tcp_receive() - handle a received TCP segment
+ *
+ * @tcp: IP packet containing the segment
+ * @len: length of the IP packet
+ */
+void tcp_receive(struct ip_tcp_hdr *tcp, unsigned int len);
+
+#endif /* __TCP_H__ */
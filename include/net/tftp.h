@@ -25,6 +25,47 @@ void tftp_start_server(void);	/* Wait for incoming TFTP put */
 extern ulong tftp_timeout_ms;
 extern int tftp_timeout_count_max;
 
+#ifdef CONFIG_TFTP_MULTI
+/* Most files which tftp_get_files() fetches at once */
+#define TFTP_MULTI_MAX	4
+
+/**
+ * struct tftp_file - a file for tftp_get_files() to fetch
+ *
+ * @name: name of the file on the server
+ * @addr: address to load the file to
+ * @size: returns the size of the file
+ * @err: returns 0 if the file was loaded, else a -ve error
+ */
+struct tftp_file {
+	const char *name;
+	ulong addr;
+	ulong size;
+	int err;
+};
+
+/**
+ * tftp_get_files() - fetch several files from the server at once
+ *
+ * Each file has its own transfer, from its own UDP port, and the transfers
+ * all run in the same net_loop(). This saves a round trip to the server for
+ * each block of all but one of the files, which matters most when the
+ * server is far away. The files are fetched from 'serverip'.
+ *
+ * A file which does not fit before the next file's address, or which runs
+ * into reserved memory, is not loaded.
+ *
+ * @files: files to fetch
+ * @count: number of files, at most TFTP_MULTI_MAX
+ * Return: number of files loaded, or -ve error if the network could not be
+ *	used
+ */
+int tftp_get_files(struct tftp_file *files, int count);
+
+/* Start the transfers for tftp_get_files(), from net_loop() */
+void tftp_multi_start(void);
+#endif
+
 /**********************************************************************/
 
 #endif /* __TFTP_H__ */
@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * HTTP/1.1 download over TCP
+ */
+
+#ifndef __WGET_H__
+#define __WGET_H__
+
+/* TCP port of the web server */
+#define WGET_HTTP_PORT	80
+
+/**
+ * wget_start() - start downloading net_boot_file_name from a web server
+ *
+ * The file is loaded to image_load_addr. The server is taken from
+ * net_boot_file_name if given there as "server:path", otherwise it is
+ * net_server_ip.
+ */
+void wget_start(void);
+
+#endif /* __WGET_H__ */
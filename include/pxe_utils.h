@@ -81,6 +81,24 @@ struct pxe_context;
 typedef int (*pxe_getfile_func)(struct pxe_context *ctx, const char *file_path,
 				char *file_addr, ulong *filesizep);
 
+/* Most files which are fetched together when a label is booted */
+#define PXE_PREFETCH_MAX	3
+
+/**
+ * struct pxe_file - a file for getfiles() to read
+ *
+ * @path: path of the file, allocated
+ * @addr: address to load the file to
+ * @size: returns the size of the file in bytes
+ * @err: returns 0 if the file was read, else a -ve error
+ */
+struct pxe_file {
+	char *path;
+	ulong addr;
+	ulong size;
+	int err;
+};
+
 /**
  * struct pxe_context - context information for PXE parsing
  *
@@ -91,6 +109,8 @@ typedef int (*pxe_getfile_func)(struct pxe_context *ctx, const char *file_path,
  * @bootdir: Directory that files are loaded from ("" if no directory). This is
  *	allocated
  * @pxe_file_size: Size of the PXE file
+ * @prefetch: Files of the label being booted which getfiles() has read
+ * @prefetch_count: Number of entries in @prefetch
  */
 struct pxe_context {
 	struct cmd_tbl *cmdtp;
@@ -106,10 +126,26 @@ struct pxe_context {
 	 */
 	pxe_getfile_func getfile;
 
+	/**
+	 * getfiles() - read several files at once
+	 *
+	 * This is optional. If set, the files needed to boot a label are read
+	 * together as soon as the label is chosen, rather than one by one.
+	 *
+	 * @ctx: PXE context
+	 * @files: Files to read, each of which returns its own result
+	 * @count: Number of files
+	 * Return 0 if OK, -ve if the files could not be read at all
+	 */
+	int (*getfiles)(struct pxe_context *ctx, struct pxe_file *files,
+			int count);
+
 	void *userdata;
 	bool allow_abs_path;
 	char *bootdir;
 	ulong pxe_file_size;
+	struct pxe_file prefetch[PXE_PREFETCH_MAX];
+	int prefetch_count;
 };
 
 /**
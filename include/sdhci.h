@@ -123,6 +123,7 @@
 #define  SDHCI_INT_CARD_INSERT	BIT(6)
 #define  SDHCI_INT_CARD_REMOVE	BIT(7)
 #define  SDHCI_INT_CARD_INT	BIT(8)
+#define  SDHCI_INT_CQE		BIT(14)
 #define  SDHCI_INT_ERROR	BIT(15)
 #define  SDHCI_INT_TIMEOUT	BIT(16)
 #define  SDHCI_INT_CRC		BIT(17)
@@ -519,6 +520,22 @@ extern const struct dm_mmc_ops sdhci_ops;
 #else
 #endif
 
+#if CONFIG_IS_ENABLED(MMC_CQHCI)
+/**
+ * sdhci_cqe_add_host() - Add a command queue engine to an SDHCI host
+ *
+ * This allocates a CQHCI instance using the SDHCI callbacks for switching
+ * between queued and legacy operation, and attaches it to the host's MMC
+ * device. It should be called from the driver's probe() method after
+ * sdhci_setup_cfg(), if the device tree node has "supports-cqe".
+ *
+ * @host:	SDHCI host structure
+ * @mmio:	Base address of the CQHCI registers
+ * Return: 0 if OK, -ve on error
+ */
+int sdhci_cqe_add_host(struct sdhci_host *host, void __iomem *mmio);
+#endif
+
 struct sdhci_adma_desc *sdhci_adma_init(void);
 void sdhci_prepare_adma_table(struct sdhci_adma_desc *table,
 			      struct mmc_data *data, dma_addr_t addr);
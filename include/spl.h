@@ -459,6 +459,47 @@ void spl_board_prepare_for_linux(void);
  */
 void spl_board_prepare_for_optee(void *fdt);
 void spl_board_prepare_for_boot(void);
+
+/* Caches turned on by spl_enable_caches() */
+enum spl_cache_flags {
+	SPL_CACHE_ICACHE	= 1 << 0,
+	SPL_CACHE_DCACHE	= 1 << 1,
+};
+
+/**
+ * spl_alloc_page_tables() - Choose where the SPL page tables go
+ *
+ * This is called by spl_enable_caches() before the data cache is enabled,
+ * unless gd->arch.tlb_addr is already set. The default uses
+ * SPL_PAGE_TABLE_ADDR if set, otherwise the top of the first DRAM bank
+ * below 4GiB. Boards may override it, e.g. to use SRAM instead.
+ *
+ * @size: Size of the page tables in bytes
+ * Return: address of the page tables, 64KiB-aligned
+ */
+ulong spl_alloc_page_tables(ulong size);
+
+/**
+ * spl_enable_caches() - Enable the MMU and caches in SPL
+ *
+ * This is called from board_init_r() when SPL_ENABLE_CACHES is enabled, once
+ * DRAM is available and before any image is loaded. Caches which are already
+ * on, e.g. because the board set them up itself, are left alone.
+ *
+ * Return: the caches which were turned on, as SPL_CACHE_... flags
+ */
+uint spl_enable_caches(void);
+
+/**
+ * spl_disable_caches() - Flush and disable caches turned on in SPL
+ *
+ * This is called from board_init_r() when SPL_ENABLE_CACHES is enabled, just
+ * before SPL hands over to the next image. The data cache is written back
+ * before it is disabled.
+ *
+ * @caches: Caches to disable, as returned by spl_enable_caches()
+ */
+void spl_disable_caches(uint caches);
 int spl_board_ubi_load_image(u32 boot_device);
 int spl_board_boot_device(u32 boot_device);
 
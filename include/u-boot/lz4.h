@@ -13,9 +13,14 @@
  * @srcn: Length of source data
  * @dst: Destination for uncompressed data
  * @dstn: Returns length of uncompressed data
+ *
+ * Both independent and linked blocks are supported. Block and content
+ * checksums are skipped rather than verified, since images are normally
+ * covered by a hash of their own.
+ *
  * Return: 0 if OK, -EPROTONOSUPPORT if the magic number or version number are
- *	not recognised or independent blocks are used, -EINVAL if the reserved
- *	fields are non-zero, or input is overrun, -EENOBUFS if the destination
+ *	not recognised, -EINVAL if the reserved fields are non-zero, or
+ *	input is overrun, -EENOBUFS if the destination
  *	buffer is overrun, -EEPROTO if the compressed data causes an error in
  *	the decompression algorithm
  */
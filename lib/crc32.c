@@ -186,6 +186,11 @@ uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 {
 #ifdef CONFIG_ARM64_CRC32
     crc = cpu_to_le32(crc);
+    /* Align it, then do eight bytes at a time */
+    for (; len && ((uintptr_t)buf & 7); len--)
+        crc = __builtin_aarch64_crc32b(crc, *buf++);
+    for (; len >= 8; len -= 8, buf += 8)
+        crc = __builtin_aarch64_crc32x(crc, *(const uint64_t *)buf);
     while (len--)
         crc = __builtin_aarch64_crc32b(crc, *buf++);
     return le32_to_cpu(crc);
@@ -106,6 +106,52 @@ write_fail:
 	return -1;
 }
 
+/* Write @blkcnt blocks filled with @fill_val at *@blkp, moving it on */
+static int write_sparse_chunk_fill(struct sparse_storage *info,
+				   lbaint_t *blkp, lbaint_t blkcnt,
+				   uint32_t fill_val, char *response)
+{
+	int fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	lbaint_t blk = *blkp;
+	uint32_t *fill_buf;
+	lbaint_t blks;
+	int i, j;
+
+	fill_buf = (uint32_t *)
+		   memalign(ARCH_DMA_MINALIGN,
+			    ROUNDUP(info->blksz * fill_buf_num_blks,
+				    ARCH_DMA_MINALIGN));
+	if (!fill_buf) {
+		info->mssg("Malloc failed for: CHUNK_TYPE_FILL", response);
+		return -1;
+	}
+
+	for (i = 0; i < (info->blksz * fill_buf_num_blks / sizeof(fill_val));
+	     i++)
+		fill_buf[i] = fill_val;
+
+	for (i = 0; i < blkcnt;) {
+		j = blkcnt - i;
+		if (j > fill_buf_num_blks)
+			j = fill_buf_num_blks;
+		blks = info->write(info, blk, j, fill_buf);
+		/* blks might be > j (eg. NAND bad-blocks) */
+		if (blks < j) {
+			printf("%s: %s " LBAFU " [%d]\n", __func__,
+			       "Write failed, block #", blk, j);
+			info->mssg("flash write failure", response);
+			free(fill_buf);
+			return -1;
+		}
+		blk += blks;
+		i += j;
+	}
+	free(fill_buf);
+	*blkp = blk;
+
+	return 0;
+}
+
 int write_sparse_image(struct sparse_storage *info,
 		       const char *part_name, void *data, char *response)
 {
@@ -116,16 +162,10 @@ int write_sparse_image(struct sparse_storage *info,
 	unsigned int chunk;
 	unsigned int offset;
 	uint64_t chunk_data_sz;
-	uint32_t *fill_buf = NULL;
 	uint32_t fill_val;
 	sparse_header_t *sparse_header;
 	chunk_header_t *chunk_header;
 	uint32_t total_blocks = 0;
-	int fill_buf_num_blks;
-	int i;
-	int j;
-
-	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
 
 	/* Read and skip over sparse image header */
 	sparse_header = (sparse_header_t *)data;
@@ -211,7 +251,7 @@ int write_sparse_image(struct sparse_storage *info,
 
 			blks = write_sparse_chunk_raw(info, blk, blkcnt,
 						      data, response);
-			if (blks < 0)
+			if (IS_ERR_VALUE(blks))
 				return -1;
 
 			blk += blks;
@@ -227,26 +267,9 @@ int write_sparse_image(struct sparse_storage *info,
 				return -1;
 			}
 
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
-					   response);
-				return -1;
-			}
-
 			fill_val = *(uint32_t *)data;
 			data = (char *)data + sizeof(uint32_t);
 
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
 			if (blk + blkcnt > info->start + info->size) {
 				printf(
 				    "%s: Request would exceed partition size!\n",
@@ -256,29 +279,13 @@ int write_sparse_image(struct sparse_storage *info,
 				return -1;
 			}
 
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					info->mssg("flash write failure",
-						   response);
-					free(fill_buf);
-					return -1;
-				}
-				blk += blks;
-				i += j;
-			}
+			if (write_sparse_chunk_fill(info, &blk, blkcnt,
+						    fill_val, response))
+				return -1;
+
 			bytes_written += ((u64)blkcnt) * info->blksz;
 			total_blocks += DIV_ROUND_UP_ULL(chunk_data_sz,
 							 sparse_header->blk_sz);
-			free(fill_buf);
 			break;
 
 		case CHUNK_TYPE_DONT_CARE:
@@ -316,3 +323,199 @@ int write_sparse_image(struct sparse_storage *info,
 
 	return 0;
 }
+
+void sparse_stream_init(struct sparse_stream *ss, struct sparse_storage *info,
+			const char *part_name, char *response)
+{
+	memset(ss, '\0', sizeof(*ss));
+	ss->info = info;
+	ss->part_name = part_name;
+	ss->response = response;
+	ss->blk = info->start;
+	if (!info->mssg)
+		info->mssg = default_log;
+}
+
+/* Read the file header, returning the bytes used, 0 if more are needed */
+static int sparse_stream_file_hdr(struct sparse_stream *ss, const void *data,
+				  size_t len)
+{
+	const sparse_header_t *hdr = data;
+	struct sparse_storage *info = ss->info;
+	unsigned int offset;
+
+	if (len < sizeof(sparse_header_t) || len < hdr->file_hdr_sz)
+		return 0;
+	if (!is_sparse_image((void *)hdr) ||
+	    hdr->file_hdr_sz < sizeof(sparse_header_t) ||
+	    hdr->chunk_hdr_sz < sizeof(chunk_header_t)) {
+		info->mssg("bad sparse image header", ss->response);
+		return -1;
+	}
+
+	div_u64_rem(hdr->blk_sz, info->blksz, &offset);
+	if (offset) {
+		printf("%s: Sparse image block size issue [%u]\n",
+		       __func__, hdr->blk_sz);
+		info->mssg("sparse image block size issue", ss->response);
+		return -1;
+	}
+	ss->hdr = *hdr;
+	ss->have_hdr = true;
+	puts("Flashing Sparse Image\n");
+
+	return hdr->file_hdr_sz;
+}
+
+/* Read a chunk header, returning the bytes used, 0 if more are needed */
+static int sparse_stream_chunk_hdr(struct sparse_stream *ss, const void *data,
+				   size_t len)
+{
+	const chunk_header_t *chunk = data;
+	struct sparse_storage *info = ss->info;
+	uint64_t chunk_data_sz;
+	lbaint_t blkcnt;
+
+	if (len < ss->hdr.chunk_hdr_sz)
+		return 0;
+
+	chunk_data_sz = (u64)ss->hdr.blk_sz * chunk->chunk_sz;
+	blkcnt = DIV_ROUND_UP_ULL(chunk_data_sz, info->blksz);
+	ss->chunk_hdr = *chunk;
+	ss->left = 0;
+	ss->chunk++;
+
+	switch (chunk->chunk_type) {
+	case CHUNK_TYPE_RAW:
+	case CHUNK_TYPE_FILL:
+		if (chunk->total_sz != ss->hdr.chunk_hdr_sz +
+		    (chunk->chunk_type == CHUNK_TYPE_RAW ? chunk_data_sz :
+		     sizeof(uint32_t))) {
+			info->mssg("Bogus chunk size", ss->response);
+			return -1;
+		}
+		if (ss->blk + blkcnt > info->start + info->size) {
+			printf("%s: Request would exceed partition size!\n",
+			       __func__);
+			info->mssg("Request would exceed partition size!",
+				   ss->response);
+			return -1;
+		}
+		ss->left = chunk->total_sz - ss->hdr.chunk_hdr_sz;
+		break;
+	case CHUNK_TYPE_DONT_CARE:
+		ss->blk += info->reserve(info, ss->blk, blkcnt);
+		ss->total_blocks += chunk->chunk_sz;
+		break;
+	case CHUNK_TYPE_CRC32:
+		if (chunk->total_sz < ss->hdr.chunk_hdr_sz) {
+			info->mssg("Bogus chunk size for chunk type CRC32",
+				   ss->response);
+			return -1;
+		}
+		ss->left = chunk->total_sz - ss->hdr.chunk_hdr_sz;
+		ss->total_blocks += chunk->chunk_sz;
+		break;
+	default:
+		printf("%s: Unknown chunk type: %x\n", __func__,
+		       chunk->chunk_type);
+		info->mssg("Unknown chunk type", ss->response);
+		return -1;
+	}
+
+	return ss->hdr.chunk_hdr_sz;
+}
+
+/* Use the data of the current chunk, returning the bytes used */
+static int sparse_stream_chunk_data(struct sparse_stream *ss, void *data,
+				    size_t len)
+{
+	struct sparse_storage *info = ss->info;
+	lbaint_t blks, blkcnt;
+	size_t n;
+
+	switch (ss->chunk_hdr.chunk_type) {
+	case CHUNK_TYPE_RAW:
+		/* Write whole blocks; a part block waits for the rest */
+		n = min_t(u64, ss->left, len);
+		blkcnt = n / info->blksz;
+		if (!blkcnt)
+			return 0;
+		n = blkcnt * info->blksz;
+		blks = write_sparse_chunk_raw(info, ss->blk, blkcnt, data,
+					      ss->response);
+		if (IS_ERR_VALUE(blks))
+			return -1;
+		ss->blk += blks;
+		ss->bytes_written += n;
+		ss->left -= n;
+		if (!ss->left)
+			ss->total_blocks += ss->chunk_hdr.chunk_sz;
+		return n;
+	case CHUNK_TYPE_FILL:
+		if (len < sizeof(uint32_t))
+			return 0;
+		blkcnt = DIV_ROUND_UP_ULL((u64)ss->hdr.blk_sz *
+					  ss->chunk_hdr.chunk_sz, info->blksz);
+		if (write_sparse_chunk_fill(info, &ss->blk, blkcnt,
+					    *(uint32_t *)data, ss->response))
+			return -1;
+		ss->bytes_written += (u64)blkcnt * info->blksz;
+		ss->total_blocks += ss->chunk_hdr.chunk_sz;
+		ss->left = 0;
+		return sizeof(uint32_t);
+	default:
+		/* Skip the CRC, which is not checked */
+		n = min_t(u64, ss->left, len);
+		ss->left -= n;
+		return n;
+	}
+}
+
+int sparse_stream_write(struct sparse_stream *ss, void *data, size_t len)
+{
+	size_t used = 0;
+	int ret;
+
+	while (used < len) {
+		if (!ss->have_hdr)
+			ret = sparse_stream_file_hdr(ss, data + used,
+						     len - used);
+		else if (ss->left)
+			ret = sparse_stream_chunk_data(ss, data + used,
+						       len - used);
+		else if (ss->chunk < ss->hdr.total_chunks)
+			ret = sparse_stream_chunk_hdr(ss, data + used,
+						      len - used);
+		else
+			/* Anything after the last chunk is ignored */
+			ret = len - used;
+		if (ret < 0)
+			return -1;
+		if (!ret)
+			break;
+		used += ret;
+	}
+
+	return used;
+}
+
+int sparse_stream_finish(struct sparse_stream *ss)
+{
+	if (!ss->have_hdr || ss->left || ss->chunk < ss->hdr.total_chunks) {
+		ss->info->mssg("sparse image is incomplete", ss->response);
+		return -1;
+	}
+
+	debug("Wrote %d blocks, expected to write %d blocks\n",
+	      ss->total_blocks, ss->hdr.total_blks);
+	printf("........ wrote %llu bytes to '%s'\n", ss->bytes_written,
+	       ss->part_name);
+
+	if (ss->total_blocks != ss->hdr.total_blks) {
+		ss->info->mssg("sparse image write failure", ss->response);
+		return -1;
+	}
+
+	return 0;
+}
@@ -96,6 +96,10 @@ FORCE_INLINE int LZ4_decompress_generic(
     const int safeDecode = (endOnInput==endOnInputSize);
     const int checkOffset = ((safeDecode) && (dictSize < (int)(64 KB)));
 
+    /* Limits for the short sequence fast path, see below */
+    const BYTE* const shortiend = iend - (endOnInput ? 14 : 8) /*maxLL*/ - 2 /*offset*/;
+    const BYTE* const shortoend = oend - (endOnInput ? 14 : 8) /*maxLL*/ - 18 /*maxML*/;
+
 
     /* Special cases */
     if ((partialDecoding) && (oexit> oend-MFLIMIT)) oexit = oend-MFLIMIT;                         /* targetOutputSize too high => decode everything */
@@ -112,7 +116,40 @@ FORCE_INLINE int LZ4_decompress_generic(
 
         /* get literal length */
         token = *ip++;
-        if ((length=(token>>ML_BITS)) == RUN_MASK)
+        length = token>>ML_BITS;
+
+        /*
+         * Fast path for the most common case, a short literal run followed by
+         * a short match: if there is enough room in the input and output,
+         * copy a fixed 16 bytes of literals (8 without input checks) and, if
+         * the match is at least 8 bytes back, a fixed 18 bytes of match. Both
+         * are checked against the limits at once, on entry.
+         */
+        if ((endOnInput ? length != RUN_MASK : length <= 8)
+            && likely((endOnInput ? ip < shortiend : 1) & (op <= shortoend)))
+        {
+            LZ4_copy8(op, ip);
+            if (endOnInput) LZ4_copy8(op+8, ip+8);
+            op += length; ip += length;
+
+            length = token & ML_MASK;
+            match = op - LZ4_readLE16(ip); ip += 2;
+            if ((length != ML_MASK) && (op-match >= 8)
+                && ((dict==withPrefix64k) || (match >= lowPrefix)))
+            {
+                LZ4_copy8(op, match);
+                LZ4_copy8(op+8, match+8);
+                op[16] = match[16];
+                op[17] = match[17];
+                op += length + MINMATCH;
+                continue;
+            }
+
+            /* Take the usual path, with the offset already decoded */
+            goto _copy_match;
+        }
+
+        if (length == RUN_MASK)
         {
             unsigned s;
             do
@@ -150,6 +187,7 @@ FORCE_INLINE int LZ4_decompress_generic(
 
         /* get offset */
         match = cpy - LZ4_readLE16(ip); ip+=2;
+_copy_match:
         if ((checkOffset) && (unlikely(match < lowLimit))) goto _output_error;   /* Error : offset outside destination buffer */
 
         /* get matchlength */
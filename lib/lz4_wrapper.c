@@ -32,7 +32,10 @@ typedef uint64_t U64;
 
 #define FORCE_INLINE static inline __attribute__((always_inline))
 
-/* lz4.c is unaltered (except removing unrelated code) from github.com/Cyan4973/lz4. */
+/*
+ * lz4.c is from github.com/Cyan4973/lz4, with unrelated code removed and the
+ * short sequence fast path of later versions added.
+ */
 #include "lz4.c"	/* #include for inlining, do not link! */
 
 #define LZ4F_BLOCKUNCOMPRESSED_FLAG 0x80000000U
@@ -43,12 +46,13 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 	const void *in = src;
 	void *out = dst;
 	int has_block_checksum;
+	int independent_blocks;
 	int ret;
 	*dstn = 0;
 
 	{ /* With in-place decompression the header may become invalid later. */
 		u32 magic;
-		u8 flags, version, independent_blocks, has_content_size;
+		u8 flags, version, has_content_size;
 		u8 block_desc;
 
 		if (srcn < sizeof(u32) + 3*sizeof(u8))
@@ -71,8 +75,6 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 			return -EPROTONOSUPPORT;	/* unknown format */
 		if ((flags & 0x03) || (block_desc & 0x8f))
 			return -EINVAL;	/* reserved bits must be zero */
-		if (!independent_blocks)
-			return -EPROTONOSUPPORT; /* we can't support this yet */
 
 		if (has_content_size) {
 			if (srcn < sizeof(u32) + 3*sizeof(u8) + sizeof(u64))
@@ -102,17 +104,23 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 
 		if (block_header & LZ4F_BLOCKUNCOMPRESSED_FLAG) {
 			size_t size = min((ptrdiff_t)block_size, end - out);
-			memcpy(out, in, size);
+			memmove(out, in, size);
 			out += size;
 			if (size < block_size) {
 				ret = -ENOBUFS;	/* output overrun */
 				break;
 			}
 		} else {
+			/*
+			 * Linked blocks may refer back into earlier blocks,
+			 * which are all in the output buffer already.
+			 */
+			const void *low = independent_blocks ? out : dst;
+
 			/* constant folding essential, do not touch params! */
 			ret = LZ4_decompress_generic(in, out, block_size,
 					end - out, endOnInputSize,
-					full, 0, noDict, out, NULL, 0);
+					full, 0, noDict, low, NULL, 0);
 			if (ret < 0) {
 				ret = -EPROTO;	/* decompression error */
 				break;
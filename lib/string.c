@@ -20,8 +20,20 @@
 #include <linux/types.h>
 #include <linux/string.h>
 #include <linux/ctype.h>
+#include <linux/kernel.h>
 #include <malloc.h>
 
+/*
+ * Several functions below work a word (32 or 64 bits) at a time. An aligned
+ * word never crosses a page boundary, so reading the whole of the word which
+ * holds the last byte of a string or area is safe.
+ */
+#define WORD_SIZE	sizeof(unsigned long)
+#define WORD_MASK	(WORD_SIZE - 1)
+
+/* Non-zero if any byte in the word @x is zero */
+#define word_has_zero(x) \
+	(((x) - REPEAT_BYTE(0x01)) & ~(x) & REPEAT_BYTE(0x80))
 
 /**
  * strncasecmp - Case insensitive, length-limited string comparison
@@ -287,9 +299,17 @@ char * strrchr(const char * s, int c)
  */
 size_t strlen(const char * s)
 {
+	const unsigned long *sl;
 	const char *sc;
 
-	for (sc = s; *sc != '\0'; ++sc)
+	for (sc = s; (ulong)sc & WORD_MASK; ++sc)
+		if (*sc == '\0')
+			return sc - s;
+
+	/* find the word holding the terminator, then the byte within it */
+	for (sl = (const unsigned long *)sc; !word_has_zero(*sl); ++sl)
+		/* nothing */;
+	for (sc = (const char *)sl; *sc != '\0'; ++sc)
 		/* nothing */;
 	return sc - s;
 }
@@ -520,19 +540,15 @@ __used void * memset(void * s,int c,size_t count)
 	char *s8;
 
 #if !CONFIG_IS_ENABLED(TINY_MEMSET)
-	unsigned long cl = 0;
-	int i;
-
-	/* do it one word at a time (32 bits or 64 bits) while possible */
-	if ( ((ulong)s & (sizeof(*sl) - 1)) == 0) {
-		for (i = 0; i < sizeof(*sl); i++) {
-			cl <<= 8;
-			cl |= c & 0xff;
-		}
-		while (count >= sizeof(*sl)) {
-			*sl++ = cl;
-			count -= sizeof(*sl);
-		}
+	unsigned long cl = REPEAT_BYTE(c & 0xff);
+
+	/* fill up to a word boundary, then one word (32 or 64 bits) at a time */
+	for (s8 = s; count && ((ulong)s8 & (sizeof(*sl) - 1)); count--)
+		*s8++ = c;
+	sl = (unsigned long *)s8;
+	while (count >= sizeof(*sl)) {
+		*sl++ = cl;
+		count -= sizeof(*sl);
 	}
 #endif	/* fill 8 bits at a time */
 	s8 = (char *)sl;
@@ -561,8 +577,17 @@ __used void * memcpy(void *dest, const void *src, size_t count)
 	if (src == dest)
 		return dest;
 
-	/* while all data is aligned (common case), copy a word at a time */
-	if ( (((ulong)dest | (ulong)src) & (sizeof(*dl) - 1)) == 0) {
+	/*
+	 * If both areas have the same alignment (common case), copy up to a
+	 * word boundary and then a word at a time
+	 */
+	if ((((ulong)dest ^ (ulong)src) & (sizeof(*dl) - 1)) == 0) {
+		d8 = dest;
+		s8 = (char *)src;
+		for (; count && ((ulong)d8 & (sizeof(*dl) - 1)); count--)
+			*d8++ = *s8++;
+		dl = (unsigned long *)d8;
+		sl = (unsigned long *)s8;
 		while (count >= sizeof(*dl)) {
 			*dl++ = *sl++;
 			count -= sizeof(*dl);
@@ -608,6 +633,16 @@ __used void * memmove(void * dest,const void *src,size_t count)
 	} else {
 		tmp = (char *) dest + count;
 		s = (char *) src + count;
+		/* copy backwards a word at a time if the alignment allows */
+		if ((((ulong)tmp ^ (ulong)s) & WORD_MASK) == 0) {
+			for (; count && ((ulong)tmp & WORD_MASK); count--)
+				*--tmp = *--s;
+			for (; count >= WORD_SIZE; count -= WORD_SIZE) {
+				tmp -= WORD_SIZE;
+				s -= WORD_SIZE;
+				*(unsigned long *)tmp = *(unsigned long *)s;
+			}
+		}
 		while (count--)
 			*--tmp = *--s;
 		}
@@ -625,10 +660,25 @@ __used void * memmove(void * dest,const void *src,size_t count)
  */
 __used int memcmp(const void * cs,const void * ct,size_t count)
 {
-	const unsigned char *su1, *su2;
+	const unsigned char *su1 = cs, *su2 = ct;
 	int res = 0;
 
-	for( su1 = cs, su2 = ct; 0 < count; ++su1, ++su2, count--)
+	/* with the same alignment, skip over equal words to the first change */
+	if ((((ulong)su1 ^ (ulong)su2) & WORD_MASK) == 0) {
+		const unsigned long *sl1, *sl2;
+
+		for (; 0 < count && ((ulong)su1 & WORD_MASK);
+		     ++su1, ++su2, count--)
+			if ((res = *su1 - *su2) != 0)
+				return res;
+		sl1 = (const unsigned long *)su1;
+		sl2 = (const unsigned long *)su2;
+		for (; count >= WORD_SIZE && *sl1 == *sl2; sl1++, sl2++)
+			count -= WORD_SIZE;
+		su1 = (const unsigned char *)sl1;
+		su2 = (const unsigned char *)sl2;
+	}
+	for (; 0 < count; ++su1, ++su2, count--)
 		if ((res = *su1 - *su2) != 0)
 			break;
 	return res;
@@ -709,11 +759,22 @@ char * strstr(const char * s1,const char * s2)
 void *memchr(const void *s, int c, size_t n)
 {
 	const unsigned char *p = s;
-	while (n-- != 0) {
-		if ((unsigned char)c == *p++) {
-			return (void *)(p-1);
-		}
-	}
+	const unsigned long *pl;
+	unsigned long cl;
+
+	for (; n && ((ulong)p & WORD_MASK); n--, p++)
+		if ((unsigned char)c == *p)
+			return (void *)p;
+
+	/* skip over words which do not contain @c */
+	cl = REPEAT_BYTE((unsigned char)c);
+	for (pl = (const unsigned long *)p;
+	     n >= WORD_SIZE && !word_has_zero(*pl ^ cl); pl++)
+		n -= WORD_SIZE;
+
+	for (p = (const unsigned char *)pl; n; n--, p++)
+		if ((unsigned char)c == *p)
+			return (void *)p;
 	return NULL;
 }
 
@@ -8,4 +8,22 @@
    subject to change. Applications should only use zlib.h.
  */
 
+/*
+ * On 64-bit little-endian machines which handle unaligned accesses well,
+ * inflate_fast() refills its bit buffer with a single eight-byte load and
+ * copies matches eight bytes at a time. Both of these may read or write a
+ * little beyond what is actually used, so more input and output space must
+ * be available before it can be called.
+ */
+#if BITS_PER_LONG == 64 && defined(__LITTLE_ENDIAN) && \
+	(defined(CONFIG_ARM64) || defined(CONFIG_X86_64) || \
+	 defined(CONFIG_SANDBOX))
+#define INFLATE_FAST_WIDE
+#define INFLATE_FAST_MIN_INPUT	8
+#define INFLATE_FAST_MIN_OUTPUT	(258 + 8)
+#else
+#define INFLATE_FAST_MIN_INPUT	6
+#define INFLATE_FAST_MIN_OUTPUT	258
+#endif
+
 void inflate_fast OF((z_streamp strm, unsigned start));
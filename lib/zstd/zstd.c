@@ -9,56 +9,121 @@
 #include <abuf.h>
 #include <log.h>
 #include <malloc.h>
+#include <asm/global_data.h>
 #include <linux/zstd.h>
 
-int zstd_decompress(struct abuf *in, struct abuf *out)
+DECLARE_GLOBAL_DATA_PTR;
+
+/*
+ * The decompression context does not depend on the input, so it is set up
+ * once and reused by later calls instead of being allocated every time.
+ * BSS cannot be written before relocation, so until then a context is
+ * allocated for each call and freed afterwards.
+ */
+static ZSTD_DCtx *zstd_dctx;
+
+/**
+ * zstd_get_dctx() - Get a decompression context
+ *
+ * @dctxp: Returns the context
+ * @workspacep: Returns the memory which the caller must free when done with
+ *	the context, or NULL if the context is kept for later calls
+ * Return: 0 if OK, -ve on error
+ */
+static int zstd_get_dctx(ZSTD_DCtx **dctxp, void **workspacep)
 {
-	ZSTD_DStream *dstream;
-	ZSTD_inBuffer in_buf;
-	ZSTD_outBuffer out_buf;
+	bool keep = gd->flags & GD_FLG_RELOC;
+	ZSTD_DCtx *dctx;
 	void *workspace;
 	size_t wsize;
-	int ret;
 
-	wsize = ZSTD_DStreamWorkspaceBound(abuf_size(in));
+	*workspacep = NULL;
+	if (keep && zstd_dctx) {
+		*dctxp = zstd_dctx;
+		return 0;
+	}
+
+	wsize = ZSTD_DCtxWorkspaceBound();
 	workspace = malloc(wsize);
 	if (!workspace) {
-		debug("%s: cannot allocate workspace of size %zu\n", __func__,
-			wsize);
+		debug("%s: cannot allocate workspace of size %zu\n",
+		      __func__, wsize);
 		return -ENOMEM;
 	}
 
-	dstream = ZSTD_initDStream(abuf_size(in), workspace, wsize);
-	if (!dstream) {
-		log_err("%s: ZSTD_initDStream failed\n", __func__);
-		ret = -EPERM;
-		goto do_free;
+	dctx = ZSTD_initDCtx(workspace, wsize);
+	if (!dctx) {
+		log_err("%s: ZSTD_initDCtx failed\n", __func__);
+		free(workspace);
+		return -EPERM;
 	}
+	if (keep)
+		zstd_dctx = dctx;
+	else
+		*workspacep = workspace;
+	*dctxp = dctx;
 
-	in_buf.src = abuf_data(in);
-	in_buf.pos = 0;
-	in_buf.size = abuf_size(in);
+	return 0;
+}
 
-	out_buf.dst = abuf_data(out);
-	out_buf.pos = 0;
-	out_buf.size = abuf_size(out);
+static int zstd_decompress_frames(ZSTD_DCtx *dctx, struct abuf *in,
+				  struct abuf *out)
+{
+	const u8 *src = abuf_data(in);
+	size_t src_len = abuf_size(in);
+	u8 *dst = abuf_data(out);
+	size_t dst_len = abuf_size(out);
+	size_t pos = 0;
+	int ret;
 
-	while (1) {
-		size_t res;
+	if (!ZSTD_isFrame(src, src_len)) {
+		log_err("%s: not a zstd frame\n", __func__);
+		return -EINVAL;
+	}
 
-		res = ZSTD_decompressStream(dstream, &out_buf, &in_buf);
+	/*
+	 * Decode one frame at a time, straight into the output buffer. Data
+	 * produced with several (e.g. seekable) frames is decoded in full,
+	 * and anything after the last frame is taken to be padding.
+	 */
+	while (ZSTD_isFrame(src, src_len)) {
+		size_t frame_len, res;
+
+		frame_len = ZSTD_findFrameCompressedSize(src, src_len);
+		if (ZSTD_isError(frame_len) || frame_len > src_len) {
+			log_err("%s: bad frame at offset %zu\n", __func__,
+				src - (const u8 *)abuf_data(in));
+			return -EINVAL;
+		}
+
+		res = ZSTD_decompressDCtx(dctx, dst + pos, dst_len - pos, src,
+					  frame_len);
 		if (ZSTD_isError(res)) {
 			ret = ZSTD_getErrorCode(res);
-			log_err("ZSTD_decompressStream error %d\n", ret);
-			goto do_free;
+			log_err("ZSTD_decompressDCtx error %d\n", ret);
+			return -EINVAL;
 		}
 
-		if (in_buf.pos >= abuf_size(in) || !res)
-			break;
+		pos += res;
+		src += frame_len;
+		src_len -= frame_len;
 	}
 
-	ret = out_buf.pos;
-do_free:
+	return pos;
+}
+
+int zstd_decompress(struct abuf *in, struct abuf *out)
+{
+	ZSTD_DCtx *dctx;
+	void *workspace;
+	int ret;
+
+	ret = zstd_get_dctx(&dctx, &workspace);
+	if (ret)
+		return ret;
+
+	ret = zstd_decompress_frames(dctx, in, out);
 	free(workspace);
+
 	return ret;
 }
@@ -41,6 +41,44 @@ int		arp_wait_try;
 uchar	       *arp_tx_packet; /* THE ARP transmit packet */
 static uchar	arp_tx_packet_buf[PKTSIZE_ALIGN + PKTALIGN];
 
+#ifdef CONFIG_NET_ARP_CACHE
+/* Number of slots looked at for an address, from the one it hashes to */
+#define ARP_CACHE_WAYS		4
+
+/**
+ * struct arp_entry - a resolved address
+ *
+ * @ip: IP address, 0 if the entry is free
+ * @ethaddr: MAC address
+ * @dev_index: Ethernet device which @ip was seen on
+ * @time: when @ethaddr was last confirmed, from get_timer()
+ */
+struct arp_entry {
+	struct in_addr ip;
+	uchar ethaddr[ARP_HLEN];
+	int dev_index;
+	ulong time;
+};
+
+/**
+ * struct arp_pending - a packet waiting for an ARP reply
+ *
+ * @dest: IP address the packet is for
+ * @ethaddr: where the sender wants the MAC address saved
+ * @len: length of @pkt, 0 if the slot is free
+ * @pkt: the packet, starting with its Ethernet header
+ */
+struct arp_pending {
+	struct in_addr dest;
+	uchar *ethaddr;
+	int len;
+	uchar pkt[PKTSIZE_ALIGN] __aligned(PKTALIGN);
+};
+
+static struct arp_entry arp_cache[CONFIG_NET_ARP_CACHE_SIZE];
+static struct arp_pending arp_queue[CONFIG_NET_ARP_QUEUE_LEN];
+#endif
+
 void arp_init(void)
 {
 	/* XXX problem with bss workaround */
@@ -82,22 +120,203 @@ void arp_raw_request(struct in_addr source_ip, const uchar *target_ethaddr,
 	net_send_packet(arp_tx_packet, eth_hdr_size + ARP_HDR_SIZE);
 }
 
+static bool arp_is_local(struct in_addr ip)
+{
+	return (ip.s_addr & net_netmask.s_addr) ==
+		(net_ip.s_addr & net_netmask.s_addr);
+}
+
+/* Get the address to ask for to reach @ip: its own or the gateway's */
+static struct in_addr arp_next_hop(struct in_addr ip)
+{
+	if (!arp_is_local(ip) && net_gateway.s_addr)
+		return net_gateway;
+
+	return ip;
+}
+
 void arp_request(void)
 {
-	if ((net_arp_wait_packet_ip.s_addr & net_netmask.s_addr) !=
-	    (net_ip.s_addr & net_netmask.s_addr)) {
-		if (net_gateway.s_addr == 0) {
-			puts("## Warning: gatewayip needed but not set\n");
-			net_arp_wait_reply_ip = net_arp_wait_packet_ip;
-		} else {
-			net_arp_wait_reply_ip = net_gateway;
+	if (!arp_is_local(net_arp_wait_packet_ip) && net_gateway.s_addr == 0)
+		puts("## Warning: gatewayip needed but not set\n");
+	net_arp_wait_reply_ip = arp_next_hop(net_arp_wait_packet_ip);
+
+	arp_raw_request(net_ip, net_null_ethaddr, net_arp_wait_reply_ip);
+}
+
+#ifdef CONFIG_NET_ARP_CACHE
+static struct arp_entry *arp_cache_find(struct in_addr ip, bool create)
+{
+	u32 addr = ntohl(ip.s_addr);
+	int dev_index = eth_get_dev_index();
+	struct arp_entry *entry, *victim = NULL;
+	uint hash, i;
+
+	hash = (addr ^ addr >> 8 ^ addr >> 16) % CONFIG_NET_ARP_CACHE_SIZE;
+	for (i = 0; i < ARP_CACHE_WAYS; i++) {
+		entry = &arp_cache[(hash + i) % CONFIG_NET_ARP_CACHE_SIZE];
+		if (entry->ip.s_addr == ip.s_addr &&
+		    entry->dev_index == dev_index)
+			return entry;
+
+		/* Replace a free entry, or else the oldest */
+		if (!victim || (victim->ip.s_addr &&
+				(!entry->ip.s_addr ||
+				 entry->time < victim->time)))
+			victim = entry;
+	}
+
+	return create ? victim : NULL;
+}
+
+bool arp_cache_lookup(struct in_addr dest, uchar *ethaddr)
+{
+	struct arp_entry *entry;
+
+	entry = arp_cache_find(arp_next_hop(dest), false);
+	if (!entry)
+		return false;
+
+	if (get_timer(entry->time) > CONFIG_NET_ARP_CACHE_TIMEOUT * 1000UL) {
+		entry->ip.s_addr = 0;
+		return false;
+	}
+	memcpy(ethaddr, entry->ethaddr, ARP_HLEN);
+
+	return true;
+}
+
+void arp_cache_learn(struct in_addr ip, const uchar *ethaddr, bool create)
+{
+	struct arp_entry *entry;
+
+	if (!ip.s_addr || ip.s_addr == 0xFFFFFFFF || !arp_is_local(ip) ||
+	    !is_valid_ethaddr(ethaddr))
+		return;
+
+	entry = arp_cache_find(ip, create);
+	if (!entry)
+		return;
+
+	entry->ip = ip;
+	memcpy(entry->ethaddr, ethaddr, ARP_HLEN);
+	entry->dev_index = eth_get_dev_index();
+	entry->time = get_timer(0);
+}
+
+void arp_cache_flush(void)
+{
+	memset(arp_cache, '\0', sizeof(arp_cache));
+}
+
+/* Start resolving the next address which packets are waiting for */
+static void arp_queue_next(void)
+{
+	int i;
+
+	if (arp_is_waiting())
+		return;
+
+	for (i = 0; i < CONFIG_NET_ARP_QUEUE_LEN; i++) {
+		if (!arp_queue[i].len)
+			continue;
+
+		/* The packet is in the queue, not in net_tx_packet */
+		net_arp_wait_packet_ip = arp_queue[i].dest;
+		arp_wait_packet_ethaddr = NULL;
+		arp_wait_tx_packet_size = 0;
+		arp_wait_try = 1;
+		arp_wait_timer_start = get_timer(0);
+		arp_request();
+		return;
+	}
+}
+
+/* Send the packets which were waiting for @ip to answer */
+static void arp_queue_resolved(struct in_addr ip, const uchar *ethaddr)
+{
+	struct arp_pending *pending;
+	int i;
+
+	for (i = 0; i < CONFIG_NET_ARP_QUEUE_LEN; i++) {
+		pending = &arp_queue[i];
+		if (!pending->len ||
+		    arp_next_hop(pending->dest).s_addr != ip.s_addr)
+			continue;
+
+		if (pending->ethaddr)
+			memcpy(pending->ethaddr, ethaddr, ARP_HLEN);
+		memcpy(((struct ethernet_hdr *)pending->pkt)->et_dest, ethaddr,
+		       ARP_HLEN);
+		net_send_packet(pending->pkt, pending->len);
+		pending->len = 0;
+	}
+
+	arp_queue_next();
+}
+
+/* Check whether two UDP or TCP packets go between the same pair of ports */
+static bool arp_same_ports(const uchar *pkt1, const uchar *pkt2)
+{
+	int eth_hdr_size = net_eth_hdr_size();
+	const struct ip_udp_hdr *ip1 = (void *)pkt1 + eth_hdr_size;
+	const struct ip_udp_hdr *ip2 = (void *)pkt2 + eth_hdr_size;
+
+	return ip1->ip_p == ip2->ip_p && ip1->udp_src == ip2->udp_src &&
+		ip1->udp_dst == ip2->udp_dst;
+}
+
+int arp_queue_packet(struct in_addr dest, uchar *ethaddr, int len)
+{
+	struct in_addr hop = arp_next_hop(dest);
+	struct arp_pending *pending, *slot = NULL;
+	bool asked = false;
+	int i;
+
+	for (i = 0; i < CONFIG_NET_ARP_QUEUE_LEN; i++) {
+		pending = &arp_queue[i];
+		if (!pending->len) {
+			if (!slot)
+				slot = pending;
+		} else if (arp_next_hop(pending->dest).s_addr == hop.s_addr) {
+			asked = true;
+
+			/* A packet sent again replaces the one still waiting */
+			if (pending->dest.s_addr == dest.s_addr &&
+			    arp_same_ports(pending->pkt, net_tx_packet)) {
+				slot = pending;
+				break;
+			}
 		}
-	} else {
-		net_arp_wait_reply_ip = net_arp_wait_packet_ip;
 	}
+	if (!slot)
+		return -ENOBUFS;
 
-	arp_raw_request(net_ip, net_null_ethaddr, net_arp_wait_reply_ip);
+	slot->dest = dest;
+	slot->ethaddr = ethaddr;
+	slot->len = len;
+	memcpy(slot->pkt, net_tx_packet, len);
+
+	/*
+	 * Only one address is retried at a time, but ask for the others
+	 * straight away in case they answer
+	 */
+	if (!arp_is_waiting())
+		arp_queue_next();
+	else if (!asked && hop.s_addr != net_arp_wait_reply_ip.s_addr)
+		arp_raw_request(net_ip, net_null_ethaddr, hop);
+
+	return 0;
+}
+
+void arp_queue_clear(void)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_NET_ARP_QUEUE_LEN; i++)
+		arp_queue[i].len = 0;
 }
+#endif
 
 int arp_timeout_check(void)
 {
@@ -159,11 +378,19 @@ void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 	if (net_ip.s_addr == 0)
 		return;
 
+	/* A gratuitous ARP updates what we know about its sender */
+	if (net_read_ip(&arp->ar_spa).s_addr ==
+	    net_read_ip(&arp->ar_tpa).s_addr)
+		arp_cache_learn(net_read_ip(&arp->ar_spa), &arp->ar_sha, false);
+
 	if (net_read_ip(&arp->ar_tpa).s_addr != net_ip.s_addr)
 		return;
 
 	switch (ntohs(arp->ar_op)) {
 	case ARPOP_REQUEST:
+		/* We are likely to talk to the host which is asking */
+		arp_cache_learn(net_read_ip(&arp->ar_spa), &arp->ar_sha, true);
+
 		/* reply with our IP address */
 		debug_cond(DEBUG_DEV_PKT, "Got ARP REQUEST, return our IP\n");
 		eth_hdr_size = net_update_ether(et, et->et_src, PROT_ARP);
@@ -192,9 +419,15 @@ void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 		return;
 
 	case ARPOP_REPLY:		/* arp reply */
+		reply_ip_addr = net_read_ip(&arp->ar_spa);
+
 		/* are we waiting for a reply? */
-		if (!arp_is_waiting())
+		if (!arp_is_waiting()) {
+			/* Only refresh what we know already */
+			arp_cache_learn(reply_ip_addr, &arp->ar_sha, false);
 			break;
+		}
+		arp_cache_learn(reply_ip_addr, &arp->ar_sha, true);
 
 		if (IS_ENABLED(CONFIG_KEEP_SERVERADDR) &&
 		    net_server_ip.s_addr == net_arp_wait_packet_ip.s_addr) {
@@ -203,8 +436,6 @@ void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 			env_set("serveraddr", buf);
 		}
 
-		reply_ip_addr = net_read_ip(&arp->ar_spa);
-
 		/* matched waiting packet's address */
 		if (reply_ip_addr.s_addr == net_arp_wait_reply_ip.s_addr) {
 			debug_cond(DEBUG_DEV_PKT,
@@ -221,15 +452,21 @@ void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 
 			/* set the mac address in the waiting packet's header
 			   and transmit it */
-			memcpy(((struct ethernet_hdr *)net_tx_packet)->et_dest,
-			       &arp->ar_sha, ARP_HLEN);
-			net_send_packet(net_tx_packet, arp_wait_tx_packet_size);
+			if (arp_wait_tx_packet_size) {
+				memcpy(((struct ethernet_hdr *)net_tx_packet)->et_dest,
+				       &arp->ar_sha, ARP_HLEN);
+				net_send_packet(net_tx_packet,
+						arp_wait_tx_packet_size);
+			}
 
 			/* no arp request pending now */
 			net_arp_wait_packet_ip.s_addr = 0;
 			arp_wait_tx_packet_size = 0;
 			arp_wait_packet_ethaddr = NULL;
 		}
+#ifdef CONFIG_NET_ARP_CACHE
+		arp_queue_resolved(reply_ip_addr, &arp->ar_sha);
+#endif
 		return;
 	default:
 		debug("Unexpected ARP opcode 0x%x\n",
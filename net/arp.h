@@ -29,4 +29,49 @@ void arp_raw_request(struct in_addr source_ip, const uchar *targetEther,
 int arp_timeout_check(void);
 void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len);
 
+#ifdef CONFIG_NET_ARP_CACHE
+/**
+ * arp_cache_learn() - note the MAC address of a host on our network
+ *
+ * @ip: IP address of the host
+ * @ethaddr: its MAC address
+ * @create: true to add an entry, false to only update an existing one
+ */
+void arp_cache_learn(struct in_addr ip, const uchar *ethaddr, bool create);
+
+/**
+ * arp_queue_packet() - keep a packet until its destination is resolved
+ *
+ * The packet is copied from net_tx_packet, which is then free for others.
+ * Once the next hop towards @dest answers, its MAC address is saved at
+ * @ethaddr and the packet is sent. A packet already waiting for @dest with
+ * the same protocol and ports is replaced, so that a protocol which sends
+ * again while resolving does not fill the queue with stale copies.
+ *
+ * @dest: IP address the packet is for
+ * @ethaddr: where to save the MAC address
+ * @len: length of the packet in net_tx_packet
+ * Return: 0 if queued, -ENOBUFS if the queue is full
+ */
+int arp_queue_packet(struct in_addr dest, uchar *ethaddr, int len);
+
+/* Drop all queued packets */
+void arp_queue_clear(void);
+#else
+static inline void arp_cache_learn(struct in_addr ip, const uchar *ethaddr,
+				   bool create)
+{
+}
+
+static inline int arp_queue_packet(struct in_addr dest, uchar *ethaddr,
+				   int len)
+{
+	return -ENOSYS;
+}
+
+static inline void arp_queue_clear(void)
+{
+}
+#endif
+
 #endif /* __ARP_H__ */
@@ -18,8 +18,8 @@
 #include <rand.h>
 #include <uuid.h>
 #include <linux/delay.h>
+#include <net/bootp.h>
 #include <net/tftp.h>
-#include "bootp.h"
 #ifdef CONFIG_LED_STATUS
 #include <status_led.h>
 #endif
@@ -46,9 +46,6 @@
 #endif
 #define TIMEOUT_MS	((3 + (TIMEOUT_COUNT * 5)) * 1000)
 
-#define PORT_BOOTPS	67		/* BOOTP server UDP port */
-#define PORT_BOOTPC	68		/* BOOTP client UDP port */
-
 #ifndef CONFIG_DHCP_MIN_EXT_LEN		/* minimal length of extension list */
 #define CONFIG_DHCP_MIN_EXT_LEN 64
 #endif
@@ -57,8 +54,31 @@
 #define CONFIG_BOOTP_ID_CACHE_SIZE 4
 #endif
 
-u32		bootp_ids[CONFIG_BOOTP_ID_CACHE_SIZE];
-unsigned int	bootp_num_ids;
+#ifdef CONFIG_BOOTP_PARALLEL
+/* Most Ethernet devices to send requests on at once */
+#define BOOTP_MAX_DEVS		8
+#else
+#define BOOTP_MAX_DEVS		1
+#endif
+
+/**
+ * struct bootp_dev - requests sent on one Ethernet device
+ *
+ * @seq: sequence number of the device, or -1 if this entry is free
+ * @ids: transaction IDs of the requests, oldest first
+ * @num_ids: number of entries in @ids
+ */
+struct bootp_dev {
+	int seq;
+	u32 ids[CONFIG_BOOTP_ID_CACHE_SIZE];
+	unsigned int num_ids;
+};
+
+static struct bootp_dev bootp_devs[BOOTP_MAX_DEVS];
+#ifdef CONFIG_BOOTP_PARALLEL
+/* Requests are sent on all Ethernet devices until one gets a reply */
+static bool bootp_parallel;
+#endif
 int		bootp_try;
 ulong		bootp_start;
 ulong		bootp_timeout;
@@ -96,30 +116,76 @@ static char *dhcpmsg2str(int type)
 #endif
 #endif
 
-static void bootp_add_id(ulong id)
+/* Find the requests sent on the current Ethernet device */
+static struct bootp_dev *bootp_find_dev(bool add)
 {
-	if (bootp_num_ids >= ARRAY_SIZE(bootp_ids)) {
-		size_t size = sizeof(bootp_ids) - sizeof(id);
+	int seq = eth_get_dev_index();
+	int i;
 
-		memmove(bootp_ids, &bootp_ids[1], size);
-		bootp_ids[bootp_num_ids - 1] = id;
+	for (i = 0; i < BOOTP_MAX_DEVS; i++)
+		if (bootp_devs[i].seq == seq)
+			return &bootp_devs[i];
+	if (!add)
+		return NULL;
+
+	for (i = 0; i < BOOTP_MAX_DEVS; i++)
+		if (bootp_devs[i].seq == -1)
+			break;
+	if (i == BOOTP_MAX_DEVS) {
+		/* Only one device is used at a time, so forget the last */
+		if (BOOTP_MAX_DEVS > 1)
+			return NULL;
+		i = 0;
+	}
+	bootp_devs[i].seq = seq;
+	bootp_devs[i].num_ids = 0;
+
+	return &bootp_devs[i];
+}
+
+static void bootp_add_id(struct bootp_dev *bd, u32 id)
+{
+	if (bd->num_ids >= ARRAY_SIZE(bd->ids)) {
+		size_t size = sizeof(bd->ids) - sizeof(bd->ids[0]);
+
+		memmove(bd->ids, &bd->ids[1], size);
+		bd->ids[bd->num_ids - 1] = id;
 	} else {
-		bootp_ids[bootp_num_ids] = id;
-		bootp_num_ids++;
+		bd->ids[bd->num_ids] = id;
+		bd->num_ids++;
 	}
 }
 
-static bool bootp_match_id(ulong id)
+static bool bootp_match_id(u32 id)
 {
+	struct bootp_dev *bd = bootp_find_dev(false);
 	unsigned int i;
 
-	for (i = 0; i < bootp_num_ids; i++)
-		if (bootp_ids[i] == id)
+	if (!bd)
+		return false;
+
+	for (i = 0; i < bd->num_ids; i++)
+		if (bd->ids[i] == id)
 			return true;
 
 	return false;
 }
 
+/*
+ * Stay on the device which got a reply, if requests went out on all of them
+ */
+static void bootp_choose_dev(void)
+{
+#ifdef CONFIG_BOOTP_PARALLEL
+	if (!bootp_parallel)
+		return;
+
+	bootp_parallel = false;
+	eth_halt_others();
+	printf("Using %s device\n", eth_get_name());
+#endif
+}
+
 static int check_reply_packet(uchar *pkt, unsigned dest, unsigned src,
 			      unsigned len)
 {
@@ -382,6 +448,7 @@ static void bootp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	status_led_set(CONFIG_LED_STATUS_BOOT, CONFIG_LED_STATUS_OFF);
 #endif
 
+	bootp_choose_dev();
 	store_net_params(bp);		/* Store net parameters from reply */
 
 	/* Retrieve extended information (we must parse the vendor area) */
@@ -714,52 +781,49 @@ static int bootp_extended(u8 *e)
 
 void bootp_reset(void)
 {
-	bootp_num_ids = 0;
+	int i;
+
+	for (i = 0; i < BOOTP_MAX_DEVS; i++)
+		bootp_devs[i].seq = -1;
+#ifdef CONFIG_BOOTP_PARALLEL
+	bootp_parallel = false;
+#endif
 	bootp_try = 0;
 	bootp_start = get_timer(0);
 	bootp_timeout = 250;
 }
 
-void bootp_request(void)
+#ifdef CONFIG_BOOTP_PARALLEL
+static bool bootp_start_all(void)
+{
+	char *ethrotate = env_get("ethrotate");
+
+	/* Stick to the current device if asked not to rotate */
+	if (ethrotate && !strcmp(ethrotate, "no"))
+		return false;
+
+	return eth_start_all() > 1;
+}
+#endif
+
+/* Send a request on the current Ethernet device */
+static void bootp_send_request(void)
 {
 	uchar *pkt, *iphdr;
 	struct bootp_hdr *bp;
+	struct bootp_dev *bd;
 	int extlen, pktlen, iplen;
 	int eth_hdr_size;
-#ifdef CONFIG_BOOTP_RANDOM_DELAY
-	ulong rand_ms;
-#endif
 	u32 bootp_id;
 	struct in_addr zero_ip;
 	struct in_addr bcast_ip;
-	char *ep;  /* Environment pointer */
-
-	bootstage_mark_name(BOOTSTAGE_ID_BOOTP_START, "bootp_start");
-#if defined(CONFIG_CMD_DHCP)
-	dhcp_state = INIT;
-#endif
-
-	ep = env_get("bootpretryperiod");
-	if (ep != NULL)
-		time_taken_max = dectoul(ep, NULL);
-	else
-		time_taken_max = TIMEOUT_MS;
-
-#ifdef CONFIG_BOOTP_RANDOM_DELAY		/* Random BOOTP delay */
-	if (bootp_try == 0)
-		srand_mac();
-
-	if (bootp_try <= 2)	/* Start with max 1024 * 1ms */
-		rand_ms = rand() >> (22 - bootp_try);
-	else		/* After 3rd BOOTP request max 8192 * 1ms */
-		rand_ms = rand() >> 19;
-
-	printf("Random delay: %ld ms...\n", rand_ms);
-	mdelay(rand_ms);
 
-#endif	/* CONFIG_BOOTP_RANDOM_DELAY */
+	bd = bootp_find_dev(true);
+	if (!bd) {
+		debug("Not sending BOOTP on %s\n", eth_get_name());
+		return;
+	}
 
-	printf("BOOTP broadcast %d\n", ++bootp_try);
 	pkt = net_tx_packet;
 	memset((void *)pkt, 0, PKTSIZE);
 
@@ -814,7 +878,7 @@ void bootp_request(void)
 		| (u32)net_ethaddr[5];
 	bootp_id += get_timer(0);
 	bootp_id = htonl(bootp_id);
-	bootp_add_id(bootp_id);
+	bootp_add_id(bd, bootp_id);
 	net_copy_u32(&bp->bp_id, &bootp_id);
 
 	/*
@@ -825,6 +889,46 @@ void bootp_request(void)
 	pktlen = eth_hdr_size + IP_UDP_HDR_SIZE + iplen;
 	bcast_ip.s_addr = 0xFFFFFFFFL;
 	net_set_udp_header(iphdr, bcast_ip, PORT_BOOTPS, PORT_BOOTPC, iplen);
+	net_send_packet(net_tx_packet, pktlen);
+}
+
+void bootp_request(void)
+{
+#ifdef CONFIG_BOOTP_RANDOM_DELAY
+	ulong rand_ms;
+#endif
+	char *ep;  /* Environment pointer */
+
+	bootstage_mark_name(BOOTSTAGE_ID_BOOTP_START, "bootp_start");
+#if defined(CONFIG_CMD_DHCP)
+	dhcp_state = INIT;
+#endif
+
+	ep = env_get("bootpretryperiod");
+	if (ep != NULL)
+		time_taken_max = dectoul(ep, NULL);
+	else
+		time_taken_max = TIMEOUT_MS;
+
+#ifdef CONFIG_BOOTP_RANDOM_DELAY		/* Random BOOTP delay */
+	if (bootp_try == 0)
+		srand_mac();
+
+	if (bootp_try <= 2)	/* Start with max 1024 * 1ms */
+		rand_ms = rand() >> (22 - bootp_try);
+	else		/* After 3rd BOOTP request max 8192 * 1ms */
+		rand_ms = rand() >> 19;
+
+	printf("Random delay: %ld ms...\n", rand_ms);
+	mdelay(rand_ms);
+
+#endif	/* CONFIG_BOOTP_RANDOM_DELAY */
+
+#ifdef CONFIG_BOOTP_PARALLEL
+	if (bootp_try == 0)
+		bootp_parallel = bootp_start_all();
+#endif
+	printf("BOOTP broadcast %d\n", ++bootp_try);
 	net_set_timeout_handler(bootp_timeout, bootp_timeout_handler);
 
 #if defined(CONFIG_CMD_DHCP)
@@ -833,7 +937,13 @@ void bootp_request(void)
 #else
 	net_set_udp_handler(bootp_handler);
 #endif
-	net_send_packet(net_tx_packet, pktlen);
+#ifdef CONFIG_BOOTP_PARALLEL
+	if (bootp_parallel) {
+		eth_foreach_active(bootp_send_request);
+		return;
+	}
+#endif
+	bootp_send_request();
 }
 
 #if defined(CONFIG_CMD_DHCP)
@@ -1095,6 +1205,7 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 			debug("TRANSITIONING TO REQUESTING STATE\n");
 			dhcp_state = REQUESTING;
+			bootp_choose_dev();
 
 			net_set_timeout_handler(5000, bootp_timeout_handler);
 			dhcp_send_request_packet(bp);
@@ -12,6 +12,7 @@
 #include <dm.h>
 #include <env.h>
 #include <log.h>
+#include <malloc.h>
 #include <net.h>
 #include <asm/global_data.h>
 #include <dm/device-internal.h>
@@ -26,19 +27,39 @@ DECLARE_GLOBAL_DATA_PTR;
  * struct eth_device_priv - private structure for each Ethernet device
  *
  * @state: The state of the Ethernet MAC driver (defined by enum eth_state_t)
+ * @rx_hint: Where the payload of coming packets belongs, if @rx_hint_on
+ * @rx_hint_on: true if eth_rx_hint() gave a hint
+ * @rx_slots: Slot given to each of the driver's receive buffers, or NULL
+ * @rx_count: Number of receive buffers, i.e. entries in @rx_slots
+ * @rx_payload: Slot holding the payload of the current packet, or NULL
+ * @rx_hdr_len: Number of bytes of the current packet not in @rx_payload
+ * @rx_csum_ok: true if the driver checked the current packet's checksum
+ * @stats: Packet counters
+ * @rx_batch: Most packets to process in one call to eth_rx()
  */
 struct eth_device_priv {
 	enum eth_state_t state;
 	bool running;
+	struct eth_stats stats;
+	uint rx_batch;
+	struct eth_rx_hint rx_hint;
+	bool rx_hint_on;
+	uchar **rx_slots;
+	uint rx_count;
+	uchar *rx_payload;
+	uint rx_hdr_len;
+	bool rx_csum_ok;
 };
 
 /**
  * struct eth_uclass_priv - The structure attached to the uclass itself
  *
  * @current: The Ethernet device that the network functions are using
+ * @all_running: true if eth_start_all() started devices other than @current
  */
 struct eth_uclass_priv {
 	struct udevice *current;
+	bool all_running;
 };
 
 /* eth_errno - This stores the most recent failure code from DM functions */
@@ -261,6 +282,52 @@ static int on_ethaddr(const char *name, const char *value, enum env_op op,
 }
 U_BOOT_ENV_CALLBACK(ethaddr, on_ethaddr);
 
+static int eth_start_dev(struct udevice *dev)
+{
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+	int ret;
+
+	ret = eth_get_ops(dev)->start(dev);
+	if (ret < 0)
+		return ret;
+
+	priv->state = ETH_STATE_ACTIVE;
+	priv->running = true;
+	priv->rx_hint_on = false;
+
+	return ret;
+}
+
+static void eth_stop_dev(struct udevice *dev)
+{
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+
+	if (!priv || !priv->running)
+		return;
+
+	priv->rx_hint_on = false;
+	eth_get_ops(dev)->stop(dev);
+	priv->state = ETH_STATE_PASSIVE;
+	priv->running = false;
+}
+
+/* Stop the devices which eth_start_all() started, except the current one */
+static void eth_stop_others(void)
+{
+	struct eth_uclass_priv *uc_priv = eth_get_uclass_priv();
+	struct udevice *dev;
+	struct uclass *uc;
+
+	if (!uc_priv || !uc_priv->all_running)
+		return;
+
+	uclass_id_foreach_dev(UCLASS_ETH, dev, uc) {
+		if (dev != uc_priv->current && device_active(dev))
+			eth_stop_dev(dev);
+	}
+	uc_priv->all_running = false;
+}
+
 int eth_init(void)
 {
 	char *ethact = env_get("ethact");
@@ -295,15 +362,9 @@ int eth_init(void)
 			debug("Trying %s\n", current->name);
 
 			if (device_active(current)) {
-				ret = eth_get_ops(current)->start(current);
-				if (ret >= 0) {
-					struct eth_device_priv *priv =
-						dev_get_uclass_priv(current);
-
-					priv->state = ETH_STATE_ACTIVE;
-					priv->running = true;
+				ret = eth_start_dev(current);
+				if (ret >= 0)
 					return 0;
-				}
 			} else {
 				ret = eth_errno;
 			}
@@ -328,19 +389,117 @@ int eth_init(void)
 void eth_halt(void)
 {
 	struct udevice *current;
-	struct eth_device_priv *priv;
 
+	eth_stop_others();
 	current = eth_get_dev();
 	if (!current)
 		return;
 
-	priv = dev_get_uclass_priv(current);
-	if (!priv || !priv->running)
+	eth_stop_dev(current);
+}
+
+/* A DSA port shares its master with the other ports of the switch */
+static bool eth_is_dsa_port(struct udevice *dev)
+{
+	return device_get_uclass_id(dev_get_parent(dev)) == UCLASS_DSA;
+}
+
+int eth_start_all(void)
+{
+	struct eth_uclass_priv *uc_priv = eth_get_uclass_priv();
+	struct udevice *current = eth_get_dev();
+	struct eth_pdata *pdata;
+	struct udevice *dev;
+	int count = 0;
+
+	if (!current || !eth_is_active(current))
+		return 0;
+	if (eth_is_dsa_port(current))
+		return 1;
+
+	for (uclass_first_device_check(UCLASS_ETH, &dev); dev;
+	     uclass_next_device_check(&dev)) {
+		if (dev != current && device_active(dev) &&
+		    !eth_is_active(dev) && !eth_is_dsa_port(dev)) {
+			pdata = dev_get_plat(dev);
+			if (is_valid_ethaddr(pdata->enetaddr) &&
+			    eth_start_dev(dev) >= 0)
+				uc_priv->all_running = true;
+			else
+				debug("%s: cannot start %s\n", __func__,
+				      dev->name);
+		}
+		if (eth_is_active(dev))
+			count++;
+	}
+
+	return count;
+}
+
+/* Make @dev current, with net_ethaddr to match */
+static void eth_switch_to(struct eth_uclass_priv *uc_priv,
+			  struct udevice *dev)
+{
+	struct eth_pdata *pdata = dev_get_plat(dev);
+
+	uc_priv->current = dev;
+	memcpy(net_ethaddr, pdata->enetaddr, ARP_HLEN);
+}
+
+void eth_foreach_active(void (*func)(void))
+{
+	struct eth_uclass_priv *uc_priv = eth_get_uclass_priv();
+	struct udevice *current = eth_get_dev();
+	struct udevice *dev;
+	struct uclass *uc;
+
+	if (!uc_priv->all_running) {
+		func();
 		return;
+	}
 
-	eth_get_ops(current)->stop(current);
-	priv->state = ETH_STATE_PASSIVE;
-	priv->running = false;
+	uclass_id_foreach_dev(UCLASS_ETH, dev, uc) {
+		if (!eth_is_active(dev))
+			continue;
+		eth_switch_to(uc_priv, dev);
+		func();
+	}
+	eth_switch_to(uc_priv, current);
+}
+
+int eth_rx_all(void)
+{
+	struct eth_uclass_priv *uc_priv = eth_get_uclass_priv();
+	struct udevice *current = eth_get_dev();
+	struct udevice *dev;
+	struct uclass *uc;
+	int ret = 0;
+
+	if (!uc_priv->all_running)
+		return eth_rx();
+
+	uclass_id_foreach_dev(UCLASS_ETH, dev, uc) {
+		if (!eth_is_active(dev))
+			continue;
+		eth_switch_to(uc_priv, dev);
+		if (dev == current)
+			ret = eth_rx();
+		else
+			eth_rx();
+
+		/* A handler chose this device with eth_halt_others() */
+		if (!uc_priv->all_running)
+			return ret;
+	}
+	eth_switch_to(uc_priv, current);
+
+	return ret;
+}
+
+void eth_halt_others(void)
+{
+	eth_stop_others();
+	eth_current_changed();
 }
 
 int eth_is_active(struct udevice *dev)
@@ -370,6 +529,10 @@ int eth_send(void *packet, int length)
 	if (ret < 0) {
 		/* We cannot completely return the error at present */
 		debug("%s: send() returned error %d\n", __func__, ret);
+		eth_get_stats(current)->tx_errors++;
+	} else {
+		eth_get_stats(current)->tx_packets++;
+		eth_get_stats(current)->tx_bytes += length;
 	}
 #if defined(CONFIG_CMD_PCAP)
 	if (ret >= 0)
@@ -378,9 +541,201 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+struct eth_stats *eth_get_stats(struct udevice *dev)
+{
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+
+	return &priv->stats;
+}
+
+uint eth_get_rx_batch(struct udevice *dev)
+{
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+
+	return priv->rx_batch;
+}
+
+int eth_get_rx_ring_size(struct udevice *dev, int def)
+{
+	return dev_read_u32_default(dev, "u-boot,rx-ring-size", def);
+}
+
+int eth_rx_hint(const struct eth_rx_hint *hint)
+{
+	struct udevice *current = eth_get_dev();
+	struct eth_device_priv *priv;
+
+	if (!current)
+		return -ENODEV;
+
+	priv = dev_get_uclass_priv(current);
+	priv->rx_hint_on = hint;
+	if (hint)
+		priv->rx_hint = *hint;
+
+	return 0;
+}
+
+int eth_send_sg(void *hdr, int hdr_len, const void *data, int data_len)
+{
+	struct udevice *current;
+	int ret;
+
+	current = eth_get_dev();
+	if (!current)
+		return -ENODEV;
+
+	if (!eth_is_active(current))
+		return -EINVAL;
+
+	/* A capture needs the packet in one piece */
+	if (!eth_get_ops(current)->send_sg ||
+	    (IS_ENABLED(CONFIG_CMD_PCAP) && pcap_active()))
+		return -ENOSYS;
+
+	ret = eth_get_ops(current)->send_sg(current, hdr, hdr_len, data,
+					    data_len);
+	if (ret == -EMSGSIZE)
+		return ret;
+	if (ret < 0) {
+		debug("%s: send_sg() returned error %d\n", __func__, ret);
+		eth_get_stats(current)->tx_errors++;
+	} else {
+		eth_get_stats(current)->tx_packets++;
+		eth_get_stats(current)->tx_bytes += hdr_len + data_len;
+	}
+
+	return ret;
+}
+
+bool eth_tx_csum_offload(void)
+{
+	struct udevice *current = eth_get_dev();
+	struct eth_pdata *pdata;
+
+	if (!current)
+		return false;
+	pdata = dev_get_plat(current);
+
+	return pdata->features & ETH_FEAT_TX_CSUM;
+}
+
+void eth_rx_set_csum_ok(struct udevice *dev)
+{
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+
+	priv->rx_csum_ok = true;
+}
+
+bool eth_rx_csum_ok(void)
+{
+	struct udevice *current = eth_get_dev();
+	struct eth_device_priv *priv;
+
+	if (!current)
+		return false;
+	priv = dev_get_uclass_priv(current);
+
+	return priv->rx_csum_ok;
+}
+
+uchar *eth_rx_payload(void)
+{
+	struct udevice *current = eth_get_dev();
+	struct eth_device_priv *priv;
+
+	if (!current)
+		return NULL;
+	priv = dev_get_uclass_priv(current);
+
+	return priv->rx_payload;
+}
+
+uchar *eth_rx_hint_buf(struct udevice *dev, uint idx, ulong align,
+		       uint *lenp, uint *hdr_lenp)
+{
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+	const struct eth_rx_hint *hint = &priv->rx_hint;
+	uchar *end = hint->buf + hint->size;
+	uchar *slot, *other;
+	uint len, i;
+
+	if (idx >= priv->rx_count)
+		return NULL;
+	priv->rx_slots[idx] = NULL;
+	if (!priv->rx_hint_on)
+		return NULL;
+
+	/*
+	 * Each of the other buffers may take a packet before this one does,
+	 * so this one is for the packet after those at the earliest. It also
+	 * goes after the slot of every buffer still with the hardware, so
+	 * that two buffers never share a slot and the slot of a packet is
+	 * never before the one it belongs in. Then the hardware never writes
+	 * to a slot which already holds data.
+	 */
+	slot = hint->buf + (priv->rx_count - 1) * hint->stride;
+	for (i = 0; i < priv->rx_count; i++) {
+		other = priv->rx_slots[i];
+		if (other >= hint->buf && other < end && other >= slot)
+			slot = other + hint->stride;
+	}
+
+	len = min(*lenp, hint->stride);
+	if (slot + len > end || (ulong)slot % align)
+		return NULL;
+	priv->rx_slots[idx] = slot;
+	*lenp = len;
+	*hdr_lenp = hint->hdr_len;
+
+	return slot;
+}
+
+void eth_rx_hint_reset(struct udevice *dev, uint count)
+{
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+
+	free(priv->rx_slots);
+	priv->rx_slots = calloc(count, sizeof(*priv->rx_slots));
+	priv->rx_count = priv->rx_slots ? count : 0;
+}
+
+void eth_rx_set_payload(struct udevice *dev, uchar *payload, uint hdr_len)
+{
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+
+	priv->rx_payload = payload;
+	priv->rx_hdr_len = hdr_len;
+}
+
+/*
+ * Put the payload of a split packet back after its headers, unless it is one
+ * of the packets the hint asked for
+ */
+static void eth_rx_check_split(struct eth_device_priv *priv, uchar *packet,
+			       int len)
+{
+	const struct eth_rx_hint *hint = &priv->rx_hint;
+	struct ethernet_hdr *et = (struct ethernet_hdr *)packet;
+	struct ip_udp_hdr *ip = (struct ip_udp_hdr *)(et + 1);
+
+	if (priv->rx_hint_on && !IS_ENABLED(CONFIG_UDP_CHECKSUM) &&
+	    priv->rx_hdr_len == hint->hdr_len &&
+	    et->et_protlen == htons(PROT_IP) && ip->ip_hl_v == 0x45 &&
+	    !(ip->ip_off & htons(IP_OFFS | IP_FLAGS_MFRAG)) &&
+	    ip->ip_p == IPPROTO_UDP && ntohs(ip->udp_dst) == hint->port &&
+	    !memcmp(ip + 1, hint->match, hint->match_len))
+		return;
+
+	memcpy(packet + priv->rx_hdr_len, priv->rx_payload,
+	       len - priv->rx_hdr_len);
+	priv->rx_payload = NULL;
+}
+
 int eth_rx(void)
 {
 	struct udevice *current;
+	struct eth_device_priv *priv;
 	uchar *packet;
 	int flags;
 	int ret;
@@ -392,24 +747,52 @@ int eth_rx(void)
 
 	if (!eth_is_active(current))
 		return -EINVAL;
+	priv = dev_get_uclass_priv(current);
+	priv->stats.rx_polls++;
 
-	/* Process up to 32 packets at one time */
+	/* Process up to rx_batch packets at one time */
 	flags = ETH_RECV_CHECK_DEVICE;
-	for (i = 0; i < ETH_PACKETS_BATCH_RECV; i++) {
+	for (i = 0; i < priv->rx_batch; i++) {
+		priv->rx_payload = NULL;
+		priv->rx_csum_ok = false;
 		ret = eth_get_ops(current)->recv(current, flags, &packet);
 		flags = 0;
+		if (ret > 0) {
+			priv->stats.rx_packets++;
+			priv->stats.rx_bytes += ret;
+		}
+		if (IS_ENABLED(CONFIG_NET_RX_HINT) && ret > 0 &&
+		    priv->rx_payload)
+			eth_rx_check_split(priv, packet, ret);
 		if (ret > 0)
 			net_process_received_packet(packet, ret);
+		priv->rx_payload = NULL;
+		priv->rx_csum_ok = false;
 		if (ret >= 0 && eth_get_ops(current)->free_pkt)
 			eth_get_ops(current)->free_pkt(current, packet, ret);
 		if (ret <= 0)
 			break;
 	}
+
+	/*
+	 * If packets are still coming in, drain more of them next time so
+	 * that the receive ring does not overflow between polls
+	 */
+	if (i == priv->rx_batch) {
+		priv->stats.rx_full_polls++;
+		if (priv->rx_batch < ETH_PACKETS_BATCH_MAX)
+			priv->rx_batch *= 2;
+	} else if (i < priv->rx_batch / 2 &&
+		   priv->rx_batch > ETH_PACKETS_BATCH_RECV) {
+		priv->rx_batch /= 2;
+	}
+
 	if (ret == -EAGAIN)
 		ret = 0;
 	if (ret < 0) {
 		/* We cannot completely return the error at present */
 		debug("%s: recv() returned error %d\n", __func__, ret);
+		priv->stats.rx_errors++;
 	}
 	return ret;
 }
@@ -550,6 +933,7 @@ static int eth_post_probe(struct udevice *dev)
 
 	priv->state = ETH_STATE_INIT;
 	priv->running = false;
+	priv->rx_batch = ETH_PACKETS_BATCH_RECV;
 
 	/* Check if the device has a valid MAC address in device tree */
 	if (!eth_dev_get_mac_address(dev, pdata->enetaddr) ||
@@ -600,8 +984,12 @@ static int eth_post_probe(struct udevice *dev)
 static int eth_pre_remove(struct udevice *dev)
 {
 	struct eth_pdata *pdata = dev_get_plat(dev);
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
 
 	eth_get_ops(dev)->stop(dev);
+	free(priv->rx_slots);
+	priv->rx_slots = NULL;
+	priv->rx_count = 0;
 
 	/* clear the MAC address */
 	memset(pdata->enetaddr, 0, ARP_HLEN);
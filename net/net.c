@@ -91,12 +91,15 @@
 #include <image.h>
 #include <log.h>
 #include <net.h>
+#include <net/bootp.h>
 #include <net/fastboot.h>
+#include <net/tcp.h>
 #include <net/tftp.h>
 #if defined(CONFIG_CMD_PCAP)
 #include <net/pcap.h>
 #endif
 #include <net/udp.h>
+#include <net/wget.h>
 #if defined(CONFIG_LED_STATUS)
 #include <miiphy.h>
 #include <status_led.h>
@@ -104,7 +107,6 @@
 #include <watchdog.h>
 #include <linux/compiler.h>
 #include "arp.h"
-#include "bootp.h"
 #include "cdp.h"
 #if defined(CONFIG_CMD_DNS)
 #include "dns.h"
@@ -340,6 +342,8 @@ void net_auto_load(void)
 
 static int net_init_loop(void)
 {
+	arp_queue_clear();
+
 	if (eth_get_dev())
 		memcpy(net_ethaddr, eth_get_ethaddr(), 6);
 	else
@@ -526,6 +530,16 @@ restart:
 		case WOL:
 			wol_start();
 			break;
+#endif
+#if defined(CONFIG_CMD_WGET)
+		case WGET:
+			wget_start();
+			break;
+#endif
+#if defined(CONFIG_TFTP_MULTI)
+		case TFTPMULTI:
+			tftp_multi_start();
+			break;
 #endif
 		default:
 			break;
@@ -569,7 +583,12 @@ restart:
 		 *	Most drivers return the most recent packet size, but not
 		 *	errors that may have happened.
 		 */
+#ifdef CONFIG_BOOTP_PARALLEL
+		eth_rx_all();
+#else
 		eth_rx();
+#endif
+		nc_poll();
 
 		/*
 		 *	Abort if ctrl-c was pressed.
@@ -816,6 +835,31 @@ int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 				  IPPROTO_UDP, 0, 0, 0);
 }
 
+int net_send_udp_data(uchar *ether, struct in_addr dest, int dport, int sport,
+		      const void *data, int len)
+{
+	uchar *pkt = (uchar *)net_tx_packet;
+	int eth_hdr_size, ret;
+
+	/* Broadcasts and packets waiting for ARP are built whole */
+	if (IS_ENABLED(CONFIG_NET_OFFLOAD) && dest.s_addr &&
+	    dest.s_addr != 0xFFFFFFFF &&
+	    (memcmp(ether, net_null_ethaddr, ARP_HLEN) ||
+	     arp_cache_lookup(dest, ether))) {
+		eth_hdr_size = net_set_ether(pkt, ether, PROT_IP);
+		net_set_udp_header(pkt + eth_hdr_size, dest, dport, sport, len);
+		ret = eth_send_sg(pkt, eth_hdr_size + IP_UDP_HDR_SIZE, data,
+				  len);
+		/* Otherwise the driver cannot gather it, so copy it in */
+		if (ret != -ENOSYS && ret != -EMSGSIZE)
+			return ret < 0 ? ret : 0;
+	}
+
+	memcpy(pkt + net_eth_hdr_size() + IP_UDP_HDR_SIZE, data, len);
+
+	return net_send_udp_packet(ether, dest, dport, sport, len);
+}
+
 int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 		       int payload_len, int proto, u8 action, u32 tcp_seq_num,
 		       u32 tcp_ack_num)
@@ -836,6 +880,9 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 	/* if broadcast, make the ether address a broadcast and don't do ARP */
 	if (dest.s_addr == 0xFFFFFFFF)
 		ether = (uchar *)net_bcast_ethaddr;
+	/* otherwise an earlier ARP may have found it already */
+	else if (memcmp(ether, net_null_ethaddr, 6) == 0)
+		arp_cache_lookup(dest, ether);
 
 	pkt = (uchar *)net_tx_packet;
 
@@ -847,6 +894,14 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 				   payload_len);
 		pkt_hdr_size = eth_hdr_size + IP_UDP_HDR_SIZE;
 		break;
+#if defined(CONFIG_PROT_TCP)
+	case IPPROTO_TCP:
+		pkt_hdr_size = eth_hdr_size +
+			tcp_set_tcp_header(pkt + eth_hdr_size, dest, dport,
+					   sport, payload_len, action,
+					   tcp_seq_num, tcp_ack_num);
+		break;
+#endif
 	default:
 		return -EINVAL;
 	}
@@ -855,6 +910,10 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 	if (memcmp(ether, net_null_ethaddr, 6) == 0) {
 		debug_cond(DEBUG_DEV_PKT, "sending ARP for %pI4\n", &dest);
 
+		/* keep the packet aside, if there is room */
+		if (!arp_queue_packet(dest, ether, pkt_hdr_size + payload_len))
+			return 1;	/* waiting */
+
 		/* save the ip and eth addr for the packet to send after arp */
 		net_arp_wait_packet_ip = dest;
 		arp_wait_packet_ethaddr = ether;
@@ -877,14 +936,18 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 
 #ifdef CONFIG_IP_DEFRAG
 /*
- * This function collects fragments in a single packet, according
- * to the algorithm in RFC815. It returns NULL or the pointer to
- * a complete packet, in static storage
+ * These functions collect fragments in a single packet, according
+ * to the algorithm in RFC815. Several datagrams may be reassembled at
+ * once, since a windowed transfer of large blocks sends their fragments
+ * interleaved.
  */
 #define IP_PKTSIZE (CONFIG_NET_MAXDEFRAG)
 
 #define IP_MAXUDP (IP_PKTSIZE - IP_HDR_SIZE)
 
+/* A datagram which gets no new fragment for this long is given up */
+#define IP_DEFRAG_TIMEOUT	2000
+
 /*
  * this is the packet being assembled, either data or frag control.
  * Fragments go by 8 bytes, so this union must be 8 bytes long
@@ -897,36 +960,93 @@ struct hole {
 	u16 unused;
 };
 
+/**
+ * struct ip_defrag - a datagram being reassembled
+ *
+ * @pkt_buff: IP header of the first fragment received, then the payload,
+ *	with the holes in it holding the hole list
+ * @time: time at which the last fragment was received
+ * @first_hole: index of the first hole, in 8-byte blocks
+ * @total_len: length of the payload, 0xffff until the last fragment is
+ *	received, 0 if this entry is free
+ */
+struct ip_defrag {
+	uchar pkt_buff[IP_PKTSIZE] __aligned(PKTALIGN);
+	ulong time;
+	u16 first_hole;
+	u16 total_len;
+};
+
+static struct ip_defrag ip_defrag_table[CONFIG_NET_DEFRAG_SLOTS];
+
+/*
+ * Find the entry for the datagram which @ip is a fragment of. If there is
+ * none, start one, in place of the least recently used entry if need be.
+ */
+static struct ip_defrag *ip_defrag_find(struct ip_udp_hdr *ip)
+{
+	struct ip_defrag *d, *spare = NULL;
+	struct ip_udp_hdr *localip;
+	struct hole *payload;
+
+	for (d = ip_defrag_table;
+	     d < ip_defrag_table + CONFIG_NET_DEFRAG_SLOTS; d++) {
+		localip = (struct ip_udp_hdr *)d->pkt_buff;
+		if (d->total_len && get_timer(d->time) > IP_DEFRAG_TIMEOUT)
+			d->total_len = 0;
+		if (!d->total_len) {
+			if (!spare || spare->total_len)
+				spare = d;
+			continue;
+		}
+		/* RFC791 tells datagrams apart by ID, addresses and protocol */
+		if (localip->ip_id == ip->ip_id &&
+		    localip->ip_src.s_addr == ip->ip_src.s_addr &&
+		    localip->ip_dst.s_addr == ip->ip_dst.s_addr &&
+		    localip->ip_p == ip->ip_p)
+			return d;
+		if (!spare || (spare->total_len &&
+			       get_timer(d->time) > get_timer(spare->time)))
+			spare = d;
+	}
+
+	/* new (or different) packet, reset structs */
+	d = spare;
+	payload = (struct hole *)(d->pkt_buff + IP_HDR_SIZE);
+	d->total_len = 0xffff;
+	payload[0].last_byte = ~0;
+	payload[0].next_hole = 0;
+	payload[0].prev_hole = 0;
+	d->first_hole = 0;
+	/* any IP header will work, copy the first we received */
+	memcpy(d->pkt_buff, ip, IP_HDR_SIZE);
+
+	return d;
+}
+
 static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 {
-	static uchar pkt_buff[IP_PKTSIZE] __aligned(PKTALIGN);
-	static u16 first_hole, total_len;
+	struct ip_defrag *d;
 	struct hole *payload, *thisfrag, *h, *newh;
-	struct ip_udp_hdr *localip = (struct ip_udp_hdr *)pkt_buff;
+	struct ip_udp_hdr *localip;
 	uchar *indata = (uchar *)ip;
 	int offset8, start, len, done = 0;
 	u16 ip_off = ntohs(ip->ip_off);
 
-	/* payload starts after IP header, this fragment is in there */
-	payload = (struct hole *)(pkt_buff + IP_HDR_SIZE);
 	offset8 =  (ip_off & IP_OFFS);
-	thisfrag = payload + offset8;
 	start = offset8 * 8;
 	len = ntohs(ip->ip_len) - IP_HDR_SIZE;
 
 	if (start + len > IP_MAXUDP) /* fragment extends too far */
 		return NULL;
 
-	if (!total_len || localip->ip_id != ip->ip_id) {
-		/* new (or different) packet, reset structs */
-		total_len = 0xffff;
-		payload[0].last_byte = ~0;
-		payload[0].next_hole = 0;
-		payload[0].prev_hole = 0;
-		first_hole = 0;
-		/* any IP header will work, copy the first we received */
-		memcpy(localip, ip, IP_HDR_SIZE);
-	}
+	d = ip_defrag_find(ip);
+	d->time = get_timer(0);
+	localip = (struct ip_udp_hdr *)d->pkt_buff;
+
+	/* payload starts after IP header, this fragment is in there */
+	payload = (struct hole *)(d->pkt_buff + IP_HDR_SIZE);
+	thisfrag = payload + offset8;
 
 	/*
 	 * What follows is the reassembly algorithm. We use the payload
@@ -935,7 +1055,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 	 * so it is represented as byte count, not as 8-byte blocks.
 	 */
 
-	h = payload + first_hole;
+	h = payload + d->first_hole;
 	while (h->last_byte < start) {
 		if (!h->next_hole) {
 			/* no hole that far away */
@@ -952,7 +1072,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 
 	if (!(ip_off & IP_FLAGS_MFRAG)) {
 		/* no more fragmentss: truncate this (last) hole */
-		total_len = start + len;
+		d->total_len = start + len;
 		h->last_byte = start + len;
 	}
 
@@ -969,7 +1089,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 			done = 1;
 		} else if (!h->prev_hole) {
 			/* first hole */
-			first_hole = h->next_hole;
+			d->first_hole = h->next_hole;
 			payload[h->next_hole].prev_hole = 0;
 		} else if (!h->next_hole) {
 			/* last hole */
@@ -994,7 +1114,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 		if (h->prev_hole)
 			payload[h->prev_hole].next_hole = (h - payload);
 		else
-			first_hole = (h - payload);
+			d->first_hole = (h - payload);
 
 	} else {
 		/* fragment sits in the middle: split the hole */
@@ -1012,8 +1132,13 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 	if (!done)
 		return NULL;
 
-	localip->ip_len = htons(total_len);
-	*lenp = total_len + IP_HDR_SIZE;
+	/*
+	 * The entry is free for the next datagram, but the packet stays in
+	 * it until another fragment arrives
+	 */
+	localip->ip_len = htons(IP_HDR_SIZE + d->total_len);
+	*lenp = d->total_len + IP_HDR_SIZE;
+	d->total_len = 0;
 	return localip;
 }
 
@@ -1221,6 +1346,9 @@ void net_process_received_packet(uchar *in_packet, int len)
 		}
 		/* Read source IP address for later use */
 		src_ip = net_read_ip(&ip->ip_src);
+		/* Remember the MAC address of a neighbour talking to us */
+		if (dst_ip.s_addr == net_ip.s_addr)
+			arp_cache_learn(src_ip, et->et_src, true);
 		/*
 		 * The function returns the unchanged packet if it's not
 		 * a fragment, and either the complete packet or NULL if
@@ -1253,6 +1381,11 @@ void net_process_received_packet(uchar *in_packet, int len)
 		if (ip->ip_p == IPPROTO_ICMP) {
 			receive_icmp(ip, len, src_ip, et);
 			return;
+#if defined(CONFIG_PROT_TCP)
+		} else if (ip->ip_p == IPPROTO_TCP) {
+			tcp_receive((struct ip_tcp_hdr *)ip, len);
+			return;
+#endif
 		} else if (ip->ip_p != IPPROTO_UDP) {	/* Only UDP packets */
 			return;
 		}
@@ -1264,7 +1397,9 @@ void net_process_received_packet(uchar *in_packet, int len)
 			   "received UDP (to=%pI4, from=%pI4, len=%d)\n",
 			   &dst_ip, &src_ip, len);
 
-		if (IS_ENABLED(CONFIG_UDP_CHECKSUM) && ip->udp_xsum != 0) {
+		/* The driver may have checked the checksum already */
+		if (IS_ENABLED(CONFIG_UDP_CHECKSUM) && ip->udp_xsum != 0 &&
+		    !(IS_ENABLED(CONFIG_NET_OFFLOAD) && eth_rx_csum_ok())) {
 			ulong   xsum;
 			u8 *sumptr;
 			ushort  sumlen;
@@ -1353,6 +1488,12 @@ static int net_check_prereq(enum proto_t protocol)
 
 #if defined(CONFIG_CMD_NFS)
 	case NFS:
+#endif
+#if defined(CONFIG_CMD_WGET)
+	case WGET:
+#endif
+#if defined(CONFIG_TFTP_MULTI)
+	case TFTPMULTI:
 #endif
 		/* Fall through */
 	case TFTPGET:
@@ -1518,6 +1659,70 @@ void net_set_udp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
 	ip->udp_xsum = 0;
 }
 
+unsigned net_pseudo_checksum(struct in_addr src, struct in_addr dest,
+			     u8 proto, unsigned len)
+{
+	struct {
+		struct in_addr src;
+		struct in_addr dest;
+		u8 zero;
+		u8 proto;
+		u16 len;
+	} __packed pseudo;
+
+	pseudo.src = src;
+	pseudo.dest = dest;
+	pseudo.zero = 0;
+	pseudo.proto = proto;
+	pseudo.len = htons(len);
+
+	return compute_ip_checksum(&pseudo, sizeof(pseudo));
+}
+
+unsigned net_l4_checksum(struct in_addr src, struct in_addr dest, u8 proto,
+			 const void *seg, unsigned len)
+{
+	/* The pseudo-header is 12 bytes, so the segment sum needs no swap */
+	return add_ip_checksums(12, net_pseudo_checksum(src, dest, proto, len),
+				compute_ip_checksum(seg, len));
+}
+
+u16 *net_l4_checksum_field(void *packet, int len, struct ip_udp_hdr **ipp)
+{
+	struct ethernet_hdr *eth = packet;
+	struct vlan_ethernet_hdr *veth = packet;
+	int hdr_size = ETHER_HDR_SIZE;
+	u16 protlen = ntohs(eth->et_protlen);
+	struct ip_udp_hdr *ip;
+	int offset;
+
+	if (len < ETHER_HDR_SIZE)
+		return NULL;
+	if (protlen == PROT_VLAN) {
+		if (len < VLAN_ETHER_HDR_SIZE)
+			return NULL;
+		hdr_size = VLAN_ETHER_HDR_SIZE;
+		protlen = ntohs(veth->vet_type);
+	}
+	ip = packet + hdr_size;
+	if (len < hdr_size + IP_HDR_SIZE || protlen != PROT_IP ||
+	    ip->ip_hl_v != 0x45 ||
+	    ntohs(ip->ip_off) & (IP_OFFS | IP_FLAGS_MFRAG))
+		return NULL;
+
+	if (ip->ip_p == IPPROTO_UDP)
+		offset = offsetof(struct ip_udp_hdr, udp_xsum);
+	else if (ip->ip_p == IPPROTO_TCP)
+		offset = IP_HDR_SIZE + 16;	/* 16 bytes into the TCP header */
+	else
+		return NULL;
+	if (hdr_size + offset + 2 > len || ntohs(ip->ip_len) < offset + 2)
+		return NULL;
+	*ipp = ip;
+
+	return (u16 *)((uchar *)ip + offset);
+}
+
 void copy_filename(char *dst, const char *src, int size)
 {
 	if (src && *src && (*src == '"')) {
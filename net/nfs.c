@@ -32,10 +32,10 @@
 #include <image.h>
 #include <log.h>
 #include <net.h>
+#include <net/bootp.h>
 #include <malloc.h>
 #include <mapmem.h>
 #include "nfs.h"
-#include "bootp.h"
 #include <time.h>
 
 #define HASHES_PER_LINE 65	/* Number of "loading" hashes per line	*/
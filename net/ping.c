@@ -109,8 +109,13 @@ void ping_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 		icmph->checksum = 0;
 		icmph->checksum = compute_ip_checksum(icmph, len - IP_HDR_SIZE);
 
+		/* The reply to a reassembled request may not fit in a frame */
+		if (eth_hdr_size + len > PKTSIZE)
+			return;
 		tx_packet = net_get_async_tx_pkt_buf();
-		memcpy(tx_packet, et, eth_hdr_size + len);
+		/* A reassembled request is not next to its Ethernet header */
+		memcpy(tx_packet, et, eth_hdr_size);
+		memcpy(tx_packet + eth_hdr_size, ip, len);
 		net_send_packet(tx_packet, eth_hdr_size + len);
 		return;
 /*	default:
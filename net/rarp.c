@@ -8,9 +8,9 @@
 #include <command.h>
 #include <log.h>
 #include <net.h>
+#include <net/bootp.h>
 #include <net/tftp.h>
 #include "nfs.h"
-#include "bootp.h"
 #include "rarp.h"
 
 #define TIMEOUT 5000UL /* Milliseconds before trying BOOTP again */
@@ -0,0 +1,572 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Minimal TCP client
+ *
+ * This handles a single connection to a server which sends a stream of data,
+ * such as an HTTP download. It is written for throughput rather than
+ * generality:
+ *
+ * - received data is handed to the application as soon as it arrives, even
+ *   out of order, so that it can be stored directly where it belongs. Ranges
+ *   received beyond a hole are remembered and reported to the server with
+ *   SACK (RFC 2018), so that only the missing segments are sent again
+ * - the receive window is scaled (RFC 7323), so that it can be larger than
+ *   64KB and a fast server need not wait for acknowledgements
+ * - acknowledgements are delayed until two segments have arrived, or until a
+ *   short timer runs out (RFC 5681), unless a segment is out of order
+ *
+ * The application can send a little data of its own, such as a request, but
+ * there is no congestion control or send window.
+ */
+
+#include <common.h>
+#include <log.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <asm/unaligned.h>
+#include "net_rand.h"
+
+/* Initial retransmission timeout, doubled each time it runs out */
+#define TCP_RTO_MS	500
+#define TCP_RTO_MAX_MS	8000
+/* Timeouts in a row without hearing from the server before giving up */
+#define TCP_RETRIES	8
+/* Longest time an acknowledgement is held back */
+#define TCP_DELACK_MS	20
+/* Acknowledge at least once for this many in-order segments */
+#define TCP_ACK_SEGS	2
+
+#define TCP_RCV_WND	CONFIG_TCP_RX_WINDOW
+
+/* A range of sequence numbers received out of order */
+struct tcp_sack {
+	u32 start;
+	u32 end;
+};
+
+static enum tcp_state tcp_state;
+static const struct tcp_ops *tcp_ops;
+static uchar tcp_ethaddr[ARP_HLEN];
+static struct in_addr tcp_server_ip;
+static int tcp_server_port;
+static int tcp_our_port;
+
+static u32 tcp_snd_una;		/* oldest unacknowledged sequence number */
+static u32 tcp_snd_nxt;		/* next sequence number to send */
+static unsigned int tcp_snd_mss;	/* largest segment the server takes */
+static u32 tcp_tx_seq;		/* sequence number of tcp_tx_buf[0] */
+static unsigned int tcp_tx_len;
+static uchar tcp_tx_buf[TCP_MSS];
+
+static u32 tcp_irs;		/* server's initial sequence number */
+static u32 tcp_rcv_nxt;		/* next sequence number expected */
+static u8 tcp_rcv_wscale;	/* shift applied to the window we send */
+static bool tcp_sack_ok;	/* server understands SACK blocks */
+static struct tcp_sack tcp_sack[TCP_SACK_BLOCKS];	/* most recent first */
+static int tcp_sack_count;
+static unsigned int tcp_ack_pending;	/* segments not yet acknowledged */
+
+static unsigned int tcp_rto;
+static int tcp_retries;
+
+static void tcp_timeout_handler(void);
+
+static inline bool tcp_seq_before(u32 a, u32 b)
+{
+	return (s32)(a - b) < 0;
+}
+
+static inline bool tcp_seq_after(u32 a, u32 b)
+{
+	return (s32)(a - b) > 0;
+}
+
+enum tcp_state tcp_get_state(void)
+{
+	return tcp_state;
+}
+
+static u16 tcp_window(u8 action)
+{
+	/* The window in a SYN is never scaled */
+	u32 win = action & TCP_SYN ? TCP_RCV_WND : TCP_RCV_WND >> tcp_rcv_wscale;
+
+	return min_t(u32, win, 0xffff);
+}
+
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num)
+{
+	struct ip_tcp_hdr *tcp = (struct ip_tcp_hdr *)pkt;
+	uchar *opt = pkt + IP_TCP_HDR_SIZE;
+	int opt_len = 0;
+	int len, i;
+
+	if (action & TCP_SYN) {
+		opt[0] = TCP_O_MSS;
+		opt[1] = 4;
+		put_unaligned_be16(TCP_MSS, opt + 2);
+		opt[4] = TCP_O_NOP;
+		opt[5] = TCP_O_SCL;
+		opt[6] = 3;
+		opt[7] = tcp_rcv_wscale;
+		opt[8] = TCP_O_NOP;
+		opt[9] = TCP_O_NOP;
+		opt[10] = TCP_O_SACK_OK;
+		opt[11] = 2;
+		opt_len = 12;
+	} else if (!payload_len && tcp_sack_ok && tcp_sack_count) {
+		opt[0] = TCP_O_NOP;
+		opt[1] = TCP_O_NOP;
+		opt[2] = TCP_O_SACK;
+		opt[3] = 2 + tcp_sack_count * 8;
+		for (i = 0; i < tcp_sack_count; i++) {
+			put_unaligned_be32(tcp_sack[i].start, opt + 4 + i * 8);
+			put_unaligned_be32(tcp_sack[i].end, opt + 8 + i * 8);
+		}
+		opt_len = 4 + tcp_sack_count * 8;
+	}
+
+	len = TCP_HDR_SIZE + opt_len + payload_len;
+	net_set_ip_header(pkt, dest, net_ip, IP_HDR_SIZE + len, IPPROTO_TCP);
+
+	tcp->tcp_src = htons(sport);
+	tcp->tcp_dst = htons(dport);
+	tcp->tcp_seq = htonl(tcp_seq_num);
+	tcp->tcp_ack = htonl(action & TCP_ACK ? tcp_ack_num : 0);
+	tcp->tcp_hlen = ((TCP_HDR_SIZE + opt_len) / 4) << 4;
+	tcp->tcp_flags = action;
+	tcp->tcp_win = htons(tcp_window(action));
+	tcp->tcp_xsum = 0;
+	tcp->tcp_urg = 0;
+	/* The hardware may fill in the checksum instead */
+	if (!(IS_ENABLED(CONFIG_NET_OFFLOAD) && eth_tx_csum_offload()))
+		tcp->tcp_xsum = net_l4_checksum(net_ip, dest, IPPROTO_TCP,
+						&tcp->tcp_src, len);
+
+	return IP_TCP_HDR_SIZE + opt_len;
+}
+
+static void tcp_arm_timer(void)
+{
+	net_set_timeout_handler(tcp_ack_pending ? TCP_DELACK_MS : tcp_rto,
+				tcp_timeout_handler);
+}
+
+static void tcp_send_segment(u8 action, u32 seq, const void *data,
+			     unsigned int len)
+{
+	uchar *pkt = net_tx_packet + net_eth_hdr_size() + IP_TCP_HDR_SIZE;
+
+	if (len)
+		memcpy(pkt, data, len);
+	net_send_ip_packet(tcp_ethaddr, tcp_server_ip, tcp_server_port,
+			   tcp_our_port, len, IPPROTO_TCP, action, seq,
+			   tcp_rcv_nxt);
+
+	/* Every segment after the SYN acknowledges what we have received */
+	if (action & TCP_ACK)
+		tcp_ack_pending = 0;
+}
+
+static void tcp_send_ack(void)
+{
+	tcp_send_segment(TCP_ACK, tcp_snd_nxt, NULL, 0);
+	tcp_arm_timer();
+}
+
+/* Send the unacknowledged part of tcp_tx_buf[] */
+static void tcp_send_data(void)
+{
+	unsigned int off, len;
+
+	for (off = tcp_snd_una - tcp_tx_seq; off < tcp_tx_len; off += len) {
+		len = min(tcp_tx_len - off, tcp_snd_mss);
+		tcp_send_segment(TCP_ACK | TCP_PUSH, tcp_tx_seq + off,
+				 tcp_tx_buf + off, len);
+	}
+}
+
+static void tcp_retransmit(void)
+{
+	switch (tcp_state) {
+	case TCP_SYN_SENT:
+		tcp_send_segment(TCP_SYN, tcp_snd_una, NULL, 0);
+		break;
+	case TCP_FIN_WAIT:
+	case TCP_LAST_ACK:
+		tcp_send_data();
+		if (tcp_snd_una != tcp_snd_nxt)
+			tcp_send_segment(TCP_FIN | TCP_ACK, tcp_snd_nxt - 1,
+					 NULL, 0);
+		else
+			tcp_send_segment(TCP_ACK, tcp_snd_nxt, NULL, 0);
+		break;
+	default:
+		if (tcp_snd_una != tcp_snd_nxt)
+			tcp_send_data();
+		else
+			tcp_send_segment(TCP_ACK, tcp_snd_nxt, NULL, 0);
+		break;
+	}
+}
+
+void tcp_abort(void)
+{
+	if (tcp_state == TCP_CLOSED)
+		return;
+	if (tcp_state != TCP_SYN_SENT)
+		tcp_send_segment(TCP_RST | TCP_ACK, tcp_snd_nxt, NULL, 0);
+	tcp_state = TCP_CLOSED;
+	net_set_timeout_handler(0, NULL);
+}
+
+static void tcp_fail(int err)
+{
+	tcp_abort();
+	tcp_ops->closed(err);
+}
+
+void tcp_close(void)
+{
+	if (tcp_state == TCP_SYN_SENT) {
+		tcp_abort();
+		return;
+	}
+	if (tcp_state != TCP_ESTABLISHED)
+		return;
+
+	tcp_send_segment(TCP_FIN | TCP_ACK, tcp_snd_nxt++, NULL, 0);
+	tcp_state = TCP_FIN_WAIT;
+	tcp_arm_timer();
+}
+
+static void tcp_timeout_handler(void)
+{
+	if (tcp_ack_pending) {
+		tcp_send_ack();
+		return;
+	}
+	if (++tcp_retries > TCP_RETRIES) {
+		printf("\nTCP: connection to %pI4 timed out\n", &tcp_server_ip);
+		tcp_fail(-ETIMEDOUT);
+		return;
+	}
+	tcp_rto = min_t(uint, tcp_rto * 2, TCP_RTO_MAX_MS);
+	tcp_retransmit();
+	tcp_arm_timer();
+}
+
+void tcp_connect(struct in_addr dest, int dport, const struct tcp_ops *ops)
+{
+	srand_mac();
+	tcp_ops = ops;
+	memset(tcp_ethaddr, '\0', ARP_HLEN);
+	tcp_server_ip = dest;
+	tcp_server_port = dport;
+	tcp_our_port = 1024 + rand() % (0x10000 - 1024);
+
+	tcp_snd_una = rand();
+	tcp_snd_nxt = tcp_snd_una + 1;
+	tcp_snd_mss = 536;
+	tcp_tx_len = 0;
+	tcp_rcv_nxt = 0;
+	for (tcp_rcv_wscale = 0; TCP_RCV_WND >> tcp_rcv_wscale > 0xffff;)
+		tcp_rcv_wscale++;
+	tcp_sack_ok = false;
+	tcp_sack_count = 0;
+	tcp_ack_pending = 0;
+	tcp_rto = TCP_RTO_MS;
+	tcp_retries = 0;
+
+	tcp_state = TCP_SYN_SENT;
+	tcp_send_segment(TCP_SYN, tcp_snd_una, NULL, 0);
+	tcp_arm_timer();
+}
+
+int tcp_send(const void *data, unsigned int len)
+{
+	if (tcp_state != TCP_ESTABLISHED)
+		return -ENOTCONN;
+	if (len > sizeof(tcp_tx_buf))
+		return -EMSGSIZE;
+	if (tcp_snd_una != tcp_snd_nxt)
+		return -EBUSY;
+
+	memcpy(tcp_tx_buf, data, len);
+	tcp_tx_seq = tcp_snd_nxt;
+	tcp_tx_len = len;
+	tcp_snd_nxt += len;
+	tcp_send_data();
+	tcp_arm_timer();
+
+	return 0;
+}
+
+static void tcp_parse_options(const uchar *opt, int len)
+{
+	bool wscale_ok = false;
+
+	while (len > 0) {
+		if (opt[0] == TCP_O_END)
+			break;
+		if (opt[0] == TCP_O_NOP) {
+			opt++;
+			len--;
+			continue;
+		}
+		if (len < 2 || opt[1] < 2 || opt[1] > len)
+			break;
+		switch (opt[0]) {
+		case TCP_O_MSS:
+			if (opt[1] == 4)
+				tcp_snd_mss = clamp_t(uint,
+						      get_unaligned_be16(opt + 2),
+						      64, TCP_MSS);
+			break;
+		case TCP_O_SCL:
+			wscale_ok = opt[1] == 3;
+			break;
+		case TCP_O_SACK_OK:
+			tcp_sack_ok = true;
+			break;
+		}
+		len -= opt[1];
+		opt += opt[1];
+	}
+
+	/* Scaling is only used if both ends ask for it */
+	if (!wscale_ok)
+		tcp_rcv_wscale = 0;
+}
+
+static void tcp_rx_syn(struct ip_tcp_hdr *tcp, unsigned int hlen, u32 seq,
+		       u32 ack, u8 flags)
+{
+	if (!(flags & TCP_ACK) || ack != tcp_snd_nxt)
+		return;
+	if (flags & TCP_RST) {
+		printf("\nTCP: connection refused by %pI4\n", &tcp_server_ip);
+		tcp_state = TCP_CLOSED;
+		net_set_timeout_handler(0, NULL);
+		tcp_ops->closed(-ECONNREFUSED);
+		return;
+	}
+	if (!(flags & TCP_SYN))
+		return;
+
+	tcp_parse_options((uchar *)tcp + IP_TCP_HDR_SIZE, hlen - TCP_HDR_SIZE);
+	tcp_irs = seq;
+	tcp_rcv_nxt = seq + 1;
+	tcp_snd_una = ack;
+	tcp_state = TCP_ESTABLISHED;
+	tcp_send_ack();
+	tcp_ops->connected();
+}
+
+static void tcp_rx_ack(u32 ack)
+{
+	if (!tcp_seq_after(ack, tcp_snd_una) || tcp_seq_after(ack, tcp_snd_nxt))
+		return;
+
+	tcp_snd_una = ack;
+	if (ack == tcp_snd_nxt) {
+		tcp_tx_len = 0;
+		/* Our FIN is acknowledged, and the server's was received */
+		if (tcp_state == TCP_LAST_ACK) {
+			tcp_state = TCP_CLOSED;
+			net_set_timeout_handler(0, NULL);
+		}
+	}
+}
+
+/* Record a range received out of order, merging it with any it touches */
+static void tcp_sack_add(u32 start, u32 end)
+{
+	int i = 0;
+
+	while (i < tcp_sack_count) {
+		struct tcp_sack *sack = &tcp_sack[i];
+
+		if (tcp_seq_after(start, sack->end) ||
+		    tcp_seq_before(end, sack->start)) {
+			i++;
+			continue;
+		}
+		if (tcp_seq_before(sack->start, start))
+			start = sack->start;
+		if (tcp_seq_after(sack->end, end))
+			end = sack->end;
+		memmove(sack, sack + 1,
+			(--tcp_sack_count - i) * sizeof(*sack));
+	}
+
+	/* The oldest range is forgotten; the server sends it again */
+	if (tcp_sack_count == TCP_SACK_BLOCKS)
+		tcp_sack_count--;
+	memmove(tcp_sack + 1, tcp_sack, tcp_sack_count * sizeof(*tcp_sack));
+	tcp_sack[0].start = start;
+	tcp_sack[0].end = end;
+	tcp_sack_count++;
+}
+
+/* Move past any ranges which the last in-order segment has reached */
+static void tcp_sack_advance(void)
+{
+	int i = 0;
+
+	while (i < tcp_sack_count) {
+		struct tcp_sack *sack = &tcp_sack[i];
+
+		if (tcp_seq_after(sack->start, tcp_rcv_nxt)) {
+			i++;
+			continue;
+		}
+		if (tcp_seq_after(sack->end, tcp_rcv_nxt))
+			tcp_rcv_nxt = sack->end;
+		memmove(sack, sack + 1,
+			(--tcp_sack_count - i) * sizeof(*sack));
+		/* An earlier range may now be reached too */
+		i = 0;
+	}
+}
+
+static void tcp_rx_data(u32 seq, const uchar *data, unsigned int len,
+			bool fin)
+{
+	bool hole;
+	int ret;
+
+	/* Drop what we already have */
+	if (tcp_seq_before(seq, tcp_rcv_nxt)) {
+		u32 skip = tcp_rcv_nxt - seq;
+
+		if (skip > len || (skip == len && !fin)) {
+			tcp_send_ack();
+			return;
+		}
+		seq += skip;
+		data += skip;
+		len -= skip;
+	}
+
+	/* ...and anything beyond the window, or after the server's FIN */
+	if (seq - tcp_rcv_nxt + len > TCP_RCV_WND ||
+	    (tcp_state != TCP_ESTABLISHED && tcp_state != TCP_FIN_WAIT)) {
+		tcp_send_ack();
+		return;
+	}
+
+	if (len) {
+		ret = tcp_ops->rx(seq - tcp_irs - 1, data, len);
+		if (ret == -EAGAIN && seq != tcp_rcv_nxt) {
+			tcp_send_ack();
+			return;
+		}
+		if (ret) {
+			tcp_fail(ret);
+			return;
+		}
+	}
+
+	if (seq != tcp_rcv_nxt) {
+		/* Ask for the hole straight away, with a duplicate ACK */
+		if (len)
+			tcp_sack_add(seq, seq + len);
+		tcp_send_ack();
+		return;
+	}
+
+	hole = tcp_sack_count;
+	tcp_rcv_nxt += len;
+	tcp_sack_advance();
+
+	if (fin) {
+		tcp_rcv_nxt++;
+		if (tcp_state == TCP_FIN_WAIT) {
+			tcp_send_segment(TCP_ACK, tcp_snd_nxt, NULL, 0);
+			tcp_state = TCP_CLOSED;
+			net_set_timeout_handler(0, NULL);
+			return;
+		}
+		tcp_send_segment(TCP_FIN | TCP_ACK, tcp_snd_nxt++, NULL, 0);
+		tcp_state = TCP_LAST_ACK;
+		tcp_arm_timer();
+		tcp_ops->closed(0);
+		return;
+	}
+
+	if (hole || ++tcp_ack_pending >= TCP_ACK_SEGS)
+		tcp_send_ack();
+	else if (tcp_ack_pending == 1)
+		tcp_arm_timer();
+}
+
+void tcp_receive(struct ip_tcp_hdr *tcp, unsigned int len)
+{
+	struct in_addr src = net_read_ip(&tcp->ip_src);
+	enum tcp_state state;
+	unsigned int hlen;
+	u32 seq, ack;
+	u8 flags;
+
+	if (tcp_state == TCP_CLOSED || len < IP_TCP_HDR_SIZE)
+		return;
+	hlen = (tcp->tcp_hlen >> 4) * 4;
+	if (hlen < TCP_HDR_SIZE || IP_HDR_SIZE + hlen > len)
+		return;
+	if (src.s_addr != tcp_server_ip.s_addr ||
+	    ntohs(tcp->tcp_src) != tcp_server_port ||
+	    ntohs(tcp->tcp_dst) != tcp_our_port)
+		return;
+	if (!(IS_ENABLED(CONFIG_NET_OFFLOAD) && eth_rx_csum_ok()) &&
+	    net_l4_checksum(src, net_read_ip(&tcp->ip_dst), IPPROTO_TCP,
+			    &tcp->tcp_src, len - IP_HDR_SIZE)) {
+		debug("TCP: bad checksum\n");
+		return;
+	}
+
+	seq = ntohl(tcp->tcp_seq);
+	ack = ntohl(tcp->tcp_ack);
+	flags = tcp->tcp_flags;
+	tcp_retries = 0;
+	tcp_rto = TCP_RTO_MS;
+
+	if (tcp_state == TCP_SYN_SENT) {
+		tcp_rx_syn(tcp, hlen, seq, ack, flags);
+		return;
+	}
+
+	if (flags & TCP_RST) {
+		/* Only believe a reset which is in the window */
+		if (seq - tcp_rcv_nxt >= TCP_RCV_WND)
+			return;
+		state = tcp_state;
+		tcp_state = TCP_CLOSED;
+		net_set_timeout_handler(0, NULL);
+		if (state == TCP_ESTABLISHED) {
+			printf("\nTCP: connection reset by %pI4\n",
+			       &tcp_server_ip);
+			tcp_ops->closed(-ECONNRESET);
+		}
+		return;
+	}
+
+	/* Our ACK of the server's SYN was lost */
+	if (flags & TCP_SYN) {
+		tcp_send_ack();
+		return;
+	}
+	if (!(flags & TCP_ACK))
+		return;
+
+	tcp_rx_ack(ack);
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	len -= IP_HDR_SIZE + hlen;
+	if (len || (flags & TCP_FIN))
+		tcp_rx_data(seq, (uchar *)tcp + IP_HDR_SIZE + hlen, len,
+			    flags & TCP_FIN);
+}
@@ -15,8 +15,8 @@
 #include <mapmem.h>
 #include <net.h>
 #include <asm/global_data.h>
+#include <net/bootp.h>
 #include <net/tftp.h>
-#include "bootp.h"
 #ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
 #include <flash.h>
 #endif
@@ -158,6 +158,34 @@ static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = CONFIG_TFTP_BLOCKSIZE;
 static unsigned short tftp_window_size_option = TFTP_WINDOWSIZE;
 
+#ifdef CONFIG_NET_RX_HINT
+/* Ask for the data from @offset on to be received straight into place */
+static void tftp_rx_hint(ulong offset)
+{
+	static const uchar match[] = { 0, TFTP_DATA };
+	struct eth_rx_hint hint;
+
+	if (offset >= tftp_tsize) {
+		eth_rx_hint(NULL);
+		return;
+	}
+
+	/* No slot may reach past the end of the file */
+	hint.size = tftp_tsize - offset;
+#ifdef CONFIG_LMB
+	if (tftp_load_size)
+		hint.size = min(hint.size, tftp_load_size - offset);
+#endif
+	hint.buf = map_sysmem(tftp_load_addr + offset, hint.size);
+	hint.stride = tftp_block_size;
+	hint.hdr_len = ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + 4;
+	hint.port = tftp_our_port;
+	hint.match = match;
+	hint.match_len = sizeof(match);
+	eth_rx_hint(&hint);
+}
+#endif
+
 static inline int store_block(int block, uchar *src, unsigned int len)
 {
 	ulong offset = block * tftp_block_size + tftp_block_wrap_offset -
@@ -202,7 +230,15 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 		}
 #endif
 		ptr = map_sysmem(store_addr, len);
+#ifdef CONFIG_NET_RX_HINT
+		/* The block may already be in place, or in a later slot */
+		if (eth_rx_payload() != ptr)
+			memmove(ptr, eth_rx_payload() ?: src, len);
+		if (tftp_tsize)
+			tftp_rx_hint(newsize);
+#else
 		memcpy(ptr, src, len);
+#endif
 		unmap_sysmem(ptr);
 	}
 
@@ -739,7 +775,8 @@ static int tftp_init_load_addr(void)
 	return 0;
 }
 
-void tftp_start(enum proto_t protocol)
+/* Read the TFTP settings which the user may give in the environment */
+static void tftp_get_env_options(void)
 {
 #if CONFIG_NET_TFTP_VARS
 	char *ep;             /* Environment pointer */
@@ -780,6 +817,15 @@ void tftp_start(enum proto_t protocol)
 
 	debug("TFTP blocksize = %i, TFTP windowsize = %d timeout = %ld ms\n",
 	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
+}
+
+void tftp_start(enum proto_t protocol)
+{
+#ifdef CONFIG_TFTP_PORT
+	char *ep;             /* Environment pointer */
+#endif
+
+	tftp_get_env_options();
 
 	tftp_remote_ip = net_server_ip;
 	if (!net_parse_bootfile(&tftp_remote_ip, tftp_filename, MAX_LEN)) {
@@ -874,6 +920,9 @@ void tftp_start(enum proto_t protocol)
 	tftp_cur_block = 0;
 	tftp_windowsize = 1;
 	tftp_last_nack = 0;
+#ifdef CONFIG_NET_RX_HINT
+	eth_rx_hint(NULL);
+#endif
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
 	/* Revert tftp_block_size to dflt */
@@ -925,3 +974,354 @@ void tftp_start_server(void)
 	memset(net_server_ethaddr, 0, 6);
 }
 #endif /* CONFIG_CMD_TFTPSRV */
+
+#ifdef CONFIG_TFTP_MULTI
+/* Period of the timer which checks each transfer for a timeout */
+#define TFTP_MULTI_TICK_MS	100
+/* Show a hash mark for this many bytes received, over all the files */
+#define TFTP_MULTI_HASH_BYTES	(64 * 1024)
+
+/**
+ * struct tftp_xfer - one of the transfers run by tftp_get_files()
+ *
+ * @file: file being fetched
+ * @our_port: UDP port at our end, which tells the transfers apart
+ * @remote_port: UDP port at the server's end
+ * @block_size: block size in use
+ * @block: number of the last block received, 0 if none
+ * @wrap_offset: offset added to blocks once the block number has wrapped
+ * @load_size: number of bytes which may be written from the file's address
+ * @sent_time: time at which we last sent a packet for this transfer
+ * @timeouts: number of timeouts since the server last sent anything
+ * @started: true once the read request has been sent
+ * @connected: true once the server has answered the read request
+ * @done: true once the transfer has finished, whether it worked or not
+ */
+struct tftp_xfer {
+	struct tftp_file *file;
+	int our_port;
+	int remote_port;
+	ushort block_size;
+	ushort block;
+	ulong wrap_offset;
+	ulong load_size;
+	ulong sent_time;
+	int timeouts;
+	bool started;
+	bool connected;
+	bool done;
+};
+
+static struct tftp_file *tftp_multi_files;
+static struct tftp_xfer tftp_xfers[TFTP_MULTI_MAX];
+static int tftp_xfer_count;
+/* MAC address to send to, filled in by ARP on the first request */
+static uchar tftp_multi_ethaddr[ARP_HLEN];
+static ulong tftp_multi_bytes;
+
+static void tftp_multi_send(struct tftp_xfer *x)
+{
+	uchar *pkt, *xp;
+	__be16 *s;
+
+	pkt = net_tx_packet + net_eth_hdr_size() + IP_UDP_HDR_SIZE;
+	xp = pkt;
+	s = (__be16 *)pkt;
+	if (!x->connected) {
+		*s++ = htons(TFTP_RRQ);
+		pkt = (uchar *)s;
+		pkt += sprintf((char *)pkt, "%s%coctet%ctsize%c0%cblksize%c%d%c",
+			       x->file->name, 0, 0, 0, 0, 0,
+			       tftp_block_size_option, 0);
+	} else {
+		*s++ = htons(TFTP_ACK);
+		*s++ = htons(x->block);
+		pkt = (uchar *)s;
+	}
+
+	x->started = true;
+	x->sent_time = get_timer(0);
+	net_send_udp_packet(tftp_multi_ethaddr, net_server_ip, x->remote_port,
+			    x->our_port, pkt - xp);
+}
+
+/* Send the read requests which were waiting for the server's MAC address */
+static void tftp_multi_kick(void)
+{
+	bool waiting = false;
+	struct tftp_xfer *x;
+
+	for (x = tftp_xfers; x < tftp_xfers + tftp_xfer_count; x++)
+		waiting |= x->started;
+	for (x = tftp_xfers; x < tftp_xfers + tftp_xfer_count; x++) {
+		if (x->started || x->done)
+			continue;
+		/* Only one request goes out until ARP has found the server */
+		if (waiting &&
+		    !memcmp(tftp_multi_ethaddr, net_null_ethaddr, ARP_HLEN))
+			break;
+		tftp_multi_send(x);
+		waiting = true;
+	}
+}
+
+static void tftp_multi_finish(struct tftp_xfer *x, int err)
+{
+	struct tftp_xfer *y;
+
+	x->done = true;
+	x->file->err = err;
+	if (!err) {
+		printf("\n%s: ", x->file->name);
+		print_size(x->file->size, "");
+	}
+
+	for (y = tftp_xfers; y < tftp_xfers + tftp_xfer_count; y++)
+		if (!y->done)
+			return;
+
+	puts("\ndone\n");
+	net_set_timeout_handler(0, NULL);
+	net_boot_file_size = 0;
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+/* Check the options which the server accepted */
+static int tftp_multi_oack(struct tftp_xfer *x, char *opt, int len)
+{
+	int i;
+
+	for (i = 0; i + 8 < len; i++) {
+		if (!strcasecmp(opt + i, "blksize")) {
+			x->block_size = dectoul(opt + i + 8, NULL);
+			if (!x->block_size ||
+			    x->block_size > tftp_block_size_option) {
+				printf("\nInvalid blk size(=%d)\n",
+				       x->block_size);
+				return -EPROTO;
+			}
+		}
+		if (!strcasecmp(opt + i, "tsize") &&
+		    dectoul(opt + i + 6, NULL) > x->load_size) {
+			printf("\n%s: too large for its space\n",
+			       x->file->name);
+			return -EFBIG;
+		}
+	}
+
+	return 0;
+}
+
+static void tftp_multi_data(struct tftp_xfer *x, ushort block, uchar *data,
+			    unsigned int len)
+{
+	ulong offset;
+	void *ptr;
+
+	if (block != (ushort)(x->block + 1)) {
+		/* Our last acknowledgement may have been lost */
+		if (block == x->block)
+			tftp_multi_send(x);
+		return;
+	}
+	if (!block)
+		x->wrap_offset += x->block_size * TFTP_SEQUENCE_SIZE;
+	x->block = block;
+
+	offset = (ulong)block * x->block_size + x->wrap_offset - x->block_size;
+	if (offset + len > x->load_size) {
+		printf("\n%s: too large for its space\n", x->file->name);
+		tftp_multi_finish(x, -EFBIG);
+		return;
+	}
+	ptr = map_sysmem(x->file->addr + offset, len);
+	memcpy(ptr, data, len);
+	unmap_sysmem(ptr);
+	x->file->size = offset + len;
+
+	if ((tftp_multi_bytes + len) / TFTP_MULTI_HASH_BYTES !=
+	    tftp_multi_bytes / TFTP_MULTI_HASH_BYTES)
+		putc('#');
+	tftp_multi_bytes += len;
+
+	tftp_multi_send(x);
+	if (len < x->block_size)
+		tftp_multi_finish(x, 0);
+}
+
+static void tftp_multi_handler(uchar *pkt, unsigned dest, struct in_addr sip,
+			       unsigned src, unsigned len)
+{
+	struct tftp_xfer *x;
+	__be16 *s = (__be16 *)pkt;
+	int ret;
+
+	for (x = tftp_xfers; x < tftp_xfers + tftp_xfer_count; x++)
+		if (x->our_port == dest)
+			break;
+	if (x == tftp_xfers + tftp_xfer_count || x->done || len < 4)
+		return;
+	if (x->connected && src != x->remote_port)
+		return;
+	x->timeouts = 0;
+
+	switch (ntohs(s[0])) {
+	case TFTP_OACK:
+		/* The server sends it again if our ACK of it is lost */
+		if (x->block)
+			break;
+		x->remote_port = src;
+		ret = tftp_multi_oack(x, (char *)pkt + 2, len - 2);
+		if (ret) {
+			tftp_multi_finish(x, ret);
+			break;
+		}
+		x->connected = true;
+		tftp_multi_send(x);
+		break;
+	case TFTP_DATA:
+		if (!x->connected) {
+			/* The server did not acknowledge any options */
+			x->remote_port = src;
+			x->block_size = TFTP_BLOCK_SIZE;
+			x->connected = true;
+		}
+		tftp_multi_data(x, ntohs(s[1]), pkt + 4, len - 4);
+		break;
+	case TFTP_ERROR:
+		printf("\n%s: TFTP error: '%s' (%d)\n", x->file->name,
+		       pkt + 4, ntohs(s[1]));
+		switch (ntohs(s[1])) {
+		case TFTP_ERR_FILE_NOT_FOUND:
+			ret = -ENOENT;
+			break;
+		case TFTP_ERR_ACCESS_DENIED:
+			ret = -EACCES;
+			break;
+		default:
+			ret = -EIO;
+			break;
+		}
+		tftp_multi_finish(x, ret);
+		break;
+	}
+
+	tftp_multi_kick();
+}
+
+static void tftp_multi_timeout_handler(void)
+{
+	struct tftp_xfer *x;
+
+	for (x = tftp_xfers; x < tftp_xfers + tftp_xfer_count; x++) {
+		if (!x->started || x->done ||
+		    get_timer(x->sent_time) < timeout_ms)
+			continue;
+		if (++x->timeouts > timeout_count_max) {
+			printf("\n%s: retry count exceeded\n", x->file->name);
+			tftp_multi_finish(x, -ETIMEDOUT);
+			continue;
+		}
+		puts("T ");
+		tftp_multi_send(x);
+	}
+
+	if (net_state != NETLOOP_CONTINUE)
+		return;
+	tftp_multi_kick();
+	net_set_timeout_handler(TFTP_MULTI_TICK_MS, tftp_multi_timeout_handler);
+}
+
+/* Work out how much may be written at each file's address */
+static void tftp_multi_init_load_sizes(void)
+{
+	struct tftp_xfer *x, *y;
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+#endif
+	for (x = tftp_xfers; x < tftp_xfers + tftp_xfer_count; x++) {
+#ifdef CONFIG_LMB
+		x->load_size = lmb_get_free_size(&lmb, x->file->addr);
+#else
+		x->load_size = ULONG_MAX - x->file->addr;
+#endif
+		/* The files are written at once, so must not run into each other */
+		for (y = tftp_xfers; y < tftp_xfers + tftp_xfer_count; y++)
+			if (y->file->addr > x->file->addr)
+				x->load_size = min(x->load_size,
+						   y->file->addr - x->file->addr);
+	}
+}
+
+void tftp_multi_start(void)
+{
+	struct tftp_xfer *x;
+	int port;
+	int i;
+
+	tftp_get_env_options();
+
+	printf("Using %s device\n", eth_get_name());
+	printf("TFTP from server %pI4; our IP address is %pI4\n",
+	       &net_server_ip, &net_ip);
+
+	port = 1024 + (get_timer(0) % 3072);
+	for (i = 0; i < tftp_xfer_count; i++) {
+		x = &tftp_xfers[i];
+		memset(x, '\0', sizeof(*x));
+		x->file = &tftp_multi_files[i];
+		x->file->size = 0;
+		x->file->err = -EINPROGRESS;
+		x->our_port = port + i;
+		x->remote_port = WELL_KNOWN_PORT;
+		x->block_size = TFTP_BLOCK_SIZE;
+		printf("Filename '%s' to 0x%lx\n", x->file->name, x->file->addr);
+	}
+	tftp_multi_init_load_sizes();
+	puts("Loading: *\b");
+
+	timeout_count_max = tftp_timeout_count_max;
+	tftp_multi_bytes = 0;
+	memset(tftp_multi_ethaddr, '\0', ARP_HLEN);
+	net_set_udp_handler(tftp_multi_handler);
+	net_set_timeout_handler(TFTP_MULTI_TICK_MS, tftp_multi_timeout_handler);
+#ifdef CONFIG_NET_RX_HINT
+	eth_rx_hint(NULL);
+#endif
+
+	for (x = tftp_xfers; x < tftp_xfers + tftp_xfer_count; x++) {
+		if (!x->load_size) {
+			printf("\n%s: trying to overwrite reserved memory\n",
+			       x->file->name);
+			tftp_multi_finish(x, -ENOSPC);
+		}
+	}
+	tftp_multi_kick();
+}
+
+int tftp_get_files(struct tftp_file *files, int count)
+{
+	int loaded = 0;
+	int ret;
+	int i;
+
+	if (count > TFTP_MULTI_MAX)
+		return -E2BIG;
+	if (!count)
+		return 0;
+
+	tftp_multi_files = files;
+	tftp_xfer_count = count;
+	ret = net_loop(TFTPMULTI);
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < count; i++)
+		if (!files[i].err)
+			loaded++;
+
+	return loaded;
+}
+#endif /* CONFIG_TFTP_MULTI */
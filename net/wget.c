@@ -0,0 +1,288 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * HTTP/1.1 download over TCP
+ *
+ * The file is fetched with a single GET request, on a connection which the
+ * server closes once it has sent everything. Each segment of the body is
+ * copied straight to its place at the load address as it arrives, whether in
+ * order or not, so there is no reassembly buffer and no second copy.
+ */
+
+#include <common.h>
+#include <display_options.h>
+#include <efi_loader.h>
+#include <env.h>
+#include <image.h>
+#include <lmb.h>
+#include <mapmem.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <net/wget.h>
+#include <asm/global_data.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Largest response header accepted */
+#define WGET_HDR_MAX		2048
+/* Without a Content-Length, show a hash mark for this many bytes */
+#define WGET_HASH_BYTES		(64 * 1024)
+#define HASHES_PER_LINE		65
+
+static struct in_addr wget_server_ip;
+static char wget_path[1024];
+static char wget_hdr[WGET_HDR_MAX + 1];
+static unsigned int wget_hdr_len;
+static bool wget_hdr_done;
+static u32 wget_body_start;	/* stream offset of the body */
+static ulong wget_content_len;	/* ULONG_MAX if not given */
+static ulong wget_load_addr;
+static ulong wget_load_size;
+static ulong wget_start_time;
+static int wget_hashes;
+
+static void wget_show_progress(void)
+{
+	ulong pos = net_boot_file_size;
+
+	if (wget_content_len != ULONG_MAX) {
+		while (wget_hashes < (u64)pos * 50 / wget_content_len) {
+			putc('#');
+			wget_hashes++;
+		}
+		return;
+	}
+
+	while (wget_hashes < pos / WGET_HASH_BYTES) {
+		putc('#');
+		if (++wget_hashes % HASHES_PER_LINE == 0)
+			puts("\n\t ");
+	}
+}
+
+static int wget_store(ulong offset, const uchar *data, unsigned int len)
+{
+	void *ptr;
+
+	if (offset + len > wget_content_len) {
+		puts("\nwget: server sent more than the Content-Length\n");
+		return -EFBIG;
+	}
+	if (wget_load_size && offset + len > wget_load_size) {
+		puts("\nwget error: trying to overwrite reserved memory...\n");
+		return -ENOSPC;
+	}
+
+	ptr = map_sysmem(wget_load_addr + offset, len);
+	memcpy(ptr, data, len);
+	unmap_sysmem(ptr);
+
+	if (net_boot_file_size < offset + len) {
+		net_boot_file_size = offset + len;
+		wget_show_progress();
+	}
+
+	return 0;
+}
+
+/* Check the status and pick out the headers that matter */
+static int wget_parse_header(void)
+{
+	char *line, *next;
+	int status;
+
+	if (strncmp(wget_hdr, "HTTP/1.", 7) || wget_hdr[8] != ' ') {
+		puts("\nwget: bad response from server\n");
+		return -EPROTO;
+	}
+	status = dectoul(wget_hdr + 9, NULL);
+	if (status != 200) {
+		next = strstr(wget_hdr, "\r\n");
+		*next = '\0';
+		printf("\nwget: server replied '%s'\n", wget_hdr + 9);
+		return -ENOENT;
+	}
+
+	for (line = strstr(wget_hdr, "\r\n") + 2;
+	     line < wget_hdr + wget_body_start - 2; line = next + 2) {
+		next = strstr(line, "\r\n");
+		*next = '\0';
+		if (!strncasecmp(line, "Content-Length:", 15)) {
+			wget_content_len = dectoul(line + 15, NULL);
+		} else if (!strncasecmp(line, "Transfer-Encoding:", 18)) {
+			/* We cannot undo chunking or compression */
+			printf("\nwget: unsupported '%s'\n", line);
+			return -EPROTONOSUPPORT;
+		}
+	}
+
+	return 0;
+}
+
+static int wget_rx(u32 offset, const uchar *data, unsigned int len)
+{
+	unsigned int n, skip;
+	char *end;
+	int ret;
+
+	if (wget_hdr_done)
+		return wget_store(offset - wget_body_start, data, len);
+
+	/* The header is collected in order; the server resends the rest */
+	if (offset != wget_hdr_len)
+		return -EAGAIN;
+
+	n = min(len, WGET_HDR_MAX - wget_hdr_len);
+	memcpy(wget_hdr + wget_hdr_len, data, n);
+	wget_hdr_len += n;
+	wget_hdr[wget_hdr_len] = '\0';
+
+	end = strstr(wget_hdr, "\r\n\r\n");
+	if (!end) {
+		if (wget_hdr_len == WGET_HDR_MAX) {
+			puts("\nwget: response header too long\n");
+			return -E2BIG;
+		}
+		return 0;
+	}
+	wget_body_start = end + 4 - wget_hdr;
+	wget_hdr_done = true;
+	ret = wget_parse_header();
+	if (ret)
+		return ret;
+
+	/* The rest of the segment is the start of the body */
+	skip = wget_body_start - offset;
+	if (skip >= len)
+		return 0;
+
+	return wget_store(0, data + skip, len - skip);
+}
+
+static void wget_connected(void)
+{
+	char req[TCP_MSS];
+	int len, ret;
+
+	len = snprintf(req, sizeof(req),
+		       "GET %s%s HTTP/1.1\r\n"
+		       "Host: %pI4\r\n"
+		       "User-Agent: U-Boot\r\n"
+		       "Connection: close\r\n"
+		       "\r\n",
+		       *wget_path == '/' ? "" : "/", wget_path,
+		       &wget_server_ip);
+	ret = len < sizeof(req) ? tcp_send(req, len) : -EMSGSIZE;
+	if (ret) {
+		printf("\nwget: cannot send request (err=%d)\n", ret);
+		tcp_abort();
+		net_set_state(NETLOOP_FAIL);
+	}
+}
+
+static void wget_closed(int err)
+{
+	ulong time;
+
+	if (err) {
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	if (!wget_hdr_done) {
+		puts("\nwget: connection closed without a response\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	if (wget_content_len != ULONG_MAX &&
+	    net_boot_file_size != wget_content_len) {
+		printf("\nwget: only received %u of %lu bytes\n",
+		       net_boot_file_size, wget_content_len);
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+
+	/* An empty file would look like a failure to net_loop() */
+	if (!net_boot_file_size) {
+		puts("\nwget: file is empty\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+
+	time = get_timer(wget_start_time);
+	if (time > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size((u64)net_boot_file_size * 1000 / time, "/s");
+	}
+	puts("\ndone\n");
+	if (IS_ENABLED(CONFIG_CMD_BOOTEFI))
+		efi_set_bootdev("Net", "", wget_path,
+				map_sysmem(wget_load_addr, 0),
+				net_boot_file_size);
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+static const struct tcp_ops wget_ops = {
+	.connected	= wget_connected,
+	.rx		= wget_rx,
+	.closed		= wget_closed,
+};
+
+/* Initialize wget_load_addr and wget_load_size from image_load_addr and lmb */
+static int wget_init_load_addr(void)
+{
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+	phys_size_t max_size;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+
+	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	if (!max_size)
+		return -1;
+
+	wget_load_size = max_size;
+#endif
+	wget_load_addr = image_load_addr;
+	return 0;
+}
+
+void wget_start(void)
+{
+	wget_server_ip = net_server_ip;
+	if (!net_parse_bootfile(&wget_server_ip, wget_path,
+				sizeof(wget_path))) {
+		puts("wget: no file name given\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+
+	printf("Using %s device\n", eth_get_name());
+	printf("HTTP from server %pI4; our IP address is %pI4",
+	       &wget_server_ip, &net_ip);
+	if (net_gateway.s_addr && net_netmask.s_addr) {
+		struct in_addr our_net;
+		struct in_addr server_net;
+
+		our_net.s_addr = net_ip.s_addr & net_netmask.s_addr;
+		server_net.s_addr = wget_server_ip.s_addr & net_netmask.s_addr;
+		if (our_net.s_addr != server_net.s_addr)
+			printf("; sending through gateway %pI4",
+			       &net_gateway);
+	}
+	printf("\nFilename '%s'.", wget_path);
+
+	wget_load_size = 0;
+	if (wget_init_load_addr()) {
+		puts("\nwget error: trying to overwrite reserved memory...\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	printf("\nLoad address: 0x%lx\nLoading: *\b", wget_load_addr);
+
+	wget_hdr_len = 0;
+	wget_hdr_done = false;
+	wget_content_len = ULONG_MAX;
+	wget_hashes = 0;
+	wget_start_time = get_timer(0);
+
+	tcp_connect(wget_server_ip, WGET_HTTP_PORT, &wget_ops);
+}
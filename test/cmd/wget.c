@@ -0,0 +1,240 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test for the wget command
+ *
+ * The sandbox Ethernet driver stands in for a web server: each packet which
+ * U-Boot sends is answered by a few segments of the response, one pair of
+ * which is swapped so that the download has to recover from a hole.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <dm.h>
+#include <env.h>
+#include <mapmem.h>
+#include <net.h>
+#include <net/tcp.h>
+#include <net/wget.h>
+#include <asm/eth.h>
+#include <dm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define SB_WGET_ADDR		0x1000000
+#define SB_WGET_BODY_SIZE	10000
+/* Bytes of the response in each segment */
+#define SB_WGET_SEG		1000
+/* Segments sent for each packet received */
+#define SB_WGET_BURST		2
+/* This segment is sent after the one following it */
+#define SB_WGET_SWAP_SEG	2
+#define SB_WGET_ISS		0x10000000
+
+/**
+ * struct sb_wget_priv - state of the fake web server
+ *
+ * @resp: response, header and body
+ * @resp_len: number of bytes in @resp
+ * @client_port: port which U-Boot connected from
+ * @client_nxt: next sequence number expected from U-Boot
+ * @snd_nxt: offset in @resp of the next byte to send
+ * @fin_sent: true once all of @resp and a FIN have been sent
+ * @sack_seen: true if U-Boot reported a SACK block
+ * @requested: true once U-Boot has sent its request
+ * @request_ok: true if the request was the expected one
+ */
+struct sb_wget_priv {
+	char resp[SB_WGET_BODY_SIZE + 100];
+	int resp_len;
+	int client_port;
+	u32 client_nxt;
+	int snd_nxt;
+	bool fin_sent;
+	bool sack_seen;
+	bool requested;
+	bool request_ok;
+};
+
+static u8 sb_wget_byte(int i)
+{
+	return i * 7 + (i >> 8);
+}
+
+static int sb_wget_send(struct udevice *dev, struct ethernet_hdr *req,
+			u8 flags, int offset, const void *data, int len,
+			const uchar *opt, int opt_len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_wget_priv *sb = priv->priv;
+	struct ethernet_hdr *eth;
+	struct ip_tcp_hdr *tcp;
+	int tcp_len = TCP_HDR_SIZE + opt_len + len;
+
+	if (priv->recv_packets >= PKTBUFSRX)
+		return -EOVERFLOW;
+
+	eth = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth->et_dest, req->et_src, ARP_HLEN);
+	memcpy(eth->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+
+	tcp = (void *)eth + ETHER_HDR_SIZE;
+	memcpy((uchar *)tcp + IP_TCP_HDR_SIZE, opt, opt_len);
+	memcpy((uchar *)tcp + IP_TCP_HDR_SIZE + opt_len, data, len);
+	net_set_ip_header((uchar *)tcp, net_ip, priv->fake_host_ipaddr,
+			  IP_HDR_SIZE + tcp_len, IPPROTO_TCP);
+	tcp->tcp_src = htons(WGET_HTTP_PORT);
+	tcp->tcp_dst = htons(sb->client_port);
+	tcp->tcp_seq = htonl(SB_WGET_ISS + (flags & TCP_SYN ? 0 : 1 + offset));
+	tcp->tcp_ack = htonl(sb->client_nxt);
+	tcp->tcp_hlen = ((TCP_HDR_SIZE + opt_len) / 4) << 4;
+	tcp->tcp_flags = flags;
+	tcp->tcp_win = htons(0xffff);
+	tcp->tcp_xsum = 0;
+	tcp->tcp_urg = 0;
+
+	tcp->tcp_xsum = net_l4_checksum(priv->fake_host_ipaddr, net_ip,
+					IPPROTO_TCP, &tcp->tcp_src, tcp_len);
+
+	priv->recv_packet_length[priv->recv_packets] = ETHER_HDR_SIZE +
+		IP_HDR_SIZE + tcp_len;
+	++priv->recv_packets;
+
+	return 0;
+}
+
+static int sb_wget_send_seg(struct udevice *dev, struct ethernet_hdr *req,
+			    int seg)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_wget_priv *sb = priv->priv;
+	int offset = seg * SB_WGET_SEG;
+
+	return sb_wget_send(dev, req, TCP_ACK, offset, sb->resp + offset,
+			    min(SB_WGET_SEG, sb->resp_len - offset), NULL, 0);
+}
+
+/* Send the next few segments of the response */
+static void sb_wget_send_resp(struct udevice *dev, struct ethernet_hdr *req)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_wget_priv *sb = priv->priv;
+	int i, seg;
+
+	for (i = 0; i < SB_WGET_BURST && sb->snd_nxt < sb->resp_len; i++) {
+		seg = sb->snd_nxt / SB_WGET_SEG;
+		if (seg == SB_WGET_SWAP_SEG) {
+			if (priv->recv_packets + 2 > PKTBUFSRX)
+				return;
+			sb_wget_send_seg(dev, req, seg + 1);
+			sb_wget_send_seg(dev, req, seg);
+			sb->snd_nxt += 2 * SB_WGET_SEG;
+			continue;
+		}
+		if (sb_wget_send_seg(dev, req, seg))
+			return;
+		sb->snd_nxt = min(sb->snd_nxt + SB_WGET_SEG, sb->resp_len);
+	}
+
+	if (sb->snd_nxt == sb->resp_len && !sb->fin_sent &&
+	    !sb_wget_send(dev, req, TCP_FIN | TCP_ACK, sb->resp_len, NULL, 0,
+			  NULL, 0))
+		sb->fin_sent = true;
+}
+
+static int sb_wget_handler(struct udevice *dev, void *packet,
+			   unsigned int len)
+{
+	static const uchar syn_opt[] = {
+		TCP_O_MSS, 4, TCP_MSS >> 8, TCP_MSS & 0xff,
+		TCP_O_NOP, TCP_O_SCL, 3, 0,
+		TCP_O_NOP, TCP_O_NOP, TCP_O_SACK_OK, 2,
+	};
+	static const char request[] = "GET /test.bin HTTP/1.1\r\n";
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_wget_priv *sb = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *tcp = packet + ETHER_HDR_SIZE;
+	uchar *opt, *data;
+	int hlen, data_len;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+	if (ntohs(eth->et_protlen) != PROT_IP || tcp->ip_p != IPPROTO_TCP)
+		return 0;
+
+	hlen = (tcp->tcp_hlen >> 4) * 4;
+	opt = (uchar *)tcp + IP_TCP_HDR_SIZE;
+	data = (uchar *)tcp + IP_HDR_SIZE + hlen;
+	data_len = ntohs(tcp->ip_len) - IP_HDR_SIZE - hlen;
+
+	if (tcp->tcp_flags & TCP_SYN) {
+		sb->client_port = ntohs(tcp->tcp_dst) == WGET_HTTP_PORT ?
+			ntohs(tcp->tcp_src) : 0;
+		sb->client_nxt = ntohl(tcp->tcp_seq) + 1;
+		sb_wget_send(dev, eth, TCP_SYN | TCP_ACK, 0, NULL, 0, syn_opt,
+			     sizeof(syn_opt));
+		return 0;
+	}
+
+	/* A SACK block follows two NOPs */
+	if (hlen > TCP_HDR_SIZE + 2 && opt[2] == TCP_O_SACK)
+		sb->sack_seen = true;
+
+	if (data_len) {
+		sb->requested = true;
+		sb->request_ok = !strncmp((char *)data, request,
+					  strlen(request));
+		sb->client_nxt += data_len;
+	}
+	if (tcp->tcp_flags & TCP_FIN) {
+		sb->client_nxt++;
+		return 0;
+	}
+	if (sb->requested)
+		sb_wget_send_resp(dev, eth);
+
+	return 0;
+}
+
+/* Download a file, with one segment arriving out of order */
+static int dm_test_cmd_wget(struct unit_test_state *uts)
+{
+	struct sb_wget_priv sb;
+	u8 *buf;
+	int i;
+
+	memset(&sb, '\0', sizeof(sb));
+	sb.resp_len = sprintf(sb.resp,
+			      "HTTP/1.1 200 OK\r\n"
+			      "Content-Length: %d\r\n"
+			      "\r\n", SB_WGET_BODY_SIZE);
+	for (i = 0; i < SB_WGET_BODY_SIZE; i++)
+		sb.resp[sb.resp_len + i] = sb_wget_byte(i);
+	sb.resp_len += SB_WGET_BODY_SIZE;
+
+	buf = map_sysmem(SB_WGET_ADDR, SB_WGET_BODY_SIZE);
+	memset(buf, '\0', SB_WGET_BODY_SIZE);
+
+	sandbox_eth_set_tx_handler(0, sb_wget_handler);
+	sandbox_eth_set_priv(0, &sb);
+	env_set("ethact", "eth@10002000");
+	env_set("serverip", "1.1.2.2");
+
+	ut_assertok(run_command("wget 1000000 /test.bin", 0));
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	sandbox_eth_set_priv(0, NULL);
+
+	ut_assert(sb.request_ok);
+	ut_assert(sb.sack_seen);
+	ut_assert(sb.fin_sent);
+	ut_asserteq(SB_WGET_BODY_SIZE, env_get_hex("filesize", 0));
+	ut_asserteq(SB_WGET_ADDR, env_get_hex("fileaddr", 0));
+	for (i = 0; i < SB_WGET_BODY_SIZE; i++)
+		ut_asserteq(sb_wget_byte(i), buf[i]);
+	unmap_sysmem(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_cmd_wget, UT_TESTF_SCAN_FDT);
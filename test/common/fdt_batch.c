@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for batched device tree property updates
+ */
+
+#include <common.h>
+#include <console.h>
+#include <fdt_support.h>
+#include <fdtdec.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Size of the tree the tests work on */
+#define FDT_BATCH_TEST_SIZE	1024
+
+/* Build a tree with a few nodes, /b having phandle 1 */
+static int fdt_batch_setup(struct unit_test_state *uts, void *fdt)
+{
+	int node;
+
+	ut_assertok(fdt_create_empty_tree(fdt, FDT_BATCH_TEST_SIZE));
+	node = fdt_add_subnode(fdt, 0, "a");
+	ut_assert(node >= 0);
+	ut_assertok(fdt_setprop_string(fdt, node, "old", "abc"));
+	ut_assert(fdt_add_subnode(fdt, node, "c") >= 0);
+	node = fdt_add_subnode(fdt, 0, "b");
+	ut_assert(node >= 0);
+	ut_assertok(fdt_setprop_u32(fdt, node, "phandle", 1));
+
+	return 0;
+}
+
+/* Test that updates land on the right nodes, in order */
+static int common_test_fdt_batch(struct unit_test_state *uts)
+{
+	char fdt[FDT_BATCH_TEST_SIZE];
+	struct fdt_batch batch;
+	ulong start;
+	int len;
+
+	start = ut_check_free();
+	ut_assertok(fdt_batch_setup(uts, fdt));
+
+	fdt_batch_init(&batch, fdt);
+	ut_assertok(fdt_batch_setprop_u32(&batch, "/a/c", "val", 1, 1));
+	ut_assertok(fdt_batch_setprop_phandle(&batch, 1, "val", "xyz", 4, 1));
+	ut_assertok(fdt_batch_setprop(&batch, "/a", "old", "defgh", 6, 0));
+	ut_assertok(fdt_batch_setprop(&batch, "/a", "new", "x", 2, 0));
+	ut_assertok(fdt_batch_setprop_u32(&batch, "/a/c", "val", 2, 1));
+	ut_assertok(fdt_batch_apply(&batch));
+	fdt_batch_free(&batch);
+
+	ut_asserteq(2, fdtdec_get_int(fdt, fdt_path_offset(fdt, "/a/c"), "val",
+				      0));
+	ut_asserteq_str("xyz", fdt_getprop(fdt, fdt_path_offset(fdt, "/b"),
+					   "val", NULL));
+	ut_asserteq_str("defgh", fdt_getprop(fdt, fdt_path_offset(fdt, "/a"),
+					     "old", NULL));
+	ut_assertnull(fdt_getprop(fdt, fdt_path_offset(fdt, "/a"), "new",
+				  &len));
+	ut_asserteq(-FDT_ERR_NOTFOUND, len);
+	ut_assertok(ut_check_delta(start));
+
+	return 0;
+}
+COMMON_TEST(common_test_fdt_batch, 0);
+
+/* Test that a batch which does not fit is applied one update at a time */
+static int common_test_fdt_batch_nospace(struct unit_test_state *uts)
+{
+	char fdt[FDT_BATCH_TEST_SIZE];
+	char big[FDT_BATCH_TEST_SIZE] = { 0 };
+	struct fdt_batch batch;
+	int len;
+
+	ut_assertok(fdt_batch_setup(uts, fdt));
+
+	console_record_reset_enable();
+	fdt_batch_init(&batch, fdt);
+	ut_assertok(fdt_batch_setprop(&batch, "/a", "old", "defgh", 6, 0));
+	ut_assertok(fdt_batch_setprop(&batch, "/b", "big", big, sizeof(big),
+				      1));
+	ut_asserteq(-FDT_ERR_NOSPACE, fdt_batch_apply(&batch));
+	fdt_batch_free(&batch);
+	ut_assert_nextline("Not enough space in the device tree to batch 2 updates");
+	ut_assert_nextline("Unable to update property /b:big, err=FDT_ERR_NOSPACE");
+	ut_assert_console_end();
+
+	ut_asserteq_str("defgh", fdt_getprop(fdt, fdt_path_offset(fdt, "/a"),
+					     "old", NULL));
+	ut_assertnull(fdt_getprop(fdt, fdt_path_offset(fdt, "/b"), "big",
+				  &len));
+	ut_asserteq(-FDT_ERR_NOTFOUND, len);
+
+	return 0;
+}
+COMMON_TEST(common_test_fdt_batch_nospace, UT_TESTF_CONSOLE_REC);
+
+/* Test that a new property name is only counted once against the space */
+static int common_test_fdt_batch_names(struct unit_test_state *uts)
+{
+	char fdt[FDT_BATCH_TEST_SIZE];
+	struct fdt_batch batch;
+	int size;
+
+	ut_assertok(fdt_batch_setup(uts, fdt));
+
+	/* Leave room for three new "val" properties and one copy of the name */
+	ut_assertok(fdt_pack(fdt));
+	size = fdt_totalsize(fdt) +
+		3 * (sizeof(struct fdt_property) + sizeof(u32)) +
+		sizeof("val");
+	ut_assertok(fdt_open_into(fdt, fdt, size));
+
+	console_record_reset_enable();
+	fdt_batch_init(&batch, fdt);
+	ut_assertok(fdt_batch_setprop_u32(&batch, "/a", "val", 1, 1));
+	ut_assertok(fdt_batch_setprop_u32(&batch, "/a/c", "val", 2, 1));
+	ut_assertok(fdt_batch_setprop_u32(&batch, "/b", "val", 3, 1));
+	ut_assertok(fdt_batch_apply(&batch));
+	fdt_batch_free(&batch);
+	ut_assert_console_end();
+
+	ut_asserteq(1, fdtdec_get_int(fdt, fdt_path_offset(fdt, "/a"), "val",
+				      0));
+	ut_asserteq(2, fdtdec_get_int(fdt, fdt_path_offset(fdt, "/a/c"), "val",
+				      0));
+	ut_asserteq(3, fdtdec_get_int(fdt, fdt_path_offset(fdt, "/b"), "val",
+				      0));
+
+	return 0;
+}
+COMMON_TEST(common_test_fdt_batch_names, UT_TESTF_CONSOLE_REC);
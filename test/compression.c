@@ -4,6 +4,7 @@
  */
 
 #include <common.h>
+#include <abuf.h>
 #include <bootm.h>
 #include <command.h>
 #include <gzip.h>
@@ -11,7 +12,9 @@
 #include <log.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <time.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
 
 #include <u-boot/lz4.h>
 #include <u-boot/zlib.h>
@@ -21,7 +24,10 @@
 #include <lzma/LzmaDec.h>
 #include <lzma/LzmaTools.h>
 
+#include <linux/libfdt.h>
 #include <linux/lzo.h>
+#include <linux/sizes.h>
+#include <linux/zstd.h>
 #include <test/compression.h>
 #include <test/suites.h>
 #include <test/ut.h>
@@ -121,6 +127,29 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+/*
+ * Two frames, so that multi-frame decoding is covered:
+ * head -n 6 /tmp/plain.txt | zstd -19 > /tmp/plain.zst
+ * tail -n +7 /tmp/plain.txt | zstd -19 >> /tmp/plain.zst
+ */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x1b\x00\x8d\x04\x00\x52\x4b\x1f\x16\x90\x3b"
+	"\x63\x44\x6d\x19\xfc\xee\x7e\x13\x2d\x54\x2b\x9d\xde\x75\x45\xd7"
+	"\x4d\x2e\xba\x0b\x80\x10\xd3\x13\x5b\x5a\x70\xd1\x5a\xad\x3e\x2f"
+	"\x4c\xb9\x5e\xe2\x21\x91\xb4\x9a\x17\x3e\x55\x6e\x7a\xb2\x97\xa6"
+	"\x40\xd3\x13\xb6\x84\x2b\xc4\x61\xe7\xf1\x06\x2d\x59\x8e\x7b\x76"
+	"\xe1\xe5\x3e\xa7\xe0\xb1\x3d\x17\x2b\x05\x30\x64\x53\x36\xd4\xb3"
+	"\xb9\xa1\xaa\x7d\x9d\x63\x21\xd9\xc9\xe8\x3a\xb6\xc4\xce\x97\xce"
+	"\x97\xca\x00\x86\x85\x72\x57\xdc\xab\xc7\xb9\x8e\x04\x61\xbe\x86"
+	"\x39\xe4\xb8\xd4\xa2\xea\x34\x4b\x17\x01\x05\x00\x2f\x1c\x05\x4f"
+	"\x23\x12\xee\x53\x55\x2d\x44\x2f\x54\x95\x01\x30\x8c\xcb\x82\x28"
+	"\xb5\x2f\xfd\x24\x43\xdd\x01\x00\x32\xc4\x0d\x12\xa0\xbb\x01\x24"
+	"\x17\x83\x65\x24\x14\x91\x2c\xfe\x3f\xfc\xf6\xeb\xbe\x02\x20\x70"
+	"\x16\x64\x4e\x04\xda\x65\xbf\xd7\x2a\x9f\xec\x73\x20\x79\x6a\x3f"
+	"\x99\xbf\xb3\x76\xd5\x93\xa1\xa6\xf8\xf6\x79\x61\x2a\x85\xd7\x61"
+	"\xb4\x05\x00\xbb\xac\x3f\x89";
+static const unsigned long zstd_compressed_size = 231;
+
 
 #define TEST_BUFFER_SIZE	512
 
@@ -296,6 +325,43 @@ static int uncompress_using_lz4(struct unit_test_state *uts,
 	return (ret != 0);
 }
 
+static int compress_using_zstd(struct unit_test_state *uts,
+			       void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	/* There is no zstd compression in u-boot, so fake it. */
+	ut_asserteq(in_size, strlen(plain));
+	ut_asserteq_mem(plain, in, in_size);
+
+	if (zstd_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	if (out_size)
+		*out_size = zstd_compressed_size;
+
+	return 0;
+}
+
+static int uncompress_using_zstd(struct unit_test_state *uts,
+				 void *in, unsigned long in_size,
+				 void *out, unsigned long out_max,
+				 unsigned long *out_size)
+{
+	struct abuf in_buf, out_buf;
+	int ret;
+
+	abuf_init_set(&in_buf, in, in_size);
+	abuf_init_set(&out_buf, out, out_max);
+
+	ret = zstd_decompress(&in_buf, &out_buf);
+	if (ret >= 0 && out_size)
+		*out_size = ret;
+
+	return ret < 0;
+}
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -440,6 +506,16 @@ static int compression_test_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_lz4, 0);
 
+static int compression_test_zstd(struct unit_test_state *uts)
+{
+	if (!IS_ENABLED(CONFIG_ZSTD))
+		return 0;
+
+	return run_test(uts, "zstd", compress_using_zstd,
+			uncompress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_zstd, 0);
+
 static int compress_using_none(struct unit_test_state *uts,
 			       void *in, unsigned long in_size,
 			       void *out, unsigned long out_max,
@@ -530,12 +606,268 @@ static int compression_test_bootm_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_lz4, 0);
 
+static int compression_test_bootm_zstd(struct unit_test_state *uts)
+{
+	if (!IS_ENABLED(CONFIG_ZSTD))
+		return 0;
+
+	return run_bootm_test(uts, IH_COMP_ZSTD, compress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_bootm_zstd, 0);
+
 static int compression_test_bootm_none(struct unit_test_state *uts)
 {
 	return run_bootm_test(uts, IH_COMP_NONE, compress_using_none);
 }
 COMPRESSION_TEST(compression_test_bootm_none, 0);
 
+/* Check the offsets worked out for in-place decompression */
+static int compression_test_decomp_offset(struct unit_test_state *uts)
+{
+	ulong offset;
+
+	/* The offset allows for a whole zstd block stored uncompressed */
+	if (IS_ENABLED(CONFIG_ZSTD)) {
+		ut_assertok(image_decomp_offset(IH_COMP_ZSTD, zstd_compressed,
+						zstd_compressed_size,
+						&offset));
+		ut_assert(offset >= strlen(plain) + ZSTD_BLOCKSIZE_ABSOLUTEMAX -
+			  zstd_compressed_size);
+		ut_asserteq(0, offset & 7);
+	}
+
+	/* These headers do not record the uncompressed size */
+	ut_asserteq(-ENODATA, image_decomp_offset(IH_COMP_LZ4, lz4_compressed,
+						  lz4_compressed_size,
+						  &offset));
+	ut_asserteq(-ENODATA, image_decomp_offset(IH_COMP_LZMA,
+						  lzma_compressed,
+						  lzma_compressed_size,
+						  &offset));
+	ut_asserteq(-EPROTONOSUPPORT,
+		    image_decomp_offset(IH_COMP_BZIP2, bzip2_compressed,
+					bzip2_compressed_size, &offset));
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_decomp_offset, 0);
+
+#define INPLACE_FIT_ADDR	0x100000
+#define INPLACE_LOAD_ADDR	0x400000
+#define INPLACE_BLOCKS		2
+#define INPLACE_SIZE		(INPLACE_BLOCKS * ZSTD_BLOCKSIZE_ABSOLUTEMAX)
+#define INPLACE_FRAME_SIZE	(9 + INPLACE_BLOCKS * 3 + INPLACE_SIZE)
+#define INPLACE_FIT_SIZE	(INPLACE_FRAME_SIZE + 0x1000)
+
+static u8 inplace_byte(int i)
+{
+	return i * 7 + (i >> 8);
+}
+
+/*
+ * Write a zstd frame made of stored blocks to @buf. It is as large as the
+ * data, so that decompressing it in place really overwrites it.
+ */
+static void inplace_make_frame(u8 *buf)
+{
+	u32 bh;
+	int i;
+
+	put_unaligned_le32(ZSTD_MAGICNUMBER, buf);
+	buf[4] = 0xa0;		/* single segment, 4-byte content size */
+	put_unaligned_le32(INPLACE_SIZE, buf + 5);
+	buf += 9;
+	for (i = 0; i < INPLACE_SIZE; i++) {
+		if (!(i % ZSTD_BLOCKSIZE_ABSOLUTEMAX)) {
+			bh = ZSTD_BLOCKSIZE_ABSOLUTEMAX << 3;
+			if (i + ZSTD_BLOCKSIZE_ABSOLUTEMAX == INPLACE_SIZE)
+				bh |= 1;	/* last block */
+			*buf++ = bh;
+			*buf++ = bh >> 8;
+			*buf++ = bh >> 16;
+		}
+		*buf++ = inplace_byte(i);
+	}
+}
+
+/*
+ * Write a FIT at @fit_addr with a zstd-compressed kernel. The data is at
+ * @data_addr if non-zero, otherwise inside the FIT.
+ */
+static int inplace_make_fit(struct unit_test_state *uts, ulong fit_addr,
+			    ulong data_addr, ulong decomp_offset)
+{
+	void *fit = map_sysmem(fit_addr, INPLACE_FIT_SIZE);
+	void *data;
+
+	ut_assertok(fdt_create(fit, INPLACE_FIT_SIZE));
+	ut_assertok(fdt_finish_reservemap(fit));
+	ut_assertok(fdt_begin_node(fit, ""));
+	ut_assertok(fdt_property_string(fit, FIT_DESC_PROP, "in-place"));
+	ut_assertok(fdt_property_u32(fit, FIT_TIMESTAMP_PROP, 0));
+	ut_assertok(fdt_begin_node(fit, "images"));
+	ut_assertok(fdt_begin_node(fit, "kernel"));
+	ut_assertok(fdt_property_string(fit, FIT_TYPE_PROP, "kernel"));
+	ut_assertok(fdt_property_string(fit, FIT_ARCH_PROP, "sandbox"));
+	ut_assertok(fdt_property_string(fit, FIT_OS_PROP, "u-boot"));
+	ut_assertok(fdt_property_string(fit, FIT_COMP_PROP, "zstd"));
+	ut_assertok(fdt_property_u32(fit, FIT_LOAD_PROP, INPLACE_LOAD_ADDR));
+	ut_assertok(fdt_property_u32(fit, FIT_ENTRY_PROP, INPLACE_LOAD_ADDR));
+	if (data_addr) {
+		ut_assertok(fdt_property_u32(fit, FIT_DATA_POSITION_PROP,
+					     data_addr - fit_addr));
+		ut_assertok(fdt_property_u32(fit, FIT_DATA_SIZE_PROP,
+					     INPLACE_FRAME_SIZE));
+		ut_assertok(fdt_property_u32(fit, FIT_DECOMP_OFFSET_PROP,
+					     decomp_offset));
+		data = map_sysmem(data_addr, INPLACE_FRAME_SIZE);
+	} else {
+		ut_assertok(fdt_property_placeholder(fit, FIT_DATA_PROP,
+						     INPLACE_FRAME_SIZE,
+						     &data));
+	}
+	inplace_make_frame(data);
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_begin_node(fit, "configurations"));
+	ut_assertok(fdt_property_string(fit, FIT_DEFAULT_PROP, "conf"));
+	ut_assertok(fdt_begin_node(fit, "conf"));
+	ut_assertok(fdt_property_string(fit, FIT_KERNEL_PROP, "kernel"));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_finish(fit));
+	unmap_sysmem(fit);
+
+	return 0;
+}
+
+/* Load a FIT kernel whose data lies inside its own output window */
+static int compression_test_bootm_inplace(struct unit_test_state *uts)
+{
+	ulong offset, fit_addr;
+	char cmd[30];
+	u8 *buf;
+	int i;
+
+	if (!IS_ENABLED(CONFIG_CMD_BOOTM) || !CONFIG_IS_ENABLED(FIT) ||
+	    !IS_ENABLED(CONFIG_ZSTD))
+		return 0;
+
+	buf = malloc(INPLACE_FRAME_SIZE);
+	ut_assertnonnull(buf);
+	inplace_make_frame(buf);
+	ut_assertok(image_decomp_offset(IH_COMP_ZSTD, buf, INPLACE_FRAME_SIZE,
+					&offset));
+	free(buf);
+	ut_assert(offset < INPLACE_SIZE);
+
+	/* External data at the offset may be overwritten */
+	ut_assertok(inplace_make_fit(uts, INPLACE_FIT_ADDR,
+				     INPLACE_LOAD_ADDR + offset, offset));
+	ut_assertok(run_command("bootm start 100000", 0));
+	ut_assertok(run_command("bootm loados", 0));
+	buf = map_sysmem(INPLACE_LOAD_ADDR, INPLACE_SIZE);
+	for (i = 0; i < INPLACE_SIZE; i++)
+		ut_asserteq(inplace_byte(i), buf[i]);
+	unmap_sysmem(buf);
+
+	/* Data inside the FIT may not, since the FIT would be overwritten */
+	fit_addr = INPLACE_LOAD_ADDR + offset;
+	ut_assertok(inplace_make_fit(uts, fit_addr, 0, 0));
+	snprintf(cmd, sizeof(cmd), "bootm start %lx", fit_addr);
+	ut_assertok(run_command(cmd, 0));
+	ut_asserteq(1, run_command("bootm loados", 0));
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_bootm_inplace, 0);
+
+#define SPEED_TEST_SIZE		SZ_1M
+#define SPEED_TEST_LOOPS	8
+
+/*
+ * Fill @buf with something resembling the usual contents of a FIT: runs of
+ * text, as found in an initramfs, mixed with less compressible data, as
+ * found in kernel code. A fixed seed keeps the corpus the same every time.
+ */
+static void speed_test_fill(u8 *buf, ulong size)
+{
+	static const char *const words[] = {
+		"the ", "kernel ", "device ", "memory ", "return ", "static ",
+		"int ", "void ", "struct ", "if (", "ret) ", "{\n", "}\n",
+		"\t", "0x", ";\n", "= ", "NULL", "config ", "boot ",
+	};
+	u32 seed = 0x12345678;
+	ulong pos = 0;
+
+	while (pos < size) {
+		const char *word;
+		int len, i;
+
+		/* xorshift32 */
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		if (seed % 4) {
+			word = words[seed % ARRAY_SIZE(words)];
+			len = min_t(ulong, strlen(word), size - pos);
+			memcpy(buf + pos, word, len);
+		} else {
+			len = min_t(ulong, 4, size - pos);
+			for (i = 0; i < len; i++)
+				buf[pos + i] = (seed >> (8 * i)) & 0x3f;
+		}
+		pos += len;
+	}
+}
+
+/* Report the decompression and CRC32 throughput of gzip data */
+static int compression_test_gzip_speed(struct unit_test_state *uts)
+{
+	unsigned long comp_size, out_size;
+	ulong start, us;
+	u8 *plain, *comp, *out;
+	u32 crc;
+	int i;
+
+	plain = malloc(SPEED_TEST_SIZE);
+	comp = malloc(SPEED_TEST_SIZE);
+	out = malloc(SPEED_TEST_SIZE);
+	ut_assertnonnull(plain);
+	ut_assertnonnull(comp);
+	ut_assertnonnull(out);
+
+	speed_test_fill(plain, SPEED_TEST_SIZE);
+	comp_size = SPEED_TEST_SIZE;
+	ut_assertok(gzip(comp, &comp_size, plain, SPEED_TEST_SIZE));
+
+	start = timer_get_us();
+	for (i = 0; i < SPEED_TEST_LOOPS; i++) {
+		out_size = comp_size;
+		ut_assertok(gunzip(out, SPEED_TEST_SIZE, comp, &out_size));
+	}
+	us = max(timer_get_us() - start, 1UL);
+	ut_asserteq(SPEED_TEST_SIZE, out_size);
+	ut_asserteq_mem(plain, out, SPEED_TEST_SIZE);
+	log_debug("gunzip: %lu bytes from %lu, %lu MB/s\n", out_size,
+		  comp_size, SPEED_TEST_SIZE * SPEED_TEST_LOOPS / us);
+
+	start = timer_get_us();
+	for (i = 0; i < SPEED_TEST_LOOPS; i++)
+		crc = crc32(0, out, SPEED_TEST_SIZE);
+	us = max(timer_get_us() - start, 1UL);
+	ut_asserteq(crc32(0, plain, SPEED_TEST_SIZE), crc);
+	log_debug("crc32: %lu MB/s\n", SPEED_TEST_SIZE * SPEED_TEST_LOOPS / us);
+
+	free(out);
+	free(comp);
+	free(plain);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_gzip_speed, 0);
+
 int do_ut_compression(struct cmd_tbl *cmdtp, int flag, int argc,
 		      char *const argv[])
 {
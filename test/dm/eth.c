@@ -13,6 +13,8 @@
 #include <log.h>
 #include <malloc.h>
 #include <net.h>
+#include <net/bootp.h>
+#include <time.h>
 #include <asm/eth.h>
 #include <dm/test.h>
 #include <dm/device-internal.h>
@@ -431,3 +433,469 @@ static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_eth_async_ping_reply, UT_TESTF_SCAN_FDT);
+
+static int sb_flood_handler(struct udevice *dev, void *packet,
+			    unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	bool *flooded = priv->priv;
+
+	sandbox_eth_arp_req_to_reply(dev, packet, len);
+	sandbox_eth_ping_req_to_reply(dev, packet, len);
+
+	/* Follow the first reply with more pings than there is room for */
+	if (!*flooded) {
+		*flooded = true;
+		while (!sandbox_eth_recv_ping_req(dev))
+			;
+	}
+
+	return 0;
+}
+
+/* Check that packets and overruns are counted */
+static int dm_test_eth_stats(struct unit_test_state *uts)
+{
+	struct eth_stats before, *stats;
+	struct udevice *dev;
+	bool flooded = false;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000",
+					      &dev));
+	stats = eth_get_stats(dev);
+	before = *stats;
+
+	net_ping_ip = string_to_ip("1.1.2.2");
+	sandbox_eth_set_tx_handler(0, sb_flood_handler);
+	sandbox_eth_set_priv(0, &flooded);
+
+	env_set("ethact", "eth@10002000");
+	ut_assertok(net_loop(PING));
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	sandbox_eth_set_priv(0, NULL);
+
+	/* ARP request, ping and a reply to each ping which fitted */
+	ut_assert(stats->tx_packets >= before.tx_packets + 2 + PKTBUFSRX - 1);
+	ut_assert(stats->rx_packets >= before.rx_packets + 2 + PKTBUFSRX - 1);
+	ut_assert(stats->rx_bytes > before.rx_bytes);
+	ut_assert(stats->rx_polls > before.rx_polls);
+	ut_asserteq(before.rx_overruns + 1, stats->rx_overruns);
+	ut_asserteq(before.tx_errors, stats->tx_errors);
+	ut_asserteq(ETH_PACKETS_BATCH_RECV, eth_get_rx_batch(dev));
+
+	return 0;
+}
+DM_TEST(dm_test_eth_stats, UT_TESTF_SCAN_FDT);
+
+static int sb_arp_count_handler(struct udevice *dev, void *packet,
+				unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct arp_hdr *arp = packet + ETHER_HDR_SIZE;
+	int *arp_count = priv->priv;
+
+	if (ntohs(eth->et_protlen) == PROT_ARP &&
+	    ntohs(arp->ar_op) == ARPOP_REQUEST)
+		(*arp_count)++;
+
+	return sandbox_eth_arp_req_to_reply(dev, packet, len);
+}
+
+/* Check that an address found by ARP is used again until it expires */
+static int dm_test_eth_arp_cache(struct unit_test_state *uts)
+{
+	struct in_addr server = string_to_ip("1.1.2.2");
+	char *old_resolve = net_dns_resolve;
+	uchar ethaddr[ARP_HLEN];
+	char *old_dnsip;
+	int arp_count = 0;
+
+	if (!IS_ENABLED(CONFIG_NET_ARP_CACHE))
+		return -EAGAIN;
+
+	old_dnsip = env_get("dnsip");
+	if (old_dnsip)
+		old_dnsip = strdup(old_dnsip);
+
+	arp_cache_flush();
+	sandbox_eth_set_tx_handler(0, sb_arp_count_handler);
+	sandbox_eth_set_priv(0, &arp_count);
+	env_set("ethact", "eth@10002000");
+	env_set("dnsip", "1.1.2.2");
+	net_dns_resolve = "example.com";
+
+	/* Nothing answers the DNS query, so each lookup times out */
+	sandbox_eth_skip_timeout();
+	net_loop(DNS);
+	ut_asserteq(1, arp_count);
+	ut_assert(arp_cache_lookup(server, ethaddr));
+
+	/* The second lookup finds the server's address in the cache */
+	sandbox_eth_skip_timeout();
+	net_loop(DNS);
+	ut_asserteq(1, arp_count);
+
+	/* Once the entry is too old, the server is asked again */
+	timer_test_add_offset(CONFIG_NET_ARP_CACHE_TIMEOUT * 1000UL + 1);
+	ut_assert(!arp_cache_lookup(server, ethaddr));
+	sandbox_eth_skip_timeout();
+	net_loop(DNS);
+	ut_asserteq(2, arp_count);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	sandbox_eth_set_priv(0, NULL);
+	arp_cache_flush();
+	net_dns_resolve = old_resolve;
+	env_set("dnsip", old_dnsip);
+	free(old_dnsip);
+
+	return 0;
+}
+DM_TEST(dm_test_eth_arp_cache, UT_TESTF_SCAN_FDT);
+
+/* Size of the ICMP message in each fragmented ping sent to U-Boot */
+#define SB_FRAG_LEN	1100
+/* Bytes of it in the first fragment, a multiple of 8 */
+#define SB_FRAG_SPLIT	800
+
+/**
+ * struct sb_frag_priv - state of the host sending fragmented pings
+ *
+ * @req: ping sent by U-Boot, answered once both of ours are answered
+ * @req_len: length of @req
+ * @replies: number of correct replies to our pings
+ */
+struct sb_frag_priv {
+	uchar req[PKTSIZE];
+	int req_len;
+	int replies;
+};
+
+/* Inject the first or second fragment of a ping with the given IP ID */
+static void sb_frag_send(struct udevice *dev, struct ethernet_hdr *req, int id,
+			 bool first)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth;
+	struct ip_udp_hdr *ip;
+	struct icmp_hdr *icmp;
+	uchar msg[SB_FRAG_LEN];
+	int i, offset, len;
+
+	if (priv->recv_packets >= PKTBUFSRX)
+		return;
+
+	icmp = (struct icmp_hdr *)msg;
+	for (i = 0; i < SB_FRAG_LEN; i++)
+		msg[i] = i + id;
+	icmp->type = ICMP_ECHO_REQUEST;
+	icmp->code = 0;
+	icmp->checksum = 0;
+	icmp->un.echo.id = htons(id);
+	icmp->un.echo.sequence = 0;
+	icmp->checksum = compute_ip_checksum(msg, SB_FRAG_LEN);
+
+	offset = first ? 0 : SB_FRAG_SPLIT;
+	len = first ? SB_FRAG_SPLIT : SB_FRAG_LEN - SB_FRAG_SPLIT;
+
+	eth = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth->et_dest, req->et_src, ARP_HLEN);
+	memcpy(eth->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+	ip = (void *)eth + ETHER_HDR_SIZE;
+	memcpy((uchar *)ip + IP_HDR_SIZE, msg + offset, len);
+	net_set_ip_header((uchar *)ip, net_ip, priv->fake_host_ipaddr,
+			  IP_HDR_SIZE + len, IPPROTO_ICMP);
+	ip->ip_id = htons(id);
+	ip->ip_off = htons(offset / 8 | (first ? IP_FLAGS_MFRAG : 0));
+	ip->ip_sum = 0;
+	ip->ip_sum = compute_ip_checksum(ip, IP_HDR_SIZE);
+
+	priv->recv_packet_length[priv->recv_packets] = ETHER_HDR_SIZE +
+		IP_HDR_SIZE + len;
+	++priv->recv_packets;
+}
+
+/*
+ * Send U-Boot two fragmented pings, interleaved and out of order, and
+ * answer U-Boot's own ping once it has replied to both
+ */
+static int sb_frag_handler(struct udevice *dev, void *packet, unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_frag_priv *sb = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	struct icmp_hdr *icmp = (struct icmp_hdr *)&ip->udp_src;
+	uchar *msg = (uchar *)icmp;
+	int i, id;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_ICMP)
+		return 0;
+
+	if (icmp->type == ICMP_ECHO_REQUEST) {
+		memcpy(sb->req, packet, len);
+		sb->req_len = len;
+		sb_frag_send(dev, eth, 1, false);
+		sb_frag_send(dev, eth, 2, true);
+		sb_frag_send(dev, eth, 1, true);
+		return 0;
+	}
+	if (icmp->type != ICMP_ECHO_REPLY ||
+	    ntohs(ip->ip_len) != IP_HDR_SIZE + SB_FRAG_LEN)
+		return 0;
+
+	id = ntohs(icmp->un.echo.id);
+	for (i = ICMP_HDR_SIZE; i < SB_FRAG_LEN; i++)
+		if (msg[i] != (uchar)(i + id))
+			return 0;
+	sb->replies++;
+
+	if (id == 1)
+		sb_frag_send(dev, eth, 2, false);
+	else
+		sandbox_eth_ping_req_to_reply(dev, sb->req, sb->req_len);
+
+	return 0;
+}
+
+/* Check that fragments of two datagrams can arrive interleaved */
+static int dm_test_eth_defrag(struct unit_test_state *uts)
+{
+	struct sb_frag_priv sb;
+
+	if (!IS_ENABLED(CONFIG_IP_DEFRAG))
+		return -EAGAIN;
+
+	memset(&sb, '\0', sizeof(sb));
+	net_ping_ip = string_to_ip("1.1.2.2");
+	sandbox_eth_set_tx_handler(0, sb_frag_handler);
+	sandbox_eth_set_priv(0, &sb);
+	env_set("ethact", "eth@10002000");
+
+	ut_assertok(net_loop(PING));
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	sandbox_eth_set_priv(0, NULL);
+
+	ut_asserteq(2, sb.replies);
+
+	return 0;
+}
+DM_TEST(dm_test_eth_defrag, UT_TESTF_SCAN_FDT);
+
+/* Answer BOOTP requests, counting them in the int at priv->priv */
+static int sb_bootp_handler(struct udevice *dev, void *packet,
+			    unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	struct ethernet_hdr *eth_recv;
+	struct bootp_hdr *bp_recv;
+	struct in_addr bcast_ip;
+	int *requests = priv->priv;
+
+	/* A request goes to the BOOTP server port */
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP ||
+	    ntohs(ip->udp_dst) != PORT_BOOTPS)
+		return 0;
+	(*requests)++;
+
+	if (priv->recv_packets >= PKTBUFSRX)
+		return 0;
+
+	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_recv, packet, len);
+	memcpy(eth_recv->et_dest, eth->et_src, ARP_HLEN);
+	memcpy(eth_recv->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+
+	/* Keep the ID and client address, with no vendor options */
+	bp_recv = (void *)eth_recv + ETHER_HDR_SIZE + IP_UDP_HDR_SIZE;
+	bp_recv->bp_op = OP_BOOTREPLY;
+	net_write_ip(&bp_recv->bp_yiaddr, string_to_ip("1.1.2.5"));
+	bp_recv->bp_vend[4] = 255;
+
+	bcast_ip.s_addr = 0xffffffff;
+	net_set_udp_header((uchar *)eth_recv + ETHER_HDR_SIZE, bcast_ip,
+			   ntohs(ip->udp_src), ntohs(ip->udp_dst),
+			   len - ETHER_HDR_SIZE - IP_UDP_HDR_SIZE);
+	priv->recv_packet_length[priv->recv_packets] = len;
+	++priv->recv_packets;
+
+	return 0;
+}
+
+/* Check that BOOTP finds a server which only one device can reach */
+static int dm_test_eth_bootp_parallel(struct unit_test_state *uts)
+{
+	struct eth_sandbox_priv *priv;
+	sandbox_eth_tx_hand_f *old_handler;
+	struct in_addr old_ip = net_ip;
+	struct udevice *dev, *first;
+	int requests = 0;
+	int ret;
+
+	if (!IS_ENABLED(CONFIG_BOOTP_PARALLEL))
+		return -EAGAIN;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000",
+					      &first));
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10003000",
+					      &dev));
+	priv = dev_get_priv(dev);
+	old_handler = priv->tx_handler;
+	priv->tx_handler = sb_bootp_handler;
+	priv->priv = &requests;
+	env_set("ethact", "eth@10002000");
+	env_set("autoload", "no");
+
+	ret = net_loop(BOOTP);
+
+	priv->tx_handler = old_handler;
+	priv->priv = NULL;
+	env_set("autoload", NULL);
+	net_ip = old_ip;
+
+	/* The first request was answered, without waiting for eth@10002000 */
+	ut_asserteq(0, ret);
+	ut_asserteq(1, requests);
+	ut_asserteq_str("eth@10003000", env_get("ethact"));
+	ut_assert(!eth_is_active(first));
+	env_set("ethact", "eth@10002000");
+
+	return 0;
+}
+DM_TEST(dm_test_eth_bootp_parallel, UT_TESTF_SCAN_FDT);
+
+/**
+ * struct sb_offload_priv - what the fake host saw of a packet sent to it
+ *
+ * @pkt: the packet
+ * @len: number of bytes in @pkt, 0 if none was sent
+ */
+struct sb_offload_priv {
+	uchar pkt[PKTSIZE];
+	int len;
+};
+
+/* Number of UDP packets handled, and whether the last had a good checksum */
+static int sb_offload_rx;
+static bool sb_offload_csum_ok;
+
+static int sb_offload_handler(struct udevice *dev, void *packet,
+			      unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_offload_priv *sb = priv->priv;
+
+	memcpy(sb->pkt, packet, len);
+	sb->len = len;
+
+	return 0;
+}
+
+static void sb_offload_udp_handler(uchar *pkt, unsigned int dport,
+				   struct in_addr sip, unsigned int sport,
+				   unsigned int len)
+{
+	sb_offload_rx++;
+	sb_offload_csum_ok = eth_rx_csum_ok();
+}
+
+/* Pass the packet last sent back to U-Boot, as if from the fake host */
+static void sb_offload_loop_back(struct udevice *dev,
+				 struct sb_offload_priv *sb, bool corrupt)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	uchar *pkt = priv->recv_packet_buffer[priv->recv_packets];
+	struct ip_udp_hdr *ip = (void *)pkt + ETHER_HDR_SIZE;
+	struct in_addr src;
+
+	/* Swapping the addresses leaves both checksums as they were */
+	memcpy(pkt, sb->pkt, sb->len);
+	src = ip->ip_src;
+	ip->ip_src = ip->ip_dst;
+	ip->ip_dst = src;
+	if (corrupt)
+		pkt[sb->len - 1] ^= 0xff;
+	priv->recv_packet_length[priv->recv_packets] = sb->len;
+	++priv->recv_packets;
+}
+
+/* Check that the driver fills in and checks UDP checksums */
+static int dm_test_eth_offload(struct unit_test_state *uts)
+{
+	static const char msg[] = "checksum offload";
+	struct in_addr dest = string_to_ip("1.1.2.2");
+	struct in_addr old_ip = net_ip;
+	ushort old_vlan = net_our_vlan;
+	struct eth_sandbox_priv *priv;
+	struct sb_offload_priv sb;
+	struct ip_udp_hdr *ip;
+	struct udevice *dev;
+	int sg_packets;
+
+	if (!IS_ENABLED(CONFIG_NET_OFFLOAD))
+		return -EAGAIN;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000",
+					      &dev));
+	priv = dev_get_priv(dev);
+	memset(&sb, '\0', sizeof(sb));
+	sandbox_eth_set_tx_handler(0, sb_offload_handler);
+	sandbox_eth_set_priv(0, &sb);
+	env_set("ethact", "eth@10002000");
+	net_ip = string_to_ip("1.1.2.10");
+	net_init();
+	ut_assertok(eth_init());
+
+	/* The payload is sent from where it is, with a checksum */
+	sg_packets = priv->tx_sg_packets;
+	ut_assertok(net_send_udp_data(priv->fake_host_hwaddr, dest, 1234, 5678,
+				      msg, sizeof(msg)));
+	ut_asserteq(sg_packets + 1, priv->tx_sg_packets);
+	ut_asserteq(ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + sizeof(msg), sb.len);
+	ip = (void *)sb.pkt + ETHER_HDR_SIZE;
+	ut_asserteq_mem(msg, ip + 1, sizeof(msg));
+	ut_assert(ip->udp_xsum);
+	ut_asserteq(0, net_l4_checksum(ip->ip_src, ip->ip_dst, IPPROTO_UDP,
+				       &ip->udp_src, ntohs(ip->udp_len)));
+
+	/* The driver vouches for a good checksum, the stack drops a bad one */
+	sb_offload_rx = 0;
+	net_set_udp_handler(sb_offload_udp_handler);
+	sb_offload_loop_back(dev, &sb, false);
+	eth_rx();
+	ut_asserteq(1, sb_offload_rx);
+	ut_assert(sb_offload_csum_ok);
+	sb_offload_loop_back(dev, &sb, true);
+	eth_rx();
+	ut_asserteq(IS_ENABLED(CONFIG_UDP_CHECKSUM) ? 1 : 2, sb_offload_rx);
+	ut_assert(!eth_rx_csum_ok());
+
+	/* The checksum is filled in behind a VLAN tag too */
+	net_our_vlan = string_to_vlan("22");
+	ut_assertok(net_send_udp_data(priv->fake_host_hwaddr, dest, 1234, 5678,
+				      msg, sizeof(msg)));
+	net_our_vlan = old_vlan;
+	ut_asserteq(VLAN_ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + sizeof(msg), sb.len);
+	ip = (void *)sb.pkt + VLAN_ETHER_HDR_SIZE;
+	ut_asserteq_mem(msg, ip + 1, sizeof(msg));
+	ut_assert(ip->udp_xsum);
+	ut_asserteq(0, net_l4_checksum(ip->ip_src, ip->ip_dst, IPPROTO_UDP,
+				       &ip->udp_src, ntohs(ip->udp_len)));
+
+	net_set_udp_handler(NULL);
+	eth_halt();
+	sandbox_eth_set_tx_handler(0, NULL);
+	sandbox_eth_set_priv(0, NULL);
+	net_ip = old_ip;
+
+	return 0;
+}
+DM_TEST(dm_test_eth_offload, UT_TESTF_SCAN_FDT);
@@ -7,9 +7,11 @@
 #include <dm.h>
 #include <fastboot.h>
 #include <fb_mmc.h>
+#include <malloc.h>
 #include <mmc.h>
 #include <part.h>
 #include <part_efi.h>
+#include <sparse_format.h>
 #include <dm/test.h>
 #include <test/ut.h>
 #include <linux/stringify.h>
@@ -93,3 +95,149 @@ static int dm_test_fastboot_mmc_part(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_fastboot_mmc_part, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(FASTBOOT_FLASH_STREAM)
+/* Sparse block size, and the number of blocks in each chunk of the image */
+#define SB_SPARSE_BLK_SZ	4096
+#define SB_SPARSE_RAW1		8
+#define SB_SPARSE_FILL		4
+#define SB_SPARSE_SKIP		2
+#define SB_SPARSE_RAW2		10
+#define SB_SPARSE_BLKS		(SB_SPARSE_RAW1 + SB_SPARSE_FILL + \
+				 SB_SPARSE_SKIP + SB_SPARSE_RAW2)
+#define SB_SPARSE_FILL_VAL	0xdeadbeef
+/* Bytes sent in each packet, as with fastboot over UDP */
+#define SB_SPARSE_PACKET	1020
+
+static u8 sb_sparse_byte(int i)
+{
+	return i * 11 + (i >> 9);
+}
+
+/* Add a chunk header to @p, returning the end of it */
+static void *sb_sparse_chunk(void *p, int type, int blks, int data_len)
+{
+	chunk_header_t *chunk = p;
+
+	chunk->chunk_type = type;
+	chunk->reserved1 = 0;
+	chunk->chunk_sz = blks;
+	chunk->total_sz = sizeof(*chunk) + data_len;
+
+	return chunk + 1;
+}
+
+/* Build a sparse image, returning its size */
+static int sb_sparse_image(void *buf)
+{
+	sparse_header_t *hdr = buf;
+	void *p = hdr + 1;
+	int i, len;
+
+	memset(hdr, '\0', sizeof(*hdr));
+	hdr->magic = SPARSE_HEADER_MAGIC;
+	hdr->major_version = 1;
+	hdr->file_hdr_sz = sizeof(*hdr);
+	hdr->chunk_hdr_sz = sizeof(chunk_header_t);
+	hdr->blk_sz = SB_SPARSE_BLK_SZ;
+	hdr->total_blks = SB_SPARSE_BLKS;
+	hdr->total_chunks = 4;
+
+	len = SB_SPARSE_RAW1 * SB_SPARSE_BLK_SZ;
+	p = sb_sparse_chunk(p, CHUNK_TYPE_RAW, SB_SPARSE_RAW1, len);
+	for (i = 0; i < len; i++)
+		((u8 *)p)[i] = sb_sparse_byte(i);
+	p += len;
+
+	p = sb_sparse_chunk(p, CHUNK_TYPE_FILL, SB_SPARSE_FILL, 4);
+	*(u32 *)p = SB_SPARSE_FILL_VAL;
+	p += 4;
+
+	p = sb_sparse_chunk(p, CHUNK_TYPE_DONT_CARE, SB_SPARSE_SKIP, 0);
+
+	len = SB_SPARSE_RAW2 * SB_SPARSE_BLK_SZ;
+	p = sb_sparse_chunk(p, CHUNK_TYPE_RAW, SB_SPARSE_RAW2, len);
+	for (i = 0; i < len; i++)
+		((u8 *)p)[i] = sb_sparse_byte(i + 1);
+	p += len;
+
+	return p - buf;
+}
+
+/* Flash a sparse image larger than the download buffer as it arrives */
+static int dm_test_fastboot_mmc_stream(struct unit_test_state *uts)
+{
+	char response[FASTBOOT_RESPONSE_LEN] = {0};
+	char str_disk_guid[UUID_STR_LEN + 1];
+	struct blk_desc *mmc_dev_desc;
+	struct disk_partition parts[1] = {
+		{
+			.start = 48,
+			.size = SB_SPARSE_BLKS * SB_SPARSE_BLK_SZ / 512,
+			.name = "stream",
+		},
+	};
+	int buf_size = 64 * 1024;
+	char cmd[32];
+	u8 *image, *buf, *out;
+	int size, i, n, fill_start, raw2_start;
+
+	ut_assertok(blk_get_device_by_str("mmc", "0", &mmc_dev_desc));
+	if (CONFIG_IS_ENABLED(RANDOM_UUID)) {
+		gen_rand_uuid_str(parts[0].uuid, UUID_STR_FORMAT_STD);
+		gen_rand_uuid_str(str_disk_guid, UUID_STR_FORMAT_STD);
+	}
+	ut_assertok(gpt_restore(mmc_dev_desc, str_disk_guid, parts,
+				ARRAY_SIZE(parts)));
+
+	image = malloc(SB_SPARSE_BLKS * SB_SPARSE_BLK_SZ);
+	buf = malloc(buf_size);
+	out = malloc(SB_SPARSE_BLKS * SB_SPARSE_BLK_SZ);
+	ut_assertnonnull(image);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(out);
+	size = sb_sparse_image(image);
+	ut_assert(size > buf_size);
+
+	fastboot_init(buf, buf_size);
+	ut_assertok(env_set("fastboot_flash_stream", "stream"));
+
+	snprintf(cmd, sizeof(cmd), "download:%08x", size);
+	fastboot_handle_command(cmd, response);
+	ut_asserteq_mem("DATA", response, 4);
+	for (i = 0; i < size; i += n) {
+		n = min(SB_SPARSE_PACKET, size - i);
+		fastboot_data_download(image + i, n, response);
+		ut_asserteq_str("", response);
+		fastboot_data_write();
+	}
+	fastboot_data_complete(response);
+	ut_asserteq_str("OKAY", response);
+
+	strcpy(cmd, "flash:stream");
+	fastboot_handle_command(cmd, response);
+	ut_asserteq_str("OKAY", response);
+
+	ut_assertok(env_set("fastboot_flash_stream", NULL));
+	fastboot_init(NULL, 0);
+
+	ut_asserteq(parts[0].size, blk_dread(mmc_dev_desc, parts[0].start,
+					     parts[0].size, out));
+	for (i = 0; i < SB_SPARSE_RAW1 * SB_SPARSE_BLK_SZ; i++)
+		ut_asserteq(sb_sparse_byte(i), out[i]);
+	fill_start = SB_SPARSE_RAW1 * SB_SPARSE_BLK_SZ;
+	for (i = 0; i < SB_SPARSE_FILL * SB_SPARSE_BLK_SZ; i += 4)
+		ut_asserteq(SB_SPARSE_FILL_VAL, *(u32 *)(out + fill_start + i));
+	raw2_start = (SB_SPARSE_RAW1 + SB_SPARSE_FILL + SB_SPARSE_SKIP) *
+		SB_SPARSE_BLK_SZ;
+	for (i = 0; i < SB_SPARSE_RAW2 * SB_SPARSE_BLK_SZ; i++)
+		ut_asserteq(sb_sparse_byte(i + 1), out[raw2_start + i]);
+
+	free(out);
+	free(buf);
+	free(image);
+
+	return 0;
+}
+DM_TEST(dm_test_fastboot_mmc_stream, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+#endif
@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test for batching of network console output
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <env.h>
+#include <net.h>
+#include <stdio_dev.h>
+#include <time.h>
+#include <asm/eth.h>
+#include <dm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define SB_NC_PORT	6666
+#define SB_NC_LINE	"a line of console output\n"
+#define SB_NC_LINES	100
+
+/**
+ * struct sb_nc_priv - output received from the network console
+ *
+ * @buf: output received
+ * @len: number of bytes in @buf
+ * @packets: number of datagrams received
+ */
+struct sb_nc_priv {
+	char buf[4096];
+	int len;
+	int packets;
+};
+
+static int sb_nc_handler(struct udevice *dev, void *packet, unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_nc_priv *sb = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	int data_len;
+
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP ||
+	    ntohs(ip->udp_dst) != SB_NC_PORT)
+		return 0;
+
+	data_len = ntohs(ip->udp_len) - UDP_HDR_SIZE;
+	if (sb->len + data_len <= sizeof(sb->buf)) {
+		memcpy(sb->buf + sb->len, (void *)ip + IP_UDP_HDR_SIZE,
+		       data_len);
+		sb->len += data_len;
+	}
+	sb->packets++;
+
+	return 0;
+}
+
+static int netconsole_batch_run(struct unit_test_state *uts,
+				struct stdio_dev *dev, struct sb_nc_priv *sb)
+{
+	const int line_len = strlen(SB_NC_LINE);
+	int i;
+
+	ut_assertok(dev->start(dev));
+	nc_flush();
+
+	/* After a quiet spell the first line goes out on its own */
+	timer_test_add_offset(CONFIG_NETCONSOLE_FLUSH_MS);
+	sb->len = 0;
+	sb->packets = 0;
+	dev->puts(dev, "quiet\n");
+	ut_asserteq(1, sb->packets);
+	ut_asserteq(6, sb->len);
+	ut_asserteq_mem("quiet\n", sb->buf, 6);
+
+	/* Only full datagrams go out while the lines come quickly */
+	sb->len = 0;
+	sb->packets = 0;
+	for (i = 0; i < SB_NC_LINES; i++)
+		dev->puts(dev, SB_NC_LINE);
+	nc_flush();
+	ut_asserteq(SB_NC_LINES * line_len, sb->len);
+	ut_asserteq(DIV_ROUND_UP(SB_NC_LINES * line_len,
+				 1500 - IP_UDP_HDR_SIZE), sb->packets);
+	for (i = 0; i < SB_NC_LINES; i++)
+		ut_asserteq_mem(SB_NC_LINE, sb->buf + i * line_len, line_len);
+
+	/* A line which has waited long enough goes out with the next one */
+	sb->len = 0;
+	sb->packets = 0;
+	dev->puts(dev, "first\n");
+	ut_asserteq(0, sb->packets);
+	timer_test_add_offset(CONFIG_NETCONSOLE_FLUSH_MS);
+	dev->puts(dev, "second\n");
+	ut_asserteq(1, sb->packets);
+	ut_asserteq(13, sb->len);
+	ut_asserteq_mem("first\nsecond\n", sb->buf, 13);
+
+	/* A last line goes out from the net loop once it has waited */
+	sb->len = 0;
+	sb->packets = 0;
+	dev->puts(dev, "last\n");
+	nc_poll();
+	ut_asserteq(0, sb->packets);
+	timer_test_add_offset(CONFIG_NETCONSOLE_FLUSH_MS);
+	nc_poll();
+	ut_asserteq(1, sb->packets);
+	ut_asserteq(5, sb->len);
+	ut_asserteq_mem("last\n", sb->buf, 5);
+
+	return 0;
+}
+
+/* Many short lines are sent in a few full datagrams */
+static int dm_test_netconsole_batch(struct unit_test_state *uts)
+{
+	struct sb_nc_priv sb;
+	struct stdio_dev *dev;
+	int ret;
+
+	dev = stdio_get_by_name("nc");
+	ut_assertnonnull(dev);
+
+	memset(&sb, '\0', sizeof(sb));
+	sandbox_eth_set_tx_handler(0, sb_nc_handler);
+	sandbox_eth_set_priv(0, &sb);
+	env_set("ethact", "eth@10002000");
+	env_set("ncip", NULL);
+
+	ret = netconsole_batch_run(uts, dev, &sb);
+
+	dev->stop(dev);
+	sandbox_eth_set_tx_handler(0, NULL);
+	sandbox_eth_set_priv(0, NULL);
+
+	return ret;
+}
+DM_TEST(dm_test_netconsole_batch, UT_TESTF_SCAN_FDT);
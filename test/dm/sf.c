@@ -10,6 +10,7 @@
 #include <mapmem.h>
 #include <os.h>
 #include <spi.h>
+#include <spi-mem.h>
 #include <spi_flash.h>
 #include <asm/state.h>
 #include <asm/test.h>
@@ -102,3 +103,45 @@ static int dm_test_spi_flash_func(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_spi_flash_func, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Check that reads through the direct mapping use the dual-output protocol */
+static int dm_test_spi_flash_dirmap(struct unit_test_state *uts)
+{
+	struct spi_mem_dirmap_desc *desc;
+	struct spi_flash *flash;
+	struct udevice *dev;
+	int full_size = 0x100000;
+	int size = 0x3000;
+	u8 *src, *dst;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(SPI_DIRMAP))
+		return -EAGAIN;
+
+	src = map_sysmem(0x20000, full_size);
+	for (i = 0; i < full_size; i++)
+		src[i] = i * 3 + (i >> 9);
+	ut_assertok(os_write_file("spi.bin", src, full_size));
+	ut_assertok(uclass_get_device_by_name(UCLASS_SPI_FLASH, "spi.bin@1",
+					      &dev));
+	flash = dev_get_uclass_priv(dev);
+	ut_asserteq(SNOR_PROTO_1_1_2, flash->read_proto);
+
+	/* The data phase of the template must match the read protocol */
+	desc = flash->dirmap.rdesc;
+	ut_assertnonnull(desc);
+	ut_asserteq(SPINOR_OP_READ_1_1_2, desc->info.op_tmpl.cmd.opcode);
+	ut_asserteq(1, desc->info.op_tmpl.addr.buswidth);
+	ut_asserteq(2, desc->info.op_tmpl.data.buswidth);
+
+	dst = map_sysmem(0x20000 + full_size, size);
+	ut_assertok(spi_flash_read_dm(dev, 0x1234, size, dst));
+	ut_asserteq_mem(src + 0x1234, dst, size);
+	unmap_sysmem(dst);
+	unmap_sysmem(src);
+
+	sandbox_sf_unbind_emul(state_get_current(), 0, 1);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_dirmap, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
@@ -0,0 +1,313 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for TFTP transfers
+ *
+ * The sandbox Ethernet driver stands in for a TFTP server which knows about
+ * no options but 'tsize', so each transfer uses 512-byte blocks.
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <env.h>
+#include <image.h>
+#include <mapmem.h>
+#include <net.h>
+#include <net/tftp.h>
+#include <asm/eth.h>
+#include <dm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define SB_TFTP_PORT		69
+/* Each transfer is answered from its own port, starting at this one */
+#define SB_TFTP_DATA_PORT	2000
+#define SB_TFTP_BLOCK_SIZE	512
+#define SB_TFTP_RRQ		1
+#define SB_TFTP_DATA		3
+#define SB_TFTP_ACK		4
+#define SB_TFTP_ERROR		5
+#define SB_TFTP_OACK		6
+#define SB_TFTP_FILES		3
+
+/**
+ * struct sb_tftp_file - a file on the fake server, with its transfer state
+ *
+ * @name: name of the file
+ * @size: size of the file in bytes
+ * @client_port: port which U-Boot asked for the file from, 0 if not yet
+ * @acked: last block which U-Boot acknowledged
+ * @done: true once U-Boot has acknowledged the last block
+ */
+struct sb_tftp_file {
+	const char *name;
+	int size;
+	int client_port;
+	int acked;
+	bool done;
+};
+
+/**
+ * struct sb_tftp_priv - state of the fake TFTP server
+ *
+ * @files: files which the server has
+ * @active: number of transfers which are running
+ * @max_active: largest value of @active seen
+ * @tsize: true to answer a request with the size of the file, if asked
+ * @shuffle: true to send every fourth block after the one following it and
+ *	the block before it again, answering only the first acknowledgement
+ *	of each block
+ */
+struct sb_tftp_priv {
+	struct sb_tftp_file files[SB_TFTP_FILES];
+	int active;
+	int max_active;
+	bool tsize;
+	bool shuffle;
+};
+
+static u8 sb_tftp_byte(int file, int i)
+{
+	return i * (file + 3) + (i >> 8);
+}
+
+static int sb_tftp_send(struct udevice *dev, struct ethernet_hdr *req,
+			int sport, int dport, const void *msg, int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth;
+	struct ip_udp_hdr *ip;
+
+	if (priv->recv_packets >= PKTBUFSRX)
+		return -EOVERFLOW;
+
+	eth = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth->et_dest, req->et_src, ARP_HLEN);
+	memcpy(eth->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+
+	ip = (void *)eth + ETHER_HDR_SIZE;
+	memcpy((void *)ip + IP_UDP_HDR_SIZE, msg, len);
+
+	net_set_ip_header((uchar *)ip, net_ip, priv->fake_host_ipaddr,
+			  IP_UDP_HDR_SIZE + len, IPPROTO_UDP);
+	ip->udp_src = htons(sport);
+	ip->udp_dst = htons(dport);
+	ip->udp_len = htons(UDP_HDR_SIZE + len);
+	ip->udp_xsum = 0;
+
+	priv->recv_packet_length[priv->recv_packets] = ETHER_HDR_SIZE +
+		IP_UDP_HDR_SIZE + len;
+	++priv->recv_packets;
+
+	return 0;
+}
+
+static void sb_tftp_send_block(struct udevice *dev, struct ethernet_hdr *req,
+			       int idx, int block)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_tftp_priv *sb = priv->priv;
+	struct sb_tftp_file *file = &sb->files[idx];
+	u8 msg[4 + SB_TFTP_BLOCK_SIZE];
+	__be16 *s = (void *)msg;
+	int offset = (block - 1) * SB_TFTP_BLOCK_SIZE;
+	int len = min(SB_TFTP_BLOCK_SIZE, file->size - offset);
+	int i;
+
+	s[0] = htons(SB_TFTP_DATA);
+	s[1] = htons(block);
+	for (i = 0; i < len; i++)
+		msg[4 + i] = sb_tftp_byte(idx, offset + i);
+	sb_tftp_send(dev, req, SB_TFTP_DATA_PORT + idx, file->client_port,
+		     msg, 4 + len);
+}
+
+static void sb_tftp_send_next(struct udevice *dev, struct ethernet_hdr *req,
+			      int idx, int block)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_tftp_priv *sb = priv->priv;
+	bool shuffle = sb->shuffle && !(block % 4);
+
+	if (shuffle && block * SB_TFTP_BLOCK_SIZE <= sb->files[idx].size)
+		sb_tftp_send_block(dev, req, idx, block + 1);
+	sb_tftp_send_block(dev, req, idx, block);
+	if (shuffle)
+		sb_tftp_send_block(dev, req, idx, block - 1);
+}
+
+static int sb_tftp_handler(struct udevice *dev, void *packet,
+			   unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_tftp_priv *sb = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	struct sb_tftp_file *file;
+	__be16 *s = (void *)ip + IP_UDP_HDR_SIZE;
+	int dport, block, idx;
+	char msg[32];
+	__be16 *m = (void *)msg;
+	int n;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP)
+		return 0;
+
+	dport = ntohs(ip->udp_dst);
+	if (dport == SB_TFTP_PORT && ntohs(s[0]) == SB_TFTP_RRQ) {
+		for (idx = 0; idx < SB_TFTP_FILES; idx++)
+			if (!strcmp((char *)&s[1], sb->files[idx].name))
+				break;
+		if (idx == SB_TFTP_FILES || !sb->files[idx].size) {
+			m[0] = htons(SB_TFTP_ERROR);
+			m[1] = htons(1);
+			strcpy(msg + 4, "File not found");
+			sb_tftp_send(dev, eth, SB_TFTP_DATA_PORT + SB_TFTP_FILES,
+				     ntohs(ip->udp_src), msg, 4 + 15);
+			return 0;
+		}
+		file = &sb->files[idx];
+		file->client_port = ntohs(ip->udp_src);
+		file->acked = -1;
+		sb->active++;
+		sb->max_active = max(sb->max_active, sb->active);
+		if (sb->tsize) {
+			m[0] = htons(SB_TFTP_OACK);
+			n = sprintf(msg + 2, "tsize%c%d", 0, file->size);
+			sb_tftp_send(dev, eth, SB_TFTP_DATA_PORT + idx,
+				     file->client_port, msg, 2 + n + 1);
+			return 0;
+		}
+		sb_tftp_send_block(dev, eth, idx, 1);
+		return 0;
+	}
+
+	idx = dport - SB_TFTP_DATA_PORT;
+	if (idx < 0 || idx >= SB_TFTP_FILES || ntohs(s[0]) != SB_TFTP_ACK)
+		return 0;
+	file = &sb->files[idx];
+	block = ntohs(s[1]);
+	if (file->done || (sb->shuffle && block <= file->acked))
+		return 0;
+	file->acked = block;
+	if (block * SB_TFTP_BLOCK_SIZE > file->size) {
+		file->done = true;
+		sb->active--;
+		return 0;
+	}
+	sb_tftp_send_next(dev, eth, idx, block + 1);
+
+	return 0;
+}
+
+#ifdef CONFIG_TFTP_MULTI
+/* Fetch three files at once, one of which is missing on the server */
+static int dm_test_tftp_get_files(struct unit_test_state *uts)
+{
+	struct tftp_file files[SB_TFTP_FILES] = {
+		{ .name = "kernel", .addr = 0x1000000 },
+		{ .name = "initrd", .addr = 0x1100000 },
+		{ .name = "missing", .addr = 0x1200000 },
+	};
+	struct sb_tftp_priv sb = {
+		.files = {
+			{ .name = "kernel", .size = 3000 },
+			{ .name = "initrd", .size = 2 * SB_TFTP_BLOCK_SIZE },
+			{ .name = "missing" },
+		},
+	};
+	u8 *buf;
+	int i, j;
+
+	sandbox_eth_set_tx_handler(0, sb_tftp_handler);
+	sandbox_eth_set_priv(0, &sb);
+	env_set("ethact", "eth@10002000");
+	env_set("serverip", "1.1.2.2");
+
+	ut_asserteq(2, tftp_get_files(files, SB_TFTP_FILES));
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	sandbox_eth_set_priv(0, NULL);
+
+	/* The transfers really did run together */
+	ut_assert(sb.max_active >= 2);
+	ut_asserteq(-ENOENT, files[2].err);
+	for (i = 0; i < 2; i++) {
+		ut_assertok(files[i].err);
+		ut_asserteq(sb.files[i].size, files[i].size);
+		ut_assert(sb.files[i].done);
+		buf = map_sysmem(files[i].addr, files[i].size);
+		for (j = 0; j < files[i].size; j++)
+			ut_asserteq(sb_tftp_byte(i, j), buf[j]);
+		unmap_sysmem(buf);
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_tftp_get_files, UT_TESTF_SCAN_FDT);
+#endif
+
+/*
+ * Receive a file straight into the load buffer while the server sends some
+ * blocks early and some twice
+ */
+static int dm_test_tftp_rx_hint(struct unit_test_state *uts)
+{
+	struct sb_tftp_priv sb = {
+		.files = {
+			{
+				.name = "hinted",
+				.size = 40 * SB_TFTP_BLOCK_SIZE + 100,
+			},
+		},
+		.tsize = true,
+		.shuffle = true,
+	};
+	struct eth_sandbox_priv *priv;
+	struct udevice *dev;
+	int size = sb.files[0].size;
+	ulong addr = 0x1000000;
+	u8 *buf;
+	int i;
+
+	if (!IS_ENABLED(CONFIG_NET_RX_HINT))
+		return -EAGAIN;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000",
+					      &dev));
+	priv = dev_get_priv(dev);
+
+	/* Nothing may be written past the end of the file */
+	buf = map_sysmem(addr, size + SB_TFTP_BLOCK_SIZE);
+	memset(buf, '\0', size);
+	memset(buf + size, 0x5a, SB_TFTP_BLOCK_SIZE);
+
+	sandbox_eth_set_tx_handler(0, sb_tftp_handler);
+	sandbox_eth_set_priv(0, &sb);
+	env_set("ethact", "eth@10002000");
+	env_set("serverip", "1.1.2.2");
+	image_load_addr = addr;
+	copy_filename(net_boot_file_name, "hinted",
+		      sizeof(net_boot_file_name));
+	priv->rx_split_packets = 0;
+
+	ut_asserteq(size, net_loop(TFTPGET));
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	sandbox_eth_set_priv(0, NULL);
+
+	ut_assert(sb.files[0].done);
+	for (i = 0; i < size; i++)
+		ut_asserteq(sb_tftp_byte(0, i), buf[i]);
+	for (i = size; i < size + SB_TFTP_BLOCK_SIZE; i++)
+		ut_asserteq(0x5a, buf[i]);
+	unmap_sysmem(buf);
+
+	/* Most of the blocks went into a slot rather than being copied */
+	ut_assert(priv->rx_split_packets > size / SB_TFTP_BLOCK_SIZE / 2);
+
+	return 0;
+}
+DM_TEST(dm_test_tftp_rx_hint, UT_TESTF_SCAN_FDT);
@@ -10,6 +10,7 @@
 #include <os.h>
 #include <spl.h>
 #include <test/ut.h>
+#include <asm/unaligned.h>
 
 /* Declare a new SPL test */
 #define SPL_TEST(_name, _flags)		UNIT_TEST(_name, _flags, spl_test)
@@ -93,3 +94,132 @@ static int spl_test_load(struct unit_test_state *uts)
 	return 0;
 }
 SPL_TEST(spl_test_load, 0);
+
+#if CONFIG_IS_ENABLED(LOAD_FIT_STREAM) && CONFIG_IS_ENABLED(GZIP)
+/* Addresses used by the streaming test */
+#define STREAM_FIT_ADDR		0x200000
+#define STREAM_DATA_ADDR	0x240000
+#define STREAM_LOAD_ADDR	0x300000
+#define STREAM_FIT_SIZE		0x1000
+#define STREAM_DATA_SIZE	0x3000
+
+/* Context used for the streaming test */
+struct stream_ctx {
+	const void *fit;
+	int reads;
+};
+
+static ulong read_stream_fit(struct spl_load_info *load, ulong sector,
+			     ulong count, void *buf)
+{
+	struct stream_ctx *stream_ctx = load->priv;
+
+	memcpy(buf, stream_ctx->fit + sector * load->bl_len,
+	       count * load->bl_len);
+	stream_ctx->reads++;
+
+	return count;
+}
+
+/*
+ * Write @data as a gzip file made of a single stored deflate block, so that
+ * no compressor is needed. Neither load path checks the CRC in the trailer.
+ */
+static int make_stored_gzip(u8 *dst, const u8 *data, int size)
+{
+	static const u8 header[] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3 };
+	u8 *ptr = dst;
+
+	memcpy(ptr, header, sizeof(header));
+	ptr += sizeof(header);
+	*ptr++ = 1;	/* final block, stored */
+	put_unaligned_le16(size, ptr);
+	put_unaligned_le16(~size, ptr + 2);
+	ptr += 4;
+	memcpy(ptr, data, size);
+	ptr += size;
+	put_unaligned_le32(0, ptr);
+	put_unaligned_le32(size, ptr + 4);
+	ptr += 8;
+
+	return ptr - dst;
+}
+
+/* Check that a gzip image with external data is loaded in chunks */
+static int spl_test_load_stream(struct unit_test_state *uts)
+{
+	ulong chunk = CONFIG_SPL_LOAD_FIT_STREAM_CHUNK_SIZE / 512;
+	struct stream_ctx stream_ctx;
+	struct spl_image_info image;
+	struct spl_load_info load;
+	int images, node, conf;
+	int pos, size, sectors;
+	u8 *fit, *data, *dst;
+	int i;
+
+	fit = map_sysmem(STREAM_FIT_ADDR, STREAM_FIT_SIZE + STREAM_DATA_SIZE);
+	data = map_sysmem(STREAM_DATA_ADDR, STREAM_DATA_SIZE);
+	dst = map_sysmem(STREAM_LOAD_ADDR, STREAM_DATA_SIZE);
+	for (i = 0; i < STREAM_DATA_SIZE; i++)
+		data[i] = i * 7 + (i >> 8);
+	memset(dst, '\0', STREAM_DATA_SIZE);
+
+	ut_assertok(fdt_create_empty_tree(fit, STREAM_FIT_SIZE));
+	images = fdt_add_subnode(fit, 0, "images");
+	ut_assert(images >= 0);
+	node = fdt_add_subnode(fit, images, "firmware-1");
+	ut_assert(node >= 0);
+	ut_assertok(fdt_setprop_string(fit, node, FIT_TYPE_PROP, "firmware"));
+	ut_assertok(fdt_setprop_string(fit, node, FIT_OS_PROP,
+				       "arm-trusted-firmware"));
+	ut_assertok(fdt_setprop_string(fit, node, FIT_COMP_PROP, "gzip"));
+	ut_assertok(fdt_setprop_u32(fit, node, FIT_LOAD_PROP,
+				    STREAM_LOAD_ADDR));
+	ut_assertok(fdt_setprop_u32(fit, node, FIT_DATA_POSITION_PROP, 0));
+	ut_assertok(fdt_setprop_u32(fit, node, FIT_DATA_SIZE_PROP, 0));
+
+	conf = fdt_add_subnode(fit, 0, "configurations");
+	ut_assert(conf >= 0);
+	ut_assertok(fdt_setprop_string(fit, conf, FIT_DEFAULT_PROP, "conf-1"));
+	conf = fdt_add_subnode(fit, conf, "conf-1");
+	ut_assert(conf >= 0);
+	ut_assertok(fdt_setprop_string(fit, conf, FIT_DESC_PROP, "stream"));
+	ut_assertok(fdt_setprop_string(fit, conf, FIT_FIRMWARE_PROP,
+				       "firmware-1"));
+	ut_assertok(fdt_pack(fit));
+
+	/* Put the data after the FIT, part-way into a sector */
+	pos = ALIGN(fdt_totalsize(fit), 4);
+	size = make_stored_gzip(fit + pos, data, STREAM_DATA_SIZE);
+	node = fdt_path_offset(fit, FIT_IMAGES_PATH "/firmware-1");
+	ut_assert(node >= 0);
+	ut_assertok(fdt_setprop_inplace_u32(fit, node, FIT_DATA_POSITION_PROP,
+					    pos));
+	ut_assertok(fdt_setprop_inplace_u32(fit, node, FIT_DATA_SIZE_PROP,
+					    size));
+
+	memset(&load, '\0', sizeof(load));
+	load.bl_len = 512;
+	load.read = read_stream_fit;
+	stream_ctx.fit = fit;
+	stream_ctx.reads = 0;
+	load.priv = &stream_ctx;
+
+	ut_assertok(spl_load_simple_fit(&image, &load, 0, fit));
+	ut_asserteq(STREAM_LOAD_ADDR, image.load_addr);
+	ut_asserteq(STREAM_DATA_SIZE, image.size);
+	ut_asserteq_mem(data, dst, STREAM_DATA_SIZE);
+
+	/* One read for the FIT, then one per chunk of the image data */
+	sectors = DIV_ROUND_UP(pos % 512 + size, 512);
+	ut_asserteq(1 + DIV_ROUND_UP(sectors, chunk), stream_ctx.reads);
+	ut_assert(stream_ctx.reads > 2);
+
+	unmap_sysmem(dst);
+	unmap_sysmem(data);
+	unmap_sysmem(fit);
+
+	return 0;
+}
+SPL_TEST(spl_test_load_stream, 0);
+#endif
@@ -196,6 +196,114 @@ static int lib_memmove(struct unit_test_state *uts)
 
 LIB_TEST(lib_memmove, 0);
 
+/**
+ * lib_memcmp() - unit test for memcmp()
+ *
+ * Test memcmp() with varied alignment and length of the compared buffers and
+ * with a difference at each position.
+ *
+ * @uts:	unit test state
+ * Return:	0 = success, 1 = failure
+ */
+static int lib_memcmp(struct unit_test_state *uts)
+{
+	u8 buf1[BUFLEN];
+	u8 buf2[BUFLEN];
+	int offset1, offset2, len, pos;
+	int ret;
+
+	init_buffer(buf1, MASK);
+
+	for (offset1 = 0; offset1 <= SWEEP; ++offset1) {
+		for (offset2 = 0; offset2 <= SWEEP; ++offset2) {
+			for (len = 1; len < BUFLEN - SWEEP; ++len) {
+				init_buffer(buf2, MASK);
+				memmove(buf2 + offset2, buf1 + offset1, len);
+				ut_asserteq(0, memcmp(buf1 + offset1,
+						      buf2 + offset2, len));
+
+				pos = (offset1 + offset2 + len) % len;
+				buf2[offset2 + pos] ^= 0x10;
+				ret = memcmp(buf1 + offset1, buf2 + offset2,
+					     len);
+				ut_assert(ret);
+				ut_asserteq(buf1[offset1 + pos] >
+					    buf2[offset2 + pos], ret > 0);
+				ut_asserteq(0, memcmp(buf1 + offset1,
+						      buf2 + offset2, pos));
+			}
+		}
+	}
+	return 0;
+}
+
+LIB_TEST(lib_memcmp, 0);
+
+/**
+ * lib_memchr() - unit test for memchr()
+ *
+ * Test memchr() with varied alignment and length of the searched buffer and
+ * with the byte at each position.
+ *
+ * @uts:	unit test state
+ * Return:	0 = success, 1 = failure
+ */
+static int lib_memchr(struct unit_test_state *uts)
+{
+	u8 buf[BUFLEN];
+	int offset, len, pos;
+
+	for (offset = 0; offset <= SWEEP; ++offset) {
+		for (len = 1; len < BUFLEN - SWEEP; ++len) {
+			memset(buf, 0, BUFLEN);
+			ut_assertnull(memchr(buf + offset, MASK, len));
+			for (pos = 0; pos < len; ++pos) {
+				buf[offset + pos] = MASK;
+				ut_asserteq_ptr(buf + offset + pos,
+						memchr(buf + offset, MASK,
+						       len));
+				/* the first occurrence must be found */
+				buf[offset + len - 1] = MASK;
+				ut_asserteq_ptr(buf + offset + pos,
+						memchr(buf + offset, MASK,
+						       len));
+				memset(buf, 0, BUFLEN);
+			}
+			/* a match just past the end must not be found */
+			buf[offset + len] = MASK;
+			ut_assertnull(memchr(buf + offset, MASK, len));
+		}
+	}
+	return 0;
+}
+
+LIB_TEST(lib_memchr, 0);
+
+/**
+ * lib_strlen() - unit test for strlen()
+ *
+ * Test strlen() with varied alignment and length of the string.
+ *
+ * @uts:	unit test state
+ * Return:	0 = success, 1 = failure
+ */
+static int lib_strlen(struct unit_test_state *uts)
+{
+	char buf[BUFLEN];
+	int offset, len;
+
+	for (offset = 0; offset <= SWEEP; ++offset) {
+		for (len = 0; len < BUFLEN - SWEEP; ++len) {
+			memset(buf, MASK, BUFLEN);
+			buf[offset + len] = '\0';
+			ut_asserteq(len, strlen(buf + offset));
+		}
+	}
+	return 0;
+}
+
+LIB_TEST(lib_strlen, 0);
+
 /** lib_memdup() - unit test for memdup() */
 static int lib_memdup(struct unit_test_state *uts)
 {
@@ -11,6 +11,7 @@
 #include <image.h>
 #include <log.h>
 #include <malloc.h>
+#include <time.h>
 
 #include <linux/sizes.h>
 
@@ -21,6 +22,9 @@
 /* 4k ought to be enough for anybody */
 #define FDT_COPY_SIZE	(4 * SZ_1K)
 
+/* Number of times fdt_overlay_repeat() applies the overlays */
+#define OVERLAY_REPEAT_COUNT	100
+
 extern u32 __dtb_test_fdt_base_begin;
 extern u32 __dtb_test_fdt_overlay_begin;
 extern u32 __dtb_test_fdt_overlay_stacked_begin;
@@ -211,6 +215,68 @@ static int fdt_overlay_stacked(struct unit_test_state *uts)
 }
 OVERLAY_TEST(fdt_overlay_stacked, 0);
 
+static int fdt_overlay_repeat_run(struct unit_test_state *uts, void *buf,
+				  int (*apply)(void *fdt, void *fdto),
+				  ulong *usp)
+{
+	void *fdt_base = &__dtb_test_fdt_base_begin;
+	void *fdt_overlay = &__dtb_test_fdt_overlay_begin;
+	void *fdt_overlay_stacked = &__dtb_test_fdt_overlay_stacked_begin;
+	void *tree = buf;
+	void *overlay = buf + FDT_COPY_SIZE;
+	void *stacked = buf + 2 * FDT_COPY_SIZE;
+	ulong start;
+	int i;
+
+	start = timer_get_us();
+	for (i = 0; i < OVERLAY_REPEAT_COUNT; i++) {
+		ut_assertok(fdt_open_into(fdt_base, tree, FDT_COPY_SIZE));
+		ut_assertok(fdt_open_into(fdt_overlay, overlay, FDT_COPY_SIZE));
+		ut_assertok(fdt_open_into(fdt_overlay_stacked, stacked,
+					  FDT_COPY_SIZE));
+
+		ut_assertok(apply(tree, overlay));
+		ut_assertok(apply(tree, stacked));
+
+		/* Each run must give the tree that the other tests check */
+		ut_asserteq_mem(fdt, tree, fdt_totalsize(fdt));
+	}
+	*usp = timer_get_us() - start;
+
+	return CMD_RET_SUCCESS;
+}
+
+static int fdt_overlay_repeat(struct unit_test_state *uts)
+{
+	ulong plain_us, verbose_us;
+	void *buf;
+	int ret;
+
+	buf = malloc(3 * FDT_COPY_SIZE);
+	ut_assertnonnull(buf);
+
+	ret = fdt_overlay_repeat_run(uts, buf, fdt_overlay_apply, &plain_us);
+	if (!ret)
+		ret = fdt_overlay_repeat_run(uts, buf, fdt_overlay_apply_verbose,
+					     &verbose_us);
+	free(buf);
+	if (ret)
+		return ret;
+
+	log_debug("%d runs: fdt_overlay_apply() %luus, fdt_overlay_apply_verbose() %luus\n",
+		  OVERLAY_REPEAT_COUNT, plain_us, verbose_us);
+
+	/*
+	 * Resolving the fixups before libfdt sees them should save about as
+	 * much as it costs, so fail if it has become much slower. The slack
+	 * allows for timer granularity and a busy host.
+	 */
+	ut_assert(verbose_us <= 2 * plain_us + 1000);
+
+	return CMD_RET_SUCCESS;
+}
+OVERLAY_TEST(fdt_overlay_repeat, 0);
+
 int do_ut_overlay(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 {
 	struct unit_test *tests = UNIT_TEST_SUITE_START(overlay_test);
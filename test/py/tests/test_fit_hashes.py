@@ -10,6 +10,7 @@ output of a fixed data block with known good hashes.
 This test doesn't run the sandbox. It only checks the host tool 'mkimage'
 """
 
+import os
 import pytest
 import u_boot_utils as util
 
@@ -109,3 +110,47 @@ def test_mkimage_hashes(u_boot_console):
         raise ValueError('FIT image has no "/image" nodes with "hash-..."')
 
     fit.verify_hashes()
+
+@pytest.mark.buildconfigspec('hash')
+@pytest.mark.requiredtool('dtc')
+def test_mkimage_hash_jobs(u_boot_console):
+    """ Test that hashing with several threads gives the same FIT image. """
+
+    def assemble_fit_image(dest_fit, its, jobs):
+        dtc_args = f'-I dts -O dtb -i {tempdir}'
+        util.run_and_log(cons, [mkimage, '-D', dtc_args, '-j', str(jobs),
+                                '-f', its, dest_fit])
+
+    cons = u_boot_console
+    mkimage = cons.config.build_dir + '/tools/mkimage'
+    datadir = cons.config.source_dir + '/test/py/tests/vboot/'
+    tempdir = cons.config.result_dir
+    its = f'{datadir}/hash-images.its'
+    util.run_and_log(cons, f'dtc {datadir}/sandbox-kernel.dts -O dtb -o '
+                           f'{tempdir}/sandbox-kernel.dtb')
+
+    with open(f'{tempdir}/test-kernel.bin', 'w') as fd:
+        fd.write(500 * chr(0xa5))
+
+    # Use a fixed timestamp so that the two images can be compared
+    old_epoch = os.environ.get('SOURCE_DATE_EPOCH')
+    os.environ['SOURCE_DATE_EPOCH'] = '1000'
+    try:
+        assemble_fit_image(f'{tempdir}/test-j1.fit', its, 1)
+        assemble_fit_image(f'{tempdir}/test-j4.fit', its, 4)
+    finally:
+        if old_epoch is None:
+            del os.environ['SOURCE_DATE_EPOCH']
+        else:
+            os.environ['SOURCE_DATE_EPOCH'] = old_epoch
+
+    with open(f'{tempdir}/test-j1.fit', 'rb') as fd:
+        single = fd.read()
+    with open(f'{tempdir}/test-j4.fit', 'rb') as fd:
+        multi = fd.read()
+    assert single == multi, 'FIT image differs when hashed with -j 4'
+
+    for jobs in ['0', '-1', '100000', 'x']:
+        util.run_and_log_expect_exception(
+            cons, [mkimage, '-j', jobs, '-f', its, f'{tempdir}/test-bad.fit'],
+            1, 'Invalid number of jobs')
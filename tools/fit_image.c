@@ -59,6 +59,9 @@ static int fit_add_file_data(struct image_tool_params *params, size_t size_inc,
 		ret = fit_set_timestamp(ptr, 0, time);
 	}
 
+	if (!ret)
+		ret = fit_add_decomp_offsets(ptr);
+
 	if (!ret) {
 		ret = fit_cipher_data(params->keydir, dest_blob, ptr,
 				      params->comment,
@@ -75,6 +78,7 @@ static int fit_add_file_data(struct image_tool_params *params, size_t size_inc,
 						params->engine_id,
 						params->cmdname,
 						params->algo_name,
+						params->jobs,
 						&params->summary);
 	}
 
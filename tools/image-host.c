@@ -13,6 +13,42 @@
 #include <fdt_region.h>
 #include <image.h>
 #include <version.h>
+#include <pthread.h>
+
+/**
+ * struct fit_hash_job - a sub-image hash calculated before it is written
+ *
+ * @data:	image data
+ * @size:	size of the image data in bytes
+ * @algo:	hash algorithm, or NULL if the hash node does not have one
+ * @value:	calculated hash value
+ * @value_len:	length of @value in bytes
+ * @ret:	0 if the hash was calculated, -1 if the algorithm is missing or
+ *		not supported
+ */
+struct fit_hash_job {
+	const void *data;
+	size_t size;
+	const char *algo;
+	uint8_t value[FIT_MAX_HASH_LEN];
+	int value_len;
+	int ret;
+};
+
+/**
+ * struct fit_hash_pool - hash jobs shared between worker threads
+ *
+ * @jobs:	jobs to run
+ * @count:	number of jobs
+ * @next:	next job to hand out
+ * @lock:	protects @next
+ */
+struct fit_hash_pool {
+	struct fit_hash_job *jobs;
+	int count;
+	int next;
+	pthread_mutex_t lock;
+};
 
 /**
  * fit_set_hash_value - set hash value in requested has node
@@ -55,12 +91,15 @@ static int fit_set_hash_value(void *fit, int noffset, uint8_t *value,
  * @noffset:	subnode offset
  * @data:	data to process
  * @size:	size of data in bytes
+ * @job:	hash already calculated for this node, or NULL to calculate it
  * Return: 0 if ok, -1 on error
  */
 static int fit_image_process_hash(void *fit, const char *image_name,
-		int noffset, const void *data, size_t size)
+		int noffset, const void *data, size_t size,
+		struct fit_hash_job *job)
 {
-	uint8_t value[FIT_MAX_HASH_LEN];
+	uint8_t buf[FIT_MAX_HASH_LEN];
+	uint8_t *value = buf;
 	const char *node_name;
 	int value_len;
 	const char *algo;
@@ -74,7 +113,14 @@ static int fit_image_process_hash(void *fit, const char *image_name,
 		return -ENOENT;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	if (job) {
+		ret = job->ret;
+		value = job->value;
+		value_len = job->value_len;
+	} else {
+		ret = calculate_hash(data, size, algo, value, &value_len);
+	}
+	if (ret) {
 		printf("Unsupported hash algorithm (%s) for '%s' hash node in '%s' image node\n",
 		       algo, node_name, image_name);
 		return -EPROTONOSUPPORT;
@@ -607,12 +653,15 @@ int fit_image_cipher_data(const char *keydir, void *keydest,
  * @comment:	Comment to add to signature nodes
  * @require_keys: Mark all keys as 'required'
  * @engine_id:	Engine to use for signing
+ * @jobp:	Cursor into the hashes calculated by fit_hash_images(), advanced
+ *		past each hash node, or NULL to calculate the hashes here
  * @return: 0 on success, <0 on failure
  */
-int fit_image_add_verification_data(const char *keydir, const char *keyfile,
+static int fit_image_add_data(const char *keydir, const char *keyfile,
 		void *keydest, void *fit, int image_noffset,
 		const char *comment, int require_keys, const char *engine_id,
-		const char *cmdname, const char* algo_name)
+		const char *cmdname, const char *algo_name,
+		struct fit_hash_job **jobp)
 {
 	const char *image_name;
 	const void *data;
@@ -643,7 +692,8 @@ int fit_image_add_verification_data(const char *keydir, const char *keyfile,
 		if (!strncmp(node_name, FIT_HASH_NODENAME,
 			     strlen(FIT_HASH_NODENAME))) {
 			ret = fit_image_process_hash(fit, image_name, noffset,
-						data, size);
+						data, size,
+						jobp ? (*jobp)++ : NULL);
 		} else if (IMAGE_ENABLE_SIGN && (keydir || keyfile) &&
 			   !strncmp(node_name, FIT_SIG_NODENAME,
 				strlen(FIT_SIG_NODENAME))) {
@@ -659,6 +709,213 @@ int fit_image_add_verification_data(const char *keydir, const char *keyfile,
 	return 0;
 }
 
+int fit_image_add_verification_data(const char *keydir, const char *keyfile,
+		void *keydest, void *fit, int image_noffset,
+		const char *comment, int require_keys, const char *engine_id,
+		const char *cmdname, const char* algo_name)
+{
+	return fit_image_add_data(keydir, keyfile, keydest, fit, image_noffset,
+				  comment, require_keys, engine_id, cmdname,
+				  algo_name, NULL);
+}
+
+static void *fit_hash_worker(void *arg)
+{
+	struct fit_hash_pool *pool = arg;
+	struct fit_hash_job *job;
+	int i;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+		if (i >= pool->count)
+			break;
+
+		job = &pool->jobs[i];
+		if (job->algo)
+			job->ret = calculate_hash(job->data, job->size,
+						  job->algo, job->value,
+						  &job->value_len);
+		else
+			job->ret = -1;
+	}
+
+	return NULL;
+}
+
+/**
+ * fit_hash_collect() - collect the hash nodes of all images
+ *
+ * This walks the images in the same order as fit_add_verification_data()
+ * and records one job for each hash node, so that the jobs can be handed
+ * out in order as the nodes are written.
+ *
+ * @fit:	Pointer to the FIT format image header
+ * @images_noffset: Offset of the /images node
+ * @jobs:	Array to fill in, or NULL to just count the hash nodes
+ * @return: number of hash nodes, or -1 if an image has no data
+ */
+static int fit_hash_collect(const void *fit, int images_noffset,
+			    struct fit_hash_job *jobs)
+{
+	int image_noffset, noffset;
+	const void *data;
+	size_t size;
+	int count = 0;
+
+	fdt_for_each_subnode(image_noffset, fit, images_noffset) {
+		if (fit_image_get_data(fit, image_noffset, &data, &size))
+			return -1;
+
+		fdt_for_each_subnode(noffset, fit, image_noffset) {
+			const char *node_name;
+
+			node_name = fit_get_name(fit, noffset, NULL);
+			if (strncmp(node_name, FIT_HASH_NODENAME,
+				    strlen(FIT_HASH_NODENAME)))
+				continue;
+			if (jobs) {
+				struct fit_hash_job *job = &jobs[count];
+
+				job->data = data;
+				job->size = size;
+				if (fit_image_hash_get_algo(fit, noffset,
+							    &job->algo))
+					job->algo = NULL;
+			}
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/**
+ * fit_hash_images() - calculate the hashes of all images in parallel
+ *
+ * The hashes are only calculated here. They are written to the FIT later,
+ * in the usual order, so that the output is the same as with a single
+ * thread.
+ *
+ * @fit:	Pointer to the FIT format image header
+ * @images_noffset: Offset of the /images node
+ * @jobs:	Number of threads to use
+ * @jobsp:	Returns the calculated hashes, one per hash node, which the
+ *		caller must free. This is NULL if there is nothing to do in
+ *		parallel, in which case the hashes are calculated as they are
+ *		written.
+ * @return: 0 if OK, -ENOMEM if out of memory
+ */
+static int fit_hash_images(const void *fit, int images_noffset, int jobs,
+			   struct fit_hash_job **jobsp)
+{
+	struct fit_hash_pool pool;
+	pthread_t *threads;
+	int started;
+	int count;
+	int i;
+
+	*jobsp = NULL;
+	count = fit_hash_collect(fit, images_noffset, NULL);
+	/* Let the serial path report any image without data */
+	if (count < 2 || jobs < 2)
+		return 0;
+
+	pool.jobs = calloc(count, sizeof(*pool.jobs));
+	if (!pool.jobs)
+		return -ENOMEM;
+	fit_hash_collect(fit, images_noffset, pool.jobs);
+	pool.count = count;
+	pool.next = 0;
+	pthread_mutex_init(&pool.lock, NULL);
+
+	if (jobs > count)
+		jobs = count;
+	threads = calloc(jobs - 1, sizeof(*threads));
+	started = 0;
+	/* If a thread cannot be started, the others pick up its share */
+	while (threads && started < jobs - 1) {
+		if (pthread_create(&threads[started], NULL, fit_hash_worker,
+				   &pool))
+			break;
+		started++;
+	}
+	fit_hash_worker(&pool);
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	free(threads);
+	pthread_mutex_destroy(&pool.lock);
+	*jobsp = pool.jobs;
+
+	return 0;
+}
+
+/**
+ * fit_image_add_decomp_offset() - add the decomp-offset property to an image
+ *
+ * Nothing is added if the image is not compressed, its compression type
+ * cannot be decompressed in place, or its header does not record the
+ * uncompressed size.
+ *
+ * @fit:	Pointer to the FIT format image header
+ * @image_noffset: Component image node
+ * @return: 0 if OK, -ENOSPC if the FIT needs to be expanded, -EIO on error
+ */
+static int fit_image_add_decomp_offset(void *fit, int image_noffset)
+{
+	const void *data;
+	size_t size;
+	ulong offset;
+	uint8_t comp;
+	int ret;
+
+	if (fit_image_get_comp(fit, image_noffset, &comp) ||
+	    comp == IH_COMP_NONE)
+		return 0;
+	if (fit_image_get_data(fit, image_noffset, &data, &size))
+		return 0;
+	if (image_decomp_offset(comp, data, size, &offset))
+		return 0;
+
+	ret = fdt_setprop_u32(fit, image_noffset, FIT_DECOMP_OFFSET_PROP,
+			      offset);
+	if (ret) {
+		printf("Can't set '%s' property for '%s' node (%s)\n",
+		       FIT_DECOMP_OFFSET_PROP,
+		       fit_get_name(fit, image_noffset, NULL),
+		       fdt_strerror(ret));
+		return ret == -FDT_ERR_NOSPACE ? -ENOSPC : -EIO;
+	}
+
+	return 0;
+}
+
+int fit_add_decomp_offsets(void *fit)
+{
+	int images_noffset;
+	int noffset;
+	int ret;
+
+	images_noffset = fdt_path_offset(fit, FIT_IMAGES_PATH);
+	if (images_noffset < 0) {
+		printf("Can't find images parent node '%s' (%s)\n",
+		       FIT_IMAGES_PATH, fdt_strerror(images_noffset));
+		return images_noffset;
+	}
+
+	for (noffset = fdt_first_subnode(fit, images_noffset);
+	     noffset >= 0;
+	     noffset = fdt_next_subnode(fit, noffset)) {
+		ret = fit_image_add_decomp_offset(fit, noffset);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
 struct strlist {
 	int count;
 	char **strings;
@@ -1150,8 +1407,9 @@ int fit_add_verification_data(const char *keydir, const char *keyfile,
 			      void *keydest, void *fit, const char *comment,
 			      int require_keys, const char *engine_id,
 			      const char *cmdname, const char *algo_name,
-			      struct image_summary *summary)
+			      int jobs, struct image_summary *summary)
 {
+	struct fit_hash_job *hash_jobs, *job;
 	int images_noffset, confs_noffset;
 	int noffset;
 	int ret;
@@ -1164,7 +1422,12 @@ int fit_add_verification_data(const char *keydir, const char *keyfile,
 		return images_noffset;
 	}
 
+	ret = fit_hash_images(fit, images_noffset, jobs, &hash_jobs);
+	if (ret)
+		return ret;
+
 	/* Process its subnodes, print out component images details */
+	job = hash_jobs;
 	for (noffset = fdt_first_subnode(fit, images_noffset);
 	     noffset >= 0;
 	     noffset = fdt_next_subnode(fit, noffset)) {
@@ -1172,12 +1435,16 @@ int fit_add_verification_data(const char *keydir, const char *keyfile,
 		 * Direct child node of the images parent node,
 		 * i.e. component image node.
 		 */
-		ret = fit_image_add_verification_data(keydir, keyfile, keydest,
-				fit, noffset, comment, require_keys, engine_id,
-				cmdname, algo_name);
-		if (ret)
+		ret = fit_image_add_data(keydir, keyfile, keydest, fit,
+					 noffset, comment, require_keys,
+					 engine_id, cmdname, algo_name,
+					 hash_jobs ? &job : NULL);
+		if (ret) {
+			free(hash_jobs);
 			return ret;
+		}
 	}
+	free(hash_jobs);
 
 	/* If there are no keys, we can't sign configurations */
 	if (!IMAGE_ENABLE_SIGN || !(keydir || keyfile))